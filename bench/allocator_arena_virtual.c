@@ -0,0 +1,185 @@
+/// benchmark: the malloc backed arena vs the virtual arena (reserved address
+/// space, committed lazily, optionally backed by huge pages), it fills the
+/// arena with small nodes, then chases pointers between them in random order,
+/// and reports page faults and dTLB misses (Linux only, perf_event_open could
+/// be denied by kernel.perf_event_paranoid, then n/a is printed)
+///
+/// usage: bench_allocator_arena_virtual [arena_size_mib] [steps_count]
+
+#include "anylibs/allocator.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+typedef struct Node Node;
+struct Node {
+  Node*    next;
+  uint64_t payload[7];
+};
+
+/// @brief arena allocations have a 16 bytes header
+#define NODE_FOOTPRINT (sizeof(Node) + 16)
+
+static long page_faults(void)
+{
+#ifdef __linux__
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt + usage.ru_majflt;
+#else
+  return 0;
+#endif
+}
+
+/// @return the perf event fd, or -1 if it is not supported
+static int dtlb_misses_open(void)
+{
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size           = sizeof(attr);
+  attr.type           = PERF_TYPE_HW_CACHE;
+  attr.config         = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled       = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+static long long dtlb_misses_read(int fd)
+{
+  long long count = -1;
+#ifdef __linux__
+  if (fd >= 0 && read(fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+#else
+  (void)fd;
+#endif
+  return count;
+}
+
+static void dtlb_misses_start(int fd)
+{
+#ifdef __linux__
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#else
+  (void)fd;
+#endif
+}
+
+static void dtlb_misses_stop(int fd)
+{
+#ifdef __linux__
+  if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#else
+  (void)fd;
+#endif
+}
+
+/// @brief allocate nodes_count nodes and link them in the order of perm
+static Node* fill(CAllocator* allocator, Node** nodes, size_t const* perm, size_t nodes_count)
+{
+  for (size_t iii = 0; iii < nodes_count; ++iii) {
+    nodes[iii] = c_allocator_alloc(allocator, c_allocator_alignas(Node, 1), false);
+    if (!nodes[iii]) return NULL;
+    nodes[iii]->payload[0] = iii;
+  }
+  for (size_t iii = 0; iii < nodes_count; ++iii) {
+    nodes[perm[iii]]->next = nodes[perm[(iii + 1) % nodes_count]];
+  }
+  return nodes[perm[0]];
+}
+
+static void run(char const* name, CAllocator* allocator, Node** nodes, size_t const* perm, size_t nodes_count, size_t steps_count, int perf_fd)
+{
+  if (!allocator) {
+    printf("%-28s failed to create the allocator\n", name);
+    return;
+  }
+
+  long   faults_before = page_faults();
+  double start         = c_bench_now();
+  Node*  node          = fill(allocator, nodes, perm, nodes_count);
+  double fill_time     = c_bench_now() - start;
+  long   fill_faults   = page_faults() - faults_before;
+  if (!node) {
+    printf("%-28s out of memory\n", name);
+    return;
+  }
+
+  uint64_t sum = 0;
+  dtlb_misses_start(perf_fd);
+  start = c_bench_now();
+  for (size_t iii = 0; iii < steps_count; ++iii) {
+    sum += node->payload[0];
+    node = node->next;
+  }
+  double    chase_time  = c_bench_now() - start;
+  long long dtlb_misses = dtlb_misses_read(perf_fd);
+  dtlb_misses_stop(perf_fd);
+
+  // reuse the arena, (released pages have to be faulted in again)
+  c_allocator_arena_reset(allocator);
+  faults_before      = page_faults();
+  node               = fill(allocator, nodes, perm, nodes_count);
+  long refill_faults = page_faults() - faults_before;
+
+  printf("%-28s fill %7.3fs %9ld faults | chase %7.3fs ", name, fill_time, fill_faults, chase_time);
+  if (dtlb_misses >= 0) {
+    printf("%12lld dTLB misses", dtlb_misses);
+  } else {
+    printf("%12s dTLB misses", "n/a");
+  }
+  printf(" | refill %9ld faults (%llu)\n", refill_faults, (unsigned long long)(sum + (node != NULL)));
+
+  c_allocator_arena_destroy(allocator);
+}
+
+int main(int argc, char** argv)
+{
+  size_t const arena_size  = c_bench_arg(argc, argv, 1, 1024) << 20;
+  size_t const steps_count = c_bench_arg(argc, argv, 2, (size_t)1 << 24);
+  size_t const nodes_count = arena_size / NODE_FOOTPRINT - 1;
+
+  Node**  nodes = malloc(nodes_count * sizeof(*nodes));
+  size_t* perm  = malloc(nodes_count * sizeof(*perm));
+  if (!nodes || !perm) return EXIT_FAILURE;
+
+  unsigned long long seed = 0x9E3779B97F4A7C15ULL;
+  for (size_t iii = 0; iii < nodes_count; ++iii) perm[iii] = iii;
+  for (size_t iii = nodes_count - 1; iii > 0; --iii) {
+    size_t jjj = c_bench_rand(&seed) % (iii + 1);
+    size_t tmp = perm[iii];
+    perm[iii]  = perm[jjj];
+    perm[jjj]  = tmp;
+  }
+
+  int perf_fd = dtlb_misses_open();
+  printf("%zu nodes (%zu MiB arena), %zu steps\n", nodes_count, arena_size >> 20, steps_count);
+
+  run("arena (malloc)", c_allocator_arena_create(arena_size), nodes, perm, nodes_count, steps_count, perf_fd);
+  run("arena virtual", c_allocator_arena_create_virtual(arena_size, C_ALLOCATOR_ARENA_FLAG_none), nodes, perm, nodes_count, steps_count, perf_fd);
+  run("arena virtual huge pages", c_allocator_arena_create_virtual(arena_size, C_ALLOCATOR_ARENA_FLAG_huge_pages), nodes, perm, nodes_count, steps_count, perf_fd);
+  run("arena virtual release reset", c_allocator_arena_create_virtual(arena_size, C_ALLOCATOR_ARENA_FLAG_huge_pages | C_ALLOCATOR_ARENA_FLAG_release_on_reset), nodes, perm, nodes_count, steps_count, perf_fd);
+
+#ifdef __linux__
+  if (perf_fd >= 0) close(perf_fd);
+#endif
+  free(perm);
+  free(nodes);
+  return EXIT_SUCCESS;
+}
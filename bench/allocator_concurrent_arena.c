@@ -0,0 +1,83 @@
+/// benchmark: threads allocating small objects from one shared arena, the
+/// concurrent arena (per-thread sub-chunks + atomic fetch-add) vs the arena
+/// guarded by a mutex, from 1 up to 64 threads
+///
+/// usage: bench_allocator_concurrent_arena [allocations_per_thread] [max_threads]
+
+#include "anylibs/allocator.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <threads.h>
+
+enum { MAX_THREADS = 64, OBJECT_SIZE = 32 };
+
+typedef struct Shared {
+  CAllocator* allocator;
+  mtx_t*      lock; ///< NULL for the concurrent arena
+  size_t      allocations_count;
+} Shared;
+
+static int worker(void* arg)
+{
+  Shared const* shared = arg;
+  for (size_t iii = 0; iii < shared->allocations_count; ++iii) {
+    if (shared->lock) mtx_lock(shared->lock);
+    uint64_t* obj = c_allocator_alloc_sized(shared->allocator, OBJECT_SIZE, 8, false);
+    if (shared->lock) mtx_unlock(shared->lock);
+    if (!obj) return 1;
+    obj[0] = iii;
+  }
+  return 0;
+}
+
+/// @return million allocations per second
+static double run(Shared* shared, size_t threads_count)
+{
+  thrd_t threads[MAX_THREADS];
+  double start = c_bench_now();
+  for (size_t iii = 0; iii < threads_count; ++iii) {
+    if (thrd_create(&threads[iii], worker, shared) != thrd_success) return 0.0;
+  }
+  int failed = 0;
+  for (size_t iii = 0; iii < threads_count; ++iii) {
+    int result;
+    thrd_join(threads[iii], &result);
+    failed |= result;
+  }
+  double elapsed = c_bench_now() - start;
+
+  return failed ? 0.0 : (double)(shared->allocations_count * threads_count) / elapsed / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+  size_t const allocations_count = c_bench_arg(argc, argv, 1, (size_t)1 << 20);
+  size_t       max_threads       = c_bench_arg(argc, argv, 2, MAX_THREADS);
+  if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+  // enough for all threads, including the lost tails of the sub-chunks
+  size_t const capacity = allocations_count * max_threads * OBJECT_SIZE * 2 + ((size_t)64 << 20);
+
+  mtx_t lock;
+  if (mtx_init(&lock, mtx_plain) != thrd_success) return EXIT_FAILURE;
+
+  printf("%zu allocations of %d bytes per thread (M allocations/s)\n", allocations_count, OBJECT_SIZE);
+  printf("%8s %18s %18s\n", "threads", "concurrent arena", "arena + mutex");
+  for (size_t threads_count = 1; threads_count <= max_threads; threads_count *= 2) {
+    Shared concurrent = {.allocator = c_allocator_concurrent_arena_create(capacity), .allocations_count = allocations_count};
+    Shared locked     = {.allocator = c_allocator_arena_create(capacity), .lock = &lock, .allocations_count = allocations_count};
+    if (!concurrent.allocator || !locked.allocator) return EXIT_FAILURE;
+
+    double concurrent_rate = run(&concurrent, threads_count);
+    double locked_rate     = run(&locked, threads_count);
+    printf("%8zu %18.1f %18.1f\n", threads_count, concurrent_rate, locked_rate);
+
+    c_allocator_concurrent_arena_destroy(concurrent.allocator);
+    c_allocator_arena_destroy(locked.allocator);
+  }
+
+  mtx_destroy(&lock);
+  return EXIT_SUCCESS;
+}
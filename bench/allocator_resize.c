@@ -0,0 +1,92 @@
+/// benchmark: growing a buffer (like c_vec_push does) through
+/// c_allocator_resize, which grows in place when it can, vs the old behavior
+/// (always allocate + copy + free)
+///
+/// usage: bench_allocator_resize [elements_count]
+
+#include "anylibs/allocator.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// same as C_ALLOCATOR_MMAP_THRESHOLD in src/allocator.c, above this the pages are remapped (not copied) on Linux
+#ifdef __linux__
+#define REMAP_THRESHOLD ((size_t)1 << 20)
+#else
+#define REMAP_THRESHOLD SIZE_MAX
+#endif
+
+int main(int argc, char** argv)
+{
+  size_t const elements_count = c_bench_arg(argc, argv, 1, (size_t)1 << 25);
+  CAllocator*  allocator      = c_allocator_default();
+
+  // [1] c_allocator_resize
+  size_t resizes_count = 0;
+  size_t moves_count   = 0;
+  size_t remaps_count  = 0;
+  size_t copied_bytes  = 0;
+
+  size_t    capacity = 1;
+  uint64_t* data     = c_allocator_alloc(allocator, c_allocator_alignas(uint64_t, capacity), false);
+  if (!data) return EXIT_FAILURE;
+
+  double start = c_bench_now();
+  for (uint64_t iii = 0; iii < elements_count; ++iii) {
+    if (iii == capacity) {
+      uint64_t* new_data = c_allocator_resize(allocator, data, capacity * 2 * sizeof(uint64_t));
+      if (!new_data) return EXIT_FAILURE;
+
+      resizes_count++;
+      if (new_data != data) {
+        if (capacity * sizeof(uint64_t) >= REMAP_THRESHOLD) {
+          remaps_count++;
+        } else {
+          moves_count++;
+          copied_bytes += capacity * sizeof(uint64_t);
+        }
+      }
+      data = new_data;
+      capacity *= 2;
+    }
+    data[iii] = iii;
+  }
+  double resize_time = c_bench_now() - start;
+  c_allocator_free(allocator, data);
+
+  // [2] the same growth sequence, always allocate + copy + free
+  size_t naive_copied_bytes = 0;
+
+  capacity = 1;
+  data     = c_allocator_alloc(allocator, c_allocator_alignas(uint64_t, capacity), false);
+  if (!data) return EXIT_FAILURE;
+
+  start = c_bench_now();
+  for (uint64_t iii = 0; iii < elements_count; ++iii) {
+    if (iii == capacity) {
+      uint64_t* new_data = c_allocator_alloc(allocator, c_allocator_alignas(uint64_t, capacity * 2), false);
+      if (!new_data) return EXIT_FAILURE;
+      memcpy(new_data, data, capacity * sizeof(uint64_t));
+      c_allocator_free(allocator, data);
+
+      naive_copied_bytes += capacity * sizeof(uint64_t);
+      data = new_data;
+      capacity *= 2;
+    }
+    data[iii] = iii;
+  }
+  double naive_time = c_bench_now() - start;
+  c_allocator_free(allocator, data);
+
+  printf("elements: %zu (%zu MiB), resizes: %zu\n", elements_count, (elements_count * sizeof(uint64_t)) >> 20, resizes_count);
+  printf("%-24s %10s %8s %8s %14s\n", "", "time (s)", "copies", "remaps", "copied (MiB)");
+  printf("%-24s %10.3f %8zu %8zu %14.1f\n", "c_allocator_resize", resize_time, moves_count, remaps_count, (double)copied_bytes / (1 << 20));
+  printf("%-24s %10.3f %8zu %8d %14.1f\n", "alloc + copy + free", naive_time, resizes_count, 0, (double)naive_copied_bytes / (1 << 20));
+  printf("copy bytes saved: %.1f MiB (%.1f%%)\n",
+         (double)(naive_copied_bytes - copied_bytes) / (1 << 20),
+         naive_copied_bytes ? 100.0 * (double)(naive_copied_bytes - copied_bytes) / (double)naive_copied_bytes : 0.0);
+
+  return EXIT_SUCCESS;
+}
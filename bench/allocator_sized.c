@@ -0,0 +1,73 @@
+/// benchmark: memory used by small objects allocated from an arena with
+/// c_allocator_alloc (16 bytes header per allocation) vs
+/// c_allocator_alloc_sized (no header), and the memory used by a map of small
+/// keys (which uses sized allocations internally)
+///
+/// usage: bench_allocator_sized [objects_count]
+
+#include "anylibs/allocator.h"
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+typedef struct Object {
+  uint64_t a;
+  uint64_t b;
+} Object;
+
+/// @brief the used bytes of a virtual arena (it is a single block)
+static size_t arena_used(CAllocator* arena)
+{
+  return c_allocator_arena_mark(arena).offset;
+}
+
+int main(int argc, char** argv)
+{
+  size_t const objects_count = c_bench_arg(argc, argv, 1, (size_t)1 << 22);
+  size_t const reserve_size  = objects_count * 64 + ((size_t)64 << 20);
+
+  // [1] c_allocator_alloc
+  CAllocator* arena = c_allocator_arena_create_virtual(reserve_size, C_ALLOCATOR_ARENA_FLAG_none);
+  if (!arena) return EXIT_FAILURE;
+
+  double start = c_bench_now();
+  for (size_t iii = 0; iii < objects_count; ++iii) {
+    Object* obj = c_allocator_alloc(arena, c_allocator_alignas(Object, 1), false);
+    if (!obj) return EXIT_FAILURE;
+    obj->a = iii;
+  }
+  double time_headered  = c_bench_now() - start;
+  size_t bytes_headered = arena_used(arena);
+  c_allocator_arena_reset(arena);
+
+  // [2] c_allocator_alloc_sized
+  start = c_bench_now();
+  for (size_t iii = 0; iii < objects_count; ++iii) {
+    Object* obj = c_allocator_alloc_sized(arena, c_allocator_alignas(Object, 1), false);
+    if (!obj) return EXIT_FAILURE;
+    obj->a = iii;
+  }
+  double time_sized  = c_bench_now() - start;
+  size_t bytes_sized = arena_used(arena);
+  c_allocator_arena_reset(arena);
+
+  printf("%zu objects of %zu bytes\n", objects_count, sizeof(Object));
+  printf("c_allocator_alloc       %7.3fs %10.2f MiB (%5.1f bytes/object)\n", time_headered, (double)bytes_headered / (1 << 20), (double)bytes_headered / (double)objects_count);
+  printf("c_allocator_alloc_sized %7.3fs %10.2f MiB (%5.1f bytes/object)\n", time_sized, (double)bytes_sized / (1 << 20), (double)bytes_sized / (double)objects_count);
+
+  // [3] map of small keys (with enough capacity, so no old buckets are left in the arena by resizing)
+  CHashMap* map = c_hashmap_create_with_capacity(sizeof(uint32_t), sizeof(uint32_t), objects_count / 2, arena);
+  if (!map) return EXIT_FAILURE;
+  for (uint32_t iii = 0; iii < objects_count / 4; ++iii) {
+    if (!c_hashmap_insert(map, &iii, &iii)) return EXIT_FAILURE;
+  }
+  printf("CHashMap<u32, u32> %zu entries, %zu capacity: %.2f MiB of arena (%.1f bytes/slot)\n",
+         c_hashmap_len(map), c_hashmap_capacity(map), (double)arena_used(arena) / (1 << 20),
+         (double)arena_used(arena) / (double)c_hashmap_capacity(map));
+
+  c_hashmap_destroy(map, NULL, NULL);
+  c_allocator_arena_destroy(arena);
+  return EXIT_SUCCESS;
+}
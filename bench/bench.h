@@ -0,0 +1,32 @@
+#ifndef ANYLIBS_BENCH_H
+#define ANYLIBS_BENCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/// @brief wall clock time in seconds
+static inline double c_bench_now(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+/// @brief get the positional argument at index as a number, or default_value if it doesn't exist
+static inline size_t c_bench_arg(int argc, char** argv, int index, size_t default_value)
+{
+  return (index < argc) ? (size_t)strtoull(argv[index], NULL, 10) : default_value;
+}
+
+/// @brief a cheap pseudo random generator (xorshift64*)
+static inline unsigned long long c_bench_rand(unsigned long long* state)
+{
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 2685821657736338717ULL;
+}
+
+#endif // ANYLIBS_BENCH_H
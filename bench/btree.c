@@ -0,0 +1,153 @@
+/// benchmark: a CBTreeMap of 8 bytes (timestamp like) keys and values: built
+/// by random inserts, by appends and from a sorted CVec, then lookups and range
+/// scans of 1000 keys (key by key, and leaf by leaf) vs a sorted CVec (lower
+/// bound with a binary search, then a scan)
+///
+/// usage: bench_btree [keys_count]
+
+#include "anylibs/btree.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+#define RANGE_LEN 1000U
+
+static int cmp_u64(void const* a, void const* b)
+{
+  uint64_t const x = *(uint64_t const*)a;
+  uint64_t const y = *(uint64_t const*)b;
+  return (x > y) - (x < y);
+}
+
+/// @brief the first index of keys whose key is >= key
+static size_t lower_bound(uint64_t const* keys, size_t keys_count, uint64_t key)
+{
+  size_t first = 0;
+  while (keys_count > 0) {
+    size_t half = keys_count / 2;
+    if (cmp_u64(&keys[first + half], &key) < 0) {
+      first += half + 1;
+      keys_count -= half + 1;
+    } else {
+      keys_count = half;
+    }
+  }
+  return first;
+}
+
+int main(int argc, char** argv)
+{
+  size_t const keys_count    = c_bench_arg(argc, argv, 1, (size_t)1 << 22);
+  size_t const queries_count = 100000;
+
+  // the keys are 10 * index (timestamps), shuffled for the random inserts
+  uint64_t* shuffled = malloc(keys_count * sizeof(*shuffled));
+  CVec*     keys     = c_vec_create_with_capacity(sizeof(uint64_t), keys_count, false, NULL);
+  if (!shuffled || !keys) return EXIT_FAILURE;
+  for (uint64_t iii = 0; iii < keys_count; ++iii) {
+    shuffled[iii] = iii * 10;
+    if (!c_vec_push(keys, &shuffled[iii])) return EXIT_FAILURE;
+  }
+  unsigned long long seed = 42;
+  for (size_t iii = keys_count - 1; iii > 0; --iii) {
+    size_t   jjj  = c_bench_rand(&seed) % (iii + 1);
+    uint64_t tmp  = shuffled[iii];
+    shuffled[iii] = shuffled[jjj];
+    shuffled[jjj] = tmp;
+  }
+
+  printf("%zu u64 keys (ns per key)\n", keys_count);
+
+  CBTreeMap* map = c_btree_map_create(sizeof(uint64_t), sizeof(uint64_t), cmp_u64, NULL);
+  if (!map) return EXIT_FAILURE;
+  double start = c_bench_now();
+  for (size_t iii = 0; iii < keys_count; ++iii) {
+    if (!c_btree_map_insert(map, &shuffled[iii], &shuffled[iii])) return EXIT_FAILURE;
+  }
+  printf("%-28s %8.1f\n", "insert (random order)", (c_bench_now() - start) * 1e9 / (double)keys_count);
+  c_btree_map_destroy(map, NULL, NULL);
+
+  map = c_btree_map_create(sizeof(uint64_t), sizeof(uint64_t), cmp_u64, NULL);
+  if (!map) return EXIT_FAILURE;
+  start = c_bench_now();
+  for (size_t iii = 0; iii < keys_count; ++iii) {
+    uint64_t* key = (uint64_t*)keys->data + iii;
+    if (!c_btree_map_insert(map, key, key)) return EXIT_FAILURE;
+  }
+  printf("%-28s %8.1f\n", "insert (appends)", (c_bench_now() - start) * 1e9 / (double)keys_count);
+  c_btree_map_destroy(map, NULL, NULL);
+
+  start = c_bench_now();
+  map   = c_btree_map_create_from_sorted(keys, keys, cmp_u64, NULL);
+  if (!map) return EXIT_FAILURE;
+  printf("%-28s %8.1f\n", "create_from_sorted", (c_bench_now() - start) * 1e9 / (double)keys_count);
+
+  // lookups of random keys (half of them exist)
+  size_t found = 0;
+  seed         = 7;
+  start        = c_bench_now();
+  for (size_t iii = 0; iii < queries_count; ++iii) {
+    uint64_t key = (c_bench_rand(&seed) % keys_count) * 10 + ((iii & 1) ? 5 : 0);
+    found += c_btree_map_has_key(map, &key);
+  }
+  double btree_lookup = (c_bench_now() - start) * 1e9 / (double)queries_count;
+
+  seed  = 7;
+  start = c_bench_now();
+  for (size_t iii = 0; iii < queries_count; ++iii) {
+    uint64_t key = (c_bench_rand(&seed) % keys_count) * 10 + ((iii & 1) ? 5 : 0);
+    found += c_vec_binary_find(keys, &key, cmp_u64, NULL);
+  }
+  double vec_lookup = (c_bench_now() - start) * 1e9 / (double)queries_count;
+
+  // range scans of RANGE_LEN keys from random timestamps
+  uint64_t sum   = 0;
+  size_t   from   = keys_count > RANGE_LEN ? keys_count - RANGE_LEN : 1;
+  double   ranges = (double)queries_count / 10;
+  seed            = 9;
+  start           = c_bench_now();
+  for (size_t iii = 0; iii < queries_count / 10; ++iii) {
+    uint64_t      first = (c_bench_rand(&seed) % from) * 10 + 3;
+    uint64_t      last  = first + (RANGE_LEN * 10);
+    uint64_t*     value;
+    CBTreeMapIter iter = c_btree_map_range(map, &first, &last);
+    while (c_btree_map_iter_next(&iter, NULL, (void**)&value)) sum += *value;
+  }
+  double btree_range = (c_bench_now() - start) * 1e9 / ranges;
+
+  seed  = 9;
+  start = c_bench_now();
+  for (size_t iii = 0; iii < queries_count / 10; ++iii) {
+    uint64_t      first = (c_bench_rand(&seed) % from) * 10 + 3;
+    uint64_t      last  = first + (RANGE_LEN * 10);
+    uint64_t*     values;
+    size_t        count;
+    CBTreeMapIter iter = c_btree_map_range(map, &first, &last);
+    while (c_btree_map_iter_next_chunk(&iter, NULL, (void**)&values, &count)) {
+      for (size_t jjj = 0; jjj < count; ++jjj) sum += values[jjj];
+    }
+  }
+  double btree_range_chunks = (c_bench_now() - start) * 1e9 / ranges;
+
+  seed  = 9;
+  start = c_bench_now();
+  for (size_t iii = 0; iii < queries_count / 10; ++iii) {
+    uint64_t        first = (c_bench_rand(&seed) % from) * 10 + 3;
+    uint64_t        last  = first + (RANGE_LEN * 10);
+    uint64_t const* data  = keys->data;
+    for (size_t jjj = lower_bound(data, keys_count, first); (jjj < keys_count) && (data[jjj] < last); ++jjj) sum += data[jjj];
+  }
+  double vec_range = (c_bench_now() - start) * 1e9 / ranges;
+
+  printf("\n%-28s %12s %12s\n", "(ns per op)", "CBTreeMap", "sorted CVec");
+  printf("%-28s %12.1f %12.1f\n", "lookup", btree_lookup, vec_lookup);
+  printf("%-28s %12.1f %12.1f\n", "range of 1000 keys", btree_range, vec_range);
+  printf("%-28s %12.1f\n", "  with iter_next_chunk", btree_range_chunks);
+  printf("(found %zu, sum %llu)\n", found, (unsigned long long)sum);
+
+  c_btree_map_destroy(map, NULL, NULL);
+  c_vec_destroy(keys);
+  free(shuffled);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/// benchmark: random lookups (all hits) of 8 bytes keys, a loop of
+/// c_hashmap_get vs c_hashmap_get_batch, and inserts, a loop of
+/// c_hashmap_insert vs c_hashmap_insert_batch, at 1K and 1M entries (and
+/// another count from the command line, like 100000000)
+///
+/// usage: bench_hashmap_batch [extra_entries_count] [lookups_count]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+enum { BATCH_SIZE = 256 };
+
+static void run(size_t entries_count, size_t lookups_count)
+{
+  uint64_t* keys    = malloc(entries_count * sizeof(*keys));
+  uint64_t* lookups = malloc(lookups_count * sizeof(*lookups));
+  void**    found   = malloc(BATCH_SIZE * sizeof(*found));
+  if (!keys || !lookups || !found) exit(EXIT_FAILURE);
+
+  unsigned long long seed = 42;
+  for (size_t iii = 0; iii < entries_count; ++iii) keys[iii] = c_bench_rand(&seed);
+  for (size_t iii = 0; iii < lookups_count; ++iii) lookups[iii] = keys[c_bench_rand(&seed) % entries_count];
+
+  // inserts
+  CHashMap* map = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  if (!map) exit(EXIT_FAILURE);
+  double start = c_bench_now();
+  for (size_t iii = 0; iii < entries_count; ++iii) {
+    if (!c_hashmap_insert(map, &keys[iii], &keys[iii])) exit(EXIT_FAILURE);
+  }
+  double insert_loop = c_bench_now() - start;
+  c_hashmap_destroy(map, NULL, NULL);
+
+  map = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  if (!map) exit(EXIT_FAILURE);
+  start = c_bench_now();
+  if (!c_hashmap_insert_batch(map, keys, keys, entries_count)) exit(EXIT_FAILURE);
+  double insert_batch = c_bench_now() - start;
+
+  // lookups
+  uint64_t sum = 0;
+  start        = c_bench_now();
+  for (size_t iii = 0; iii < lookups_count; ++iii) {
+    uint64_t* value = NULL;
+    c_hashmap_get(map, &lookups[iii], (void**)&value);
+    sum += *value;
+  }
+  double get_loop = c_bench_now() - start;
+
+  start = c_bench_now();
+  for (size_t first = 0; first < lookups_count; first += BATCH_SIZE) {
+    size_t count = (lookups_count - first) < BATCH_SIZE ? (lookups_count - first) : BATCH_SIZE;
+    c_hashmap_get_batch(map, &lookups[first], count, found);
+    for (size_t iii = 0; iii < count; ++iii) sum -= *(uint64_t*)found[iii];
+  }
+  double get_batch = c_bench_now() - start;
+
+  printf("%11zu entries: get %7.1f M/s, get_batch %7.1f M/s | insert %7.1f M/s, insert_batch %7.1f M/s%s\n", entries_count,
+         (double)lookups_count / get_loop / 1e6, (double)lookups_count / get_batch / 1e6,
+         (double)entries_count / insert_loop / 1e6, (double)entries_count / insert_batch / 1e6, sum ? " (mismatch)" : "");
+
+  c_hashmap_destroy(map, NULL, NULL);
+  free(keys);
+  free(lookups);
+  free(found);
+}
+
+int main(int argc, char** argv)
+{
+  size_t const extra_entries_count = c_bench_arg(argc, argv, 1, 0);
+  size_t const lookups_count       = c_bench_arg(argc, argv, 2, (size_t)1 << 24);
+
+  printf("%zu random lookups (hits), batches of %d keys\n", lookups_count, BATCH_SIZE);
+  run(1000, lookups_count);
+  run(1000000, lookups_count);
+  if (extra_entries_count) run(extra_entries_count, lookups_count);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+/// benchmark: building a map of 8 bytes keys and values from arrays, a loop of
+/// c_hashmap_insert (with the resizes) vs c_hashmap_build_from with 1 up to
+/// max_threads threads
+///
+/// usage: bench_hashmap_build [entries_count] [max_threads]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+int main(int argc, char** argv)
+{
+  size_t const entries_count = c_bench_arg(argc, argv, 1, (size_t)1 << 24);
+  size_t const max_threads   = c_bench_arg(argc, argv, 2, 16);
+
+  uint64_t* keys   = malloc(entries_count * sizeof(*keys));
+  uint64_t* values = malloc(entries_count * sizeof(*values));
+  if (!keys || !values) return EXIT_FAILURE;
+
+  unsigned long long seed = 42;
+  for (size_t iii = 0; iii < entries_count; ++iii) {
+    keys[iii]   = c_bench_rand(&seed);
+    values[iii] = iii;
+  }
+
+  CHashMap* map = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  if (!map) return EXIT_FAILURE;
+  double start = c_bench_now();
+  for (size_t iii = 0; iii < entries_count; ++iii) {
+    if (!c_hashmap_insert(map, &keys[iii], &values[iii])) return EXIT_FAILURE;
+  }
+  double insert_time = c_bench_now() - start;
+  c_hashmap_destroy(map, NULL, NULL);
+
+  printf("%zu entries\n", entries_count);
+  printf("%-24s %8.3f s\n", "c_hashmap_insert loop", insert_time);
+  for (size_t threads_count = 1; threads_count <= max_threads; threads_count *= 2) {
+    start          = c_bench_now();
+    map            = c_hashmap_build_from(keys, values, entries_count, sizeof(uint64_t), sizeof(uint64_t), threads_count, NULL, NULL);
+    double elapsed = c_bench_now() - start;
+    if (!map || (c_hashmap_len(map) != entries_count)) return EXIT_FAILURE;
+    printf("build_from %2zu threads    %8.3f s\n", threads_count, elapsed);
+    c_hashmap_destroy(map, NULL, NULL);
+  }
+
+  free(keys);
+  free(values);
+  return EXIT_SUCCESS;
+}
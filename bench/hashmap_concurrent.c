@@ -0,0 +1,110 @@
+/// benchmark: threads doing a read-mostly workload (1 insert every 20 ops) on
+/// one shared map, CConcurrentHashMap vs CHashMap guarded by a mutex, from 1
+/// up to 64 threads
+///
+/// usage: bench_hashmap_concurrent [entries_count] [ops_per_thread] [max_threads]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <threads.h>
+
+enum { MAX_THREADS = 64, WRITE_EVERY = 20 };
+
+typedef struct Shared {
+  CConcurrentHashMap* concurrent_map; ///< NULL for the locked map
+  CHashMap*           map;
+  mtx_t*              lock;
+  size_t              entries_count;
+  size_t              ops_count;
+} Shared;
+
+typedef struct Worker {
+  Shared const* shared;
+  uint64_t      seed;
+  uint64_t      found;
+} Worker;
+
+static int worker(void* arg)
+{
+  Worker*            self   = arg;
+  Shared const*      shared = self->shared;
+  unsigned long long seed   = self->seed;
+  for (size_t iii = 0; iii < shared->ops_count; ++iii) {
+    uint64_t key   = c_bench_rand(&seed) % (shared->entries_count * 2);
+    uint64_t value = key;
+    if (iii % WRITE_EVERY == 0) {
+      if (shared->concurrent_map) {
+        c_concurrent_hashmap_insert(shared->concurrent_map, &key, &value);
+      } else {
+        mtx_lock(shared->lock);
+        c_hashmap_insert(shared->map, &key, &value);
+        mtx_unlock(shared->lock);
+      }
+    } else {
+      if (shared->concurrent_map) {
+        self->found += c_concurrent_hashmap_get(shared->concurrent_map, &key, &value);
+      } else {
+        uint64_t* found = NULL;
+        mtx_lock(shared->lock);
+        c_hashmap_get(shared->map, &key, (void**)&found);
+        if (found) value = *found;
+        mtx_unlock(shared->lock);
+        self->found += found != NULL;
+      }
+    }
+  }
+  return 0;
+}
+
+/// @return million ops per second
+static double run(Shared const* shared, size_t threads_count)
+{
+  thrd_t threads[MAX_THREADS];
+  Worker workers[MAX_THREADS];
+  double start = c_bench_now();
+  for (size_t iii = 0; iii < threads_count; ++iii) {
+    workers[iii] = (Worker){.shared = shared, .seed = iii + 1};
+    if (thrd_create(&threads[iii], worker, &workers[iii]) != thrd_success) return 0.0;
+  }
+  for (size_t iii = 0; iii < threads_count; ++iii) thrd_join(threads[iii], NULL);
+  double elapsed = c_bench_now() - start;
+
+  return (double)(shared->ops_count * threads_count) / elapsed / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+  size_t const entries_count = c_bench_arg(argc, argv, 1, (size_t)1 << 20);
+  size_t const ops_count     = c_bench_arg(argc, argv, 2, (size_t)1 << 20);
+  size_t       max_threads   = c_bench_arg(argc, argv, 3, MAX_THREADS);
+  if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+  mtx_t lock;
+  if (mtx_init(&lock, mtx_plain) != thrd_success) return EXIT_FAILURE;
+
+  Shared concurrent = {.concurrent_map = c_concurrent_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), 0, NULL, NULL), .entries_count = entries_count, .ops_count = ops_count};
+  Shared locked     = {.map = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL), .lock = &lock, .entries_count = entries_count, .ops_count = ops_count};
+  if (!concurrent.concurrent_map || !locked.map) return EXIT_FAILURE;
+
+  // half of the lookups hit
+  for (uint64_t key = 0; key < entries_count * 2; key += 2) {
+    if (!c_concurrent_hashmap_insert(concurrent.concurrent_map, &key, &key)) return EXIT_FAILURE;
+    if (!c_hashmap_insert(locked.map, &key, &key)) return EXIT_FAILURE;
+  }
+
+  printf("%zu entries, %zu ops per thread, 1 insert every %d ops (M ops/s)\n", entries_count, ops_count, WRITE_EVERY);
+  printf("%8s %22s %18s\n", "threads", "CConcurrentHashMap", "CHashMap + mutex");
+  for (size_t threads_count = 1; threads_count <= max_threads; threads_count *= 2) {
+    double concurrent_rate = run(&concurrent, threads_count);
+    double locked_rate     = run(&locked, threads_count);
+    printf("%8zu %22.1f %18.1f\n", threads_count, concurrent_rate, locked_rate);
+  }
+
+  c_concurrent_hashmap_destroy(concurrent.concurrent_map, NULL, NULL);
+  c_hashmap_destroy(locked.map, NULL, NULL);
+  mtx_destroy(&lock);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,52 @@
+/// benchmark: counting keys (a histogram of random 8 bytes keys), with
+/// c_hashmap_get + c_hashmap_insert vs c_hashmap_entry
+///
+/// usage: bench_hashmap_entry [distinct_keys_count] [ops_count]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+int main(int argc, char** argv)
+{
+  size_t const keys_count = c_bench_arg(argc, argv, 1, (size_t)1 << 20);
+  size_t const ops_count  = c_bench_arg(argc, argv, 2, (size_t)1 << 24);
+
+  CHashMap* map1 = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  CHashMap* map2 = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  if (!map1 || !map2) return EXIT_FAILURE;
+
+  unsigned long long seed  = 42;
+  double             start = c_bench_now();
+  for (size_t iii = 0; iii < ops_count; ++iii) {
+    uint64_t  key   = c_bench_rand(&seed) % keys_count;
+    uint64_t* count = NULL;
+    c_hashmap_get(map1, &key, (void**)&count);
+    if (count) {
+      *count += 1;
+    } else if (!c_hashmap_insert(map1, &key, &(uint64_t){1})) {
+      return EXIT_FAILURE;
+    }
+  }
+  double get_insert_time = c_bench_now() - start;
+
+  seed  = 42;
+  start = c_bench_now();
+  for (size_t iii = 0; iii < ops_count; ++iii) {
+    uint64_t  key   = c_bench_rand(&seed) % keys_count;
+    uint64_t* count = NULL;
+    if (!c_hashmap_entry(map2, &key, (void**)&count, NULL)) return EXIT_FAILURE;
+    *count += 1;
+  }
+  double entry_time = c_bench_now() - start;
+
+  printf("%zu increments over %zu distinct keys (%zu/%zu counted)\n", ops_count, keys_count, c_hashmap_len(map1), c_hashmap_len(map2));
+  printf("get + insert %7.1f ns/op\n", get_insert_time * 1e9 / (double)ops_count);
+  printf("entry        %7.1f ns/op\n", entry_time * 1e9 / (double)ops_count);
+
+  c_hashmap_destroy(map1, NULL, NULL);
+  c_hashmap_destroy(map2, NULL, NULL);
+  return EXIT_SUCCESS;
+}
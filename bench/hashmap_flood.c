@@ -0,0 +1,76 @@
+/// benchmark: inserts and lookups of 32 bytes keys that are crafted to collide
+/// under a multiply-based hash (the 8 bytes that are multiplied by a secret of
+/// the hash are set to that secret, which zeroes the product whatever the seed
+/// is) vs random keys, with the default hash and with SipHash
+///
+/// usage: bench_hashmap_flood [keys_count]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct Key {
+  uint64_t words[4];
+} Key;
+
+/// @return ns per op of the inserts, and of the lookups in out_lookup_time
+static double run(Key const* keys, size_t keys_count, CHashMapHashFn hash_fn, double* out_lookup_time)
+{
+  CHashMap* map = c_hashmap_create_ex(sizeof(Key), sizeof(uint64_t), 16, &(CHashMapOptions){.hash_fn = hash_fn}, NULL);
+  if (!map) exit(EXIT_FAILURE);
+
+  double start = c_bench_now();
+  for (uint64_t iii = 0; iii < keys_count; ++iii) {
+    if (!c_hashmap_insert(map, (void*)&keys[iii], &iii)) exit(EXIT_FAILURE);
+  }
+  double insert_time = c_bench_now() - start;
+
+  uint64_t found = 0;
+  start          = c_bench_now();
+  for (size_t iii = 0; iii < keys_count; ++iii) {
+    uint64_t* value = NULL;
+    c_hashmap_get(map, (void*)&keys[iii], (void**)&value);
+    found += (value != NULL);
+  }
+  *out_lookup_time = (c_bench_now() - start) * 1e9 / (double)keys_count;
+  if (found != keys_count) exit(EXIT_FAILURE);
+
+  c_hashmap_destroy(map, NULL, NULL);
+  return insert_time * 1e9 / (double)keys_count;
+}
+
+int main(int argc, char** argv)
+{
+  size_t const keys_count = c_bench_arg(argc, argv, 1, (size_t)1 << 16);
+
+  Key* random  = malloc(keys_count * sizeof(Key));
+  Key* crafted = malloc(keys_count * sizeof(Key));
+  if (!random || !crafted) return EXIT_FAILURE;
+
+  unsigned long long seed = 42;
+  for (size_t iii = 0; iii < keys_count; ++iii) {
+    for (size_t jjj = 0; jjj < 4; ++jjj) random[iii].words[jjj] = c_bench_rand(&seed);
+    // the last 16 bytes are mixed as (words[2] ^ secret) * (words[3] ^ seed)
+    crafted[iii] = (Key){.words = {iii, c_bench_rand(&seed), 0xE7037ED1A0B428DBULL, c_bench_rand(&seed)}};
+  }
+
+  printf("%zu keys of %zu bytes (ns/op)\n", keys_count, sizeof(Key));
+  printf("%-24s %10s %10s\n", "", "insert", "lookup");
+
+  CHashMapHashFn const hash_fns[]   = {c_hashmap_hash_bytes, c_hashmap_hash_siphash};
+  char const* const    hash_names[] = {"default", "siphash"};
+  for (size_t iii = 0; iii < 2; ++iii) {
+    double lookup_time;
+    double insert_time = run(random, keys_count, hash_fns[iii], &lookup_time);
+    printf("%-8s %-15s %10.1f %10.1f\n", hash_names[iii], "random keys", insert_time, lookup_time);
+    insert_time = run(crafted, keys_count, hash_fns[iii], &lookup_time);
+    printf("%-8s %-15s %10.1f %10.1f\n", hash_names[iii], "crafted keys", insert_time, lookup_time);
+  }
+
+  free(random);
+  free(crafted);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+/// benchmark: a CHashMap vs the CFrozenMap built from it (8 bytes keys and
+/// values): the memory of the tables, the build time of the frozen map, and
+/// lookups (hits and misses) in random order
+///
+/// usage: bench_hashmap_frozen [entries_count] [lookups_count]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+int main(int argc, char** argv)
+{
+  size_t const entries_count = c_bench_arg(argc, argv, 1, (size_t)1 << 20);
+  size_t const lookups_count = c_bench_arg(argc, argv, 2, (size_t)1 << 22);
+
+  // odd keys are inserted, even keys are used for misses
+  CHashMap* map = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  if (!map) return EXIT_FAILURE;
+  for (uint64_t iii = 0; iii < entries_count; ++iii) {
+    uint64_t key = (iii * 2) + 1;
+    if (!c_hashmap_insert(map, &key, &iii)) return EXIT_FAILURE;
+  }
+
+  double      start       = c_bench_now();
+  CFrozenMap* frozen      = c_hashmap_freeze(map, NULL);
+  double      freeze_time = c_bench_now() - start;
+  if (!frozen) return EXIT_FAILURE;
+
+  // the tables: a control byte and a 16 bytes slot for each slot of the map,
+  // a slot for each key and 8 bytes of displacements for each 4 keys of the
+  // frozen map
+  double map_bytes    = (double)(c_hashmap_capacity(map) * 17) / (double)entries_count;
+  double frozen_bytes = (double)((entries_count * 16) + (((entries_count + 3) / 4) * 8)) / (double)entries_count;
+
+  printf("%zu entries, %zu lookups, freeze %.1f ms\n", entries_count, lookups_count, freeze_time * 1e3);
+  printf("%-10s %12s %12s %12s\n", "", "bytes/entry", "hit ns/op", "miss ns/op");
+
+  uint64_t found = 0;
+  for (int frozen_index = 0; frozen_index < 2; ++frozen_index) {
+    unsigned long long seed = 42;
+    double             times[2];
+    for (int miss = 0; miss < 2; ++miss) {
+      start = c_bench_now();
+      for (size_t iii = 0; iii < lookups_count; ++iii) {
+        uint64_t  key   = ((c_bench_rand(&seed) % entries_count) * 2) + (miss ? 0 : 1);
+        uint64_t* value = NULL;
+        if (frozen_index) {
+          c_frozen_map_get(frozen, &key, (void**)&value);
+        } else {
+          c_hashmap_get(map, &key, (void**)&value);
+        }
+        found += (value != NULL);
+      }
+      times[miss] = (c_bench_now() - start) * 1e9 / (double)lookups_count;
+    }
+    printf("%-10s %12.1f %12.1f %12.1f\n", frozen_index ? "CFrozenMap" : "CHashMap", frozen_index ? frozen_bytes : map_bytes, times[0], times[1]);
+  }
+  printf("(found %llu)\n", (unsigned long long)found);
+
+  c_frozen_map_destroy(frozen);
+  c_hashmap_destroy(map, NULL, NULL);
+  return EXIT_SUCCESS;
+}
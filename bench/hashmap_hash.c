@@ -0,0 +1,93 @@
+/// benchmark: the default hash (8 bytes at a time) vs byte-wise FNV-1a for
+/// different key lengths, and lookups of 8 bytes keys through the specialized
+/// path vs the generic one (custom eq fn)
+///
+/// usage: bench_hashmap_hash [bytes_per_length] [entries_count]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static uint64_t fnv1a(void const* key, size_t key_size, uint64_t seed)
+{
+  uint8_t const* bytes = key;
+  uint64_t       hash  = 14695981039346656037ULL ^ seed;
+  for (size_t iii = 0; iii < key_size; ++iii) {
+    hash ^= bytes[iii];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static bool eq_bytes(void const* key1, void const* key2, size_t key_size)
+{
+  return memcmp(key1, key2, key_size) == 0;
+}
+
+/// @return GiB per second
+static double hash_rate(CHashMapHashFn hash_fn, uint8_t const* data, size_t key_len, size_t total_bytes, uint64_t* sink)
+{
+  size_t count = total_bytes / key_len;
+  double start = c_bench_now();
+  for (size_t iii = 0; iii < count; ++iii) {
+    *sink += hash_fn(data + (iii & 1023), key_len, *sink);
+  }
+  return (double)(count * key_len) / (c_bench_now() - start) / (double)(1 << 30);
+}
+
+/// @return ns per lookup
+static double lookup_time(CHashMapOptions const* options, size_t entries_count, uint64_t* sink)
+{
+  CHashMap* map = c_hashmap_create_ex(sizeof(uint64_t), sizeof(uint64_t), entries_count, options, NULL);
+  if (!map) exit(EXIT_FAILURE);
+  for (uint64_t iii = 0; iii < entries_count; ++iii) {
+    if (!c_hashmap_insert(map, &iii, &iii)) exit(EXIT_FAILURE);
+  }
+
+  unsigned long long seed          = 42;
+  size_t const       lookups_count = entries_count * 4;
+  double             start         = c_bench_now();
+  for (size_t iii = 0; iii < lookups_count; ++iii) {
+    uint64_t  key   = c_bench_rand(&seed) % (entries_count * 2);
+    uint64_t* value = NULL;
+    c_hashmap_get(map, &key, (void**)&value);
+    *sink += value ? *value : 0;
+  }
+  double elapsed = c_bench_now() - start;
+
+  c_hashmap_destroy(map, NULL, NULL);
+  return elapsed * 1e9 / (double)lookups_count;
+}
+
+int main(int argc, char** argv)
+{
+  size_t const total_bytes   = c_bench_arg(argc, argv, 1, (size_t)1 << 28);
+  size_t const entries_count = c_bench_arg(argc, argv, 2, (size_t)1 << 16);
+
+  static uint8_t data[1024 + 4096];
+  for (size_t iii = 0; iii < sizeof(data); ++iii) data[iii] = (uint8_t)(iii * 31);
+
+  uint64_t     sink      = 0;
+  size_t const lengths[] = {4, 8, 16, 32, 64, 256, 4096};
+  printf("hashing %zu bytes per length (GiB/s)\n", total_bytes);
+  printf("%8s %12s %12s\n", "key len", "default", "FNV-1a");
+  for (size_t iii = 0; iii < sizeof(lengths) / sizeof(*lengths); ++iii) {
+    double fast = hash_rate(c_hashmap_hash_bytes, data, lengths[iii], total_bytes, &sink);
+    double fnv  = hash_rate(fnv1a, data, lengths[iii], total_bytes, &sink);
+    printf("%8zu %12.2f %12.2f\n", lengths[iii], fast, fnv);
+  }
+
+  double specialized = lookup_time(NULL, entries_count, &sink);
+  double generic     = lookup_time(&(CHashMapOptions){.eq_fn = eq_bytes}, entries_count, &sink);
+  double generic_fnv = lookup_time(&(CHashMapOptions){.hash_fn = fnv1a, .eq_fn = eq_bytes}, entries_count, &sink);
+  printf("u64 lookups, %zu entries (ns/op)\n", entries_count);
+  printf("specialized         %7.1f\n", specialized);
+  printf("generic             %7.1f\n", generic);
+  printf("generic (FNV-1a)    %7.1f\n", generic_fnv);
+  printf("(sink %llu)\n", (unsigned long long)sink);
+
+  return EXIT_SUCCESS;
+}
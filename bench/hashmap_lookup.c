@@ -0,0 +1,56 @@
+/// benchmark: CHashMap lookups (hits and misses) in random order, with
+/// 8 bytes keys and values
+///
+/// usage: bench_hashmap_lookup [entries_count] [lookups_count]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+int main(int argc, char** argv)
+{
+  size_t const entries_count = c_bench_arg(argc, argv, 1, (size_t)1 << 20);
+  size_t const lookups_count = c_bench_arg(argc, argv, 2, (size_t)1 << 22);
+
+  CHashMap* map = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  if (!map) return EXIT_FAILURE;
+
+  // odd keys are inserted, even keys are used for misses
+  unsigned long long seed  = 42;
+  double             start = c_bench_now();
+  for (uint64_t iii = 0; iii < entries_count; ++iii) {
+    uint64_t key = (iii * 2) + 1;
+    if (!c_hashmap_insert(map, &key, &iii)) return EXIT_FAILURE;
+  }
+  double insert_time = c_bench_now() - start;
+
+  uint64_t found = 0;
+  start          = c_bench_now();
+  for (size_t iii = 0; iii < lookups_count; ++iii) {
+    uint64_t  key   = ((c_bench_rand(&seed) % entries_count) * 2) + 1;
+    uint64_t* value = NULL;
+    c_hashmap_get(map, &key, (void**)&value);
+    found += (value != NULL);
+  }
+  double hit_time = c_bench_now() - start;
+
+  start = c_bench_now();
+  for (size_t iii = 0; iii < lookups_count; ++iii) {
+    uint64_t  key   = (c_bench_rand(&seed) % entries_count) * 2;
+    uint64_t* value = NULL;
+    c_hashmap_get(map, &key, (void**)&value);
+    found += (value != NULL);
+  }
+  double miss_time = c_bench_now() - start;
+
+  printf("%zu entries (capacity %zu), %zu lookups\n", entries_count, c_hashmap_capacity(map), lookups_count);
+  printf("insert %7.1f ns/op\n", insert_time * 1e9 / (double)entries_count);
+  printf("hit    %7.1f ns/op\n", hit_time * 1e9 / (double)lookups_count);
+  printf("miss   %7.1f ns/op\n", miss_time * 1e9 / (double)lookups_count);
+  printf("(found %llu)\n", (unsigned long long)found);
+
+  c_hashmap_destroy(map, NULL, NULL);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+/// benchmark: the latency of each insert while a map grows from empty, with
+/// the stop-the-world resize vs the incremental resize, as a histogram
+/// (power of 2 buckets) and percentiles
+///
+/// usage: bench_hashmap_resize_latency [entries_count]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+enum { BUCKETS_COUNT = 40 };
+
+static int compare_u32(void const* a, void const* b)
+{
+  uint32_t x = *(uint32_t const*)a, y = *(uint32_t const*)b;
+  return (x > y) - (x < y);
+}
+
+static void run(char const* name, bool incremental_resize, size_t entries_count, uint32_t* latencies)
+{
+  CHashMapOptions options = {.incremental_resize = incremental_resize};
+  CHashMap*       map     = c_hashmap_create_ex(sizeof(uint64_t), sizeof(uint64_t), 16, &options, NULL);
+  if (!map) exit(EXIT_FAILURE);
+
+  unsigned long long seed  = 42;
+  double             total = c_bench_now();
+  for (size_t iii = 0; iii < entries_count; ++iii) {
+    uint64_t key   = c_bench_rand(&seed);
+    double   start = c_bench_now();
+    if (!c_hashmap_insert(map, &key, &key)) exit(EXIT_FAILURE);
+    double ns      = (c_bench_now() - start) * 1e9;
+    latencies[iii] = ns < (double)UINT32_MAX ? (uint32_t)ns : UINT32_MAX;
+  }
+  total = c_bench_now() - total;
+
+  size_t histogram[BUCKETS_COUNT] = {0};
+  for (size_t iii = 0; iii < entries_count; ++iii) {
+    size_t bucket = 0;
+    while ((bucket < BUCKETS_COUNT - 1) && ((uint64_t)latencies[iii] >> (bucket + 1))) bucket++;
+    histogram[bucket]++;
+  }
+  qsort(latencies, entries_count, sizeof(*latencies), compare_u32);
+
+  printf("%s: %zu inserts in %.3fs\n", name, entries_count, total);
+  printf("  p50 %uns, p99 %uns, p99.9 %uns, p99.99 %uns, max %.3fms\n",
+         latencies[entries_count / 2], latencies[entries_count / 100 * 99], latencies[entries_count / 1000 * 999],
+         latencies[entries_count / 10000 * 9999], (double)latencies[entries_count - 1] / 1e6);
+  for (size_t bucket = 0; bucket < BUCKETS_COUNT; ++bucket) {
+    if (histogram[bucket]) printf("  [%12llu ns, ...) %10zu\n", bucket ? 1ULL << bucket : 0ULL, histogram[bucket]);
+  }
+
+  c_hashmap_destroy(map, NULL, NULL);
+}
+
+int main(int argc, char** argv)
+{
+  size_t const entries_count = c_bench_arg(argc, argv, 1, (size_t)1 << 24);
+  if (entries_count < 10000) return EXIT_FAILURE;
+
+  uint32_t* latencies = malloc(entries_count * sizeof(*latencies));
+  if (!latencies) return EXIT_FAILURE;
+
+  run("stop-the-world resize", false, entries_count, latencies);
+  run("incremental resize", true, entries_count, latencies);
+
+  free(latencies);
+  return EXIT_SUCCESS;
+}
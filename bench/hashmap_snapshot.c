@@ -0,0 +1,63 @@
+/// benchmark: the startup of a map of 8 bytes keys and values, rebuilt by
+/// inserting all the entries vs opened from a snapshot with
+/// c_hashmap_open_mmap (then a batch of random lookups, which loads the
+/// touched pages)
+///
+/// usage: bench_hashmap_snapshot [entries_count] [lookups_count]
+
+#include "anylibs/fs.h"
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+int main(int argc, char** argv)
+{
+  size_t const entries_count = c_bench_arg(argc, argv, 1, (size_t)1 << 22);
+  size_t const lookups_count = c_bench_arg(argc, argv, 2, (size_t)1 << 16);
+  CStr const   path          = CSTR("bench_hashmap_snapshot.bin");
+
+  double    start = c_bench_now();
+  CHashMap* map   = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  if (!map) return EXIT_FAILURE;
+  for (uint64_t iii = 0; iii < entries_count; ++iii) {
+    uint64_t key = iii * 0x9E3779B97F4A7C15ULL;
+    if (!c_hashmap_insert(map, &key, &iii)) return EXIT_FAILURE;
+  }
+  double build_time = c_bench_now() - start;
+
+  CFile* f = c_fs_file_open(path, CSTR("wb"));
+  if (!f) return EXIT_FAILURE;
+  start = c_bench_now();
+  if (!c_hashmap_save(map, f)) return EXIT_FAILURE;
+  c_fs_file_close(f);
+  double save_time = c_bench_now() - start;
+  c_hashmap_destroy(map, NULL, NULL);
+
+  start = c_bench_now();
+  map   = c_hashmap_open_mmap(path, NULL, NULL);
+  if (!map) return EXIT_FAILURE;
+  double open_time = c_bench_now() - start;
+
+  unsigned long long seed  = 42;
+  uint64_t           found = 0;
+  start                    = c_bench_now();
+  for (size_t iii = 0; iii < lookups_count; ++iii) {
+    uint64_t  key   = (c_bench_rand(&seed) % entries_count) * 0x9E3779B97F4A7C15ULL;
+    uint64_t* value = NULL;
+    c_hashmap_get(map, &key, (void**)&value);
+    found += (value != NULL);
+  }
+  double lookup_time = c_bench_now() - start;
+
+  printf("%zu entries (capacity %zu)\n", entries_count, c_hashmap_capacity(map));
+  printf("rebuild             %9.3f ms\n", build_time * 1e3);
+  printf("save                %9.3f ms\n", save_time * 1e3);
+  printf("open_mmap           %9.3f ms\n", open_time * 1e3);
+  printf("first %zu lookups %9.3f ms (found %llu)\n", lookups_count, lookup_time * 1e3, (unsigned long long)found);
+
+  c_hashmap_destroy(map, NULL, NULL);
+  c_fs_delete(path);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/// benchmark: CHashMap with 8 bytes keys and 256 bytes values, the
+/// interleaved [key, value] slots vs the split keys/values arrays: lookups
+/// (hits and misses) in random order, and an iteration over the keys only
+///
+/// usage: bench_hashmap_split [entries_count] [lookups_count]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+typedef struct Value {
+  uint64_t data[32];
+} Value;
+
+static void run(char const* name, bool split_values, size_t entries_count, size_t lookups_count)
+{
+  CHashMapOptions options = {.split_values = split_values};
+  CHashMap*       map     = c_hashmap_create_ex(sizeof(uint64_t), sizeof(Value), entries_count, &options, NULL);
+  if (!map) return;
+
+  // odd keys are inserted, even keys are used for misses
+  Value value = {0};
+  for (uint64_t iii = 0; iii < entries_count; ++iii) {
+    uint64_t key  = (iii * 2) + 1;
+    value.data[0] = iii;
+    if (!c_hashmap_insert(map, &key, &value)) return;
+  }
+
+  unsigned long long seed  = 42;
+  uint64_t           found = 0;
+  double             start = c_bench_now();
+  for (size_t iii = 0; iii < lookups_count; ++iii) {
+    uint64_t key     = ((c_bench_rand(&seed) % entries_count) * 2) + 1;
+    Value*   element = NULL;
+    if (c_hashmap_get(map, &key, (void**)&element)) found += element->data[0];
+  }
+  double hit_time = c_bench_now() - start;
+
+  start = c_bench_now();
+  for (size_t iii = 0; iii < lookups_count; ++iii) {
+    uint64_t key     = (c_bench_rand(&seed) % entries_count) * 2;
+    Value*   element = NULL;
+    found += c_hashmap_get(map, &key, (void**)&element);
+  }
+  double miss_time = c_bench_now() - start;
+
+  uint64_t* key = NULL;
+  start         = c_bench_now();
+  for (CHashMapIter iter = c_hashmap_iter(map); c_hashmap_iter_next(&iter, (void**)&key, NULL);) {
+    found += *key;
+  }
+  double iter_time = c_bench_now() - start;
+
+  printf("%-12s hit %7.1f ns/op  miss %7.1f ns/op  keys iteration %7.2f ns/key  (%llu)\n", name,
+         hit_time * 1e9 / (double)lookups_count, miss_time * 1e9 / (double)lookups_count,
+         iter_time * 1e9 / (double)entries_count, (unsigned long long)found);
+
+  c_hashmap_destroy(map, NULL, NULL);
+}
+
+int main(int argc, char** argv)
+{
+  size_t const entries_count = c_bench_arg(argc, argv, 1, (size_t)1 << 20);
+  size_t const lookups_count = c_bench_arg(argc, argv, 2, (size_t)1 << 22);
+
+  printf("%zu entries of %zu bytes values, %zu lookups\n", entries_count, sizeof(Value), lookups_count);
+  run("interleaved", false, entries_count, lookups_count);
+  run("split", true, entries_count, lookups_count);
+
+  return EXIT_SUCCESS;
+}
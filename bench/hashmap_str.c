@@ -0,0 +1,93 @@
+/// benchmark: string keys (header names / tenant IDs like, 4 to 40 bytes),
+/// CStrHashMap vs CHashMap with keys padded to char[64], the memory of the
+/// tables (measured with an arena) and random lookups
+///
+/// usage: bench_hashmap_str [entries_count] [lookups_count]
+
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <string.h>
+
+enum { MAX_KEY_LEN = 64, INLINE_CAPACITY = 20 };
+
+static size_t arena_used(CAllocator* arena)
+{
+  return c_allocator_arena_mark(arena).offset;
+}
+
+int main(int argc, char** argv)
+{
+  size_t const entries_count = c_bench_arg(argc, argv, 1, (size_t)1 << 20);
+  size_t const lookups_count = c_bench_arg(argc, argv, 2, (size_t)1 << 22);
+
+  // keys of random lengths (4 to 40), most of them are short
+  char (*keys)[MAX_KEY_LEN] = calloc(entries_count, MAX_KEY_LEN);
+  size_t* lens              = malloc(entries_count * sizeof(*lens));
+  if (!keys || !lens) return EXIT_FAILURE;
+
+  unsigned long long seed            = 42;
+  size_t             long_keys_bytes = 0;
+  for (size_t iii = 0; iii < entries_count; ++iii) {
+    size_t len = (c_bench_rand(&seed) % 4) ? 4 + (c_bench_rand(&seed) % 13) : 21 + (c_bench_rand(&seed) % 20);
+    int    n   = snprintf(keys[iii], MAX_KEY_LEN, "%zx-", iii);
+    for (size_t jjj = (size_t)n; jjj < len; ++jjj) keys[iii][jjj] = (char)('a' + (c_bench_rand(&seed) % 26));
+    lens[iii] = len > (size_t)n ? len : (size_t)n;
+    if (lens[iii] > INLINE_CAPACITY) long_keys_bytes += lens[iii];
+  }
+
+  CAllocator* arena = c_allocator_arena_create_virtual((size_t)16 << 30, C_ALLOCATOR_ARENA_FLAG_none);
+  if (!arena) return EXIT_FAILURE;
+
+  // [1] CStrHashMap
+  CStrHashMap* str_map = c_str_hashmap_create_with_capacity(sizeof(uint64_t), entries_count, arena);
+  if (!str_map) return EXIT_FAILURE;
+  for (uint64_t iii = 0; iii < entries_count; ++iii) {
+    if (!c_str_hashmap_insert(str_map, (CStr){keys[iii], lens[iii]}, &iii)) return EXIT_FAILURE;
+  }
+  size_t str_map_bytes = arena_used(arena) + long_keys_bytes;
+
+  uint64_t sum   = 0;
+  double   start = c_bench_now();
+  for (size_t iii = 0; iii < lookups_count; ++iii) {
+    size_t    index = c_bench_rand(&seed) % entries_count;
+    uint64_t* value = NULL;
+    c_str_hashmap_get(str_map, (CStr){keys[index], lens[index]}, (void**)&value);
+    sum += *value;
+  }
+  double str_map_time = c_bench_now() - start;
+  c_str_hashmap_destroy(str_map);
+  c_allocator_arena_reset(arena);
+
+  // [2] CHashMap<char[64]>
+  CHashMap* map = c_hashmap_create_with_capacity(MAX_KEY_LEN, sizeof(uint64_t), entries_count, arena);
+  if (!map) return EXIT_FAILURE;
+  for (uint64_t iii = 0; iii < entries_count; ++iii) {
+    if (!c_hashmap_insert(map, keys[iii], &iii)) return EXIT_FAILURE;
+  }
+  size_t map_bytes = arena_used(arena);
+
+  start = c_bench_now();
+  for (size_t iii = 0; iii < lookups_count; ++iii) {
+    char      key[MAX_KEY_LEN] = {0};
+    size_t    index            = c_bench_rand(&seed) % entries_count;
+    uint64_t* value            = NULL;
+    memcpy(key, keys[index], lens[index]);
+    c_hashmap_get(map, key, (void**)&value);
+    sum += *value;
+  }
+  double map_time = c_bench_now() - start;
+  c_hashmap_destroy(map, NULL, NULL);
+
+  printf("%zu string keys (%zu lookups)\n", entries_count, lookups_count);
+  printf("CStrHashMap        %8.1f MiB (%6.1f bytes/entry) %7.1f ns/lookup\n", (double)str_map_bytes / (1 << 20), (double)str_map_bytes / (double)entries_count, str_map_time * 1e9 / (double)lookups_count);
+  printf("CHashMap<char[64]> %8.1f MiB (%6.1f bytes/entry) %7.1f ns/lookup\n", (double)map_bytes / (1 << 20), (double)map_bytes / (double)entries_count, map_time * 1e9 / (double)lookups_count);
+  printf("(sum %llu)\n", (unsigned long long)sum);
+
+  c_allocator_arena_destroy(arena);
+  free(keys);
+  free(lens);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+/// benchmark: a set of 8 bytes keys, CHashSet vs CHashMap with a 1 byte dummy
+/// value (memory, inserts and lookups), and the set operations between a big
+/// set and a small one
+///
+/// usage: bench_hashset [keys_count]
+
+#include "anylibs/allocator.h"
+#include "anylibs/hashmap.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+
+/// @brief the used bytes of a virtual arena (it is a single block)
+static size_t arena_used(CAllocator* arena)
+{
+  return c_allocator_arena_mark(arena).offset;
+}
+
+int main(int argc, char** argv)
+{
+  size_t const keys_count = c_bench_arg(argc, argv, 1, (size_t)1 << 22);
+
+  CAllocator* arena = c_allocator_arena_create_virtual(keys_count * 128 + ((size_t)64 << 20), C_ALLOCATOR_ARENA_FLAG_none);
+  if (!arena) return EXIT_FAILURE;
+
+  // [1] CHashMap<u64, u8> (with enough capacity, so no old tables are left in the arena)
+  CHashMap* map = c_hashmap_create_with_capacity(sizeof(uint64_t), 1, keys_count, arena);
+  if (!map) return EXIT_FAILURE;
+  double start = c_bench_now();
+  for (uint64_t iii = 0; iii < keys_count; ++iii) {
+    if (!c_hashmap_insert(map, &iii, &(uint8_t){1})) return EXIT_FAILURE;
+  }
+  double map_insert = c_bench_now() - start;
+
+  unsigned long long seed  = 42;
+  size_t             found = 0;
+  start                    = c_bench_now();
+  for (size_t iii = 0; iii < keys_count; ++iii) {
+    uint64_t key = c_bench_rand(&seed) % (keys_count * 2);
+    found += c_hashmap_has_key(map, &key);
+  }
+  double map_lookup = c_bench_now() - start;
+  size_t map_bytes  = arena_used(arena);
+  c_hashmap_destroy(map, NULL, NULL);
+  c_allocator_arena_reset(arena);
+
+  // [2] CHashSet<u64>
+  CHashSet* set = c_hashset_create_ex(sizeof(uint64_t), keys_count, NULL, arena);
+  if (!set) return EXIT_FAILURE;
+  start = c_bench_now();
+  for (uint64_t iii = 0; iii < keys_count; ++iii) {
+    if (!c_hashset_insert(set, &iii, NULL)) return EXIT_FAILURE;
+  }
+  double set_insert = c_bench_now() - start;
+
+  seed  = 42;
+  start = c_bench_now();
+  for (size_t iii = 0; iii < keys_count; ++iii) {
+    uint64_t key = c_bench_rand(&seed) % (keys_count * 2);
+    found += c_hashset_contains(set, &key);
+  }
+  double set_lookup = c_bench_now() - start;
+  size_t set_bytes  = arena_used(arena);
+
+  printf("%zu u64 keys\n", keys_count);
+  printf("%-20s %10s %10s %12s\n", "", "insert", "lookup", "memory");
+  printf("%-20s %7.1f ns %7.1f ns %8.1f MiB\n", "CHashMap<u64, u8>", map_insert * 1e9 / (double)keys_count, map_lookup * 1e9 / (double)keys_count, (double)map_bytes / (1 << 20));
+  printf("%-20s %7.1f ns %7.1f ns %8.1f MiB\n", "CHashSet<u64>", set_insert * 1e9 / (double)keys_count, set_lookup * 1e9 / (double)keys_count, (double)set_bytes / (1 << 20));
+
+  // [3] set operations with a set of 1/64 of the keys (half of them are in set)
+  CHashSet* small = c_hashset_create(sizeof(uint64_t), NULL);
+  if (!small) return EXIT_FAILURE;
+  for (uint64_t iii = 0; iii < keys_count / 64; ++iii) {
+    uint64_t key = iii * 128;
+    if (!c_hashset_insert(small, &key, NULL)) return EXIT_FAILURE;
+  }
+
+  typedef CHashSet* (*SetOperation)(CHashSet const* set1, CHashSet const* set2);
+  SetOperation const operations[] = {c_hashset_union, c_hashset_intersect, c_hashset_difference, c_hashset_difference};
+  char const* const  names[]      = {"union", "intersect", "difference (big - small)", "difference (small - big)"};
+  for (size_t iii = 0; iii < 4; ++iii) {
+    start             = c_bench_now();
+    CHashSet* result  = (iii == 3) ? operations[iii](small, set) : operations[iii](set, small);
+    double    elapsed = c_bench_now() - start;
+    if (!result) return EXIT_FAILURE;
+    printf("%-26s %8.2f ms (%zu keys)\n", names[iii], elapsed * 1e3, c_hashset_len(result));
+    c_hashset_destroy(result);
+  }
+  printf("(found %zu)\n", found);
+
+  c_hashset_destroy(small);
+  c_hashset_destroy(set);
+  c_allocator_arena_destroy(arena);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+/// benchmark: sorting a CVec of uint64_t with several distributions, qsort vs
+/// c_vec_sort (the same compare function) vs c_vec_sort_u64 (inlined compare)
+///
+/// usage: bench_vec_sort [elements_count]
+
+#include "anylibs/vec.h"
+
+#include "bench.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define DISTRIBUTIONS_COUNT 5U
+
+static char const* const DISTRIBUTIONS[DISTRIBUTIONS_COUNT] = {"random", "sorted", "reversed", "few unique", "organ pipe"};
+
+static int cmp_u64(void const* a, void const* b)
+{
+  uint64_t const x = *(uint64_t const*)a;
+  uint64_t const y = *(uint64_t const*)b;
+  return (x > y) - (x < y);
+}
+
+static void fill(uint64_t* data, size_t len, size_t distribution)
+{
+  unsigned long long seed = 42;
+  for (size_t iii = 0; iii < len; ++iii) {
+    switch (distribution) {
+      case 1: data[iii] = iii; break;
+      case 2: data[iii] = len - iii; break;
+      case 3: data[iii] = c_bench_rand(&seed) % 16; break;
+      case 4: data[iii] = iii < len / 2 ? iii : len - iii; break;
+      default: data[iii] = c_bench_rand(&seed); break;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  size_t const elements_count = c_bench_arg(argc, argv, 1, 10000000);
+
+  uint64_t* expected = malloc((elements_count + 1) * sizeof(*expected));
+  CVec*     vec      = c_vec_create_with_capacity(sizeof(uint64_t), elements_count + 1, false, NULL);
+  if (!expected || !vec || !c_vec_set_len(vec, elements_count)) return EXIT_FAILURE;
+
+  printf("%zu u64 elements (ms)\n", elements_count);
+  printf("%-12s %10s %12s %16s\n", "", "qsort", "c_vec_sort", "c_vec_sort_u64");
+  for (size_t distribution = 0; distribution < DISTRIBUTIONS_COUNT; ++distribution) {
+    fill(expected, elements_count, distribution);
+    double start = c_bench_now();
+    qsort(expected, elements_count, sizeof(*expected), cmp_u64);
+    double qsort_time = c_bench_now() - start;
+
+    fill(vec->data, elements_count, distribution);
+    start = c_bench_now();
+    if (!c_vec_sort(vec, cmp_u64)) return EXIT_FAILURE;
+    double sort_time = c_bench_now() - start;
+    if (memcmp(expected, vec->data, elements_count * sizeof(*expected)) != 0) return EXIT_FAILURE;
+
+    fill(vec->data, elements_count, distribution);
+    start = c_bench_now();
+    if (!c_vec_sort_u64(vec)) return EXIT_FAILURE;
+    double sort_u64_time = c_bench_now() - start;
+    if (memcmp(expected, vec->data, elements_count * sizeof(*expected)) != 0) return EXIT_FAILURE;
+
+    printf("%-12s %10.1f %12.1f %16.1f\n", DISTRIBUTIONS[distribution], qsort_time * 1e3, sort_time * 1e3, sort_u64_time * 1e3);
+  }
+
+  c_vec_destroy(vec);
+  free(expected);
+  return EXIT_SUCCESS;
+}
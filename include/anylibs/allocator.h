@@ -6,6 +6,29 @@
 #include <stddef.h>
 
 typedef struct CAllocator CAllocator;
+typedef struct CAllocatorArenaMark {
+  void*  block; ///< the arena block that was active when the mark was taken
+  size_t offset; ///< the used size of that block
+  size_t live_bytes; ///< the allocated bytes when the mark was taken (for the statistics)
+  size_t live_count; ///< the allocations count when the mark was taken (for the statistics)
+} CAllocatorArenaMark; ///< a saved position of an arena, check @ref c_allocator_arena_mark
+
+typedef enum CAllocatorArenaFlags {
+  C_ALLOCATOR_ARENA_FLAG_none             = 0,
+  C_ALLOCATOR_ARENA_FLAG_huge_pages       = 1 << 0, ///< back the arena with huge pages (MAP_HUGETLB of 2 MiB pages, then MADV_HUGEPAGE), it silently fallbacks to normal pages if they are not available (or can't be committed)
+  C_ALLOCATOR_ARENA_FLAG_release_on_reset = 1 << 1, ///< @ref c_allocator_arena_reset gives the unused pages back to the OS (MADV_DONTNEED), the address space is kept reserved
+} CAllocatorArenaFlags; ///< check @ref c_allocator_arena_create_virtual
+
+#define C_ALLOCATOR_STATS_SIZE_CLASSES_COUNT 64
+typedef struct CAllocatorStats {
+  size_t live_bytes; ///< the bytes currently allocated (without the allocators metadata)
+  size_t peak_bytes; ///< the maximum value live_bytes has reached
+  size_t alloc_count;
+  size_t resize_count;
+  size_t free_count;
+  size_t resize_copied_bytes; ///< the bytes copied by resize because it could not grow/shrink in place
+  size_t size_classes[C_ALLOCATOR_STATS_SIZE_CLASSES_COUNT]; ///< allocations count by size, size_classes[n] counts sizes in [2^n, 2^(n+1))
+} CAllocatorStats; ///< check @ref c_allocator_stats
 
 //-------------------------------
 // Allocators
@@ -15,13 +38,32 @@ typedef struct CAllocator CAllocator;
 CAllocator* c_allocator_default(void); ///< this will always return valid allocator based on (malloc, free, ...) family
 
 // -- Arena Allocator
-CAllocator* c_allocator_arena_create(size_t capacity); ///< create Arena allocator (this will use malloc to create memory)
-void        c_allocator_arena_destroy(CAllocator* self); ///< destroy the memory hold by the arena allocator, and the allocator itself
+CAllocator*         c_allocator_arena_create(size_t capacity); ///< create Arena allocator (this will use malloc to create memory)
+CAllocator*         c_allocator_arena_create_growable(size_t initial_capacity); ///< same like c_allocator_arena_create, but when the current block is exhausted a new one (twice as big) is chained instead of failing
+CAllocator*         c_allocator_arena_create_virtual(size_t reserve_size, int flags); ///< same like c_allocator_arena_create, but reserve_size of address space is reserved (mmap/VirtualAlloc) and the pages are committed lazily as the arena grows, flags are a combination of @ref CAllocatorArenaFlags
+void                c_allocator_arena_destroy(CAllocator* self); ///< destroy the memory hold by the arena allocator, and the allocator itself
+void                c_allocator_arena_reset(CAllocator* self); ///< free all allocations at once, the memory is kept to be reused by the next allocations (works with Fixed buffer Allocator too), the statistics count them as freed
+CAllocatorArenaMark c_allocator_arena_mark(CAllocator* self); ///< save the current position of the arena (works with Fixed buffer Allocator too)
+void                c_allocator_arena_rewind_to_mark(CAllocator* self, CAllocatorArenaMark mark); ///< free all allocations done after the mark was taken, the memory is kept to be reused (the statistics count them as freed)
+
+// -- Concurrent Arena Allocator
+CAllocator* c_allocator_concurrent_arena_create(size_t capacity); ///< create thread safe Arena allocator with fixed capacity, each thread bumps its own sub-chunk (taken from the shared buffer with an atomic compare-exchange, the last one gets what is left), free and resize only work in place for the last allocation of the calling thread
+void        c_allocator_concurrent_arena_reset(CAllocator* self); ///< free all allocations at once, this must not run concurrently with allocations
+void        c_allocator_concurrent_arena_destroy(CAllocator* self); ///< destroy the memory hold by the concurrent arena allocator (from all threads), and the allocator itself
 
 // -- Fixed buffer Allocator
 CAllocator* c_allocator_fixed_buffer_create(void* buffer, size_t buffer_size); ///< craete fixed buffer allocator (it is the same like arena, but you will provide the memory to be used instead of allocating one)
 void        c_allocator_fixed_buffer_destroy(CAllocator* self); ///< destroy the fixed buffer allocator
 
+// -- Pool Allocator
+CAllocator* c_allocator_pool_create(size_t object_size, size_t alignment, size_t objects_per_chunk); ///< create Pool allocator, objects of object_size are allocated from chunks of objects_per_chunk using a free list in O(1), bigger allocations will fallback to the Default Allocator, the slots are sized for @ref c_allocator_alloc (object_size plus its header), use @ref c_allocator_pool_create_sized for @ref c_allocator_alloc_sized objects
+CAllocator* c_allocator_pool_create_sized(size_t object_size, size_t alignment, size_t objects_per_chunk); ///< same like c_allocator_pool_create, but the slots are sized for @ref c_allocator_alloc_sized (object_size without a header, as used by CVec, CHashMap, ...), so @ref c_allocator_alloc of object_size will fallback to the Default Allocator
+void        c_allocator_pool_destroy(CAllocator* self); ///< destroy all chunks hold by the pool allocator, and the allocator itself
+
+// -- Slab Allocator
+CAllocator* c_allocator_slab_create(void); ///< create general purpose Slab allocator, small allocations are served from size classes with a per-thread cache, this one is thread safe
+void        c_allocator_slab_destroy(CAllocator* self); ///< destroy all memory hold by the slab allocator (from all threads), and the allocator itself
+
 //-------------------------------
 // Allocators generic functions
 //-------------------------------
@@ -29,9 +71,13 @@ void        c_allocator_fixed_buffer_destroy(CAllocator* self); ///< destroy the
 #define c_allocator_alignas(type__, count__) sizeof(type__) * (count__), alignof(type__) ///< this macro is used to calculate size and alignment parameters of @ref c_allocator_alloc (check unit tests for an example)
 
 void*  c_allocator_alloc(CAllocator* self, size_t size, size_t alignment, bool set_mem_to_zero); ///< this is similar to malloc, for alignment, check https://en.cppreference.com/w/c/memory/aligned_alloc
-void*  c_allocator_resize(CAllocator* self, void* memory, size_t new_size); ///< this is similar to realloc, note: Default Allocator will ALWAYS create new memory on resize to keep the alignment, it will return NULL on error
+void*  c_allocator_resize(CAllocator* self, void* memory, size_t new_size); ///< this is similar to realloc, note: Default Allocator will try to grow in place (realloc, or remapping the pages of big memory blocks on Linux) before creating new memory, it will return NULL on error
 void   c_allocator_free(CAllocator* self, void* memory); ///< this is similar to free
-size_t c_allocator_mem_size(void* memory); ///< get memory size
-size_t c_allocator_mem_alignment(void* memory); ///< get alignment
+void*  c_allocator_alloc_sized(CAllocator* self, size_t size, size_t alignment, bool set_mem_to_zero); ///< same like c_allocator_alloc, but no header (size and alignment) is stored with the memory, the caller has to pass them back to resize/free it, so c_allocator_mem_size/c_allocator_mem_alignment can't be used with it
+void*  c_allocator_resize_sized(CAllocator* self, void* memory, size_t old_size, size_t new_size, size_t alignment); ///< resize memory allocated by @ref c_allocator_alloc_sized, old_size and alignment are the ones used to allocate it
+void   c_allocator_free_sized(CAllocator* self, void* memory, size_t size, size_t alignment); ///< free memory allocated by @ref c_allocator_alloc_sized, size and alignment are the ones used to allocate it (or the last resize)
+size_t c_allocator_mem_size(void* memory); ///< get memory size (only for memory allocated by @ref c_allocator_alloc)
+size_t c_allocator_mem_alignment(void* memory); ///< get alignment (only for memory allocated by @ref c_allocator_alloc)
+bool   c_allocator_stats(CAllocator* self, CAllocatorStats* out_stats); ///< get the allocator statistics, this will return false if the library is built without ANYLIBS_ENABLE_ALLOCATOR_STATS
 
 #endif // ANYLIBS_ALLOCATOR_H
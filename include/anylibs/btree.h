@@ -0,0 +1,40 @@
+#ifndef ANYLIBS_BTREE_H
+#define ANYLIBS_BTREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "allocator.h"
+#include "vec.h"
+
+typedef struct CBTreeMap     CBTreeMap;
+typedef struct CBTreeMapNode CBTreeMapNode;
+typedef struct CBTreeMapIter {
+  CBTreeMap*     map;
+  CBTreeMapNode* leaf; ///< the leaf of the next key, NULL at the end of the map
+  size_t         index; ///< the next key in leaf
+  CBTreeMapNode* end_leaf; ///< the iteration stops at (end_leaf, end_index), or at the end of the map if end_leaf is NULL
+  size_t         end_index;
+} CBTreeMapIter; ///< an insert/remove invalidates the iterators of the map
+typedef void (*CBTreeMapElementDestroyFn)(void* key, void* value, void* user_data);
+
+CBTreeMap*    c_btree_map_create(size_t key_size, size_t value_size, CVecCompareFn cmp, CAllocator* allocator); ///< an ordered map (a B+ tree) of keys sorted by cmp, the nodes are a few cache lines (wider for big keys/values) and the leaves are linked, so range scans read them in order, value_size could be 0 (a set), allocator could be NULL (c_allocator_default)
+CBTreeMap*    c_btree_map_create_from_sorted(CVec const* keys, CVec const* values, CVecCompareFn cmp, CAllocator* allocator); ///< same like c_btree_map_create, with the keys (sorted by cmp, C_ERROR_invalid_data otherwise) and the values of two vectors of the same length, the leaves are filled in order without any split, a key that repeats takes its last value, values could be NULL (value_size is 0)
+size_t        c_btree_map_len(CBTreeMap const* self);
+bool          c_btree_map_is_empty(CBTreeMap const* self);
+bool          c_btree_map_insert(CBTreeMap* self, void const* key, void const* value); ///< insert or update, a full node is split in half, except the last one of the map when the key goes at its end (appending sorted keys fills the nodes)
+bool          c_btree_map_get(CBTreeMap const* self, void const* key, void** out_value); ///< same like c_hashmap_get, out_value points to the map memory (valid until the next insert/remove)
+bool          c_btree_map_has_key(CBTreeMap const* self, void const* key);
+bool          c_btree_map_remove(CBTreeMap* self, void const* key, void** out_key, void** out_value); ///< false (C_ERROR_not_found) if key doesn't exist, out_key/out_value (could be NULL) point to a copy of the removed key/value (valid until the next remove)
+bool          c_btree_map_first(CBTreeMap* self, void** out_key, void** out_value); ///< the smallest key, false (C_ERROR_empty) if the map is empty, out_key/out_value could be NULL
+bool          c_btree_map_last(CBTreeMap* self, void** out_key, void** out_value); ///< same like c_btree_map_first, the biggest key
+CBTreeMapIter c_btree_map_iter(CBTreeMap* self); ///< all the keys in order
+CBTreeMapIter c_btree_map_lower_bound(CBTreeMap* self, void const* key); ///< the keys from the first one >= key
+CBTreeMapIter c_btree_map_upper_bound(CBTreeMap* self, void const* key); ///< the keys from the first one > key
+CBTreeMapIter c_btree_map_range(CBTreeMap* self, void const* from_key, void const* to_key); ///< the keys in [from_key, to_key), from_key NULL: from the first key, to_key NULL: to the last one
+bool          c_btree_map_iter_next(CBTreeMapIter* iter, void** key, void** value); ///< key/value point to the map memory, they could be NULL
+bool          c_btree_map_iter_next_chunk(CBTreeMapIter* iter, void** keys, void** values, size_t* out_count); ///< same like c_btree_map_iter_next, but the next keys of the same leaf at once: keys/values point to arrays of out_count keys/values (up to a whole leaf), this is the fastest way to scan a range
+void          c_btree_map_clear(CBTreeMap* self, CBTreeMapElementDestroyFn element_destroy_fn, void* user_data);
+void          c_btree_map_destroy(CBTreeMap* self, CBTreeMapElementDestroyFn element_destroy_fn, void* user_data);
+
+#endif // ANYLIBS_BTREE_H
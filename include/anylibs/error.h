@@ -35,6 +35,7 @@ typedef enum c_error_t {
   C_ERROR_invalid_format,
   C_ERROR_dl_loader_failed,
   C_ERROR_dl_loader_invalid_symbol,
+  C_ERROR_read_only,
 } c_error_t;
 
 char const* c_error_to_str(c_error_t code);
@@ -6,16 +6,39 @@
 #include <stdint.h>
 
 #include "allocator.h"
+#include "fs.h"
+#include "str.h"
 
-typedef struct CHashMap CHashMap;
+typedef struct CHashMap           CHashMap;
+typedef struct CConcurrentHashMap CConcurrentHashMap;
+typedef struct CStrHashMap        CStrHashMap;
+typedef struct CFrozenMap         CFrozenMap;
+typedef struct CHashSet           CHashSet;
 typedef struct CHashMapIter {
   CHashMap* map;
   size_t    index;
 } CHashMapIter;
+typedef struct CStrHashMapIter {
+  CHashMapIter iter;
+} CStrHashMapIter;
+typedef struct CHashSetIter {
+  CHashMapIter iter;
+} CHashSetIter;
 typedef void (*CHashMapElementDestroyFn)(void* key, void* value, void* user_data);
+typedef void (*CHashMapUpsertFn)(void* value, bool was_present, void* user_data); ///< value is zeroed if the key was not present
+typedef uint64_t (*CHashMapHashFn)(void const* key, size_t key_size, uint64_t seed); ///< all bits of the result should be well mixed, the map uses both the low and the high bits
+typedef bool (*CHashMapEqFn)(void const* key1, void const* key2, size_t key_size); ///< true if key1 and key2 are the same key (keys that are equal must have the same hash)
+typedef struct CHashMapOptions {
+  CHashMapHashFn hash_fn; ///< NULL: @ref c_hashmap_hash_bytes
+  CHashMapEqFn   eq_fn; ///< NULL: compare the bytes of the keys
+  bool           incremental_resize; ///< true: the table is not rehashed at once when it grows, the old table is kept and migrated a few slots on each insert/remove (this keeps the insert latency flat, but lookups check both tables until the migration is done)
+  bool           split_values; ///< true: the keys are stored in one array and the values in another one (instead of [key, value] slots), so probing and iterating over the keys don't touch the values, useful with large values
+  uint64_t       seed; ///< 0: a random seed for each map, otherwise this one (the hashes are reproducible, but whoever knows it could craft colliding keys), see @ref c_hashmap_seed
+} CHashMapOptions;
 
 CHashMap*    c_hashmap_create(size_t key_size, size_t value_size, CAllocator* allocator);
 CHashMap*    c_hashmap_create_with_capacity(size_t key_size, size_t value_size, size_t capacity, CAllocator* allocator);
+CHashMap*    c_hashmap_create_ex(size_t key_size, size_t value_size, size_t capacity, CHashMapOptions const* options, CAllocator* allocator); ///< same like c_hashmap_create_with_capacity, options could be NULL (the defaults), keys of 4, 8 or 16 bytes with the default hash and equality take a specialized path
 size_t       c_hashmap_len(CHashMap const* self);
 bool         c_hashmap_is_empty(CHashMap const* self);
 size_t       c_hashmap_capacity(CHashMap const* self);
@@ -23,9 +46,69 @@ bool         c_hashmap_insert(CHashMap* self, void* key, void* value);
 bool         c_hashmap_get(CHashMap const* self, void* key, void** out_value);
 bool         c_hashmap_has_key(CHashMap const* self, void* key);
 bool         c_hashmap_remove(CHashMap* self, void* key, void** out_value);
+uint64_t     c_hashmap_hash(CHashMap const* self, void const* key); ///< the hash of key that the map uses, it could be passed to the *_prehashed functions of this map (or any map with the same key size, hash fn and seed), until the map reseeds
+uint64_t     c_hashmap_seed(CHashMap const* self); ///< the seed passed to the hash fn, an insert that probes too many groups (colliding keys) rehashes the map with a new random seed (once per capacity), so the hashes of c_hashmap_hash are valid until the seed changes
+bool         c_hashmap_get_prehashed(CHashMap const* self, void const* key, uint64_t hash, void** out_value); ///< same like c_hashmap_get, hash should be c_hashmap_hash(self, key)
+bool         c_hashmap_insert_prehashed(CHashMap* self, void const* key, void const* value, uint64_t hash); ///< same like c_hashmap_insert, hash should be c_hashmap_hash(self, key)
+bool         c_hashmap_remove_prehashed(CHashMap* self, void const* key, uint64_t hash, void** out_value); ///< same like c_hashmap_remove, hash should be c_hashmap_hash(self, key)
+bool         c_hashmap_entry(CHashMap* self, void const* key, void** out_value, bool* out_was_present); ///< get the value of key, or insert key with a zeroed value, with one probe, out_value points to the value inside the map (valid until the next insert/remove), out_was_present could be NULL
+bool         c_hashmap_upsert_with(CHashMap* self, void const* key, CHashMapUpsertFn upsert_fn, void* user_data); ///< same like c_hashmap_entry, then upsert_fn updates the value in place
+bool         c_hashmap_get_batch(CHashMap const* self, void const* keys, size_t keys_count, void** out_values); ///< same like c_hashmap_get for an array of keys (key_size each), out_values[i] is the value of keys[i] (or NULL), the keys are hashed and their groups are prefetched first, so the cache misses overlap
+bool         c_hashmap_insert_batch(CHashMap* self, void const* keys, void const* values, size_t count); ///< same like c_hashmap_insert for arrays of keys and values, the map grows once for all of them
+CHashMap*    c_hashmap_build_from(void const* keys, void const* values, size_t count, size_t key_size, size_t value_size, size_t threads_count, CHashMapOptions const* options, CAllocator* allocator); ///< a map of arrays of keys and values (a key that repeats takes its last value), sized for count at once, with threads_count threads (the calling one included, at most 64, and fewer for small arrays): the keys are split by the high bits of their first group, so each thread fills its own part of the table without locks, the hash/eq functions have to be thread safe
+bool         c_hashmap_save(CHashMap* self, CFile* file); ///< write a snapshot of the map to file (opened with "wb"): a versioned header and the table as it is in memory, the keys and the values must not hold pointers, a pending incremental resize is finished first
+CHashMap*    c_hashmap_open_mmap(CStr path, CHashMapOptions const* options, CAllocator* allocator); ///< map a snapshot written by c_hashmap_save read only (the pages are loaded on demand), options give the hash/eq functions of the saved map (the rest is read from the header), inserts/removes fail with C_ERROR_read_only, the header is validated but the table is not, close it with c_hashmap_destroy
 void         c_hashmap_clear(CHashMap* self, CHashMapElementDestroyFn element_destroy_fn, void* user_data);
 CHashMapIter c_hashmap_iter(CHashMap* self);
 bool         c_hashmap_iter_next(CHashMapIter* iter, void** key, void** value);
 void         c_hashmap_destroy(CHashMap* self, CHashMapElementDestroyFn element_destroy_fn, void* user_data);
 
+CFrozenMap* c_hashmap_freeze(CHashMap const* map, CAllocator* allocator); ///< an immutable copy of map, with a minimal perfect hash (CHD): each key has its own slot and there are no empty ones, a lookup reads one displacement (about 2 bytes per key) and one slot, it keeps the hash/eq functions of map, allocator could be NULL (the allocator of map)
+CFrozenMap* c_frozen_map_create(void const* keys, void const* values, size_t count, size_t key_size, size_t value_size, CHashMapOptions const* options, CAllocator* allocator); ///< same like c_hashmap_freeze from arrays of keys and values, the keys must be unique (C_ERROR_invalid_data), options could be NULL (only hash_fn and eq_fn are used)
+size_t      c_frozen_map_len(CFrozenMap const* self);
+bool        c_frozen_map_get(CFrozenMap const* self, void const* key, void** out_value); ///< same like c_hashmap_get
+bool        c_frozen_map_save(CFrozenMap const* self, CFile* file); ///< same like c_hashmap_save
+CFrozenMap* c_frozen_map_open_mmap(CStr path, CHashMapOptions const* options, CAllocator* allocator); ///< same like c_hashmap_open_mmap
+void        c_frozen_map_destroy(CFrozenMap* self);
+
+CConcurrentHashMap* c_concurrent_hashmap_create(size_t key_size, size_t value_size, size_t shards_count, CHashMapOptions const* options, CAllocator* allocator); ///< the keys are spread (by the high bits of their hash) over shards_count CHashMaps (a power of 2, 0 for the default), each one has a readers/writer lock, the allocator has to be thread safe (like c_allocator_default), the shards start with the same seed
+size_t              c_concurrent_hashmap_len(CConcurrentHashMap* self); ///< the sum of the shards lengths (they are not locked at once)
+bool                c_concurrent_hashmap_insert(CConcurrentHashMap* self, void const* key, void const* value); ///< insert or update
+bool                c_concurrent_hashmap_get(CConcurrentHashMap* self, void const* key, void* out_value); ///< copy the value to out_value, false (C_ERROR_not_found) if the key doesn't exist, readers don't block each other
+bool                c_concurrent_hashmap_remove(CConcurrentHashMap* self, void const* key, void* out_value); ///< copy the removed value to out_value (could be NULL)
+bool                c_concurrent_hashmap_get_or_insert(CConcurrentHashMap* self, void const* key, void const* value, void* out_value, bool* out_inserted); ///< atomically: insert value if the key doesn't exist, then copy the value of the key to out_value (could be NULL), out_inserted could be NULL
+void                c_concurrent_hashmap_destroy(CConcurrentHashMap* self, CHashMapElementDestroyFn element_destroy_fn, void* user_data);
+
+CStrHashMap*    c_str_hashmap_create(size_t value_size, CAllocator* allocator); ///< a map keyed by strings (of any length), the keys are copied: short ones (up to 20 bytes) inline in the slots, long ones to an internal arena, the keys keep their hash (with a random seed) so the map doesn't reseed
+CStrHashMap*    c_str_hashmap_create_with_capacity(size_t value_size, size_t capacity, CAllocator* allocator);
+size_t          c_str_hashmap_len(CStrHashMap const* self);
+bool            c_str_hashmap_insert(CStrHashMap* self, CStr key, void const* value); ///< insert or update
+bool            c_str_hashmap_get(CStrHashMap const* self, CStr key, void** out_value); ///< same like c_hashmap_get
+bool            c_str_hashmap_entry(CStrHashMap* self, CStr key, void** out_value, bool* out_was_present); ///< same like c_hashmap_entry
+bool            c_str_hashmap_remove(CStrHashMap* self, CStr key, void** out_value); ///< same like c_hashmap_remove, the memory of a removed long key is reused only if it was the last one added (it is freed by clear/destroy)
+void            c_str_hashmap_clear(CStrHashMap* self);
+CStrHashMapIter c_str_hashmap_iter(CStrHashMap* self);
+bool            c_str_hashmap_iter_next(CStrHashMapIter* iter, CStr* key, void** value); ///< key points to the map memory
+void            c_str_hashmap_destroy(CStrHashMap* self);
+
+CHashSet*    c_hashset_create(size_t key_size, CAllocator* allocator); ///< a set of keys, it is a CHashMap without values (the slots hold only the keys)
+CHashSet*    c_hashset_create_ex(size_t key_size, size_t capacity, CHashMapOptions const* options, CAllocator* allocator); ///< same like c_hashmap_create_ex (split_values is ignored)
+size_t       c_hashset_len(CHashSet const* self);
+size_t       c_hashset_capacity(CHashSet const* self);
+bool         c_hashset_insert(CHashSet* self, void const* key, bool* out_was_present); ///< out_was_present could be NULL
+bool         c_hashset_contains(CHashSet const* self, void const* key);
+bool         c_hashset_remove(CHashSet* self, void const* key); ///< false (C_ERROR_not_found) if key doesn't exist
+void         c_hashset_clear(CHashSet* self);
+CHashSet*    c_hashset_union(CHashSet const* set1, CHashSet const* set2); ///< a new set (with the allocator of set1) of the keys of both sets: a copy of the bigger one, then the keys of the smaller one are inserted, the sets need the same key size, hash fn and eq fn (C_ERROR_invalid_data)
+CHashSet*    c_hashset_intersect(CHashSet const* set1, CHashSet const* set2); ///< same like c_hashset_union, the keys of the smaller set are looked for in the bigger one
+CHashSet*    c_hashset_difference(CHashSet const* set1, CHashSet const* set2); ///< same like c_hashset_union, the keys of set1 that set2 doesn't have: the keys of set1 are looked for in set2, or if set2 is smaller, they are removed from a copy of set1
+CHashSetIter c_hashset_iter(CHashSet* self);
+bool         c_hashset_iter_next(CHashSetIter* iter, void** key); ///< key points to the set memory
+void         c_hashset_destroy(CHashSet* self);
+
+uint64_t c_hashmap_hash_bytes(void const* key, size_t key_size, uint64_t seed); ///< the default hash (wyhash like), it reads 8 bytes at a time
+uint64_t c_hashmap_hash_siphash(void const* key, size_t key_size, uint64_t seed); ///< SipHash-2-4 keyed by the seed, a few times slower than the default hash, but its collisions can't be found without the seed (use it for keys from untrusted input)
+uint64_t c_hashmap_hash_str_ptr(void const* key, size_t key_size, uint64_t seed); ///< hash fn for keys of type `char const*`, it hashes the content of the null terminated string
+bool     c_hashmap_eq_str_ptr(void const* key1, void const* key2, size_t key_size); ///< eq fn for keys of type `char const*`, it compares the content of the null terminated strings
+
 #endif // ANYLIBS_HASHMAP_H
@@ -11,6 +11,12 @@ typedef struct CVec {
 } CVec;
 typedef struct CStrBuf CStrBuf;
 typedef int (*CVecCompareFn)(void const*, void const*); ///< this is similar to strcmp
+typedef enum CVecRadixSortFlags {
+  C_VEC_RADIX_SORT_FLAG_unsigned   = 0, ///< the key is an unsigned integer
+  C_VEC_RADIX_SORT_FLAG_signed     = 1 << 0, ///< the key is a signed integer
+  C_VEC_RADIX_SORT_FLAG_float      = 1 << 1, ///< the key is a float (4 bytes) or a double (8 bytes), -NaN goes first, -0.0 before 0.0, NaN last
+  C_VEC_RADIX_SORT_FLAG_descending = 1 << 2, ///< biggest key first
+} CVecRadixSortFlags; ///< check @ref c_vec_radix_sort
 
 CVec*    c_vec_create(size_t element_size, CAllocator* allocator); ///< create a new CVec object, allocator could be NULL, in that case c_allocator_default will be used
 CVec*    c_vec_create_with_capacity(size_t element_size, size_t capacity, bool set_mem_to_zero, CAllocator* allocator); ///< same like c_vec_create
@@ -29,7 +35,14 @@ bool     c_vec_find(CVec const* self, void* element, CVecCompareFn cmp, void** o
 bool     c_vec_binary_find(CVec const* self, void const* element, CVecCompareFn cmp, void** out_data); ///< same like c_vec_find, but will use binary search tree, If data is not sorted, the returned result is unspecified and meaningless
 int      c_vec_starts_with(CVec const* self, void const* data, size_t data_len, CVecCompareFn cmp); ///< check if the vector starts with data using cmp, 0 => success, 1 => failed, -1 => failed with error
 int      c_vec_ends_with(CVec const* self, void const* data, size_t data_len, CVecCompareFn cmp); ///< check if the vector ends with data using cmp, 0 => success, 1 => failed, -1 => failed with error
-bool     c_vec_sort(CVec* self, CVecCompareFn cmp); ///< sort using cmp
+bool     c_vec_sort(CVec* self, CVecCompareFn cmp); ///< sort using cmp (pattern-defeating quicksort, not stable), O(n log n) in the worst case, and O(n) for sorted, reversed or all equal elements, the elements bigger than 256 bytes will allocate 2 of them
+bool     c_vec_sort_u32(CVec* self); ///< same like c_vec_sort, for a vector of uint32_t (C_ERROR_invalid_element_size otherwise), the comparison is inlined and the partitions are branchless
+bool     c_vec_sort_u64(CVec* self); ///< same like c_vec_sort_u32, for uint64_t
+bool     c_vec_sort_i32(CVec* self); ///< same like c_vec_sort_u32, for int32_t
+bool     c_vec_sort_i64(CVec* self); ///< same like c_vec_sort_u32, for int64_t
+bool     c_vec_sort_f32(CVec* self); ///< same like c_vec_sort_u32, for float, NaNs go last
+bool     c_vec_sort_f64(CVec* self); ///< same like c_vec_sort_u32, for double, NaNs go last
+bool     c_vec_radix_sort(CVec* self, size_t key_offset, size_t key_width, CVecRadixSortFlags flags); ///< sort the elements by the key of key_width bytes (1, 2, 4 or 8, C_ERROR_invalid_size otherwise) at key_offset of each one (C_ERROR_invalid_range if it is outside the element), flags set its type, this is a stable LSD radix sort (a pass per byte of the key, the passes where all the keys have the same byte are skipped), it allocates a copy of the elements
 int      c_vec_is_sorted(CVec* self, CVecCompareFn cmp); ///< check if sorted using cmp, 0 => success, 1 => failed, -1 => failed with error
 bool     c_vec_push(CVec* self, void const* element); ///< push a new element to the end, this will copy the element data, this could resize the data
 bool     c_vec_push_range(CVec* self, void const* elements, size_t elements_len); ///< same like c_vec_push, but push multiple elements, this could resize the data
@@ -1,2 +1,4 @@
 option(ANYLIBS_ENABLE_TESTS "Enable tests" OFF)
+option(ANYLIBS_ENABLE_BENCHMARKS "Enable benchmarks" OFF)
 option(ANYLIBS_ENABLE_ERROR_CALLBACK "enable callback on error" ON)
+option(ANYLIBS_ENABLE_ALLOCATOR_STATS "enable allocators statistics (check c_allocator_stats)" OFF)
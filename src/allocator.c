@@ -1,14 +1,26 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // mremap
+#endif
+
 #include "anylibs/allocator.h"
 #include "anylibs/error.h"
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 #ifdef _WIN32
 #include <malloc.h>
+#include <windows.h>
 #else
 #include <stdalign.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#define C_ALLOCATOR_HAS_MREMAP 1
 #endif
 
 #ifdef _WIN32
@@ -16,27 +28,182 @@
 #define c_mem_resize(mem, old_size, new_size, align) ((void)(old_size), _aligned_realloc(mem, new_size, align))
 #define c_mem_free(mem) _aligned_free(mem)
 #else
-#define c_mem_alloc(size, align) aligned_alloc((align), (size))
+#define c_mem_alloc(size, align) aligned_alloc((align), c_internal_allocator_align_forward((size), (align))) // size must be multiple of align
 #define c_mem_resize(mem, old_size, new_size, align) c_internal_allocator_default_posix_resize((mem), (old_size), (new_size), (align))
 #define c_mem_free(mem) free(mem)
 #endif
 
 #define TO_CMEMORY(ptr) ((CMemory*)(ptr) - 1)
 
+#ifdef ANYLIBS_ENABLE_ALLOCATOR_STATS
+#define c_stats_alloc(self, size) c_internal_allocator_stats_alloc(&(self)->stats, (size))
+#define c_stats_resize(self, old_size, new_size) c_internal_allocator_stats_resize(&(self)->stats, (old_size), (new_size))
+#define c_stats_free(self, size) c_internal_allocator_stats_free(&(self)->stats, (size))
+#define c_stats_copied(self, size) c_stats_counter_add((self)->stats.resize_copied_bytes, (size))
+#define c_stats_drop(self, live_bytes, live_count) c_internal_allocator_stats_drop(&(self)->stats, (live_bytes), (live_count))
+#define c_stats_live_bytes(self) c_stats_counter_load((self)->stats.live_bytes)
+#define c_stats_live_count(self) (c_stats_counter_load((self)->stats.alloc_count) - c_stats_counter_load((self)->stats.free_count))
+typedef _Atomic(size_t) c_stats_counter_t;
+#define c_stats_counter_add(counter, value) atomic_fetch_add_explicit(&(counter), (value), memory_order_relaxed)
+#define c_stats_counter_sub(counter, value) atomic_fetch_sub_explicit(&(counter), (value), memory_order_relaxed)
+#define c_stats_counter_load(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+#else
+#define c_stats_alloc(self, size) ((void)0)
+#define c_stats_resize(self, old_size, new_size) ((void)0)
+#define c_stats_free(self, size) ((void)0)
+#define c_stats_copied(self, size) ((void)0)
+#define c_stats_drop(self, live_bytes, live_count) ((void)0)
+#define c_stats_live_bytes(self) ((size_t)0)
+#define c_stats_live_count(self) ((size_t)0)
+#endif
+
+enum {
+  C_ALLOCATOR_MMAP_THRESHOLD = 1 << 20, ///< the Default Allocator maps memory blocks bigger than this directly, so it could be remapped on resize instead of copied
+  C_ALLOCATOR_MIN_PAGE_SIZE  = 4096,
+  C_ALLOCATOR_HUGE_PAGE_SIZE = 1 << 21, ///< 2 MiB, the default huge page size on x86_64 and aarch64
+  C_ALLOCATOR_COMMIT_STEP    = 1 << 20, ///< the virtual arena commits at least this much at once, to avoid a syscall for each new page
+};
+
 typedef struct CAllocator CAllocator;
 typedef struct CAllocatorVTable {
   void* (*alloc)(CAllocator* self, size_t size, size_t align);
   void* (*resize)(CAllocator* self, void* mem, size_t old_size, size_t new_size, size_t align);
-  void (*free)(CAllocator* self, void* mem);
+  void (*free)(CAllocator* self, void* mem, size_t size, size_t align);
 } CAllocatorVTable;
 
+/// @brief a block of memory owned by the arena, blocks are chained when
+///        the arena is growable
+typedef struct CArenaBlock CArenaBlock;
+struct CArenaBlock {
+  CArenaBlock* next;
+  size_t       capacity; ///< the size of @ref CArenaBlock::data
+  char         data[];
+};
+
+/// @brief a chunk of objects owned by the pool, the objects start after
+///        the chunk header (padded to the pool alignment)
+typedef struct CPoolChunk CPoolChunk;
+struct CPoolChunk {
+  CPoolChunk* next;
+};
+
+enum {
+  C_SLAB_CLASSES_COUNT = 40, ///< 16 bytes steps up to 128, then 4 steps for every power of 2 up to 32KiB
+  C_SLAB_MAX_SIZE      = 32768,
+  C_SLAB_ALIGNMENT     = 16,
+  C_SLAB_BATCH_SIZE    = 32, ///< objects moved between a thread cache and the depot at once
+  C_SLAB_SPAN_SIZE     = 65536, ///< minimum size of the memory carved into objects
+};
+
+/// @brief a span of memory carved into objects of one size class, the
+///        objects start after the span header (padded to the slab alignment)
+typedef struct CSlabSpan CSlabSpan;
+struct CSlabSpan {
+  CSlabSpan* next;
+};
+
+/// @brief the shared part of a size class, batches are NULL terminated
+///        linked lists of up to @ref C_SLAB_BATCH_SIZE objects (the first word
+///        of an object is the next object in the batch, the second word of the
+///        batch head is the next batch)
+typedef struct CSlabDepot {
+  mtx_t      lock;
+  void*      batches;
+  CSlabSpan* spans;
+  char*      span_cursor; ///< the remaining (not yet carved) part of the last span
+  char*      span_end;
+} CSlabDepot;
+
+/// @brief per-thread cache, allocation and free only touch this unless the
+///        magazine is empty or full
+typedef struct CSlabThreadCache CSlabThreadCache;
+struct CSlabThreadCache {
+  struct {
+    size_t count;
+    void*  objects[C_SLAB_BATCH_SIZE * 2];
+  } magazines[C_SLAB_CLASSES_COUNT];
+  struct CSlab*     slab;
+  CSlabThreadCache* next;
+};
+
+typedef struct CSlab {
+  tss_t             thread_cache_key;
+  mtx_t             thread_caches_lock;
+  CSlabThreadCache* thread_caches;
+  CSlabDepot        depots[C_SLAB_CLASSES_COUNT];
+} CSlab;
+
+enum {
+  C_CONCURRENT_ARENA_CHUNK_SIZE = 65536, ///< the sub-chunk a thread takes from the shared buffer at once
+  C_CONCURRENT_ARENA_MAX_CACHED = 8192, ///< bigger allocations take their memory directly from the shared buffer
+  C_CONCURRENT_ARENA_ALIGNMENT  = 64, ///< the alignment of the shared buffer and the sub-chunks
+};
+
+/// @brief per-thread sub-chunk of the concurrent arena, allocations from it
+///        don't need any atomic operation
+typedef struct CConcurrentArenaThreadCache CConcurrentArenaThreadCache;
+struct CConcurrentArenaThreadCache {
+  struct CConcurrentArena*     arena;
+  size_t                       epoch; ///< the sub-chunk is not valid anymore if this doesn't match @ref CConcurrentArena::epoch
+  uintptr_t                    chunk_start;
+  uintptr_t                    cursor;
+  uintptr_t                    chunk_end;
+  CConcurrentArenaThreadCache* next;
+};
+
+typedef struct CConcurrentArena {
+  _Atomic(size_t)              offset; ///< the bump pointer of the shared buffer
+  char                         padding[C_CONCURRENT_ARENA_ALIGNMENT - sizeof(size_t)]; ///< keep the contended offset in its own cache line
+  _Atomic(size_t)              epoch; ///< incremented by @ref c_allocator_concurrent_arena_reset
+  char*                        buf;
+  size_t                       capacity;
+  tss_t                        thread_cache_key;
+  mtx_t                        thread_caches_lock;
+  CConcurrentArenaThreadCache* thread_caches;
+} CConcurrentArena;
+
+#ifdef ANYLIBS_ENABLE_ALLOCATOR_STATS
+typedef struct CAllocatorStatsCounters {
+  c_stats_counter_t live_bytes;
+  c_stats_counter_t peak_bytes;
+  c_stats_counter_t alloc_count;
+  c_stats_counter_t resize_count;
+  c_stats_counter_t free_count;
+  c_stats_counter_t resize_copied_bytes;
+  c_stats_counter_t size_classes[C_ALLOCATOR_STATS_SIZE_CLASSES_COUNT];
+} CAllocatorStatsCounters;
+#endif
+
 typedef struct CAllocator {
   struct {
     void*  buf;
     size_t current_size;
     size_t capacity;
   } main_mem;
+  union {
+    struct {
+      CArenaBlock* first; ///< NULL for fixed buffer allocator
+      CArenaBlock* current; ///< the block that @ref CAllocator::main_mem points to
+      bool         growable;
+      size_t       reserved; ///< the reserved address space of a virtual arena (0 otherwise), @ref CAllocator::main_mem::capacity is the committed part of it
+      size_t       page_size; ///< the commit granularity of a virtual arena
+      int          flags; ///< @ref CAllocatorArenaFlags
+      bool         is_hugetlb; ///< the reserved address space is backed by explicit huge pages (MAP_HUGETLB)
+    } arena;
+    struct {
+      void*       free_list; ///< each free slot holds a pointer to the next free slot
+      CPoolChunk* chunks;
+      size_t      slot_size; ///< the object size including the @ref CMemory header
+      size_t      alignment;
+      size_t      objects_per_chunk;
+    } pool;
+    CSlab*            slab;
+    CConcurrentArena* concurrent_arena;
+  };
   CAllocatorVTable vtable;
+#ifdef ANYLIBS_ENABLE_ALLOCATOR_STATS
+  CAllocatorStatsCounters stats;
+#endif
 } CAllocator;
 
 typedef struct CMemory {
@@ -48,14 +215,49 @@ typedef struct CMemory {
 #ifndef _WIN32
 static void* c_internal_allocator_default_posix_resize(void* mem, size_t old_size, size_t new_size, size_t align);
 #endif
+static inline size_t                c_internal_allocator_real_alignment(size_t alignment);
+static inline size_t                c_internal_allocator_header_size(size_t alignment);
+static inline size_t                c_internal_allocator_sized_alignment(size_t alignment);
+static inline uintptr_t             c_internal_allocator_align_forward(uintptr_t address, size_t align);
+static inline bool                  c_internal_allocator_default_is_mapped(size_t size, size_t align);
+#ifdef ANYLIBS_ENABLE_ALLOCATOR_STATS
+static void                         c_internal_allocator_stats_alloc(CAllocatorStatsCounters* stats, size_t size);
+static void                         c_internal_allocator_stats_resize(CAllocatorStatsCounters* stats, size_t old_size, size_t new_size);
+static void                         c_internal_allocator_stats_free(CAllocatorStatsCounters* stats, size_t size);
+static void                         c_internal_allocator_stats_update_peak(CAllocatorStatsCounters* stats, size_t live_bytes);
+static void                         c_internal_allocator_stats_drop(CAllocatorStatsCounters* stats, size_t live_bytes, size_t live_count);
+#endif
+static CAllocator*                  c_internal_allocator_arena_create(size_t capacity, bool growable);
+static void                         c_internal_allocator_arena_use_block(CAllocator* self, CArenaBlock* block);
+static void*                        c_internal_allocator_arena_alloc_slow(CAllocator* self, size_t size, size_t align);
+static inline size_t                c_internal_allocator_page_size(void);
+static void*                        c_internal_allocator_virtual_reserve(size_t* reserve_size, int flags, size_t* page_size, bool* is_hugetlb);
+static bool                         c_internal_allocator_arena_commit(CAllocator* self, size_t required_capacity);
+static void                         c_internal_allocator_arena_release_tail(CAllocator* self);
+static CAllocator*                  c_internal_allocator_pool_create(size_t object_size, size_t alignment, size_t objects_per_chunk, bool is_sized);
+static inline bool                  c_internal_allocator_pool_owns(CAllocator* self, size_t size, size_t align);
+static bool                         c_internal_allocator_pool_add_chunk(CAllocator* self);
+static inline size_t                c_internal_allocator_log2(size_t value);
+static inline size_t                c_internal_allocator_slab_class(size_t size);
+static inline size_t                c_internal_allocator_slab_class_size(size_t class_index);
+static CSlabThreadCache*            c_internal_allocator_slab_thread_cache(CSlab* slab);
+static void                         c_internal_allocator_slab_thread_cache_destroy(void* thread_cache);
+static bool                         c_internal_allocator_slab_refill(CSlab* slab, CSlabThreadCache* cache, size_t class_index);
+static void                         c_internal_allocator_slab_flush(CSlab* slab, CSlabThreadCache* cache, size_t class_index, size_t count);
+static void*                        c_internal_allocator_concurrent_arena_bump(CConcurrentArena* arena, size_t size, size_t min_size, size_t align, size_t* out_size);
+static CConcurrentArenaThreadCache* c_internal_allocator_concurrent_arena_thread_cache(CConcurrentArena* arena);
+static void                         c_internal_allocator_concurrent_arena_thread_cache_destroy(void* thread_cache);
 
 #define C_INTERNAL_ALLOCATOR_DEFINE(name)                                                                                         \
   static void* c_internal_allocator_##name##_alloc(CAllocator* self, size_t size, size_t align);                                  \
   static void* c_internal_allocator_##name##_resize(CAllocator* self, void* mem, size_t old_size, size_t new_size, size_t align); \
-  static void  c_internal_allocator_##name##_free(CAllocator* self, void* mem);
+  static void  c_internal_allocator_##name##_free(CAllocator* self, void* mem, size_t size, size_t align);
 C_INTERNAL_ALLOCATOR_DEFINE(default)
 C_INTERNAL_ALLOCATOR_DEFINE(arena)
 C_INTERNAL_ALLOCATOR_DEFINE(fixed_buffer)
+C_INTERNAL_ALLOCATOR_DEFINE(pool)
+C_INTERNAL_ALLOCATOR_DEFINE(slab)
+C_INTERNAL_ALLOCATOR_DEFINE(concurrent_arena)
 
 // default allocator
 static CAllocator c_allocator_default__ = {
@@ -72,24 +274,45 @@ CAllocator* c_allocator_default(void)
 //--------------------------------- Arena --------------------------------- //
 CAllocator* c_allocator_arena_create(size_t capacity)
 {
+  return c_internal_allocator_arena_create(capacity, false);
+}
+
+CAllocator* c_allocator_arena_create_growable(size_t initial_capacity)
+{
+  return c_internal_allocator_arena_create(initial_capacity, true);
+}
+
+CAllocator* c_allocator_arena_create_virtual(size_t reserve_size, int flags)
+{
+  if (reserve_size == 0) {
+    c_error_set(C_ERROR_invalid_size);
+    return NULL;
+  }
+
   CAllocator* allocator = malloc(sizeof(CAllocator));
   if (!allocator) {
     c_error_set(C_ERROR_mem_allocation);
     return NULL;
   }
 
-  allocator->main_mem.buf = malloc(capacity);
-  if (!allocator->main_mem.buf) {
+  size_t page_size  = 0;
+  bool   is_hugetlb = true;
+  void*  buf        = c_internal_allocator_virtual_reserve(&reserve_size, flags, &page_size, &is_hugetlb);
+  if (!buf) {
     free(allocator);
     c_error_set(C_ERROR_mem_allocation);
     return NULL;
   }
 
-  allocator->main_mem.capacity     = capacity;
-  allocator->main_mem.current_size = 0;
-  allocator->vtable                = (CAllocatorVTable){.alloc  = c_internal_allocator_arena_alloc,
-                                                        .resize = c_internal_allocator_arena_resize,
-                                                        .free   = c_internal_allocator_arena_free};
+  *allocator = (CAllocator){
+      .main_mem.buf     = buf,
+      .arena.reserved   = reserve_size,
+      .arena.page_size  = page_size,
+      .arena.flags      = flags,
+      .arena.is_hugetlb = is_hugetlb,
+      .vtable           = (CAllocatorVTable){.alloc  = c_internal_allocator_arena_alloc,
+                                             .resize = c_internal_allocator_arena_resize,
+                                             .free   = c_internal_allocator_arena_free}};
 
   return allocator;
 }
@@ -97,12 +320,54 @@ CAllocator* c_allocator_arena_create(size_t capacity)
 void c_allocator_arena_destroy(CAllocator* self)
 {
   if (self) {
-    free(self->main_mem.buf);
+    if (self->arena.reserved) {
+#ifdef _WIN32
+      VirtualFree(self->main_mem.buf, 0, MEM_RELEASE);
+#else
+      munmap(self->main_mem.buf, self->arena.reserved);
+#endif
+    }
+    CArenaBlock* block = self->arena.first;
+    while (block) {
+      CArenaBlock* next = block->next;
+      free(block);
+      block = next;
+    }
     *self = (CAllocator){0};
     free(self);
   }
 }
 
+void c_allocator_arena_reset(CAllocator* self)
+{
+  assert(self);
+
+  if (self->arena.first) c_internal_allocator_arena_use_block(self, self->arena.first);
+  self->main_mem.current_size = 0;
+  if (self->arena.flags & C_ALLOCATOR_ARENA_FLAG_release_on_reset) c_internal_allocator_arena_release_tail(self);
+  c_stats_drop(self, 0, 0);
+}
+
+CAllocatorArenaMark c_allocator_arena_mark(CAllocator* self)
+{
+  assert(self);
+
+  return (CAllocatorArenaMark){.block      = self->arena.current,
+                               .offset     = self->main_mem.current_size,
+                               .live_bytes = c_stats_live_bytes(self),
+                               .live_count = c_stats_live_count(self)};
+}
+
+void c_allocator_arena_rewind_to_mark(CAllocator* self, CAllocatorArenaMark mark)
+{
+  assert(self);
+  assert(mark.block == NULL || self->arena.first);
+
+  if (mark.block) c_internal_allocator_arena_use_block(self, mark.block);
+  self->main_mem.current_size = mark.offset;
+  c_stats_drop(self, mark.live_bytes, mark.live_count);
+}
+
 //----------------------------- Fixed buffer ----------------------------- //
 CAllocator* c_allocator_fixed_buffer_create(void* buffer, size_t buffer_size)
 {
@@ -112,12 +377,12 @@ CAllocator* c_allocator_fixed_buffer_create(void* buffer, size_t buffer_size)
     return NULL;
   }
 
-  allocator->main_mem.buf          = buffer;
-  allocator->main_mem.capacity     = buffer_size;
-  allocator->main_mem.current_size = 0;
-  allocator->vtable                = (CAllocatorVTable){.alloc  = c_internal_allocator_fixed_buffer_alloc,
-                                                        .resize = c_internal_allocator_fixed_buffer_resize,
-                                                        .free   = c_internal_allocator_fixed_buffer_free};
+  *allocator = (CAllocator){
+      .main_mem.buf      = buffer,
+      .main_mem.capacity = buffer_size,
+      .vtable            = (CAllocatorVTable){.alloc  = c_internal_allocator_fixed_buffer_alloc,
+                                              .resize = c_internal_allocator_fixed_buffer_resize,
+                                              .free   = c_internal_allocator_fixed_buffer_free}};
 
   return allocator;
 }
@@ -130,6 +395,171 @@ void c_allocator_fixed_buffer_destroy(CAllocator* self)
   }
 }
 
+//--------------------------------- Pool --------------------------------- //
+CAllocator* c_allocator_pool_create(size_t object_size, size_t alignment, size_t objects_per_chunk)
+{
+  return c_internal_allocator_pool_create(object_size, alignment, objects_per_chunk, false);
+}
+
+CAllocator* c_allocator_pool_create_sized(size_t object_size, size_t alignment, size_t objects_per_chunk)
+{
+  return c_internal_allocator_pool_create(object_size, alignment, objects_per_chunk, true);
+}
+
+void c_allocator_pool_destroy(CAllocator* self)
+{
+  if (self) {
+    CPoolChunk* chunk = self->pool.chunks;
+    while (chunk) {
+      CPoolChunk* next = chunk->next;
+      c_mem_free(chunk);
+      chunk = next;
+    }
+    *self = (CAllocator){0};
+    free(self);
+  }
+}
+
+//--------------------------------- Slab --------------------------------- //
+CAllocator* c_allocator_slab_create(void)
+{
+  CAllocator* allocator = malloc(sizeof(CAllocator));
+  CSlab*      slab      = calloc(1, sizeof(CSlab));
+  if (!allocator || !slab) goto ON_ERROR;
+
+  if (tss_create(&slab->thread_cache_key, c_internal_allocator_slab_thread_cache_destroy) != thrd_success) goto ON_ERROR;
+  if (mtx_init(&slab->thread_caches_lock, mtx_plain) != thrd_success) {
+    tss_delete(slab->thread_cache_key);
+    goto ON_ERROR;
+  }
+  for (size_t iii = 0; iii < C_SLAB_CLASSES_COUNT; ++iii) {
+    if (mtx_init(&slab->depots[iii].lock, mtx_plain) != thrd_success) {
+      while (iii--) mtx_destroy(&slab->depots[iii].lock);
+      mtx_destroy(&slab->thread_caches_lock);
+      tss_delete(slab->thread_cache_key);
+      goto ON_ERROR;
+    }
+  }
+
+  *allocator = (CAllocator){
+      .slab   = slab,
+      .vtable = (CAllocatorVTable){.alloc  = c_internal_allocator_slab_alloc,
+                                   .resize = c_internal_allocator_slab_resize,
+                                   .free   = c_internal_allocator_slab_free}};
+
+  return allocator;
+
+ON_ERROR:
+  free(allocator);
+  free(slab);
+  c_error_set(C_ERROR_mem_allocation);
+  return NULL;
+}
+
+void c_allocator_slab_destroy(CAllocator* self)
+{
+  if (self) {
+    CSlab* slab = self->slab;
+
+    // this will not call the destructor of the thread caches
+    tss_delete(slab->thread_cache_key);
+
+    CSlabThreadCache* cache = slab->thread_caches;
+    while (cache) {
+      CSlabThreadCache* next = cache->next;
+      free(cache);
+      cache = next;
+    }
+    mtx_destroy(&slab->thread_caches_lock);
+
+    for (size_t iii = 0; iii < C_SLAB_CLASSES_COUNT; ++iii) {
+      CSlabSpan* span = slab->depots[iii].spans;
+      while (span) {
+        CSlabSpan* next = span->next;
+        c_mem_free(span);
+        span = next;
+      }
+      mtx_destroy(&slab->depots[iii].lock);
+    }
+
+    free(slab);
+    *self = (CAllocator){0};
+    free(self);
+  }
+}
+
+//--------------------------- Concurrent Arena --------------------------- //
+CAllocator* c_allocator_concurrent_arena_create(size_t capacity)
+{
+  if (capacity == 0) {
+    c_error_set(C_ERROR_invalid_capacity);
+    return NULL;
+  }
+
+  CAllocator*       allocator = malloc(sizeof(CAllocator));
+  CConcurrentArena* arena     = calloc(1, sizeof(CConcurrentArena));
+  char*             buf       = c_mem_alloc(capacity, C_CONCURRENT_ARENA_ALIGNMENT);
+  if (!allocator || !arena || !buf) goto ON_ERROR;
+
+  if (tss_create(&arena->thread_cache_key, c_internal_allocator_concurrent_arena_thread_cache_destroy) != thrd_success) goto ON_ERROR;
+  if (mtx_init(&arena->thread_caches_lock, mtx_plain) != thrd_success) {
+    tss_delete(arena->thread_cache_key);
+    goto ON_ERROR;
+  }
+  atomic_init(&arena->offset, 0);
+  atomic_init(&arena->epoch, 0);
+  arena->buf      = buf;
+  arena->capacity = capacity;
+
+  *allocator = (CAllocator){
+      .concurrent_arena = arena,
+      .vtable           = (CAllocatorVTable){.alloc  = c_internal_allocator_concurrent_arena_alloc,
+                                             .resize = c_internal_allocator_concurrent_arena_resize,
+                                             .free   = c_internal_allocator_concurrent_arena_free}};
+
+  return allocator;
+
+ON_ERROR:
+  free(allocator);
+  free(arena);
+  if (buf) c_mem_free(buf);
+  c_error_set(C_ERROR_mem_allocation);
+  return NULL;
+}
+
+void c_allocator_concurrent_arena_reset(CAllocator* self)
+{
+  assert(self);
+
+  atomic_store_explicit(&self->concurrent_arena->offset, 0, memory_order_relaxed);
+  // the sub-chunks hold by the threads are dropped on their next allocation
+  atomic_fetch_add_explicit(&self->concurrent_arena->epoch, 1, memory_order_release);
+  c_stats_drop(self, 0, 0);
+}
+
+void c_allocator_concurrent_arena_destroy(CAllocator* self)
+{
+  if (self) {
+    CConcurrentArena* arena = self->concurrent_arena;
+
+    // this will not call the destructor of the thread caches
+    tss_delete(arena->thread_cache_key);
+
+    CConcurrentArenaThreadCache* cache = arena->thread_caches;
+    while (cache) {
+      CConcurrentArenaThreadCache* next = cache->next;
+      free(cache);
+      cache = next;
+    }
+    mtx_destroy(&arena->thread_caches_lock);
+
+    c_mem_free(arena->buf);
+    free(arena);
+    *self = (CAllocator){0};
+    free(self);
+  }
+}
+
 void* c_allocator_alloc(CAllocator* self, size_t size, size_t alignment, bool set_mem_to_zero)
 {
   assert(self);
@@ -143,12 +573,16 @@ void* c_allocator_alloc(CAllocator* self, size_t size, size_t alignment, bool se
     return NULL;
   }
 
-  CMemory* new_memory = self->vtable.alloc(self, size + sizeof(*new_memory), alignment);
-  if (!new_memory) {
+  size_t header_size = c_internal_allocator_header_size(alignment);
+  char*  block       = self->vtable.alloc(self, size + header_size, c_internal_allocator_real_alignment(alignment));
+  if (!block) {
     c_error_set(C_ERROR_mem_allocation);
     return NULL;
   }
 
+  c_stats_alloc(self, size);
+
+  CMemory* new_memory   = TO_CMEMORY(block + header_size);
   new_memory->size      = size;
   new_memory->alignment = alignment;
   if (set_mem_to_zero) memset(new_memory->data, 0, size);
@@ -169,14 +603,19 @@ void* c_allocator_resize(CAllocator* self, void* memory, size_t new_size)
     return memory;
   }
 
-  CMemory* old_mem = TO_CMEMORY(memory);
-  CMemory* new_mem = self->vtable.resize(self, old_mem, old_mem->size + sizeof(*old_mem), new_size + sizeof(*old_mem), old_mem->alignment);
-  if (!new_mem) {
+  CMemory* old_mem     = TO_CMEMORY(memory);
+  size_t   old_size    = old_mem->size;
+  size_t   header_size = c_internal_allocator_header_size(old_mem->alignment);
+  char*    new_block   = self->vtable.resize(self, (char*)memory - header_size, old_size + header_size, new_size + header_size, c_internal_allocator_real_alignment(old_mem->alignment));
+  if (!new_block) {
     c_error_set(C_ERROR_mem_allocation);
     return NULL;
   }
 
-  new_mem->size = new_size;
+  c_stats_resize(self, old_size, new_size);
+
+  CMemory* new_mem = TO_CMEMORY(new_block + header_size);
+  new_mem->size    = new_size;
 
   return new_mem->data;
 }
@@ -184,7 +623,75 @@ void* c_allocator_resize(CAllocator* self, void* memory, size_t new_size)
 void c_allocator_free(CAllocator* self, void* memory)
 {
   assert(self);
-  if (memory) self->vtable.free(self, TO_CMEMORY(memory));
+  if (memory) {
+    CMemory* mem         = TO_CMEMORY(memory);
+    size_t   header_size = c_internal_allocator_header_size(mem->alignment);
+    c_stats_free(self, mem->size);
+    self->vtable.free(self, (char*)memory - header_size, mem->size + header_size, c_internal_allocator_real_alignment(mem->alignment));
+  }
+}
+
+void* c_allocator_alloc_sized(CAllocator* self, size_t size, size_t alignment, bool set_mem_to_zero)
+{
+  assert(self);
+
+  if (size == 0) {
+    c_error_set(C_ERROR_invalid_size);
+    return NULL;
+  }
+  if ((alignment == 0) || (size % alignment != 0)) {
+    c_error_set(C_ERROR_invalid_alignment);
+    return NULL;
+  }
+
+  void* mem = self->vtable.alloc(self, size, c_internal_allocator_sized_alignment(alignment));
+  if (!mem) {
+    c_error_set(C_ERROR_mem_allocation);
+    return NULL;
+  }
+
+  c_stats_alloc(self, size);
+
+  if (set_mem_to_zero) memset(mem, 0, size);
+
+  return mem;
+}
+
+void* c_allocator_resize_sized(CAllocator* self, void* memory, size_t old_size, size_t new_size, size_t alignment)
+{
+  assert(self);
+
+  if (!memory) {
+    c_error_set(C_ERROR_null_ptr);
+    return NULL;
+  }
+  if (new_size == 0) {
+    c_error_set(C_ERROR_invalid_size);
+    return NULL;
+  }
+  if (alignment == 0) {
+    c_error_set(C_ERROR_invalid_alignment);
+    return NULL;
+  }
+
+  void* new_mem = self->vtable.resize(self, memory, old_size, new_size, c_internal_allocator_sized_alignment(alignment));
+  if (!new_mem) {
+    c_error_set(C_ERROR_mem_allocation);
+    return NULL;
+  }
+
+  c_stats_resize(self, old_size, new_size);
+
+  return new_mem;
+}
+
+void c_allocator_free_sized(CAllocator* self, void* memory, size_t size, size_t alignment)
+{
+  assert(self);
+  if (memory) {
+    c_stats_free(self, size);
+    self->vtable.free(self, memory, size, c_internal_allocator_sized_alignment(alignment));
+  }
 }
 
 size_t c_allocator_mem_size(void* memory)
@@ -197,14 +704,269 @@ size_t c_allocator_mem_alignment(void* memory)
   return TO_CMEMORY(memory)->alignment;
 }
 
+bool c_allocator_stats(CAllocator* self, CAllocatorStats* out_stats)
+{
+  assert(self);
+
+  if (!out_stats) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+#ifdef ANYLIBS_ENABLE_ALLOCATOR_STATS
+  out_stats->live_bytes          = c_stats_counter_load(self->stats.live_bytes);
+  out_stats->peak_bytes          = c_stats_counter_load(self->stats.peak_bytes);
+  out_stats->alloc_count         = c_stats_counter_load(self->stats.alloc_count);
+  out_stats->resize_count        = c_stats_counter_load(self->stats.resize_count);
+  out_stats->free_count          = c_stats_counter_load(self->stats.free_count);
+  out_stats->resize_copied_bytes = c_stats_counter_load(self->stats.resize_copied_bytes);
+  for (size_t iii = 0; iii < C_ALLOCATOR_STATS_SIZE_CLASSES_COUNT; ++iii) {
+    out_stats->size_classes[iii] = c_stats_counter_load(self->stats.size_classes[iii]);
+  }
+  return true;
+#else
+  *out_stats = (CAllocatorStats){0};
+  return false;
+#endif
+}
+
 // ----------------------------------- internal
 // ----------------------------------- //
 
+/// @brief the alignment requested by the user could be any divisor of the
+///        size (@ref c_vec_create use the element size), the real alignment
+///        is the largest power of 2 that divides it, and it is at least the
+///        alignment of the @ref CMemory header
+size_t c_internal_allocator_real_alignment(size_t alignment)
+{
+  size_t real_alignment = alignment & (~alignment + 1);
+  return real_alignment < alignof(CMemory) ? alignof(CMemory) : real_alignment;
+}
+
+/// @brief the header is placed right before the data, and padded so the data
+///        keeps the alignment of the allocated block
+size_t c_internal_allocator_header_size(size_t alignment)
+{
+  size_t real_alignment = c_internal_allocator_real_alignment(alignment);
+  return sizeof(CMemory) < real_alignment ? real_alignment : sizeof(CMemory);
+}
+
+/// @brief the sized allocations don't have a header, so the alignment could
+///        be lower than alignof(CMemory)
+size_t c_internal_allocator_sized_alignment(size_t alignment)
+{
+  return alignment & (~alignment + 1);
+}
+
+/// @brief align is always a power of 2
+uintptr_t c_internal_allocator_align_forward(uintptr_t address, size_t align)
+{
+  return (address + (align - 1)) & ~(uintptr_t)(align - 1);
+}
+
+CAllocator* c_internal_allocator_arena_create(size_t capacity, bool growable)
+{
+  CAllocator* allocator = malloc(sizeof(CAllocator));
+  if (!allocator) {
+    c_error_set(C_ERROR_mem_allocation);
+    return NULL;
+  }
+
+  CArenaBlock* block = malloc(sizeof(CArenaBlock) + capacity);
+  if (!block) {
+    free(allocator);
+    c_error_set(C_ERROR_mem_allocation);
+    return NULL;
+  }
+  block->next     = NULL;
+  block->capacity = capacity;
+
+  *allocator = (CAllocator){
+      .arena.first    = block,
+      .arena.growable = growable,
+      .vtable         = (CAllocatorVTable){.alloc  = c_internal_allocator_arena_alloc,
+                                           .resize = c_internal_allocator_arena_resize,
+                                           .free   = c_internal_allocator_arena_free}};
+  c_internal_allocator_arena_use_block(allocator, block);
+
+  return allocator;
+}
+
+void c_internal_allocator_arena_use_block(CAllocator* self, CArenaBlock* block)
+{
+  self->arena.current         = block;
+  self->main_mem.buf          = block->data;
+  self->main_mem.capacity     = block->capacity;
+  self->main_mem.current_size = 0;
+}
+
+/// @brief the current block is exhausted, move to the next chained block
+///        (if any is big enough) or chain a new one
+void* c_internal_allocator_arena_alloc_slow(CAllocator* self, size_t size, size_t align)
+{
+  if (self->arena.reserved) {
+    uintptr_t base   = (uintptr_t)self->main_mem.buf;
+    size_t    offset = c_internal_allocator_align_forward(base + self->main_mem.current_size, align) - base;
+    if ((offset > self->arena.reserved) || (self->arena.reserved - offset < size)) return NULL;
+    if (!c_internal_allocator_arena_commit(self, offset + size)) return NULL;
+    return c_internal_allocator_arena_alloc(self, size, align);
+  }
+  if (!self->arena.growable) return NULL;
+
+  // worst case, we need (align - 1) bytes for padding
+  size_t required_capacity = size + align - 1;
+
+  CArenaBlock* current = self->arena.current;
+  if (current->next && current->next->capacity >= required_capacity) {
+    c_internal_allocator_arena_use_block(self, current->next);
+    return c_internal_allocator_arena_alloc(self, size, align);
+  }
+
+  size_t new_capacity = current->capacity * 2;
+  if (new_capacity < required_capacity) new_capacity = required_capacity;
+
+  CArenaBlock* block = malloc(sizeof(CArenaBlock) + new_capacity);
+  if (!block) return NULL;
+  block->capacity = new_capacity;
+  block->next     = current->next;
+  current->next   = block;
+
+  c_internal_allocator_arena_use_block(self, block);
+  return c_internal_allocator_arena_alloc(self, size, align);
+}
+
+size_t c_internal_allocator_page_size(void)
+{
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+#else
+  long page_size = sysconf(_SC_PAGESIZE);
+  return page_size > 0 ? (size_t)page_size : C_ALLOCATOR_MIN_PAGE_SIZE;
+#endif
+}
+
+/// @brief reserve address space without committing it, reserve_size is
+///        rounded up to a multiple of the commit granularity (page_size)
+/// @param is_hugetlb in: explicit huge pages could be used, out: they are used
+void* c_internal_allocator_virtual_reserve(size_t* reserve_size, int flags, size_t* page_size, bool* is_hugetlb)
+{
+  bool allow_hugetlb = *is_hugetlb;
+  *is_hugetlb        = false;
+  *page_size         = c_internal_allocator_page_size();
+#ifdef _WIN32
+  // large pages on Windows require a privilege and can't be committed lazily
+  (void)flags;
+  (void)allow_hugetlb;
+  *reserve_size = c_internal_allocator_align_forward(*reserve_size, *page_size);
+  return VirtualAlloc(NULL, *reserve_size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+  void* mem = MAP_FAILED;
+  if (flags & C_ALLOCATOR_ARENA_FLAG_huge_pages) {
+    // commit whole huge pages, so the kernel could back them with huge pages
+    if (*page_size < C_ALLOCATOR_HUGE_PAGE_SIZE) *page_size = C_ALLOCATOR_HUGE_PAGE_SIZE;
+    *reserve_size = c_internal_allocator_align_forward(*reserve_size, *page_size);
+#if defined(MAP_HUGETLB) && (defined(MAP_HUGE_2MB) || defined(MAP_HUGE_SHIFT))
+    // explicit huge pages are reserved up front, so this fails (instead of
+    // SIGBUS later) if the huge pages pool is too small, their size is
+    // requested explicitly (the default one could be 1 GiB, 512 MiB, ...)
+#ifdef MAP_HUGE_2MB
+    int const huge_2mb = MAP_HUGE_2MB;
+#else
+    int const huge_2mb = 21 << MAP_HUGE_SHIFT;
+#endif
+    if (allow_hugetlb) {
+      mem         = mmap(NULL, *reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge_2mb, -1, 0);
+      *is_hugetlb = mem != MAP_FAILED;
+    }
+#endif
+  }
+  *reserve_size = c_internal_allocator_align_forward(*reserve_size, *page_size);
+
+  if (mem == MAP_FAILED) {
+    int map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    map_flags |= MAP_NORESERVE;
+#endif
+    mem = mmap(NULL, *reserve_size, PROT_NONE, map_flags, -1, 0);
+    if (mem == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+    // transparent huge pages, this is only a hint
+    if (flags & C_ALLOCATOR_ARENA_FLAG_huge_pages) madvise(mem, *reserve_size, MADV_HUGEPAGE);
+#endif
+  }
+  return mem;
+#endif
+}
+
+/// @brief commit pages of the reserved address space, so the committed part
+///        is at least required_capacity, this commits @ref C_ALLOCATOR_COMMIT_STEP
+///        at least to reduce the syscalls
+bool c_internal_allocator_arena_commit(CAllocator* self, size_t required_capacity)
+{
+  size_t committed = self->main_mem.capacity;
+  if (required_capacity <= committed) return true;
+  if (required_capacity > self->arena.reserved) return false;
+
+  size_t new_committed = committed + C_ALLOCATOR_COMMIT_STEP;
+  if (new_committed < required_capacity) new_committed = required_capacity;
+  new_committed = c_internal_allocator_align_forward(new_committed, self->arena.page_size);
+  if (new_committed > self->arena.reserved) new_committed = self->arena.reserved;
+
+  char* start = (char*)self->main_mem.buf + committed;
+#ifdef _WIN32
+  if (!VirtualAlloc(start, new_committed - committed, MEM_COMMIT, PAGE_READWRITE)) return false;
+#else
+  if (mprotect(start, new_committed - committed, PROT_READ | PROT_WRITE) != 0) {
+    // the explicit huge pages can't be committed, the arena is still empty,
+    // so it moves to normal pages (with the transparent huge pages hint)
+    if ((committed != 0) || !self->arena.is_hugetlb) return false;
+
+    size_t reserve_size = self->arena.reserved;
+    size_t page_size;
+    bool   is_hugetlb = false;
+    void*  buf        = c_internal_allocator_virtual_reserve(&reserve_size, self->arena.flags, &page_size, &is_hugetlb);
+    if (!buf) return false;
+
+    munmap(self->main_mem.buf, self->arena.reserved);
+    self->main_mem.buf     = buf;
+    self->arena.reserved   = reserve_size;
+    self->arena.page_size  = page_size;
+    self->arena.is_hugetlb = false;
+    return c_internal_allocator_arena_commit(self, required_capacity);
+  }
+#endif
+  self->main_mem.capacity = new_committed;
+  return true;
+}
+
+/// @brief give the unused committed pages back to the OS, they stay
+///        committed and will be faulted in again (zeroed) when touched
+void c_internal_allocator_arena_release_tail(CAllocator* self)
+{
+  if (!self->arena.reserved) return;
+
+  size_t used = c_internal_allocator_align_forward(self->main_mem.current_size, self->arena.page_size);
+  if (used >= self->main_mem.capacity) return;
+
+  char* start = (char*)self->main_mem.buf + used;
+#ifdef _WIN32
+  VirtualAlloc(start, self->main_mem.capacity - used, MEM_RESET, PAGE_READWRITE);
+#else
+  madvise(start, self->main_mem.capacity - used, MADV_DONTNEED);
+#endif
+}
+
 #ifndef _WIN32
+/// @brief try to grow in place first (realloc could do that), otherwise
+///        allocate a new memory with the same alignment and copy
 void* c_internal_allocator_default_posix_resize(void* mem, size_t old_size, size_t new_size, size_t align)
 {
   if (new_size <= old_size) return mem;
 
+  if (align <= alignof(max_align_t)) return realloc(mem, new_size);
+
   void* new_mem = c_mem_alloc(new_size, align);
   if (!new_mem) return NULL;
 
@@ -214,67 +976,622 @@ void* c_internal_allocator_default_posix_resize(void* mem, size_t old_size, size
 }
 #endif
 
+/// @brief big memory blocks are mapped directly (mmap returns page aligned
+///        memory), so they could be resized by remapping the pages
+bool c_internal_allocator_default_is_mapped(size_t size, size_t align)
+{
+#ifdef C_ALLOCATOR_HAS_MREMAP
+  return (size >= C_ALLOCATOR_MMAP_THRESHOLD) && (align <= C_ALLOCATOR_MIN_PAGE_SIZE);
+#else
+  (void)size;
+  (void)align;
+  return false;
+#endif
+}
+
 void* c_internal_allocator_default_alloc(CAllocator* self, size_t size, size_t align)
 {
   (void)self;
+#ifdef C_ALLOCATOR_HAS_MREMAP
+  if (c_internal_allocator_default_is_mapped(size, align)) {
+    void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return mem != MAP_FAILED ? mem : NULL;
+  }
+#endif
   return c_mem_alloc(size, align);
 }
 
 void* c_internal_allocator_default_resize(CAllocator* self, void* mem, size_t old_size, size_t new_size, size_t align)
 {
-  (void)self;
-  void* resized_mem = c_mem_resize(mem, old_size, new_size, align);
-  return resized_mem ? resized_mem : NULL;
+  bool old_mapped = c_internal_allocator_default_is_mapped(old_size, align);
+  bool new_mapped = c_internal_allocator_default_is_mapped(new_size, align);
+
+  if (!old_mapped && !new_mapped) {
+    void* new_mem = c_mem_resize(mem, old_size, new_size, align);
+    if (new_mem && new_mem != mem) c_stats_copied(self, old_size < new_size ? old_size : new_size);
+    return new_mem;
+  }
+
+#ifdef C_ALLOCATOR_HAS_MREMAP
+  // the kernel will move the pages (if it can't grow in place) without copying
+  if (old_mapped && new_mapped) {
+    void* new_mem = mremap(mem, old_size, new_size, MREMAP_MAYMOVE);
+    return new_mem != MAP_FAILED ? new_mem : NULL;
+  }
+#endif
+
+  // crossing the threshold, the memory has to be moved once
+  void* new_mem = c_internal_allocator_default_alloc(self, new_size, align);
+  if (!new_mem) return NULL;
+
+  memcpy(new_mem, mem, old_size < new_size ? old_size : new_size);
+  c_stats_copied(self, old_size < new_size ? old_size : new_size);
+  c_internal_allocator_default_free(self, mem, old_size, align);
+  return new_mem;
 }
 
-void c_internal_allocator_default_free(CAllocator* self, void* mem)
+void c_internal_allocator_default_free(CAllocator* self, void* mem, size_t size, size_t align)
 {
   (void)self;
+#ifdef C_ALLOCATOR_HAS_MREMAP
+  if (c_internal_allocator_default_is_mapped(size, align)) {
+    munmap(mem, size);
+    return;
+  }
+#endif
   c_mem_free(mem);
 }
 
 void* c_internal_allocator_arena_alloc(CAllocator* self, size_t size, size_t align)
 {
-  // get aligned address first
-  size_t new_data_index = self->main_mem.current_size;
-  while ((new_data_index < self->main_mem.capacity) &&
-         ((intptr_t)((char*)self->main_mem.buf + new_data_index) % align != 0)) {
-    new_data_index++;
-  }
+  uintptr_t base   = (uintptr_t)self->main_mem.buf;
+  size_t    offset = c_internal_allocator_align_forward(base + self->main_mem.current_size, align) - base;
 
-  if ((self->main_mem.capacity - (new_data_index - size)) < size) {
-    c_error_set(C_ERROR_mem_allocation);
-    return NULL;
+  if ((offset > self->main_mem.capacity) || (self->main_mem.capacity - offset < size)) {
+    return c_internal_allocator_arena_alloc_slow(self, size, align);
   }
-  self->main_mem.current_size += size;
+  self->main_mem.current_size = offset + size;
 
-  return &((char*)self->main_mem.buf)[self->main_mem.current_size - size];
+  return (char*)self->main_mem.buf + offset;
 }
 
 void* c_internal_allocator_arena_resize(CAllocator* self, void* mem, size_t old_size, size_t new_size, size_t align)
 {
-  // this is the last allocated block
-  if ((char*)self->main_mem.buf + self->main_mem.current_size - old_size == mem) {
-    self->main_mem.current_size = (self->main_mem.current_size - old_size) + new_size;
+  // this is the last allocated block, and it has enough space
+  uintptr_t mem_address = (uintptr_t)mem;
+  uintptr_t buf_address = (uintptr_t)self->main_mem.buf;
+  if ((mem_address + old_size == buf_address + self->main_mem.current_size) &&
+      (buf_address + self->main_mem.capacity - mem_address >= new_size)) {
+    self->main_mem.current_size = (size_t)(mem_address - buf_address) + new_size;
+    return mem;
+  }
+  if (new_size <= old_size) return mem;
+  // a virtual arena could commit more pages to grow in place
+  if ((mem_address + old_size == buf_address + self->main_mem.current_size) &&
+      c_internal_allocator_arena_commit(self, (size_t)(mem_address - buf_address) + new_size)) {
+    self->main_mem.current_size = (size_t)(mem_address - buf_address) + new_size;
     return mem;
   }
 
   void* new_mem = c_internal_allocator_arena_alloc(self, new_size, align);
-  if (!new_mem) {
+  if (!new_mem) return NULL;
+
+  memcpy(new_mem, mem, old_size);
+  c_stats_copied(self, old_size);
+  return new_mem;
+}
+
+void c_internal_allocator_arena_free(CAllocator* self, void* mem, size_t size, size_t align)
+{
+  (void)align;
+
+  // remove it if this is the last one
+  if ((char*)mem + size == (char*)self->main_mem.buf + self->main_mem.current_size) {
+    self->main_mem.current_size -= size;
+  }
+}
+
+/// @brief is_sized: the slots hold objects of c_allocator_alloc_sized (without
+///        a header), otherwise the objects of c_allocator_alloc with their header
+CAllocator* c_internal_allocator_pool_create(size_t object_size, size_t alignment, size_t objects_per_chunk, bool is_sized)
+{
+  if (object_size == 0) {
+    c_error_set(C_ERROR_invalid_size);
+    return NULL;
+  }
+  if ((alignment == 0) || (object_size % alignment != 0)) {
+    c_error_set(C_ERROR_invalid_alignment);
+    return NULL;
+  }
+  if (objects_per_chunk == 0) {
+    c_error_set(C_ERROR_invalid_capacity);
+    return NULL;
+  }
+
+  CAllocator* allocator = malloc(sizeof(CAllocator));
+  if (!allocator) {
     c_error_set(C_ERROR_mem_allocation);
     return NULL;
   }
 
+  // every slot holds an object, and when it is free, it holds the next free
+  // slot (the chunks start with a pointer, so they are aligned to it at least)
+  size_t pool_alignment;
+  size_t slot_size;
+  if (is_sized) {
+    pool_alignment = c_internal_allocator_sized_alignment(alignment);
+    if (pool_alignment < alignof(CPoolChunk)) pool_alignment = alignof(CPoolChunk);
+    slot_size = object_size;
+  } else {
+    pool_alignment = c_internal_allocator_real_alignment(alignment);
+    slot_size      = object_size + c_internal_allocator_header_size(alignment);
+  }
+  if (slot_size < sizeof(void*)) slot_size = sizeof(void*);
+  slot_size = c_internal_allocator_align_forward(slot_size, pool_alignment);
+
+  *allocator = (CAllocator){
+      .pool.slot_size         = slot_size,
+      .pool.alignment         = pool_alignment,
+      .pool.objects_per_chunk = objects_per_chunk,
+      .vtable                 = (CAllocatorVTable){.alloc  = c_internal_allocator_pool_alloc,
+                                                   .resize = c_internal_allocator_pool_resize,
+                                                   .free   = c_internal_allocator_pool_free}};
+
+  return allocator;
+}
+
+bool c_internal_allocator_pool_owns(CAllocator* self, size_t size, size_t align)
+{
+  return (size <= self->pool.slot_size) && (align <= self->pool.alignment);
+}
+
+bool c_internal_allocator_pool_add_chunk(CAllocator* self)
+{
+  size_t      header_size = c_internal_allocator_align_forward(sizeof(CPoolChunk), self->pool.alignment);
+  CPoolChunk* chunk       = c_mem_alloc(header_size + (self->pool.slot_size * self->pool.objects_per_chunk), self->pool.alignment);
+  if (!chunk) return false;
+
+  chunk->next       = self->pool.chunks;
+  self->pool.chunks = chunk;
+
+  // link the slots in address order, so consecutive allocations are adjacent
+  char* slots = (char*)chunk + header_size;
+  for (size_t iii = 0; iii < self->pool.objects_per_chunk; ++iii) {
+    void* next_slot = (iii + 1 < self->pool.objects_per_chunk) ? slots + ((iii + 1) * self->pool.slot_size) : self->pool.free_list;
+    memcpy(slots + (iii * self->pool.slot_size), &next_slot, sizeof(next_slot));
+  }
+  self->pool.free_list = slots;
+
+  return true;
+}
+
+void* c_internal_allocator_pool_alloc(CAllocator* self, size_t size, size_t align)
+{
+  if (!c_internal_allocator_pool_owns(self, size, align)) {
+    return c_internal_allocator_default_alloc(self, size, align);
+  }
+
+  if (!self->pool.free_list && !c_internal_allocator_pool_add_chunk(self)) return NULL;
+
+  void* slot = self->pool.free_list;
+  memcpy(&self->pool.free_list, slot, sizeof(self->pool.free_list));
+  return slot;
+}
+
+void* c_internal_allocator_pool_resize(CAllocator* self, void* mem, size_t old_size, size_t new_size, size_t align)
+{
+  bool old_owned = c_internal_allocator_pool_owns(self, old_size, align);
+  bool new_owned = c_internal_allocator_pool_owns(self, new_size, align);
+
+  if (old_owned && new_owned) return mem;
+  if (!old_owned && !new_owned) return c_internal_allocator_default_resize(self, mem, old_size, new_size, align);
+
+  // moving between a slot and the fallback allocator
+  void* new_mem = c_internal_allocator_pool_alloc(self, new_size, align);
+  if (!new_mem) return NULL;
+
+  memcpy(new_mem, mem, old_size < new_size ? old_size : new_size);
+  c_stats_copied(self, old_size < new_size ? old_size : new_size);
+  c_internal_allocator_pool_free(self, mem, old_size, align);
+  return new_mem;
+}
+
+void c_internal_allocator_pool_free(CAllocator* self, void* mem, size_t size, size_t align)
+{
+  if (!c_internal_allocator_pool_owns(self, size, align)) {
+    c_internal_allocator_default_free(self, mem, size, align);
+    return;
+  }
+
+  memcpy(mem, &self->pool.free_list, sizeof(self->pool.free_list));
+  self->pool.free_list = mem;
+}
+
+size_t c_internal_allocator_log2(size_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (sizeof(unsigned long long) * 8U) - 1U - (size_t)__builtin_clzll((unsigned long long)value);
+#else
+  size_t result = 0;
+  while (value >>= 1) result++;
+  return result;
+#endif
+}
+
+#ifdef ANYLIBS_ENABLE_ALLOCATOR_STATS
+void c_internal_allocator_stats_alloc(CAllocatorStatsCounters* stats, size_t size)
+{
+  c_stats_counter_add(stats->alloc_count, 1);
+  c_stats_counter_add(stats->size_classes[c_internal_allocator_log2(size)], 1);
+  c_internal_allocator_stats_update_peak(stats, c_stats_counter_add(stats->live_bytes, size) + size);
+}
+
+void c_internal_allocator_stats_resize(CAllocatorStatsCounters* stats, size_t old_size, size_t new_size)
+{
+  c_stats_counter_add(stats->resize_count, 1);
+  if (new_size > old_size) {
+    c_internal_allocator_stats_update_peak(stats, c_stats_counter_add(stats->live_bytes, new_size - old_size) + (new_size - old_size));
+  } else {
+    c_stats_counter_sub(stats->live_bytes, old_size - new_size);
+  }
+}
+
+void c_internal_allocator_stats_free(CAllocatorStatsCounters* stats, size_t size)
+{
+  c_stats_counter_add(stats->free_count, 1);
+  c_stats_counter_sub(stats->live_bytes, size);
+}
+
+/// @brief the allocations dropped at once (by an arena reset or rewind) are
+///        counted as freed, down to live_bytes in live_count allocations
+void c_internal_allocator_stats_drop(CAllocatorStatsCounters* stats, size_t live_bytes, size_t live_count)
+{
+  size_t current_bytes = c_stats_counter_load(stats->live_bytes);
+  if (current_bytes > live_bytes) c_stats_counter_sub(stats->live_bytes, current_bytes - live_bytes);
+
+  size_t current_count = c_stats_counter_load(stats->alloc_count) - c_stats_counter_load(stats->free_count);
+  if (current_count > live_count) c_stats_counter_add(stats->free_count, current_count - live_count);
+}
+
+void c_internal_allocator_stats_update_peak(CAllocatorStatsCounters* stats, size_t live_bytes)
+{
+  size_t peak_bytes = atomic_load_explicit(&stats->peak_bytes, memory_order_relaxed);
+  while (peak_bytes < live_bytes &&
+         !atomic_compare_exchange_weak_explicit(&stats->peak_bytes, &peak_bytes, live_bytes, memory_order_relaxed, memory_order_relaxed)) {
+  }
+}
+#endif
+
+/// @brief size is in (0, C_SLAB_MAX_SIZE]
+size_t c_internal_allocator_slab_class(size_t size)
+{
+  if (size <= 128) return (size + 15) / 16 - 1;
+
+  // 4 classes for every (2^k, 2^(k+1)]
+  size_t k = c_internal_allocator_log2(size - 1);
+  return 8 + ((k - 7) * 4) + (((size - 1) >> (k - 2)) & 3);
+}
+
+size_t c_internal_allocator_slab_class_size(size_t class_index)
+{
+  if (class_index < 8) return (class_index + 1) * 16;
+
+  size_t k = 7 + ((class_index - 8) / 4);
+  return ((size_t)1 << k) + ((((class_index - 8) % 4) + 1) << (k - 2));
+}
+
+CSlabThreadCache* c_internal_allocator_slab_thread_cache(CSlab* slab)
+{
+  CSlabThreadCache* cache = tss_get(slab->thread_cache_key);
+  if (cache) return cache;
+
+  cache = calloc(1, sizeof(CSlabThreadCache));
+  if (!cache) return NULL;
+  cache->slab = slab;
+
+  if (tss_set(slab->thread_cache_key, cache) != thrd_success) {
+    free(cache);
+    return NULL;
+  }
+
+  mtx_lock(&slab->thread_caches_lock);
+  cache->next         = slab->thread_caches;
+  slab->thread_caches = cache;
+  mtx_unlock(&slab->thread_caches_lock);
+
+  return cache;
+}
+
+/// @brief called on thread exit, return all cached objects to the depots
+void c_internal_allocator_slab_thread_cache_destroy(void* thread_cache)
+{
+  CSlabThreadCache* cache = thread_cache;
+  CSlab*            slab  = cache->slab;
+
+  for (size_t iii = 0; iii < C_SLAB_CLASSES_COUNT; ++iii) {
+    while (cache->magazines[iii].count > 0) {
+      size_t count = cache->magazines[iii].count < C_SLAB_BATCH_SIZE ? cache->magazines[iii].count : C_SLAB_BATCH_SIZE;
+      c_internal_allocator_slab_flush(slab, cache, iii, count);
+    }
+  }
+
+  mtx_lock(&slab->thread_caches_lock);
+  for (CSlabThreadCache** link = &slab->thread_caches; *link; link = &(*link)->next) {
+    if (*link == cache) {
+      *link = cache->next;
+      break;
+    }
+  }
+  mtx_unlock(&slab->thread_caches_lock);
+
+  free(cache);
+}
+
+/// @brief fill the empty magazine with one batch from the depot, or carve a
+///        new one from the current span
+bool c_internal_allocator_slab_refill(CSlab* slab, CSlabThreadCache* cache, size_t class_index)
+{
+  CSlabDepot* depot      = &slab->depots[class_index];
+  size_t      class_size = c_internal_allocator_slab_class_size(class_index);
+  void**      objects    = cache->magazines[class_index].objects;
+
+  mtx_lock(&depot->lock);
+
+  if (depot->batches) {
+    void* object = depot->batches;
+    memcpy(&depot->batches, (void**)object + 1, sizeof(void*));
+    mtx_unlock(&depot->lock);
+
+    size_t count = 0;
+    while (object) {
+      objects[count++] = object;
+      memcpy(&object, object, sizeof(void*));
+    }
+    cache->magazines[class_index].count = count;
+    return true;
+  }
+
+  if ((size_t)(depot->span_end - depot->span_cursor) < class_size * C_SLAB_BATCH_SIZE) {
+    size_t header_size = c_internal_allocator_align_forward(sizeof(CSlabSpan), C_SLAB_ALIGNMENT);
+    size_t span_size   = class_size * C_SLAB_BATCH_SIZE < C_SLAB_SPAN_SIZE ? C_SLAB_SPAN_SIZE : class_size * C_SLAB_BATCH_SIZE;
+
+    CSlabSpan* span = c_mem_alloc(header_size + span_size, C_SLAB_ALIGNMENT);
+    if (!span) {
+      mtx_unlock(&depot->lock);
+      return false;
+    }
+    span->next         = depot->spans;
+    depot->spans       = span;
+    depot->span_cursor = (char*)span + header_size;
+    depot->span_end    = depot->span_cursor + span_size;
+  }
+
+  // in reverse, so the objects are handed out in address order
+  for (size_t iii = 0; iii < C_SLAB_BATCH_SIZE; ++iii) {
+    objects[C_SLAB_BATCH_SIZE - 1 - iii] = depot->span_cursor;
+    depot->span_cursor += class_size;
+  }
+
+  mtx_unlock(&depot->lock);
+  cache->magazines[class_index].count = C_SLAB_BATCH_SIZE;
+  return true;
+}
+
+/// @brief move count objects from the top of the magazine to the depot as one batch
+void c_internal_allocator_slab_flush(CSlab* slab, CSlabThreadCache* cache, size_t class_index, size_t count)
+{
+  CSlabDepot* depot   = &slab->depots[class_index];
+  void**      objects = cache->magazines[class_index].objects + (cache->magazines[class_index].count - count);
+
+  for (size_t iii = 0; iii < count; ++iii) {
+    void* next = (iii + 1 < count) ? objects[iii + 1] : NULL;
+    memcpy(objects[iii], &next, sizeof(void*));
+  }
+
+  mtx_lock(&depot->lock);
+  memcpy((void**)objects[0] + 1, &depot->batches, sizeof(void*));
+  depot->batches = objects[0];
+  mtx_unlock(&depot->lock);
+
+  cache->magazines[class_index].count -= count;
+}
+
+void* c_internal_allocator_slab_alloc(CAllocator* self, size_t size, size_t align)
+{
+  if ((size > C_SLAB_MAX_SIZE) || (align > C_SLAB_ALIGNMENT)) {
+    return c_internal_allocator_default_alloc(self, size, align);
+  }
+
+  CSlabThreadCache* cache = c_internal_allocator_slab_thread_cache(self->slab);
+  if (!cache) return NULL;
+
+  size_t class_index = c_internal_allocator_slab_class(size);
+  if (cache->magazines[class_index].count == 0 && !c_internal_allocator_slab_refill(self->slab, cache, class_index)) {
+    return NULL;
+  }
+
+  return cache->magazines[class_index].objects[--cache->magazines[class_index].count];
+}
+
+void* c_internal_allocator_slab_resize(CAllocator* self, void* mem, size_t old_size, size_t new_size, size_t align)
+{
+  bool old_owned = (old_size <= C_SLAB_MAX_SIZE) && (align <= C_SLAB_ALIGNMENT);
+  bool new_owned = (new_size <= C_SLAB_MAX_SIZE) && (align <= C_SLAB_ALIGNMENT);
+
+  if (!old_owned && !new_owned) return c_internal_allocator_default_resize(self, mem, old_size, new_size, align);
+  if (old_owned && new_owned && (c_internal_allocator_slab_class(old_size) == c_internal_allocator_slab_class(new_size))) {
+    return mem;
+  }
+
+  void* new_mem = c_internal_allocator_slab_alloc(self, new_size, align);
+  if (!new_mem) return NULL;
+
+  memcpy(new_mem, mem, old_size < new_size ? old_size : new_size);
+  c_stats_copied(self, old_size < new_size ? old_size : new_size);
+  c_internal_allocator_slab_free(self, mem, old_size, align);
+  return new_mem;
+}
+
+void c_internal_allocator_slab_free(CAllocator* self, void* mem, size_t size, size_t align)
+{
+  if ((size > C_SLAB_MAX_SIZE) || (align > C_SLAB_ALIGNMENT)) {
+    c_internal_allocator_default_free(self, mem, size, align);
+    return;
+  }
+
+  CSlabThreadCache* cache       = c_internal_allocator_slab_thread_cache(self->slab);
+  size_t            class_index = c_internal_allocator_slab_class(size);
+  if (!cache) {
+    // no cache for this thread (out of memory), hand it to the depot as a batch of one object
+    CSlabDepot* depot = &self->slab->depots[class_index];
+    void*       next  = NULL;
+    memcpy(mem, &next, sizeof(void*));
+    mtx_lock(&depot->lock);
+    memcpy((void**)mem + 1, &depot->batches, sizeof(void*));
+    depot->batches = mem;
+    mtx_unlock(&depot->lock);
+    return;
+  }
+
+  if (cache->magazines[class_index].count == C_SLAB_BATCH_SIZE * 2) {
+    c_internal_allocator_slab_flush(self->slab, cache, class_index, C_SLAB_BATCH_SIZE);
+  }
+  cache->magazines[class_index].objects[cache->magazines[class_index].count++] = mem;
+}
+
+/// @brief take memory directly from the shared buffer with a compare-exchange
+///        loop (a request that doesn't fit never moves the offset), if less
+///        than size is left, the rest is taken when it is at least min_size
+/// @param out_size the size taken (could be NULL)
+void* c_internal_allocator_concurrent_arena_bump(CConcurrentArena* arena, size_t size, size_t min_size, size_t align, size_t* out_size)
+{
+  size_t offset = atomic_load_explicit(&arena->offset, memory_order_relaxed);
+  for (;;) {
+    uintptr_t start     = c_internal_allocator_align_forward((uintptr_t)(arena->buf + offset), align);
+    size_t    padding   = start - (uintptr_t)(arena->buf + offset);
+    size_t    available = arena->capacity - offset;
+    if (padding > available) return NULL;
+    available -= padding;
+
+    size_t taken = size;
+    if (available < size) {
+      if (available < min_size) return NULL;
+      taken = available;
+    }
+    if (atomic_compare_exchange_weak_explicit(&arena->offset, &offset, offset + padding + taken, memory_order_relaxed, memory_order_relaxed)) {
+      if (out_size) *out_size = taken;
+      return (void*)start;
+    }
+  }
+}
+
+CConcurrentArenaThreadCache* c_internal_allocator_concurrent_arena_thread_cache(CConcurrentArena* arena)
+{
+  CConcurrentArenaThreadCache* cache = tss_get(arena->thread_cache_key);
+  if (cache) return cache;
+
+  cache = calloc(1, sizeof(CConcurrentArenaThreadCache));
+  if (!cache) return NULL;
+  cache->arena = arena;
+  cache->epoch = atomic_load_explicit(&arena->epoch, memory_order_acquire);
+
+  if (tss_set(arena->thread_cache_key, cache) != thrd_success) {
+    free(cache);
+    return NULL;
+  }
+
+  mtx_lock(&arena->thread_caches_lock);
+  cache->next          = arena->thread_caches;
+  arena->thread_caches = cache;
+  mtx_unlock(&arena->thread_caches_lock);
+
+  return cache;
+}
+
+/// @brief called on thread exit, the rest of the sub-chunk is lost until the
+///        arena is reset
+void c_internal_allocator_concurrent_arena_thread_cache_destroy(void* thread_cache)
+{
+  CConcurrentArenaThreadCache* cache = thread_cache;
+  CConcurrentArena*            arena = cache->arena;
+
+  mtx_lock(&arena->thread_caches_lock);
+  for (CConcurrentArenaThreadCache** link = &arena->thread_caches; *link; link = &(*link)->next) {
+    if (*link == cache) {
+      *link = cache->next;
+      break;
+    }
+  }
+  mtx_unlock(&arena->thread_caches_lock);
+
+  free(cache);
+}
+
+void* c_internal_allocator_concurrent_arena_alloc(CAllocator* self, size_t size, size_t align)
+{
+  CConcurrentArena* arena = self->concurrent_arena;
+  if (size + align - 1 > C_CONCURRENT_ARENA_MAX_CACHED) return c_internal_allocator_concurrent_arena_bump(arena, size, size, align, NULL);
+
+  CConcurrentArenaThreadCache* cache = c_internal_allocator_concurrent_arena_thread_cache(arena);
+  if (!cache) return c_internal_allocator_concurrent_arena_bump(arena, size, size, align, NULL);
+
+  size_t epoch = atomic_load_explicit(&arena->epoch, memory_order_acquire);
+  if (cache->epoch != epoch) {
+    cache->epoch       = epoch;
+    cache->chunk_start = 0;
+    cache->cursor      = 0;
+    cache->chunk_end   = 0;
+  }
+
+  uintptr_t mem = c_internal_allocator_align_forward(cache->cursor, align);
+  if (!cache->cursor || (mem > cache->chunk_end) || (cache->chunk_end - mem < size)) {
+    // take a new sub-chunk (or the rest of the shared buffer if it is
+    // smaller), the rest of the current one is lost
+    size_t chunk_size;
+    char*  chunk = c_internal_allocator_concurrent_arena_bump(arena, C_CONCURRENT_ARENA_CHUNK_SIZE, size + align - 1, C_CONCURRENT_ARENA_ALIGNMENT, &chunk_size);
+    if (!chunk) return c_internal_allocator_concurrent_arena_bump(arena, size, size, align, NULL);
+
+    cache->chunk_start = (uintptr_t)chunk;
+    cache->chunk_end   = (uintptr_t)chunk + chunk_size;
+    mem                = c_internal_allocator_align_forward(cache->chunk_start, align);
+  }
+  cache->cursor = mem + size;
+
+  return (void*)mem;
+}
+
+void* c_internal_allocator_concurrent_arena_resize(CAllocator* self, void* mem, size_t old_size, size_t new_size, size_t align)
+{
+  // this is the last allocation of this thread sub-chunk, and it has enough space
+  CConcurrentArena*            arena   = self->concurrent_arena;
+  CConcurrentArenaThreadCache* cache   = tss_get(arena->thread_cache_key);
+  uintptr_t                    address = (uintptr_t)mem;
+  if (cache && (cache->epoch == atomic_load_explicit(&arena->epoch, memory_order_acquire)) &&
+      (address >= cache->chunk_start) && (address + old_size == cache->cursor) && (cache->chunk_end - address >= new_size)) {
+    cache->cursor = address + new_size;
+    return mem;
+  }
+  if (new_size <= old_size) return mem;
+
+  void* new_mem = c_internal_allocator_concurrent_arena_alloc(self, new_size, align);
+  if (!new_mem) return NULL;
+
   memcpy(new_mem, mem, old_size);
+  c_stats_copied(self, old_size);
   return new_mem;
 }
 
-void c_internal_allocator_arena_free(CAllocator* self, void* mem)
+void c_internal_allocator_concurrent_arena_free(CAllocator* self, void* mem, size_t size, size_t align)
 {
-  // remove it if this is the last one
-  if ((size_t)((uint8_t*)mem - (uint8_t*)self->main_mem.buf) ==
-      self->main_mem.current_size - ((CMemory*)(mem))->size) {
-    self->main_mem.current_size -= TO_CMEMORY(mem)->size;
+  (void)align;
+
+  // remove it if this is the last allocation of this thread sub-chunk
+  CConcurrentArena*            arena   = self->concurrent_arena;
+  CConcurrentArenaThreadCache* cache   = tss_get(arena->thread_cache_key);
+  uintptr_t                    address = (uintptr_t)mem;
+  if (cache && (cache->epoch == atomic_load_explicit(&arena->epoch, memory_order_acquire)) &&
+      (address >= cache->chunk_start) && (address + size == cache->cursor)) {
+    cache->cursor = address;
   }
 }
 
@@ -288,7 +1605,7 @@ void* c_internal_allocator_fixed_buffer_resize(CAllocator* self, void* mem, size
   return c_internal_allocator_arena_resize(self, mem, old_size, new_size, align);
 }
 
-void c_internal_allocator_fixed_buffer_free(CAllocator* self, void* mem)
+void c_internal_allocator_fixed_buffer_free(CAllocator* self, void* mem, size_t size, size_t align)
 {
-  c_internal_allocator_arena_free(self, mem);
+  c_internal_allocator_arena_free(self, mem, size, align);
 }
@@ -0,0 +1,925 @@
+#include "anylibs/btree.h"
+#include "anylibs/error.h"
+#include "internal/vec.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#if !defined(__GNUC__) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+#if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
+#error "You need MSVC must be higher that or equal to 1900"
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996) // disable warning about unsafe functions
+#endif
+
+#define CBTREE_NODE_SIZE 512U ///< the target size of a node (8 cache lines), it holds as many keys as fit
+#define CBTREE_NODE_ALIGNMENT 64U ///< the nodes start at a cache line
+#define CBTREE_MIN_CAPACITY 4U ///< keys of a node at least (big keys/values make bigger nodes)
+#define CBTREE_MAX_ALIGNMENT 16U
+#define CBTREE_MAX_HEIGHT 48U ///< the nodes (except the last one of each level) are at least half full, so this is never reached
+
+/// @brief the header of a node, followed by capacity keys, then capacity
+///        values (leaves) or capacity + 1 children (inner nodes), the keys of
+///        children[i] are < keys[i] <= the keys of children[i + 1]
+struct CBTreeMapNode {
+  CBTreeMapNode* next; ///< leaves: the next leaf (NULL for the last one)
+  uint32_t       len; ///< keys count
+};
+
+/// @brief the sizes of a kind of node
+typedef struct CBTreeMapLayout {
+  size_t capacity; ///< keys
+  size_t min_len; ///< a node with fewer keys borrows from (or merges with) a sibling on remove
+  size_t items_offset; ///< the values of a leaf, or the children of an inner node
+  size_t size; ///< a multiple of CBTREE_NODE_ALIGNMENT
+} CBTreeMapLayout;
+
+/// @brief the inner nodes from the root to a leaf
+typedef struct CBTreeMapPath {
+  CBTreeMapNode* nodes[CBTREE_MAX_HEIGHT];
+  size_t         indexes[CBTREE_MAX_HEIGHT]; ///< the child taken in each one
+} CBTreeMapPath;
+
+struct CBTreeMap {
+  CBTreeMapNode*  root;
+  size_t          height; ///< levels of inner nodes (0: the root is a leaf)
+  size_t          len;
+  size_t          key_size;
+  size_t          value_size;
+  size_t          keys_offset; ///< the same in leaves and inner nodes
+  CBTreeMapLayout leaf;
+  CBTreeMapLayout inner;
+  CVecCompareFn   cmp;
+  CAllocator*     allocator;
+  char*           buffer; ///< [2 keys: the separators of the levels of a split][the removed key][the removed value]
+  size_t          buffer_size;
+  size_t          removed_value_offset;
+};
+
+static CBTreeMap*             c_internal_btree_create(size_t key_size, size_t value_size, CVecCompareFn cmp, CAllocator* allocator);
+static void                   c_internal_btree_init_layout(CBTreeMap* self);
+static inline size_t          c_internal_btree_alignment_of(size_t size);
+static inline size_t          c_internal_btree_align(size_t size, size_t alignment);
+static inline char*           c_internal_btree_key(CBTreeMap const* self, CBTreeMapNode const* node, size_t index);
+static inline char*           c_internal_btree_value(CBTreeMap const* self, CBTreeMapNode const* node, size_t index);
+static inline CBTreeMapNode** c_internal_btree_children(CBTreeMap const* self, CBTreeMapNode const* node);
+static size_t                 c_internal_btree_search(CBTreeMap const* self, CBTreeMapNode const* node, void const* key, bool* out_found);
+static size_t                 c_internal_btree_child(CBTreeMap const* self, CBTreeMapNode const* node, void const* key);
+static inline void            c_internal_btree_prefetch(CBTreeMapNode const* node, size_t size);
+static CBTreeMapNode*         c_internal_btree_find_leaf(CBTreeMap const* self, void const* key, CBTreeMapPath* path, bool* out_rightmost);
+static CBTreeMapNode*         c_internal_btree_edge_leaf(CBTreeMap const* self, bool last);
+static CBTreeMapIter          c_internal_btree_seek(CBTreeMap* self, void const* key, bool after_equal);
+static bool                   c_internal_btree_split(CBTreeMap* self, CBTreeMapPath const* path, CBTreeMapNode* leaf, size_t index, void const* key, void const* value, bool rightmost);
+static void                   c_internal_btree_leaf_insert(CBTreeMap const* self, CBTreeMapNode* leaf, size_t index, void const* key, void const* value);
+static void                   c_internal_btree_inner_insert(CBTreeMap const* self, CBTreeMapNode* node, size_t index, void const* key, CBTreeMapNode* child);
+static void                   c_internal_btree_inner_split(CBTreeMap const* self, CBTreeMapNode* node, CBTreeMapNode* right, size_t index, void const* key, CBTreeMapNode* child, size_t left_len, char* out_separator);
+static void                   c_internal_btree_rebalance(CBTreeMap* self, CBTreeMapPath const* path, CBTreeMapNode* node);
+static void                   c_internal_btree_move(CBTreeMap const* self, CBTreeMapNode* dst, size_t dst_index, CBTreeMapNode const* src, size_t src_index, size_t count, bool is_leaf);
+static bool                   c_internal_btree_bulk_load(CBTreeMap* self, char const* keys, char const* values, size_t count);
+static size_t                 c_internal_btree_bulk_items(size_t items_count, size_t nodes_count, size_t capacity, size_t min_items, size_t index);
+static CBTreeMapNode*         c_internal_btree_alloc_node(CBTreeMap const* self, bool is_leaf);
+static void                   c_internal_btree_free_node(CBTreeMap const* self, CBTreeMapNode* node, bool is_leaf);
+static void                   c_internal_btree_free(CBTreeMap const* self, CBTreeMapNode* node, size_t height, CBTreeMapNode const* keep);
+static void                   c_internal_btree_destroy_elements(CBTreeMap* self, CBTreeMapElementDestroyFn element_destroy_fn, void* user_data);
+
+CBTreeMap* c_btree_map_create(size_t key_size, size_t value_size, CVecCompareFn cmp, CAllocator* allocator)
+{
+  return c_internal_btree_create(key_size, value_size, cmp, allocator);
+}
+
+CBTreeMap* c_btree_map_create_from_sorted(CVec const* keys, CVec const* values, CVecCompareFn cmp, CAllocator* allocator)
+{
+  if (!keys) {
+    c_error_set(C_ERROR_null_ptr);
+    return NULL;
+  }
+
+  CVecImpl const* keys_impl   = (CVecImpl const*)keys;
+  CVecImpl const* values_impl = (CVecImpl const*)values;
+  size_t          count       = keys_impl->len / keys_impl->element_size;
+  if (values_impl && ((values_impl->len / values_impl->element_size) != count)) {
+    c_error_set(C_ERROR_invalid_len);
+    return NULL;
+  }
+
+  CBTreeMap* self = c_internal_btree_create(keys_impl->element_size, values_impl ? values_impl->element_size : 0, cmp, allocator);
+  if (!self) return NULL;
+
+  if (!c_internal_btree_bulk_load(self, keys_impl->data, values_impl ? values_impl->data : NULL, count)) {
+    c_btree_map_destroy(self, NULL, NULL);
+    return NULL;
+  }
+
+  return self;
+}
+
+size_t c_btree_map_len(CBTreeMap const* self)
+{
+  assert(self);
+  return self->len;
+}
+
+bool c_btree_map_is_empty(CBTreeMap const* self)
+{
+  assert(self);
+  return self->len == 0;
+}
+
+bool c_btree_map_insert(CBTreeMap* self, void const* key, void const* value)
+{
+  assert(self && self->root);
+
+  if (!key || (!value && self->value_size)) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  CBTreeMapPath  path;
+  bool           rightmost;
+  bool           found;
+  CBTreeMapNode* leaf  = c_internal_btree_find_leaf(self, key, &path, &rightmost);
+  size_t         index = c_internal_btree_search(self, leaf, key, &found);
+  if (found) {
+    if (self->value_size) memcpy(c_internal_btree_value(self, leaf, index), value, self->value_size);
+    return true;
+  }
+
+  if (leaf->len < self->leaf.capacity) {
+    c_internal_btree_leaf_insert(self, leaf, index, key, value);
+  } else if (!c_internal_btree_split(self, &path, leaf, index, key, value, rightmost)) {
+    return false;
+  }
+
+  self->len++;
+  return true;
+}
+
+bool c_btree_map_get(CBTreeMap const* self, void const* key, void** out_value)
+{
+  assert(self && self->root);
+
+  if (!key || !out_value) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  bool           found;
+  CBTreeMapNode* leaf  = c_internal_btree_find_leaf(self, key, NULL, NULL);
+  size_t         index = c_internal_btree_search(self, leaf, key, &found);
+  *out_value           = found ? c_internal_btree_value(self, leaf, index) : NULL;
+  return true;
+}
+
+bool c_btree_map_has_key(CBTreeMap const* self, void const* key)
+{
+  assert(self && self->root);
+
+  if (!key) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  bool found;
+  c_internal_btree_search(self, c_internal_btree_find_leaf(self, key, NULL, NULL), key, &found);
+  return found;
+}
+
+bool c_btree_map_remove(CBTreeMap* self, void const* key, void** out_key, void** out_value)
+{
+  assert(self && self->root);
+
+  if (!key) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  CBTreeMapPath  path;
+  bool           found;
+  CBTreeMapNode* leaf  = c_internal_btree_find_leaf(self, key, &path, NULL);
+  size_t         index = c_internal_btree_search(self, leaf, key, &found);
+  if (!found) {
+    c_error_set(C_ERROR_not_found);
+    return false;
+  }
+
+  char* removed_key   = self->buffer + (2 * self->key_size);
+  char* removed_value = self->buffer + self->removed_value_offset;
+  memcpy(removed_key, c_internal_btree_key(self, leaf, index), self->key_size);
+  memcpy(removed_value, c_internal_btree_value(self, leaf, index), self->value_size);
+
+  c_internal_btree_move(self, leaf, index, leaf, index + 1, leaf->len - index - 1, true);
+  leaf->len--;
+  self->len--;
+  c_internal_btree_rebalance(self, &path, leaf);
+
+  if (out_key) *out_key = removed_key;
+  if (out_value) *out_value = removed_value;
+  return true;
+}
+
+bool c_btree_map_first(CBTreeMap* self, void** out_key, void** out_value)
+{
+  assert(self && self->root);
+
+  if (!self->len) {
+    c_error_set(C_ERROR_empty);
+    return false;
+  }
+
+  CBTreeMapNode* leaf = c_internal_btree_edge_leaf(self, false);
+  if (out_key) *out_key = c_internal_btree_key(self, leaf, 0);
+  if (out_value) *out_value = c_internal_btree_value(self, leaf, 0);
+  return true;
+}
+
+bool c_btree_map_last(CBTreeMap* self, void** out_key, void** out_value)
+{
+  assert(self && self->root);
+
+  if (!self->len) {
+    c_error_set(C_ERROR_empty);
+    return false;
+  }
+
+  CBTreeMapNode* leaf = c_internal_btree_edge_leaf(self, true);
+  if (out_key) *out_key = c_internal_btree_key(self, leaf, leaf->len - 1);
+  if (out_value) *out_value = c_internal_btree_value(self, leaf, leaf->len - 1);
+  return true;
+}
+
+CBTreeMapIter c_btree_map_iter(CBTreeMap* self)
+{
+  return c_btree_map_range(self, NULL, NULL);
+}
+
+CBTreeMapIter c_btree_map_lower_bound(CBTreeMap* self, void const* key)
+{
+  assert(self && self->root);
+  return c_internal_btree_seek(self, key, false);
+}
+
+CBTreeMapIter c_btree_map_upper_bound(CBTreeMap* self, void const* key)
+{
+  assert(self && self->root);
+  return c_internal_btree_seek(self, key, true);
+}
+
+CBTreeMapIter c_btree_map_range(CBTreeMap* self, void const* from_key, void const* to_key)
+{
+  assert(self && self->root);
+
+  if (from_key && to_key && (self->cmp(from_key, to_key) >= 0)) return (CBTreeMapIter){.map = self};
+
+  CBTreeMapIter iter = c_internal_btree_seek(self, from_key, false);
+  if (to_key) {
+    CBTreeMapIter end = c_internal_btree_seek(self, to_key, false);
+    iter.end_leaf     = end.leaf;
+    iter.end_index    = end.index;
+  }
+  return iter;
+}
+
+bool c_btree_map_iter_next(CBTreeMapIter* iter, void** key, void** value)
+{
+  if (!iter || !iter->leaf) return false;
+  if ((iter->leaf == iter->end_leaf) && (iter->index == iter->end_index)) return false;
+
+  if (key) *key = c_internal_btree_key(iter->map, iter->leaf, iter->index);
+  if (value) *value = c_internal_btree_value(iter->map, iter->leaf, iter->index);
+  if (++iter->index == iter->leaf->len) {
+    iter->leaf  = iter->leaf->next;
+    iter->index = 0;
+    if (iter->leaf && iter->leaf->next) c_internal_btree_prefetch(iter->leaf->next, iter->map->leaf.size); // one leaf ahead
+  }
+  return true;
+}
+
+bool c_btree_map_iter_next_chunk(CBTreeMapIter* iter, void** keys, void** values, size_t* out_count)
+{
+  if (!iter || !out_count) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+  if (!iter->leaf) return false;
+  if ((iter->leaf == iter->end_leaf) && (iter->index == iter->end_index)) return false;
+
+  size_t end = (iter->leaf == iter->end_leaf) ? iter->end_index : iter->leaf->len;
+  if (keys) *keys = c_internal_btree_key(iter->map, iter->leaf, iter->index);
+  if (values) *values = c_internal_btree_value(iter->map, iter->leaf, iter->index);
+  *out_count = end - iter->index;
+  if (end == iter->leaf->len) {
+    iter->leaf  = iter->leaf->next;
+    iter->index = 0;
+    if (iter->leaf && iter->leaf->next) c_internal_btree_prefetch(iter->leaf->next, iter->map->leaf.size);
+  } else {
+    iter->index = end;
+  }
+  return true;
+}
+
+void c_btree_map_clear(CBTreeMap* self, CBTreeMapElementDestroyFn element_destroy_fn, void* user_data)
+{
+  assert(self && self->root);
+
+  if (element_destroy_fn) c_internal_btree_destroy_elements(self, element_destroy_fn, user_data);
+
+  // keep the first leaf as the (empty) root
+  CBTreeMapNode* first = c_internal_btree_edge_leaf(self, false);
+  c_internal_btree_free(self, self->root, self->height, first);
+  *first       = (CBTreeMapNode){0};
+  self->root   = first;
+  self->height = 0;
+  self->len    = 0;
+}
+
+void c_btree_map_destroy(CBTreeMap* self, CBTreeMapElementDestroyFn element_destroy_fn, void* user_data)
+{
+  if (self && self->root) {
+    if (element_destroy_fn) c_internal_btree_destroy_elements(self, element_destroy_fn, user_data);
+
+    CAllocator* allocator = self->allocator;
+    c_internal_btree_free(self, self->root, self->height, NULL);
+    c_allocator_free_sized(allocator, self->buffer, self->buffer_size, CBTREE_MAX_ALIGNMENT);
+    *self = (CBTreeMap){0};
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CBTreeMap, 1));
+  }
+}
+
+// ------------------------- internal ------------------------- //
+
+/// @brief a map with an empty leaf as the root
+CBTreeMap* c_internal_btree_create(size_t key_size, size_t value_size, CVecCompareFn cmp, CAllocator* allocator)
+{
+  if (!key_size) {
+    c_error_set(C_ERROR_invalid_size);
+    return NULL;
+  }
+  if (!cmp) {
+    c_error_set(C_ERROR_invalid_compare_fn);
+    return NULL;
+  }
+
+  if (!allocator) allocator = c_allocator_default();
+
+  CBTreeMap* self = c_allocator_alloc_sized(allocator, c_allocator_alignas(CBTreeMap, 1), true);
+  if (!self) return NULL;
+
+  self->key_size   = key_size;
+  self->value_size = value_size;
+  self->cmp        = cmp;
+  self->allocator  = allocator;
+  c_internal_btree_init_layout(self);
+
+  self->buffer = c_allocator_alloc_sized(allocator, self->buffer_size, CBTREE_MAX_ALIGNMENT, false);
+  self->root   = c_internal_btree_alloc_node(self, true);
+  if (!self->buffer || !self->root) {
+    c_allocator_free_sized(allocator, self->buffer, self->buffer_size, CBTREE_MAX_ALIGNMENT);
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CBTreeMap, 1));
+    return NULL;
+  }
+
+  return self;
+}
+
+/// @brief fit as many keys as possible in CBTREE_NODE_SIZE bytes (but at least
+///        CBTREE_MIN_CAPACITY), for leaves and for inner nodes
+void c_internal_btree_init_layout(CBTreeMap* self)
+{
+  // the size of a type is a multiple of its alignment, so this is enough for
+  // any key/value type of these sizes
+  size_t key_alignment   = c_internal_btree_alignment_of(self->key_size);
+  size_t value_alignment = self->value_size ? c_internal_btree_alignment_of(self->value_size) : 1;
+  self->keys_offset      = c_internal_btree_align(sizeof(CBTreeMapNode), key_alignment);
+
+  size_t capacity = (CBTREE_NODE_SIZE - self->keys_offset) / (self->key_size + self->value_size);
+  while ((capacity > CBTREE_MIN_CAPACITY) && (c_internal_btree_align(self->keys_offset + (capacity * self->key_size), value_alignment) + (capacity * self->value_size) > CBTREE_NODE_SIZE)) {
+    --capacity;
+  }
+  if (capacity < CBTREE_MIN_CAPACITY) capacity = CBTREE_MIN_CAPACITY;
+  self->leaf.capacity     = capacity;
+  self->leaf.min_len      = capacity / 2;
+  self->leaf.items_offset = c_internal_btree_align(self->keys_offset + (capacity * self->key_size), value_alignment);
+  self->leaf.size         = c_internal_btree_align(self->leaf.items_offset + (capacity * self->value_size), CBTREE_NODE_ALIGNMENT);
+
+  capacity = (CBTREE_NODE_SIZE - self->keys_offset - sizeof(CBTreeMapNode*)) / (self->key_size + sizeof(CBTreeMapNode*));
+  while ((capacity > CBTREE_MIN_CAPACITY) && (c_internal_btree_align(self->keys_offset + (capacity * self->key_size), alignof(CBTreeMapNode*)) + ((capacity + 1) * sizeof(CBTreeMapNode*)) > CBTREE_NODE_SIZE)) {
+    --capacity;
+  }
+  if (capacity < CBTREE_MIN_CAPACITY) capacity = CBTREE_MIN_CAPACITY;
+  self->inner.capacity     = capacity;
+  self->inner.min_len      = capacity / 2;
+  self->inner.items_offset = c_internal_btree_align(self->keys_offset + (capacity * self->key_size), alignof(CBTreeMapNode*));
+  self->inner.size         = c_internal_btree_align(self->inner.items_offset + ((capacity + 1) * sizeof(CBTreeMapNode*)), CBTREE_NODE_ALIGNMENT);
+
+  self->removed_value_offset = c_internal_btree_align(3 * self->key_size, value_alignment);
+  self->buffer_size          = c_internal_btree_align(self->removed_value_offset + self->value_size, CBTREE_MAX_ALIGNMENT);
+}
+
+size_t c_internal_btree_alignment_of(size_t size)
+{
+  size_t alignment = size & (~size + 1);
+  return alignment < CBTREE_MAX_ALIGNMENT ? alignment : CBTREE_MAX_ALIGNMENT;
+}
+
+size_t c_internal_btree_align(size_t size, size_t alignment)
+{
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+char* c_internal_btree_key(CBTreeMap const* self, CBTreeMapNode const* node, size_t index)
+{
+  return (char*)node + self->keys_offset + (index * self->key_size);
+}
+
+char* c_internal_btree_value(CBTreeMap const* self, CBTreeMapNode const* node, size_t index)
+{
+  return (char*)node + self->leaf.items_offset + (index * self->value_size);
+}
+
+CBTreeMapNode** c_internal_btree_children(CBTreeMap const* self, CBTreeMapNode const* node)
+{
+  return (CBTreeMapNode**)((char*)node + self->inner.items_offset);
+}
+
+/// @return the first index of node whose key is >= key (binary search)
+size_t c_internal_btree_search(CBTreeMap const* self, CBTreeMapNode const* node, void const* key, bool* out_found)
+{
+  size_t first = 0;
+  size_t count = node->len;
+  while (count > 0) {
+    size_t half = count / 2;
+    if (self->cmp(c_internal_btree_key(self, node, first + half), key) < 0) {
+      first += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+
+  *out_found = (first < node->len) && (self->cmp(c_internal_btree_key(self, node, first), key) == 0);
+  return first;
+}
+
+/// @return the child of an inner node where key is (the first index whose key is > key)
+size_t c_internal_btree_child(CBTreeMap const* self, CBTreeMapNode const* node, void const* key)
+{
+  size_t first = 0;
+  size_t count = node->len;
+  while (count > 0) {
+    size_t half = count / 2;
+    if (self->cmp(c_internal_btree_key(self, node, first + half), key) <= 0) {
+      first += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  return first;
+}
+
+/// @brief a hint to load the first size bytes of node (at most CBTREE_NODE_SIZE),
+///        the lines of a node are read by the binary search one after the other,
+///        so their misses overlap this way
+void c_internal_btree_prefetch(CBTreeMapNode const* node, size_t size)
+{
+  if (size > CBTREE_NODE_SIZE) size = CBTREE_NODE_SIZE;
+  for (size_t offset = 0; offset < size; offset += CBTREE_NODE_ALIGNMENT) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch((char const*)node + offset, 0, 3);
+#elif defined(_M_X64) || defined(_M_IX86)
+    _mm_prefetch((char const*)node + offset, _MM_HINT_T0);
+#else
+    (void)node;
+#endif
+  }
+}
+
+/// @brief the leaf where key is (or would be), path (could be NULL) gets the
+///        inner nodes on the way, out_rightmost (could be NULL) is true if
+///        the leaf is the last one
+CBTreeMapNode* c_internal_btree_find_leaf(CBTreeMap const* self, void const* key, CBTreeMapPath* path, bool* out_rightmost)
+{
+  CBTreeMapNode* node      = self->root;
+  bool           rightmost = true;
+  for (size_t level = 0; level < self->height; ++level) {
+    size_t index = c_internal_btree_child(self, node, key);
+    if (path) {
+      path->nodes[level]   = node;
+      path->indexes[level] = index;
+    }
+    rightmost = rightmost && (index == node->len);
+    node      = c_internal_btree_children(self, node)[index];
+    c_internal_btree_prefetch(node, (level + 1 < self->height) ? self->inner.size : self->leaf.size);
+  }
+
+  if (out_rightmost) *out_rightmost = rightmost;
+  return node;
+}
+
+/// @brief the first leaf, or the last one
+CBTreeMapNode* c_internal_btree_edge_leaf(CBTreeMap const* self, bool last)
+{
+  CBTreeMapNode* node = self->root;
+  for (size_t level = 0; level < self->height; ++level) {
+    node = c_internal_btree_children(self, node)[last ? node->len : 0];
+  }
+  return node;
+}
+
+/// @brief an iterator from the first key >= key (or > key if after_equal) to
+///        the end, key NULL: from the first key
+CBTreeMapIter c_internal_btree_seek(CBTreeMap* self, void const* key, bool after_equal)
+{
+  CBTreeMapIter iter = {.map = self};
+  if (key) {
+    bool found;
+    iter.leaf  = c_internal_btree_find_leaf(self, key, NULL, NULL);
+    iter.index = c_internal_btree_search(self, iter.leaf, key, &found) + (after_equal && found);
+  } else {
+    iter.leaf = c_internal_btree_edge_leaf(self, false);
+  }
+
+  // the position after the last key of a leaf is the first one of the next leaf
+  while (iter.leaf && (iter.index == iter.leaf->len)) {
+    iter.leaf  = iter.leaf->next;
+    iter.index = 0;
+  }
+  return iter;
+}
+
+/// @brief insert into the full leaf, it is split in two and the separator of
+///        the new leaf is inserted in the parent (which could be split too, up
+///        to the root), the nodes are allocated first, so a failed allocation
+///        leaves the map as it was
+bool c_internal_btree_split(CBTreeMap* self, CBTreeMapPath const* path, CBTreeMapNode* leaf, size_t index, void const* key, void const* value, bool rightmost)
+{
+  // the full inner nodes above the leaf are split too
+  size_t splits_count = 0;
+  while ((splits_count < self->height) && (path->nodes[self->height - 1 - splits_count]->len == self->inner.capacity)) {
+    ++splits_count;
+  }
+  bool   grows       = (splits_count == self->height);
+  size_t inner_count = splits_count + grows;
+  assert(!grows || (self->height < CBTREE_MAX_HEIGHT));
+
+  CBTreeMapNode* right = c_internal_btree_alloc_node(self, true);
+  CBTreeMapNode* inner_nodes[CBTREE_MAX_HEIGHT + 1];
+  size_t         allocated_count = 0;
+  while (right && (allocated_count < inner_count)) {
+    inner_nodes[allocated_count] = c_internal_btree_alloc_node(self, false);
+    if (!inner_nodes[allocated_count]) break;
+    ++allocated_count;
+  }
+  if (!right || (allocated_count < inner_count)) {
+    while (allocated_count > 0) c_internal_btree_free_node(self, inner_nodes[--allocated_count], false);
+    c_internal_btree_free_node(self, right, true);
+    return false;
+  }
+
+  // split the leaf in half, or keep it full if the key is appended to the map
+  size_t len      = leaf->len;
+  size_t left_len = (rightmost && (index == len)) ? len : (len + 1) / 2;
+  if (index < left_len) {
+    c_internal_btree_move(self, right, 0, leaf, left_len - 1, len - left_len + 1, true);
+    right->len = (uint32_t)(len - left_len + 1);
+    leaf->len  = (uint32_t)(left_len - 1);
+    c_internal_btree_leaf_insert(self, leaf, index, key, value);
+  } else {
+    c_internal_btree_move(self, right, 0, leaf, left_len, len - left_len, true);
+    right->len = (uint32_t)(len - left_len);
+    leaf->len  = (uint32_t)left_len;
+    c_internal_btree_leaf_insert(self, right, index - left_len, key, value);
+  }
+  right->next = leaf->next;
+  leaf->next  = right;
+
+  // insert the separator of the new node in the parent, until a parent has room
+  char const*    separator = c_internal_btree_key(self, right, 0);
+  CBTreeMapNode* child     = right;
+  for (size_t level = self->height; level-- > 0;) {
+    CBTreeMapNode* node     = path->nodes[level];
+    size_t         position = path->indexes[level];
+    if (node->len < self->inner.capacity) {
+      c_internal_btree_inner_insert(self, node, position, separator, child);
+      return true;
+    }
+
+    // the separator that goes up is copied to one of the 2 buffers (the one that
+    // this level doesn't read)
+    size_t         capacity       = self->inner.capacity;
+    size_t         inner_left_len = (rightmost && (position == capacity)) ? capacity - 1 : capacity / 2;
+    char*          up_separator   = self->buffer + ((level & 1) * self->key_size);
+    CBTreeMapNode* new_node       = inner_nodes[--inner_count];
+    c_internal_btree_inner_split(self, node, new_node, position, separator, child, inner_left_len, up_separator);
+    separator = up_separator;
+    child     = new_node;
+  }
+
+  // the root was split, a new one is on top of it
+  CBTreeMapNode* root = inner_nodes[--inner_count];
+  root->len           = 1;
+  memcpy(c_internal_btree_key(self, root, 0), separator, self->key_size);
+  c_internal_btree_children(self, root)[0] = self->root;
+  c_internal_btree_children(self, root)[1] = child;
+  self->root                               = root;
+  self->height++;
+  return true;
+}
+
+/// @brief insert into a leaf that has room
+void c_internal_btree_leaf_insert(CBTreeMap const* self, CBTreeMapNode* leaf, size_t index, void const* key, void const* value)
+{
+  c_internal_btree_move(self, leaf, index + 1, leaf, index, leaf->len - index, true);
+  memcpy(c_internal_btree_key(self, leaf, index), key, self->key_size);
+  if (self->value_size) memcpy(c_internal_btree_value(self, leaf, index), value, self->value_size);
+  leaf->len++;
+}
+
+/// @brief insert key at index and child at index + 1 into an inner node that has room
+void c_internal_btree_inner_insert(CBTreeMap const* self, CBTreeMapNode* node, size_t index, void const* key, CBTreeMapNode* child)
+{
+  c_internal_btree_move(self, node, index + 1, node, index, node->len - index, false);
+  memcpy(c_internal_btree_key(self, node, index), key, self->key_size);
+  c_internal_btree_children(self, node)[index + 1] = child;
+  node->len++;
+}
+
+/// @brief split the full inner node while inserting key/child at index: node
+///        keeps left_len keys, the next key goes up (to out_separator), and
+///        right gets the rest
+void c_internal_btree_inner_split(CBTreeMap const* self, CBTreeMapNode* node, CBTreeMapNode* right, size_t index, void const* key, CBTreeMapNode* child, size_t left_len, char* out_separator)
+{
+  size_t          len            = node->len;
+  CBTreeMapNode** right_children = c_internal_btree_children(self, right);
+  if (index < left_len) {
+    memcpy(out_separator, c_internal_btree_key(self, node, left_len - 1), self->key_size);
+    memcpy(c_internal_btree_key(self, right, 0), c_internal_btree_key(self, node, left_len), (len - left_len) * self->key_size);
+    memcpy(right_children, c_internal_btree_children(self, node) + left_len, (len - left_len + 1) * sizeof(CBTreeMapNode*));
+    right->len = (uint32_t)(len - left_len);
+    node->len  = (uint32_t)(left_len - 1);
+    c_internal_btree_inner_insert(self, node, index, key, child);
+  } else if (index == left_len) {
+    memcpy(out_separator, key, self->key_size);
+    memcpy(c_internal_btree_key(self, right, 0), c_internal_btree_key(self, node, left_len), (len - left_len) * self->key_size);
+    right_children[0] = child;
+    memcpy(right_children + 1, c_internal_btree_children(self, node) + left_len + 1, (len - left_len) * sizeof(CBTreeMapNode*));
+    right->len = (uint32_t)(len - left_len);
+    node->len  = (uint32_t)left_len;
+  } else {
+    memcpy(out_separator, c_internal_btree_key(self, node, left_len), self->key_size);
+    memcpy(c_internal_btree_key(self, right, 0), c_internal_btree_key(self, node, left_len + 1), (len - left_len - 1) * self->key_size);
+    memcpy(right_children, c_internal_btree_children(self, node) + left_len + 1, (len - left_len) * sizeof(CBTreeMapNode*));
+    right->len = (uint32_t)(len - left_len - 1);
+    node->len  = (uint32_t)left_len;
+    c_internal_btree_inner_insert(self, right, index - left_len - 1, key, child);
+  }
+}
+
+/// @brief after a remove from node (a leaf), while a node has fewer than
+///        min_len keys, it borrows a key from a sibling, or merges with it
+///        (then its parent lost a key), a root without keys is removed
+void c_internal_btree_rebalance(CBTreeMap* self, CBTreeMapPath const* path, CBTreeMapNode* node)
+{
+  bool is_leaf = true;
+  for (size_t level = self->height; level-- > 0; is_leaf = false) {
+    CBTreeMapLayout const* layout = is_leaf ? &self->leaf : &self->inner;
+    if (node->len >= layout->min_len) break;
+
+    CBTreeMapNode*  parent   = path->nodes[level];
+    CBTreeMapNode** children = c_internal_btree_children(self, parent);
+    size_t          index    = path->indexes[level];
+    size_t          sep      = (index > 0) ? index - 1 : 0; // the separator between left and right
+    CBTreeMapNode*  left     = children[sep];
+    CBTreeMapNode*  right    = children[sep + 1];
+    CBTreeMapNode*  sibling  = (index > 0) ? left : right;
+    char*           sep_key  = c_internal_btree_key(self, parent, sep);
+
+    if (sibling->len > layout->min_len) {
+      // borrow one key (a leaf), or rotate one key through the parent (an inner node)
+      if (sibling == left) {
+        c_internal_btree_move(self, right, 1, right, 0, right->len, is_leaf);
+        if (is_leaf) {
+          c_internal_btree_move(self, right, 0, left, left->len - 1, 1, true);
+          memcpy(sep_key, c_internal_btree_key(self, right, 0), self->key_size);
+        } else {
+          c_internal_btree_children(self, right)[1] = c_internal_btree_children(self, right)[0];
+          memcpy(c_internal_btree_key(self, right, 0), sep_key, self->key_size);
+          c_internal_btree_children(self, right)[0] = c_internal_btree_children(self, left)[left->len];
+          memcpy(sep_key, c_internal_btree_key(self, left, left->len - 1), self->key_size);
+        }
+        left->len--;
+        right->len++;
+      } else {
+        if (is_leaf) {
+          c_internal_btree_move(self, left, left->len, right, 0, 1, true);
+          c_internal_btree_move(self, right, 0, right, 1, right->len - 1, true);
+          memcpy(sep_key, c_internal_btree_key(self, right, 0), self->key_size);
+        } else {
+          memcpy(c_internal_btree_key(self, left, left->len), sep_key, self->key_size);
+          c_internal_btree_children(self, left)[left->len + 1] = c_internal_btree_children(self, right)[0];
+          memcpy(sep_key, c_internal_btree_key(self, right, 0), self->key_size);
+          c_internal_btree_children(self, right)[0] = c_internal_btree_children(self, right)[1];
+          c_internal_btree_move(self, right, 0, right, 1, right->len - 1, false);
+        }
+        left->len++;
+        right->len--;
+      }
+      return;
+    }
+
+    // merge right into left (an inner node takes the separator down too)
+    if (is_leaf) {
+      c_internal_btree_move(self, left, left->len, right, 0, right->len, true);
+      left->len += right->len;
+      left->next = right->next;
+    } else {
+      memcpy(c_internal_btree_key(self, left, left->len), sep_key, self->key_size);
+      c_internal_btree_children(self, left)[left->len + 1] = c_internal_btree_children(self, right)[0];
+      left->len++;
+      c_internal_btree_move(self, left, left->len, right, 0, right->len, false);
+      left->len += right->len;
+    }
+    c_internal_btree_free_node(self, right, is_leaf);
+    c_internal_btree_move(self, parent, sep, parent, sep + 1, parent->len - sep - 1, false);
+    parent->len--;
+    node = parent;
+  }
+
+  if (self->height && (self->root->len == 0)) {
+    CBTreeMapNode* root = self->root;
+    self->root          = c_internal_btree_children(self, root)[0];
+    self->height--;
+    c_internal_btree_free_node(self, root, false);
+  }
+}
+
+/// @brief memmove count keys (with their values for leaves, or with the child
+///        on the right of each key for inner nodes) from src at src_index to dst
+///        at dst_index
+void c_internal_btree_move(CBTreeMap const* self, CBTreeMapNode* dst, size_t dst_index, CBTreeMapNode const* src, size_t src_index, size_t count, bool is_leaf)
+{
+  if (!count) return;
+
+  memmove(c_internal_btree_key(self, dst, dst_index), c_internal_btree_key(self, src, src_index), count * self->key_size);
+  if (is_leaf) {
+    if (self->value_size) memmove(c_internal_btree_value(self, dst, dst_index), c_internal_btree_value(self, src, src_index), count * self->value_size);
+  } else {
+    memmove(c_internal_btree_children(self, dst) + dst_index + 1, c_internal_btree_children(self, src) + src_index + 1, count * sizeof(CBTreeMapNode*));
+  }
+}
+
+/// @brief build the tree of an empty map from sorted keys: the leaves are
+///        filled in order, then each level of inner nodes on top of the
+///        previous one, all the nodes are allocated first
+bool c_internal_btree_bulk_load(CBTreeMap* self, char const* keys, char const* values, size_t count)
+{
+  size_t const key_size = self->key_size;
+
+  size_t unique_count = count ? 1 : 0;
+  for (size_t iii = 1; iii < count; ++iii) {
+    int order = self->cmp(keys + ((iii - 1) * key_size), keys + (iii * key_size));
+    if (order > 0) {
+      c_error_set(C_ERROR_invalid_data);
+      return false;
+    }
+    unique_count += (order != 0);
+  }
+  if (!unique_count) return true;
+
+  // the nodes count of each level, from the leaves up to the root
+  size_t levels_count[CBTREE_MAX_HEIGHT + 1];
+  size_t height      = 0;
+  levels_count[0]    = (unique_count + self->leaf.capacity - 1) / self->leaf.capacity;
+  size_t nodes_count = levels_count[0];
+  while (levels_count[height] > 1) {
+    levels_count[height + 1] = (levels_count[height] + self->inner.capacity) / (self->inner.capacity + 1);
+    nodes_count += levels_count[++height];
+  }
+
+  CBTreeMapNode** nodes  = c_allocator_alloc_sized(self->allocator, c_allocator_alignas(CBTreeMapNode*, nodes_count), false);
+  char const**    firsts = c_allocator_alloc_sized(self->allocator, c_allocator_alignas(char const*, levels_count[0]), false); ///< the first key of each subtree
+  size_t          allocated_count = 0;
+  if (nodes && firsts) {
+    for (; allocated_count < nodes_count; ++allocated_count) {
+      nodes[allocated_count] = c_internal_btree_alloc_node(self, allocated_count < levels_count[0]);
+      if (!nodes[allocated_count]) break;
+    }
+  }
+  bool is_allocated = nodes && firsts && (allocated_count == nodes_count);
+  if (!is_allocated) {
+    while (allocated_count > 0) {
+      --allocated_count;
+      c_internal_btree_free_node(self, nodes[allocated_count], allocated_count < levels_count[0]);
+    }
+  }
+
+  if (is_allocated) {
+    // the leaves (a key that repeats overwrites the value of the previous one)
+    size_t         leaf_index = 0;
+    CBTreeMapNode* leaf       = nodes[0];
+    size_t         leaf_len   = c_internal_btree_bulk_items(unique_count, levels_count[0], self->leaf.capacity, self->leaf.min_len, 0);
+    for (size_t iii = 0; iii < count; ++iii) {
+      char const* key   = keys + (iii * key_size);
+      char const* value = self->value_size ? values + (iii * self->value_size) : NULL;
+      if ((iii > 0) && (self->cmp(keys + ((iii - 1) * key_size), key) == 0)) {
+        if (self->value_size) memcpy(c_internal_btree_value(self, leaf, leaf->len - 1), value, self->value_size);
+        continue;
+      }
+      if (leaf->len == leaf_len) {
+        leaf->next = nodes[++leaf_index];
+        leaf       = leaf->next;
+        leaf_len   = c_internal_btree_bulk_items(unique_count, levels_count[0], self->leaf.capacity, self->leaf.min_len, leaf_index);
+      }
+      if (!leaf->len) firsts[leaf_index] = key;
+      memcpy(c_internal_btree_key(self, leaf, leaf->len), key, key_size);
+      if (self->value_size) memcpy(c_internal_btree_value(self, leaf, leaf->len), value, self->value_size);
+      leaf->len++;
+    }
+
+    // the inner levels, firsts is updated in place (a node is before its first child)
+    CBTreeMapNode** children = nodes;
+    for (size_t level = 1; level <= height; ++level) {
+      CBTreeMapNode** level_nodes = children + levels_count[level - 1];
+      size_t          child_index = 0;
+      for (size_t iii = 0; iii < levels_count[level]; ++iii) {
+        CBTreeMapNode* node           = level_nodes[iii];
+        size_t         children_count = c_internal_btree_bulk_items(levels_count[level - 1], levels_count[level], self->inner.capacity + 1, self->inner.min_len + 1, iii);
+        char const*    first          = firsts[child_index];
+        node->len                     = (uint32_t)(children_count - 1);
+        for (size_t jjj = 0; jjj < children_count; ++jjj, ++child_index) {
+          c_internal_btree_children(self, node)[jjj] = children[child_index];
+          if (jjj) memcpy(c_internal_btree_key(self, node, jjj - 1), firsts[child_index], key_size);
+        }
+        firsts[iii] = first;
+      }
+      children = level_nodes;
+    }
+
+    c_internal_btree_free_node(self, self->root, true);
+    self->root   = nodes[nodes_count - 1];
+    self->height = height;
+    self->len    = unique_count;
+  }
+
+  c_allocator_free_sized(self->allocator, nodes, c_allocator_alignas(CBTreeMapNode*, nodes_count));
+  c_allocator_free_sized(self->allocator, firsts, c_allocator_alignas(char const*, levels_count[0]));
+  return is_allocated;
+}
+
+/// @return the items of the node at index of a level of nodes_count nodes that
+///         hold items_count items: the nodes are full, except the last one, it
+///         shares the items of the one before it if it would have fewer than
+///         min_items
+size_t c_internal_btree_bulk_items(size_t items_count, size_t nodes_count, size_t capacity, size_t min_items, size_t index)
+{
+  size_t last_items = items_count - ((nodes_count - 1) * capacity);
+  if ((nodes_count == 1) || (last_items >= min_items) || (index + 2 < nodes_count)) {
+    return (index + 1 < nodes_count) ? capacity : last_items;
+  }
+
+  size_t shared_items = capacity + last_items;
+  return (index + 1 < nodes_count) ? shared_items - (shared_items / 2) : shared_items / 2;
+}
+
+CBTreeMapNode* c_internal_btree_alloc_node(CBTreeMap const* self, bool is_leaf)
+{
+  CBTreeMapNode* node = c_allocator_alloc_sized(self->allocator, is_leaf ? self->leaf.size : self->inner.size, CBTREE_NODE_ALIGNMENT, false);
+  if (node) *node = (CBTreeMapNode){0};
+  return node;
+}
+
+void c_internal_btree_free_node(CBTreeMap const* self, CBTreeMapNode* node, bool is_leaf)
+{
+  c_allocator_free_sized(self->allocator, node, is_leaf ? self->leaf.size : self->inner.size, CBTREE_NODE_ALIGNMENT);
+}
+
+/// @brief free node and its subtree (except keep, could be NULL)
+void c_internal_btree_free(CBTreeMap const* self, CBTreeMapNode* node, size_t height, CBTreeMapNode const* keep)
+{
+  if (height) {
+    for (size_t iii = 0; iii <= node->len; ++iii) {
+      c_internal_btree_free(self, c_internal_btree_children(self, node)[iii], height - 1, keep);
+    }
+  }
+  if (node != keep) c_internal_btree_free_node(self, node, height == 0);
+}
+
+void c_internal_btree_destroy_elements(CBTreeMap* self, CBTreeMapElementDestroyFn element_destroy_fn, void* user_data)
+{
+  void*         key;
+  void*         value;
+  CBTreeMapIter iter = c_btree_map_iter(self);
+  while (c_btree_map_iter_next(&iter, &key, &value)) {
+    element_destroy_fn(key, value, user_data);
+  }
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
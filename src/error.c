@@ -40,6 +40,7 @@ char const* c_error_to_str(c_error_t code)
     case C_ERROR_invalid_format:           return "invalid format";
     case C_ERROR_dl_loader_failed:         return "dl_loader failed";
     case C_ERROR_dl_loader_invalid_symbol: return "dl_loader invalid symbol";
+    case C_ERROR_read_only:                return "read only";
     default:                               {
 #ifdef _WIN32
       static thread_local char buffer[1024];
@@ -1,33 +1,27 @@
+#ifdef _WIN32
+#define _CRT_RAND_S // rand_s
+#endif
+
 #include "anylibs/hashmap.h"
 #include "anylibs/error.h"
+#include "internal/hashmap.h"
 
 #include <assert.h>
-
-#define CMAP_DEFAULT_CAPACITY 16U
-
-typedef struct CHashMap {
-  void*  buckets; // { [CHashMapBucket, key, value], ... }
-  void*  spare_bucket1; // { [CHashMapBucket, key, value] }
-  void*  spare_bucket2; // { [CHashMapBucket, key, value] }
-  size_t capacity; ///< in units
-  size_t len; ///< in units
-  struct {
-    size_t orig;
-    size_t aligned;
-  } key_size;
-  struct {
-    size_t orig;
-    size_t aligned;
-  } value_size;
-  size_t      bucket_size;
-  size_t      mask;
-  CAllocator* allocator;
-} CHashMap;
-
-#include <assert.h>
+#include <errno.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
 #error "You need MSVC must be higher that or equal to 1900"
@@ -38,21 +32,212 @@ typedef struct CHashMap {
 #pragma warning(disable : 4996) // disable warning about unsafe functions
 #endif
 
-typedef struct CHashMapBucket CHashMapBucket;
-struct CHashMapBucket {
-  uint64_t distance_from_initial_bucket : 16;
-  uint64_t hash : 48;
+#define CMAP_DEFAULT_CAPACITY 16U
+#define CMAP_MAX_ALIGNMENT 16U
+#define CMAP_MIGRATE_SLOTS 8U ///< old slots migrated by each insert/remove while an incremental resize is in progress
+#define CMAP_BATCH_SIZE 16U ///< keys of a batch that are prefetched together
+#define CMAP_BUILD_MIN_KEYS_PER_THREAD 16384U ///< c_hashmap_build_from uses fewer threads for fewer keys
+#define CMAP_BUILD_MAX_THREADS 64U
+#define CMAP_MAX_PROBE_GROUPS 16U ///< an insert that probes more groups reseeds the map (with a random seed, this is very unlikely at a load factor <= 7/8)
+#define CMAP_STR_INLINE_CAPACITY 20U ///< longer keys of CStrHashMap are stored in its arena
+#define CMAP_STR_ARENA_CAPACITY 4096U
+#define CMAP_CONCURRENT_DEFAULT_SHARDS 64U
+#define CMAP_CONCURRENT_ALIGNMENT 64U
+#define CMAP_CONCURRENT_WRITER 0x80000000U ///< the lock bit of the writer, the other bits count the readers
+#define CMAP_FILE_MAGIC "CHASHMAP"
+#define CMAP_FILE_VERSION 2U ///< bump it on any change of the header, of the table layout or of the default hash
+#define CMAP_FILE_HEADER_SIZE 128U ///< the table follows the header, this keeps it aligned (the mapping is page aligned)
+#define CMAP_FILE_FLAG_SPLIT_VALUES 0x1U
+#define CMAP_FILE_FLAG_CUSTOM_HASH 0x2U
+#define CMAP_FILE_FLAG_CUSTOM_EQ 0x4U
+#define CMAP_FILE_FLAGS (CMAP_FILE_FLAG_SPLIT_VALUES | CMAP_FILE_FLAG_CUSTOM_HASH | CMAP_FILE_FLAG_CUSTOM_EQ)
+#define CMAP_FROZEN_MAGIC "CFROZMAP"
+#define CMAP_FROZEN_BUCKET_SIZE 4U ///< average keys per displacement of a CFrozenMap (more: less memory, slower build)
+#define CMAP_FROZEN_MAX_BUCKET 64U ///< a seed that puts more keys in one bucket is skipped
+#define CMAP_FROZEN_MAX_D1 64U ///< the displacements tried for a bucket are d1 < CMAP_FROZEN_MAX_D1, d2 < len
+#define CMAP_FROZEN_MAX_ATTEMPTS 32U ///< seeds tried before the build fails
+#define CMAP_FROZEN_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+/// @brief the offsets of the parts of a table block
+typedef struct CHashMapLayout {
+  size_t size;
+  size_t alignment;
+  size_t keys_offset;
+  size_t values_offset;
+  size_t removed_slot_offset;
+} CHashMapLayout;
+
+/// @brief the header of a snapshot written by @ref c_hashmap_save, it is
+///        followed by the table block (without the removed slot), there are no
+///        pointers in the file, only the sizes that the layout is computed from.
+///        the fields are in the byte order of the writer (a file of the other
+///        byte order fails the version check)
+typedef struct CHashMapFileHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t flags; ///< CMAP_FILE_FLAG_*
+  uint64_t key_size;
+  uint64_t value_size;
+  uint64_t capacity;
+  uint64_t len;
+  uint64_t seed;
+  uint64_t table_size; ///< bytes of the table block in the file
+  uint64_t checksum; ///< of the fields above
+  char     reserved[CMAP_FILE_HEADER_SIZE - (9 * sizeof(uint64_t))];
+} CHashMapFileHeader;
+
+typedef struct CConcurrentHashMapShard {
+  CHashMap*         map;
+  _Atomic(uint32_t) lock; ///< @ref CMAP_CONCURRENT_WRITER | readers count
+  char              padding[CMAP_CONCURRENT_ALIGNMENT - sizeof(CHashMap*) - sizeof(_Atomic(uint32_t))]; ///< each lock in its own cache line
+} CConcurrentHashMapShard;
+
+/// @brief a key of c_hashmap_build_from (sorted by partition)
+typedef struct CHashMapBuildEntry {
+  uint64_t hash;
+  size_t   index; ///< in keys/values
+} CHashMapBuildEntry;
+
+/// @brief the work of one thread of c_hashmap_build_from: the keys of an
+///        input chunk are counted/scattered by partition, then the keys of a
+///        partition are placed in its groups of the table
+typedef struct CHashMapBuildTask {
+  CHashMap*           map;
+  char const*         keys;
+  char const*         values;
+  size_t              first; ///< the input chunk
+  size_t              end;
+  size_t              partition;
+  size_t              partitions_count;
+  unsigned            groups_shift; ///< log2 of the groups count of the table
+  size_t*             offsets; ///< [partitions_count] the keys of the input chunk in each partition, then where its next one goes in entries
+  CHashMapBuildEntry* entries;
+  size_t              entries_first; ///< the entries of the partition
+  size_t              entries_end;
+  size_t              placed_count;
+  size_t              deferred_count; ///< the entries that would probe out of the partition, moved to entries_first..
+} CHashMapBuildTask;
+
+/// @brief the key of a CStrHashMap slot, the hash and the length are compared
+///        before the strings
+typedef struct CStrHashMapKey {
+  uint64_t hash;
+  uint32_t len;
+  char     data[CMAP_STR_INLINE_CAPACITY]; ///< the string, or a pointer to it (if len > CMAP_STR_INLINE_CAPACITY)
+} CStrHashMapKey;
+
+struct CStrHashMap {
+  CHashMap*   map;
+  CAllocator* long_keys; ///< a growable arena (created with the first long key)
+};
+
+struct CHashSet {
+  CHashMap* map; ///< without values (value_size is 0), the slots hold only the keys
+};
+
+/// @brief a minimal perfect hash table (CHD): the hash selects a bucket, and the
+///        displacements (d1, d2) of the bucket give the slot of each of its
+///        keys as (f1 + d1 * f2 + d2) % len, they are searched at build time so
+///        that the keys of all the buckets land on distinct slots
+struct CFrozenMap {
+  char*           block; ///< [displacements][slots], or NULL if mapping
+  uint32_t const* displacements; ///< (d1, d2) of each bucket
+  char const*     slots; ///< len [key, value] slots
+  size_t          len;
+  size_t          buckets_count;
+  size_t          key_size;
+  size_t          value_size;
+  size_t          value_offset;
+  size_t          slot_size;
+  size_t          slot_alignment;
+  CHashMapHashFn  hash_fn;
+  CHashMapEqFn    eq_fn; ///< NULL: memcmp
+  CHashMapKeyKind key_kind;
+  uint64_t        seed; ///< the one that the displacements were found with
+  CAllocator*     allocator;
+  void*           mapping; ///< the file mapped by @ref c_frozen_map_open_mmap
+  size_t          mapping_size;
 };
 
-static const size_t spare_buckets_count = 2U;
+struct CConcurrentHashMap {
+  CConcurrentHashMapShard* shards;
+  size_t                   shards_count;
+  unsigned                 shard_shift; ///< the shard is the high bits of the hash
+  uint64_t                 seed; ///< of the shard selection (and of the shards, until one of them reseeds)
+  CAllocator*              allocator;
+};
 
-static size_t                 c_internal_map_hash(const void* data, size_t data_len);
-static size_t                 c_internal_map_hash_fnv(const void* data, size_t data_len);
-static size_t                 c_internal_map_clip_hash(size_t hash);
-static bool                   c_internal_map_resize(CHashMap* self, size_t new_capacity);
-static inline void*           c_internal_map_get_key(CHashMap const* self, size_t index);
-static inline void*           c_internal_map_get_value(CHashMap const* self, size_t index);
-static inline CHashMapBucket* c_internal_map_get_bucket(CHashMap const* self, size_t index);
+static uint64_t c_internal_map_secret[2]; ///< see @ref c_internal_map_random_seed
+
+static inline uint64_t                 c_internal_map_hash(CHashMap const* self, void const* key);
+static inline uint64_t                 c_internal_map_hash_with_seed(CHashMap const* self, void const* key, uint64_t seed);
+static uint64_t                        c_internal_map_random_seed(void);
+static void                            c_internal_map_init_secret(void);
+static bool                            c_internal_map_reseed(CHashMap* self);
+static uint64_t                        c_internal_hashmap_siphash(void const* data, size_t data_len, uint64_t k0, uint64_t k1);
+static inline void                     c_internal_hashmap_sipround(uint64_t v[4]);
+static inline uint64_t                 c_internal_hashmap_rotl(uint64_t value, unsigned bits);
+static inline size_t                   c_internal_map_alignment_of(size_t size);
+static CHashMap*                       c_internal_map_create(size_t key_size, size_t value_size, size_t capacity, CHashMapOptions const* options, CAllocator* allocator);
+static void                            c_internal_map_init(CHashMap* map, size_t key_size, size_t value_size, CHashMapOptions const* options, CAllocator* allocator);
+static CHashMap*                       c_internal_map_clone(CHashMap const* self, CAllocator* allocator);
+static CHashMapKeyKind                 c_internal_map_key_kind(CHashMapHashFn hash_fn, CHashMapEqFn eq_fn, size_t key_size);
+static inline bool                     c_internal_map_check_writable(CHashMap const* self);
+static bool                            c_internal_map_insert(CHashMap* self, void const* key, void const* value, uint64_t hash);
+static void*                           c_internal_map_entry(CHashMap* self, void const* key, uint64_t hash, bool* out_was_present, void** out_key);
+static void*                           c_internal_map_get(CHashMap const* self, void const* key, uint64_t hash);
+static bool                            c_internal_map_remove(CHashMap* self, void const* key, uint64_t hash);
+static size_t                          c_internal_map_capacity_for(size_t elements_count);
+static CHashMapLayout                  c_internal_map_layout(CHashMap const* self, size_t capacity);
+static bool                            c_internal_map_allocate(CHashMap* self, size_t capacity, CHashMapTable* out_table);
+static void                            c_internal_map_deallocate(CHashMap* self, CHashMapTable* table);
+static void                            c_internal_map_set_table(CHashMap* self, CHashMapTable table);
+static bool                            c_internal_map_grow(CHashMap* self);
+static bool                            c_internal_map_resize(CHashMap* self, size_t new_capacity);
+static void                            c_internal_map_migrate(CHashMap* self, size_t slots_count);
+static void                            c_internal_map_place(CHashMap* self, void const* key, void const* value, uint64_t hash);
+static inline bool                     c_internal_map_eq(CHashMap const* self, void const* key1, void const* key2);
+static bool                            c_internal_map_build(CHashMap* self, char const* keys, char const* values, size_t count, size_t threads_count);
+static bool                            c_internal_map_build_run(thrd_start_t task_fn, CHashMapBuildTask* tasks, size_t tasks_count);
+static inline size_t                   c_internal_map_build_partition(CHashMapBuildTask const* task, size_t group);
+static int                             c_internal_map_build_count(void* task);
+static int                             c_internal_map_build_scatter(void* task);
+static int                             c_internal_map_build_place(void* task);
+static void                            c_internal_map_erase(CHashMap* self, CHashMapTable* table, size_t index);
+static inline size_t                   c_internal_map_first_group(CHashMapTable const* table, uint64_t hash);
+static bool                            c_internal_map_find(CHashMap const* self, CHashMapTable const* table, void const* key, uint64_t hash, size_t* out_index);
+static inline bool                     c_internal_map_find_sized(CHashMap const* self, CHashMapTable const* table, void const* key, uint64_t hash, size_t fixed_key_size, size_t* out_index);
+static bool                            c_internal_map_find_any(CHashMap const* self, void const* key, uint64_t hash, CHashMapTable const** out_table, size_t* out_index);
+static size_t                          c_internal_map_find_insert_slot(CHashMapTable const* table, uint64_t hash, size_t* out_groups);
+static inline void*                    c_internal_map_get_key(CHashMap const* self, CHashMapTable const* table, size_t index);
+static inline void*                    c_internal_map_get_value(CHashMap const* self, CHashMapTable const* table, size_t index);
+static uint64_t                        c_internal_map_file_checksum(CHashMapFileHeader const* header);
+static bool                            c_internal_map_file_write(CFile* file, char const* magic, CHashMapFileHeader* header, void const* table);
+static char*                           c_internal_map_file_open(CStr path, char const* magic, CHashMapOptions const* options, size_t* out_size);
+static bool                            c_internal_map_file_check(CHashMapFileHeader const* header, size_t file_size, char const* magic, CHashMapOptions const* options);
+static void*                           c_internal_map_file_map(char const* path, size_t* out_size);
+static void                            c_internal_map_file_unmap(void* mapping, size_t size);
+static bool                            c_internal_frozen_map_init(CFrozenMap* self, size_t key_size, size_t value_size, CHashMapHashFn hash_fn, CHashMapEqFn eq_fn, size_t len);
+static size_t                          c_internal_frozen_map_block_size(CFrozenMap const* self, size_t* out_slots_offset, size_t* out_alignment);
+static bool                            c_internal_frozen_map_build(CFrozenMap* self, void const* const* keys, void const* const* values);
+static bool                            c_internal_frozen_map_place(CFrozenMap const* self, void const* const* keys, uint32_t* positions, uint32_t* displacements, bool* out_retry);
+static inline uint64_t                 c_internal_frozen_map_hash(CFrozenMap const* self, void const* key, uint64_t seed);
+static inline size_t                   c_internal_frozen_map_bucket(CFrozenMap const* self, uint64_t hash);
+static inline size_t                   c_internal_frozen_map_slot(CFrozenMap const* self, uint64_t hash, uint32_t d1, uint32_t d2);
+static inline bool                     c_internal_frozen_map_eq(CFrozenMap const* self, void const* key1, void const* key2);
+static uint64_t                        c_internal_str_map_key_hash(void const* key, size_t key_size, uint64_t seed);
+static bool                            c_internal_str_map_key_eq(void const* key1, void const* key2, size_t key_size);
+static bool                            c_internal_str_map_key(CStrHashMap const* self, CStr str, CStrHashMapKey* out_key);
+static inline char const*              c_internal_str_map_key_data(CStrHashMapKey const* key);
+static CHashSet*                       c_internal_set_create(CHashMap* map, CAllocator* allocator);
+static bool                            c_internal_set_check_pair(CHashSet const* set1, CHashSet const* set2);
+static CHashSet*                       c_internal_set_create_like(CHashSet const* set, size_t capacity);
+static inline CConcurrentHashMapShard* c_internal_concurrent_map_shard(CConcurrentHashMap* self, void const* key, uint64_t* out_hash);
+static inline uint64_t                 c_internal_concurrent_map_shard_hash(CConcurrentHashMap const* self, CConcurrentHashMapShard const* shard, void const* key, uint64_t hash);
+static inline void                     c_internal_concurrent_map_read_lock(CConcurrentHashMapShard* shard);
+static inline void                     c_internal_concurrent_map_read_unlock(CConcurrentHashMapShard* shard);
+static inline void                     c_internal_concurrent_map_write_lock(CConcurrentHashMapShard* shard);
+static inline void                     c_internal_concurrent_map_write_unlock(CConcurrentHashMapShard* shard);
 
 CHashMap* c_hashmap_create(size_t key_size, size_t value_size, CAllocator* allocator)
 {
@@ -61,62 +246,17 @@ CHashMap* c_hashmap_create(size_t key_size, size_t value_size, CAllocator* alloc
 
 CHashMap* c_hashmap_create_with_capacity(size_t key_size, size_t value_size, size_t capacity, CAllocator* allocator)
 {
-  if (!key_size || !value_size) {
+  return c_hashmap_create_ex(key_size, value_size, capacity, NULL, allocator);
+}
+
+CHashMap* c_hashmap_create_ex(size_t key_size, size_t value_size, size_t capacity, CHashMapOptions const* options, CAllocator* allocator)
+{
+  if (!value_size) {
     c_error_set(C_ERROR_invalid_size);
     return NULL;
   }
-  if (!capacity) {
-    c_error_set(C_ERROR_invalid_capacity);
-    return NULL;
-  }
-
-  // make sure the capacity is multiplicate of 2
-  if (capacity < CMAP_DEFAULT_CAPACITY) {
-    capacity = CMAP_DEFAULT_CAPACITY;
-  } else {
-    size_t new_capacity = CMAP_DEFAULT_CAPACITY;
-    while (new_capacity < capacity) {
-      new_capacity *= 2;
-    }
-    capacity = new_capacity;
-  }
-
-  if (!allocator) allocator = c_allocator_default();
-
-  CHashMap* map = c_allocator_alloc(allocator, c_allocator_alignas(CHashMap, 1), true);
-  if (!map) return NULL;
-
-  // make sure the key and value sizes are multiplicate of sizeof(uintptr_t)
-  size_t aligned_key_size   = key_size;
-  size_t aligned_value_size = value_size;
-  while (aligned_key_size & (sizeof(uintptr_t) - 1)) {
-    aligned_key_size++;
-  }
-  while (aligned_value_size & (sizeof(uintptr_t) - 1)) {
-    aligned_value_size++;
-  }
-  size_t bucket_size = sizeof(CHashMapBucket) + aligned_key_size + aligned_value_size;
-
-  map->spare_bucket1 = c_allocator_alloc(allocator, (capacity + spare_buckets_count) * bucket_size, sizeof(CHashMapBucket), true);
-  if (!map->spare_bucket1) goto ON_ERROR;
-  map->spare_bucket2 = (char*)(map->spare_bucket1) + bucket_size;
-  map->buckets       = (char*)(map->spare_bucket2) + bucket_size;
-
-  map->capacity           = capacity;
-  map->key_size.orig      = key_size;
-  map->key_size.aligned   = aligned_key_size;
-  map->value_size.orig    = value_size;
-  map->value_size.aligned = aligned_value_size;
-  map->bucket_size        = bucket_size;
-  map->mask               = map->capacity - 1;
-  map->allocator          = allocator;
 
-  return map;
-
-ON_ERROR:
-  c_allocator_free(allocator, map->spare_bucket1);
-  c_allocator_free(allocator, map);
-  return NULL;
+  return c_internal_map_create(key_size, value_size, capacity, options, allocator);
 }
 
 size_t c_hashmap_len(CHashMap const* self)
@@ -131,159 +271,343 @@ bool c_hashmap_is_empty(CHashMap const* self)
 
 size_t c_hashmap_capacity(CHashMap const* self)
 {
-  return self->capacity;
+  return self->table.capacity;
 }
 
 bool c_hashmap_insert(CHashMap* self, void* key, void* value)
 {
-  assert(self && self->buckets);
+  assert(self && self->table.ctrl);
 
   if (!key || !value) {
     c_error_set(C_ERROR_invalid_data);
     return false;
   }
 
-  size_t hash  = c_internal_map_hash(key, self->key_size.orig);
-  size_t index = hash & self->mask;
+  return c_internal_map_insert(self, key, value, c_internal_map_hash(self, key));
+}
+
+bool c_hashmap_get(CHashMap const* self, void* key, void** out_value)
+{
+  assert(self && self->table.ctrl);
 
-  if (self->capacity <= self->len) {
-    bool status = c_internal_map_resize(self, self->capacity * 2);
-    if (!status) return false;
+  if (!key || !out_value) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
   }
 
-  CHashMapBucket* new_bucket               = self->spare_bucket1;
-  new_bucket->distance_from_initial_bucket = 1;
-  new_bucket->hash                         = hash;
-  memcpy((char*)(&new_bucket[1]), key, self->key_size.orig);
-  memcpy((char*)(&new_bucket[1]) + self->key_size.aligned, value, self->value_size.orig);
+  *out_value = c_internal_map_get(self, key, c_internal_map_hash(self, key));
+  return true;
+}
 
-  for (;;) {
-    CHashMapBucket* bucket     = c_internal_map_get_bucket(self, index);
-    void*           bucket_key = c_internal_map_get_key(self, index);
+bool c_hashmap_has_key(CHashMap const* self, void* key)
+{
+  assert(self && self->table.ctrl);
 
-    // [1] empty bucket
-    if (bucket->distance_from_initial_bucket == 0) {
-      memcpy(bucket, new_bucket, self->bucket_size);
-      self->len++;
-      return true;
-    }
+  if (!key) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
 
-    // [2] found one, same hash, update it
-    /// TODO: we need external compare method
-    /// TODO: we need to return old data
-    if ((new_bucket->hash == bucket->hash) && (memcmp(bucket_key, key, self->key_size.orig) == 0)) {
-      memcpy(bucket, new_bucket, self->bucket_size);
-      return true;
-    }
+  return c_internal_map_get(self, key, c_internal_map_hash(self, key)) != NULL;
+}
 
-    // [3] found one, different hash, collision
-    if (bucket->distance_from_initial_bucket < new_bucket->distance_from_initial_bucket) {
-      // swap
-      CHashMapBucket* tmp = (CHashMapBucket*)(self->spare_bucket2);
-      memcpy(tmp, bucket, self->bucket_size);
-      memcpy(bucket, new_bucket, self->bucket_size);
-      memcpy(new_bucket, tmp, self->bucket_size);
-    }
+bool c_hashmap_remove(CHashMap* self, void* key, void** out_value)
+{
+  assert(self && self->table.ctrl);
+
+  if (!key || !out_value) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+  if (!c_internal_map_check_writable(self)) return false;
 
-    index = (index + 1) & self->mask;
-    new_bucket->distance_from_initial_bucket++;
+  if (!c_internal_map_remove(self, key, c_internal_map_hash(self, key))) {
+    c_error_set(C_ERROR_not_found);
+    return false;
   }
 
-  return false;
+  *out_value = self->removed_slot + self->value_offset;
+  return true;
 }
 
-bool c_hashmap_get(CHashMap const* self, void* key, void** out_value)
+uint64_t c_hashmap_hash(CHashMap const* self, void const* key)
+{
+  assert(self && key);
+  return c_internal_map_hash(self, key);
+}
+
+uint64_t c_hashmap_seed(CHashMap const* self)
+{
+  assert(self);
+  return self->seed;
+}
+
+bool c_hashmap_get_prehashed(CHashMap const* self, void const* key, uint64_t hash, void** out_value)
 {
-  assert(self && self->buckets);
+  assert(self && self->table.ctrl);
 
   if (!key || !out_value) {
     c_error_set(C_ERROR_null_ptr);
     return false;
   }
 
-  size_t hash = c_internal_map_hash(key, self->key_size.orig);
+  *out_value = c_internal_map_get(self, key, hash);
+  return true;
+}
 
-  for (size_t index = hash & self->mask;; index = (index + 1) & self->mask) {
-    CHashMapBucket* bucket       = c_internal_map_get_bucket(self, index);
-    void*           bucket_key   = c_internal_map_get_key(self, index);
-    void*           bucket_value = c_internal_map_get_value(self, index);
+bool c_hashmap_insert_prehashed(CHashMap* self, void const* key, void const* value, uint64_t hash)
+{
+  assert(self && self->table.ctrl);
 
-    if (!bucket->distance_from_initial_bucket) {
-      *out_value = NULL;
-      break;
-    }
+  if (!key || !value) {
+    c_error_set(C_ERROR_invalid_data);
+    return false;
+  }
 
-    if (bucket->hash == hash) {
-      if (memcmp(bucket_key, key, self->key_size.orig) == 0) {
-        *out_value = bucket_value;
-        break;
-      }
-    }
+  return c_internal_map_insert(self, key, value, hash);
+}
+
+bool c_hashmap_remove_prehashed(CHashMap* self, void const* key, uint64_t hash, void** out_value)
+{
+  assert(self && self->table.ctrl);
+
+  if (!key || !out_value) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+  if (!c_internal_map_check_writable(self)) return false;
+
+  if (!c_internal_map_remove(self, key, hash)) {
+    c_error_set(C_ERROR_not_found);
+    return false;
   }
 
+  *out_value = self->removed_slot + self->value_offset;
   return true;
 }
 
-bool c_hashmap_has_key(CHashMap const* self, void* key)
+bool c_hashmap_entry(CHashMap* self, void const* key, void** out_value, bool* out_was_present)
 {
-  void* out_value;
-  bool  status = c_hashmap_get(self, key, &out_value);
+  assert(self && self->table.ctrl);
 
-  return status;
+  if (!key || !out_value) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  bool  was_present;
+  void* value = c_internal_map_entry(self, key, c_internal_map_hash(self, key), &was_present, NULL);
+  if (!value) return false;
+
+  if (!was_present) memset(value, 0, self->value_size);
+  *out_value = value;
+  if (out_was_present) *out_was_present = was_present;
+
+  return true;
 }
 
-bool c_hashmap_remove(CHashMap* self, void* key, void** out_value)
+bool c_hashmap_upsert_with(CHashMap* self, void const* key, CHashMapUpsertFn upsert_fn, void* user_data)
 {
-  assert(self && self->buckets);
+  assert(self && self->table.ctrl);
 
-  if (!key || !out_value) {
+  if (!key || !upsert_fn) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  void* value;
+  bool  was_present;
+  if (!c_hashmap_entry(self, key, &value, &was_present)) return false;
+  upsert_fn(value, was_present, user_data);
+
+  return true;
+}
+
+bool c_hashmap_get_batch(CHashMap const* self, void const* keys, size_t keys_count, void** out_values)
+{
+  assert(self && self->table.ctrl);
+
+  if (!keys || !out_values) {
     c_error_set(C_ERROR_null_ptr);
     return false;
   }
 
-  size_t hash = c_internal_map_hash(key, self->key_size.orig);
+  char const* key_bytes = keys;
+  uint64_t    hashes[CMAP_BATCH_SIZE];
+  for (size_t first = 0; first < keys_count; first += CMAP_BATCH_SIZE) {
+    size_t count = (keys_count - first) < CMAP_BATCH_SIZE ? (keys_count - first) : CMAP_BATCH_SIZE;
 
-  for (size_t index = hash & self->mask;; index = (index + 1) & self->mask) {
-    CHashMapBucket* bucket = c_internal_map_get_bucket(self, index);
-    if (!bucket->distance_from_initial_bucket) {
-      c_error_set(C_ERROR_not_found);
-      return false;
+    // [1] hash, and prefetch the first group of each key
+    for (size_t iii = 0; iii < count; ++iii) {
+      hashes[iii] = c_internal_map_hash(self, key_bytes + ((first + iii) * self->key_size));
+      c_internal_hashmap_prefetch(self->table.ctrl + c_internal_map_first_group(&self->table, hashes[iii]));
     }
 
-    void* bucket_key = c_internal_map_get_key(self, index);
-    if (bucket->hash == hash && (memcmp(bucket_key, key, self->key_size.orig) == 0)) {
-      memcpy(self->spare_bucket1, bucket, self->bucket_size);
-      bucket->distance_from_initial_bucket = 0;
+    // [2] the groups are (hopefully) loaded, prefetch the first matched slot
+    for (size_t iii = 0; iii < count; ++iii) {
+      size_t            group   = c_internal_map_first_group(&self->table, hashes[iii]);
+      CHashMapGroupMask matched = c_internal_hashmap_group_match(self->table.ctrl + group, c_internal_hashmap_h2(hashes[iii]));
+      if (matched) c_internal_hashmap_prefetch(c_internal_map_get_key(self, &self->table, group + c_internal_hashmap_mask_next(&matched)));
+    }
 
-      for (;;) {
-        CHashMapBucket* prev   = bucket;
-        index                  = (index + 1) & self->mask;
-        CHashMapBucket* bucket = c_internal_map_get_bucket(self, index);
-        if (bucket->distance_from_initial_bucket <= 1) {
-          prev->distance_from_initial_bucket = 0;
-          break;
-        }
+    // [3] probe
+    for (size_t iii = 0; iii < count; ++iii) {
+      out_values[first + iii] = c_internal_map_get(self, key_bytes + ((first + iii) * self->key_size), hashes[iii]);
+    }
+  }
 
-        memcpy(prev, bucket, self->bucket_size);
-        prev->distance_from_initial_bucket--;
-      }
+  return true;
+}
 
-      self->len--;
+bool c_hashmap_insert_batch(CHashMap* self, void const* keys, void const* values, size_t count)
+{
+  assert(self && self->table.ctrl);
 
-      if ((self->len <= (self->capacity / 4)) && (self->len > CMAP_DEFAULT_CAPACITY)) {
-        c_internal_map_resize(self, self->capacity / 2);
-      }
+  if (!keys || !values) {
+    c_error_set(C_ERROR_invalid_data);
+    return false;
+  }
+  if (!c_internal_map_check_writable(self)) return false;
+
+  // grow once (if all the keys are new), instead of growing in the middle
+  size_t capacity = c_internal_map_capacity_for(self->len + count);
+  if (!self->incremental_resize && !self->old_table.ctrl && (capacity > self->table.capacity)) {
+    if (!c_internal_map_resize(self, capacity)) return false;
+  }
+
+  char const* key_bytes   = keys;
+  char const* value_bytes = values;
+  uint64_t    hashes[CMAP_BATCH_SIZE];
+  for (size_t first = 0; first < count; first += CMAP_BATCH_SIZE) {
+    size_t batch_count = (count - first) < CMAP_BATCH_SIZE ? (count - first) : CMAP_BATCH_SIZE;
+
+    for (size_t iii = 0; iii < batch_count; ++iii) {
+      hashes[iii] = c_internal_map_hash(self, key_bytes + ((first + iii) * self->key_size));
+      c_internal_hashmap_prefetch(self->table.ctrl + c_internal_map_first_group(&self->table, hashes[iii]));
+    }
 
-      *out_value = (char*)self->spare_bucket1 + sizeof(CHashMapBucket) + self->key_size.aligned;
-      break;
+    uint64_t seed = self->seed;
+    for (size_t iii = 0; iii < batch_count; ++iii) {
+      void const* key = key_bytes + ((first + iii) * self->key_size);
+      // the map reseeded (the hashes of the batch are stale)
+      if (self->seed != seed) hashes[iii] = c_internal_map_hash(self, key);
+      if (!c_internal_map_insert(self, key, value_bytes + ((first + iii) * self->value_size), hashes[iii])) return false;
     }
   }
 
   return true;
 }
 
+CHashMap* c_hashmap_build_from(void const* keys, void const* values, size_t count, size_t key_size, size_t value_size, size_t threads_count, CHashMapOptions const* options, CAllocator* allocator)
+{
+  if (count && (!keys || !values)) {
+    c_error_set(C_ERROR_invalid_data);
+    return NULL;
+  }
+
+  CHashMap* map = c_hashmap_create_ex(key_size, value_size, count ? count : CMAP_DEFAULT_CAPACITY, options, allocator);
+  if (!map) return NULL;
+
+  // enough keys for each thread (the threads have a fixed cost)
+  size_t max_threads = count / CMAP_BUILD_MIN_KEYS_PER_THREAD;
+  if (max_threads > CMAP_BUILD_MAX_THREADS) max_threads = CMAP_BUILD_MAX_THREADS;
+  if (threads_count > max_threads) threads_count = max_threads;
+
+  bool is_built = true;
+  if (threads_count > 1) {
+    is_built = c_internal_map_build(map, keys, values, count, threads_count);
+  } else if (count) {
+    is_built = c_hashmap_insert_batch(map, keys, values, count);
+  }
+  if (!is_built) {
+    c_hashmap_destroy(map, NULL, NULL);
+    return NULL;
+  }
+
+  return map;
+}
+
+bool c_hashmap_save(CHashMap* self, CFile* file)
+{
+  assert(self && self->table.ctrl);
+
+  if (!file) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  if (self->old_table.ctrl) c_internal_map_migrate(self, self->old_table.capacity);
+
+  CHashMapFileHeader header = {
+      .flags      = (self->split_values ? CMAP_FILE_FLAG_SPLIT_VALUES : 0) | (self->hash_fn != c_hashmap_hash_bytes ? CMAP_FILE_FLAG_CUSTOM_HASH : 0) | (self->eq_fn ? CMAP_FILE_FLAG_CUSTOM_EQ : 0),
+      .key_size   = self->key_size,
+      .value_size = self->value_size,
+      .capacity   = self->table.capacity,
+      .len        = self->len,
+      .seed       = self->seed,
+      .table_size = c_internal_map_layout(self, self->table.capacity).removed_slot_offset,
+  };
+
+  return c_internal_map_file_write(file, CMAP_FILE_MAGIC, &header, self->table.ctrl);
+}
+
+CHashMap* c_hashmap_open_mmap(CStr path, CHashMapOptions const* options, CAllocator* allocator)
+{
+  if (!allocator) allocator = c_allocator_default();
+
+  size_t mapping_size;
+  char*  mapping = c_internal_map_file_open(path, CMAP_FILE_MAGIC, options, &mapping_size);
+  if (!mapping) return NULL;
+
+  // all the slots fit in the table, so computing its layout can't overflow
+  CHashMapFileHeader const* header    = (CHashMapFileHeader const*)mapping;
+  uint64_t                  capacity  = header->capacity;
+  uint64_t                  slot_size = (capacity >= CMAP_DEFAULT_CAPACITY) ? header->table_size / capacity : 0;
+  if ((capacity < CMAP_DEFAULT_CAPACITY) || (capacity & (capacity - 1)) || (header->len > capacity - (capacity / 8)) ||
+      (header->key_size > slot_size) || (header->value_size > slot_size - header->key_size)) {
+    c_error_set(C_ERROR_invalid_format);
+    c_internal_map_file_unmap(mapping, mapping_size);
+    return NULL;
+  }
+
+  CHashMap* map = c_allocator_alloc_sized(allocator, c_allocator_alignas(CHashMap, 1), true);
+  if (!map) {
+    c_internal_map_file_unmap(mapping, mapping_size);
+    return NULL;
+  }
+
+  CHashMapOptions file_options = {.split_values = header->flags & CMAP_FILE_FLAG_SPLIT_VALUES};
+  if (options) {
+    file_options.hash_fn = options->hash_fn;
+    file_options.eq_fn   = options->eq_fn;
+  }
+  c_internal_map_init(map, header->key_size, header->value_size, &file_options, allocator);
+
+  CHashMapLayout layout = c_internal_map_layout(map, header->capacity);
+  if (layout.removed_slot_offset != header->table_size) {
+    c_error_set(C_ERROR_invalid_format);
+    c_allocator_free_sized(allocator, map, c_allocator_alignas(CHashMap, 1));
+    c_internal_map_file_unmap(mapping, mapping_size);
+    return NULL;
+  }
+
+  char* block         = mapping + CMAP_FILE_HEADER_SIZE;
+  map->table.ctrl     = (uint8_t*)block;
+  map->table.keys     = block + layout.keys_offset;
+  map->table.values   = block + layout.values_offset;
+  map->table.capacity = header->capacity;
+  map->len            = header->len;
+  map->seed           = header->seed;
+  map->mapping        = mapping;
+  map->mapping_size   = mapping_size;
+
+  return map;
+}
+
 void c_hashmap_clear(CHashMap* self, CHashMapElementDestroyFn element_destroy_fn, void* user_data)
 {
+  if (!c_internal_map_check_writable(self)) return;
+
   if (element_destroy_fn) {
     void*        key;
     void*        value;
@@ -293,13 +617,15 @@ void c_hashmap_clear(CHashMap* self, CHashMapElementDestroyFn element_destroy_fn
     }
   }
 
-  memset(self->spare_bucket1, 0, (self->capacity + 2) * self->bucket_size);
-  self->len = 0;
+  if (self->old_table.ctrl) c_internal_map_deallocate(self, &self->old_table);
+  memset(self->table.ctrl, C_HASHMAP_CTRL_EMPTY, self->table.capacity);
+  self->len         = 0;
+  self->growth_left = self->table.capacity - (self->table.capacity / 8);
 }
 
 CHashMapIter c_hashmap_iter(CHashMap* self)
 {
-  assert(self && self->spare_bucket1);
+  assert(self && self->table.ctrl);
 
   CHashMapIter iter = {
       .map = self,
@@ -312,121 +638,2125 @@ bool c_hashmap_iter_next(CHashMapIter* iter, void** key, void** value)
 {
   if (!iter) return false;
 
-  if (!iter->index) iter->index = 0;
+  // the old table (if any) then the table
+  CHashMap* map = iter->map;
+  for (; iter->index < map->old_table.capacity + map->table.capacity; ++iter->index) {
+    CHashMapTable const* table = &map->old_table;
+    size_t               index = iter->index;
+    if (index >= map->old_table.capacity) {
+      table = &map->table;
+      index -= map->old_table.capacity;
+    }
 
-  for (; iter->index < iter->map->capacity; ++iter->index) {
-    CHashMapBucket* bucket = c_internal_map_get_bucket(iter->map, iter->index);
-    if (bucket->distance_from_initial_bucket) {
-      if (key) { *key = c_internal_map_get_key(iter->map, iter->index); }
-      if (value) { *value = c_internal_map_get_value(iter->map, iter->index); }
+    if (c_internal_hashmap_is_full(table->ctrl[index])) {
+      if (key) { *key = c_internal_map_get_key(map, table, index); }
+      if (value) { *value = c_internal_map_get_value(map, table, index); }
       iter->index++;
-      break;
+      return true;
     }
   }
 
-  if (iter->index >= iter->map->capacity) {
-    return false;
-  } else {
-    return true;
-  }
+  return false;
 }
 
 void c_hashmap_destroy(CHashMap* self, CHashMapElementDestroyFn element_destroy_fn, void* user_data)
 {
-  if (self && self->buckets) {
+  if (self && self->table.ctrl) {
     if (element_destroy_fn) {
-      c_hashmap_clear(self, element_destroy_fn, user_data);
+      void*        key;
+      void*        value;
+      CHashMapIter iter = c_hashmap_iter(self);
+      while (c_hashmap_iter_next(&iter, &key, &value)) {
+        element_destroy_fn(key, value, user_data);
+      }
     }
     CAllocator* allocator = self->allocator;
-    c_allocator_free(allocator, self->spare_bucket1);
+    if (self->mapping) {
+      c_internal_map_file_unmap(self->mapping, self->mapping_size);
+    } else {
+      if (self->old_table.ctrl) c_internal_map_deallocate(self, &self->old_table);
+      c_internal_map_deallocate(self, &self->table);
+    }
     *self = (CHashMap){0};
-    c_allocator_free(allocator, self);
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CHashMap, 1));
   }
 }
 
-// ------------------------- internal ------------------------- //
+CStrHashMap* c_str_hashmap_create(size_t value_size, CAllocator* allocator)
+{
+  return c_str_hashmap_create_with_capacity(value_size, CMAP_DEFAULT_CAPACITY, allocator);
+}
 
-size_t c_internal_map_hash(const void* data, size_t data_len)
+CStrHashMap* c_str_hashmap_create_with_capacity(size_t value_size, size_t capacity, CAllocator* allocator)
 {
-  /// TODO: make the hash algo changeable
-  return c_internal_map_clip_hash(c_internal_map_hash_fnv(data, data_len));
+  if (!allocator) allocator = c_allocator_default();
+
+  CStrHashMap* map = c_allocator_alloc_sized(allocator, c_allocator_alignas(CStrHashMap, 1), true);
+  if (!map) return NULL;
+
+  CHashMapOptions options = {.hash_fn = c_internal_str_map_key_hash, .eq_fn = c_internal_str_map_key_eq};
+  map->map                = c_hashmap_create_ex(sizeof(CStrHashMapKey), value_size, capacity, &options, allocator);
+  if (!map->map) {
+    c_allocator_free_sized(allocator, map, c_allocator_alignas(CStrHashMap, 1));
+    return NULL;
+  }
+  // the keys store their hashes (with the random seed of the map), a new seed
+  // wouldn't change them
+  map->map->can_reseed = false;
+
+  return map;
 }
 
-size_t c_internal_map_hash_fnv(const void* data, size_t data_len)
+size_t c_str_hashmap_len(CStrHashMap const* self)
 {
-  // Constants for the FNV-1a hash function
-  const size_t fnv_prime = 1099511628211U;
-  size_t       hash      = 14695981039346656037U; // FNV offset basis
+  assert(self);
+  return self->map->len;
+}
 
-  const uint8_t* bytes = (const uint8_t*)data;
+bool c_str_hashmap_insert(CStrHashMap* self, CStr key, void const* value)
+{
+  assert(self);
 
-  for (size_t i = 0; i < data_len; i++) {
-    hash ^= bytes[i]; // XOR the byte with the hash
-    hash *= fnv_prime; // Multiply by the FNV prime
+  if (!value) {
+    c_error_set(C_ERROR_invalid_data);
+    return false;
   }
 
-  return hash;
+  void* slot_value;
+  if (!c_str_hashmap_entry(self, key, &slot_value, NULL)) return false;
+  memcpy(slot_value, value, self->map->value_size);
+
+  return true;
 }
 
-bool c_internal_map_resize(CHashMap* self, size_t new_capacity)
+bool c_str_hashmap_get(CStrHashMap const* self, CStr key, void** out_value)
 {
-  CHashMap* new_map = c_hashmap_create_with_capacity(self->key_size.orig, self->value_size.orig, new_capacity, self->allocator);
-  if (new_map) return false;
+  assert(self);
 
-  for (size_t iii = 0; iii < self->capacity; iii++) {
-    CHashMapBucket* bucket = c_internal_map_get_bucket(self, iii);
-    if (!bucket->distance_from_initial_bucket) continue;
+  CStrHashMapKey map_key;
+  if (!out_value) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+  if (!c_internal_str_map_key(self, key, &map_key)) return false;
 
-    bucket->distance_from_initial_bucket = 1;
+  *out_value = c_internal_map_get(self->map, &map_key, map_key.hash);
+  return true;
+}
 
-    for (size_t new_index = bucket->hash & new_map->mask;; new_index = (new_index + 1) & new_map->mask) {
-      CHashMapBucket* new_map_bucket = c_internal_map_get_bucket(new_map, new_index);
+bool c_str_hashmap_entry(CStrHashMap* self, CStr key, void** out_value, bool* out_was_present)
+{
+  assert(self);
 
-      if (new_map_bucket->distance_from_initial_bucket == 0) {
-        memcpy(new_map_bucket, bucket, self->bucket_size);
-        break;
+  CStrHashMapKey map_key;
+  if (!out_value) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+  if (!c_internal_str_map_key(self, key, &map_key)) return false;
+
+  bool  was_present;
+  void* slot_key;
+  void* value = c_internal_map_entry(self->map, &map_key, map_key.hash, &was_present, &slot_key);
+  if (!value) return false;
+
+  if (!was_present) {
+    // the new slot points to the caller string, copy it to the arena
+    if (key.len > CMAP_STR_INLINE_CAPACITY) {
+      char* data = NULL;
+      if (!self->long_keys) self->long_keys = c_allocator_arena_create_growable(CMAP_STR_ARENA_CAPACITY);
+      if (self->long_keys) data = c_allocator_alloc_sized(self->long_keys, key.len, 1, false);
+      if (!data) {
+        c_internal_map_remove(self->map, &map_key, map_key.hash);
+        return false;
       }
+      memcpy(data, key.data, key.len);
+      memcpy((char*)slot_key + offsetof(CStrHashMapKey, data), &data, sizeof(data));
+    }
+    memset(value, 0, self->map->value_size);
+  }
 
-      if (new_map_bucket->distance_from_initial_bucket < bucket->distance_from_initial_bucket) {
-        // swap
-        memcpy(self->spare_bucket2, bucket, self->bucket_size);
-        memcpy(bucket, new_map_bucket, self->bucket_size);
-        memcpy(new_map_bucket, self->spare_bucket2, self->bucket_size);
-      }
+  *out_value = value;
+  if (out_was_present) *out_was_present = was_present;
 
-      bucket->distance_from_initial_bucket += 1;
-    }
+  return true;
+}
+
+bool c_str_hashmap_remove(CStrHashMap* self, CStr key, void** out_value)
+{
+  assert(self);
+
+  CStrHashMapKey map_key;
+  if (!out_value) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+  if (!c_internal_str_map_key(self, key, &map_key)) return false;
+
+  if (!c_internal_map_remove(self->map, &map_key, map_key.hash)) {
+    c_error_set(C_ERROR_not_found);
+    return false;
   }
 
-  memcpy(new_map->spare_bucket1, self->spare_bucket1, self->bucket_size);
-  memcpy(new_map->spare_bucket2, self->spare_bucket2, self->bucket_size);
-  c_allocator_free(self->allocator, self->spare_bucket1);
+  if (key.len > CMAP_STR_INLINE_CAPACITY) {
+    CStrHashMapKey const* removed_key = (CStrHashMapKey const*)self->map->removed_slot;
+    c_allocator_free_sized(self->long_keys, (void*)c_internal_str_map_key_data(removed_key), key.len, 1);
+  }
+
+  *out_value = self->map->removed_slot + self->map->value_offset;
+  return true;
+}
+
+void c_str_hashmap_clear(CStrHashMap* self)
+{
+  assert(self);
+
+  c_hashmap_clear(self->map, NULL, NULL);
+  if (self->long_keys) c_allocator_arena_reset(self->long_keys);
+}
+
+CStrHashMapIter c_str_hashmap_iter(CStrHashMap* self)
+{
+  assert(self);
+  return (CStrHashMapIter){.iter = c_hashmap_iter(self->map)};
+}
+
+bool c_str_hashmap_iter_next(CStrHashMapIter* iter, CStr* key, void** value)
+{
+  if (!iter) return false;
+
+  void* map_key;
+  if (!c_hashmap_iter_next(&iter->iter, &map_key, value)) return false;
+
+  if (key) {
+    CStrHashMapKey const* str_key = map_key;
+    *key                          = (CStr){.data = (char*)c_internal_str_map_key_data(str_key), .len = str_key->len};
+  }
 
-  self->spare_bucket1 = new_map->spare_bucket1;
-  self->spare_bucket2 = new_map->spare_bucket2;
-  self->buckets       = new_map->buckets;
-  self->capacity      = new_map->capacity;
-  self->mask          = new_map->mask;
+  return true;
+}
 
-  return new_map;
+void c_str_hashmap_destroy(CStrHashMap* self)
+{
+  if (self && self->map) {
+    CAllocator* allocator = self->map->allocator;
+    c_hashmap_destroy(self->map, NULL, NULL);
+    if (self->long_keys) c_allocator_arena_destroy(self->long_keys);
+    *self = (CStrHashMap){0};
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CStrHashMap, 1));
+  }
 }
 
-void* c_internal_map_get_key(const CHashMap* self, size_t index)
+CHashSet* c_hashset_create(size_t key_size, CAllocator* allocator)
 {
-  return (void*)(((char*)(c_internal_map_get_bucket(self, index))) + sizeof(CHashMapBucket));
+  return c_hashset_create_ex(key_size, CMAP_DEFAULT_CAPACITY, NULL, allocator);
 }
 
-void* c_internal_map_get_value(const CHashMap* self, size_t index)
+CHashSet* c_hashset_create_ex(size_t key_size, size_t capacity, CHashMapOptions const* options, CAllocator* allocator)
 {
-  return (void*)(((char*)(c_internal_map_get_bucket(self, index))) + sizeof(CHashMapBucket) + self->key_size.aligned);
+  if (!allocator) allocator = c_allocator_default();
+
+  CHashMapOptions set_options = options ? *options : (CHashMapOptions){0};
+  set_options.split_values    = false;
+
+  CHashMap* map = c_internal_map_create(key_size, 0, capacity, &set_options, allocator);
+  if (!map) return NULL;
+
+  return c_internal_set_create(map, allocator);
 }
 
-CHashMapBucket* c_internal_map_get_bucket(const CHashMap* self, size_t index)
+size_t c_hashset_len(CHashSet const* self)
 {
-  return (CHashMapBucket*)(((char*)(self->buckets)) + (self->bucket_size * index));
+  assert(self);
+  return self->map->len;
 }
 
-size_t c_internal_map_clip_hash(size_t hash)
+size_t c_hashset_capacity(CHashSet const* self)
 {
-  return hash & 0xFFFFFFFFFFFF;
+  assert(self);
+  return self->map->table.capacity;
 }
+
+bool c_hashset_insert(CHashSet* self, void const* key, bool* out_was_present)
+{
+  assert(self);
+
+  if (!key) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  bool was_present;
+  if (!c_internal_map_entry(self->map, key, c_internal_map_hash(self->map, key), &was_present, NULL)) return false;
+  if (out_was_present) *out_was_present = was_present;
+
+  return true;
+}
+
+bool c_hashset_contains(CHashSet const* self, void const* key)
+{
+  assert(self);
+
+  if (!key) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  return c_internal_map_get(self->map, key, c_internal_map_hash(self->map, key)) != NULL;
+}
+
+bool c_hashset_remove(CHashSet* self, void const* key)
+{
+  assert(self);
+
+  if (!key) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+  if (!c_internal_map_check_writable(self->map)) return false;
+
+  if (!c_internal_map_remove(self->map, key, c_internal_map_hash(self->map, key))) {
+    c_error_set(C_ERROR_not_found);
+    return false;
+  }
+
+  return true;
+}
+
+void c_hashset_clear(CHashSet* self)
+{
+  assert(self);
+  c_hashmap_clear(self->map, NULL, NULL);
+}
+
+CHashSet* c_hashset_union(CHashSet const* set1, CHashSet const* set2)
+{
+  if (!c_internal_set_check_pair(set1, set2)) return NULL;
+
+  // a copy of the bigger one, with the keys of the smaller one
+  bool            is_set1_bigger = set1->map->len >= set2->map->len;
+  CHashSet const* bigger         = is_set1_bigger ? set1 : set2;
+  CHashSet const* smaller        = is_set1_bigger ? set2 : set1;
+
+  CHashMap* map = c_internal_map_clone(bigger->map, set1->map->allocator);
+  if (!map) return NULL;
+  CHashSet* result = c_internal_set_create(map, set1->map->allocator);
+  if (!result) return NULL;
+
+  void*        key;
+  CHashMapIter iter = c_hashmap_iter(smaller->map);
+  while (c_hashmap_iter_next(&iter, &key, NULL)) {
+    if (!c_hashset_insert(result, key, NULL)) {
+      c_hashset_destroy(result);
+      return NULL;
+    }
+  }
+
+  return result;
+}
+
+CHashSet* c_hashset_intersect(CHashSet const* set1, CHashSet const* set2)
+{
+  if (!c_internal_set_check_pair(set1, set2)) return NULL;
+
+  // the keys of the smaller one that the bigger one has
+  bool            is_set1_bigger = set1->map->len >= set2->map->len;
+  CHashSet const* bigger         = is_set1_bigger ? set1 : set2;
+  CHashSet const* smaller        = is_set1_bigger ? set2 : set1;
+
+  CHashSet* result = c_internal_set_create_like(set1, smaller->map->len);
+  if (!result) return NULL;
+
+  void*        key;
+  CHashMapIter iter = c_hashmap_iter(smaller->map);
+  while (c_hashmap_iter_next(&iter, &key, NULL)) {
+    if (c_hashset_contains(bigger, key) && !c_hashset_insert(result, key, NULL)) {
+      c_hashset_destroy(result);
+      return NULL;
+    }
+  }
+
+  return result;
+}
+
+CHashSet* c_hashset_difference(CHashSet const* set1, CHashSet const* set2)
+{
+  if (!c_internal_set_check_pair(set1, set2)) return NULL;
+
+  void*     key;
+  CHashSet* result;
+  if (set2->map->len < set1->map->len) {
+    // a copy of set1, without the keys of set2
+    CHashMap* map = c_internal_map_clone(set1->map, set1->map->allocator);
+    if (!map) return NULL;
+    result = c_internal_set_create(map, set1->map->allocator);
+    if (!result) return NULL;
+
+    CHashMapIter iter = c_hashmap_iter(set2->map);
+    while (c_hashmap_iter_next(&iter, &key, NULL)) {
+      c_internal_map_remove(result->map, key, c_internal_map_hash(result->map, key));
+    }
+  } else {
+    // the keys of set1 that set2 doesn't have
+    result = c_internal_set_create_like(set1, set1->map->len);
+    if (!result) return NULL;
+
+    CHashMapIter iter = c_hashmap_iter(set1->map);
+    while (c_hashmap_iter_next(&iter, &key, NULL)) {
+      if (!c_hashset_contains(set2, key) && !c_hashset_insert(result, key, NULL)) {
+        c_hashset_destroy(result);
+        return NULL;
+      }
+    }
+  }
+
+  return result;
+}
+
+CHashSetIter c_hashset_iter(CHashSet* self)
+{
+  assert(self);
+  return (CHashSetIter){.iter = c_hashmap_iter(self->map)};
+}
+
+bool c_hashset_iter_next(CHashSetIter* iter, void** key)
+{
+  if (!iter) return false;
+  return c_hashmap_iter_next(&iter->iter, key, NULL);
+}
+
+void c_hashset_destroy(CHashSet* self)
+{
+  if (self) {
+    CAllocator* allocator = self->map->allocator;
+    c_hashmap_destroy(self->map, NULL, NULL);
+    *self = (CHashSet){0};
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CHashSet, 1));
+  }
+}
+
+CFrozenMap* c_hashmap_freeze(CHashMap const* map, CAllocator* allocator)
+{
+  assert(map && map->table.ctrl);
+
+  if (!allocator) allocator = map->allocator;
+
+  CFrozenMap* self = c_allocator_alloc_sized(allocator, c_allocator_alignas(CFrozenMap, 1), true);
+  if (!self) return NULL;
+  self->allocator = allocator;
+
+  void const** pointers = NULL;
+  bool         is_built = c_internal_frozen_map_init(self, map->key_size, map->value_size, map->hash_fn, map->eq_fn, map->len);
+  if (is_built && map->len) {
+    pointers = c_allocator_alloc_sized(allocator, c_allocator_alignas(void const*, map->len * 2), false);
+    is_built = pointers != NULL;
+  }
+
+  if (is_built) {
+    // the keys and the values are read from the map
+    size_t               count     = 0;
+    CHashMapTable const* tables[2] = {&map->old_table, &map->table};
+    for (size_t iii = 0; iii < 2; ++iii) {
+      for (size_t index = 0; index < tables[iii]->capacity; ++index) {
+        if (!c_internal_hashmap_is_full(tables[iii]->ctrl[index])) continue;
+        pointers[count]            = c_internal_map_get_key(map, tables[iii], index);
+        pointers[map->len + count] = c_internal_map_get_value(map, tables[iii], index);
+        count++;
+      }
+    }
+    is_built = c_internal_frozen_map_build(self, pointers, pointers + map->len);
+  }
+
+  if (pointers) c_allocator_free_sized(allocator, pointers, c_allocator_alignas(void const*, map->len * 2));
+  if (!is_built) {
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CFrozenMap, 1));
+    return NULL;
+  }
+
+  return self;
+}
+
+CFrozenMap* c_frozen_map_create(void const* keys, void const* values, size_t count, size_t key_size, size_t value_size, CHashMapOptions const* options, CAllocator* allocator)
+{
+  if (!key_size || !value_size) {
+    c_error_set(C_ERROR_invalid_size);
+    return NULL;
+  }
+  if (count && (!keys || !values)) {
+    c_error_set(C_ERROR_invalid_data);
+    return NULL;
+  }
+
+  if (!allocator) allocator = c_allocator_default();
+
+  CFrozenMap* self = c_allocator_alloc_sized(allocator, c_allocator_alignas(CFrozenMap, 1), true);
+  if (!self) return NULL;
+  self->allocator = allocator;
+
+  CHashMapHashFn hash_fn  = (options && options->hash_fn) ? options->hash_fn : c_hashmap_hash_bytes;
+  void const**   pointers = NULL;
+  bool           is_built = c_internal_frozen_map_init(self, key_size, value_size, hash_fn, options ? options->eq_fn : NULL, count);
+  if (is_built && count) {
+    pointers = c_allocator_alloc_sized(allocator, c_allocator_alignas(void const*, count * 2), false);
+    is_built = pointers != NULL;
+  }
+
+  if (is_built) {
+    for (size_t iii = 0; iii < count; ++iii) {
+      pointers[iii]         = (char const*)keys + (iii * key_size);
+      pointers[count + iii] = (char const*)values + (iii * value_size);
+    }
+    is_built = c_internal_frozen_map_build(self, pointers, pointers + count);
+  }
+
+  if (pointers) c_allocator_free_sized(allocator, pointers, c_allocator_alignas(void const*, count * 2));
+  if (!is_built) {
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CFrozenMap, 1));
+    return NULL;
+  }
+
+  return self;
+}
+
+size_t c_frozen_map_len(CFrozenMap const* self)
+{
+  assert(self);
+  return self->len;
+}
+
+bool c_frozen_map_get(CFrozenMap const* self, void const* key, void** out_value)
+{
+  assert(self);
+
+  if (!key || !out_value) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  *out_value = NULL;
+  if (!self->len) return true;
+
+  // one displacement, and the only slot that the key could be in
+  uint64_t        hash         = c_internal_frozen_map_hash(self, key, self->seed);
+  uint32_t const* displacement = self->displacements + (2 * c_internal_frozen_map_bucket(self, hash));
+  char const*     slot         = self->slots + (self->slot_size * c_internal_frozen_map_slot(self, hash, displacement[0], displacement[1]));
+  if (c_internal_frozen_map_eq(self, slot, key)) *out_value = (void*)(slot + self->value_offset);
+
+  return true;
+}
+
+bool c_frozen_map_save(CFrozenMap const* self, CFile* file)
+{
+  assert(self);
+
+  if (!file) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  size_t             slots_offset, alignment;
+  CHashMapFileHeader header = {
+      .flags      = (self->hash_fn != c_hashmap_hash_bytes ? CMAP_FILE_FLAG_CUSTOM_HASH : 0) | (self->eq_fn ? CMAP_FILE_FLAG_CUSTOM_EQ : 0),
+      .key_size   = self->key_size,
+      .value_size = self->value_size,
+      .capacity   = self->buckets_count,
+      .len        = self->len,
+      .seed       = self->seed,
+      .table_size = c_internal_frozen_map_block_size(self, &slots_offset, &alignment),
+  };
+
+  return c_internal_map_file_write(file, CMAP_FROZEN_MAGIC, &header, self->displacements);
+}
+
+CFrozenMap* c_frozen_map_open_mmap(CStr path, CHashMapOptions const* options, CAllocator* allocator)
+{
+  if (!allocator) allocator = c_allocator_default();
+
+  size_t mapping_size;
+  char*  mapping = c_internal_map_file_open(path, CMAP_FROZEN_MAGIC, options, &mapping_size);
+  if (!mapping) return NULL;
+
+  CFrozenMap* self = c_allocator_alloc_sized(allocator, c_allocator_alignas(CFrozenMap, 1), true);
+  if (!self) {
+    c_internal_map_file_unmap(mapping, mapping_size);
+    return NULL;
+  }
+  self->allocator = allocator;
+
+  // all the slots fit in the table, so computing its layout can't overflow
+  CHashMapFileHeader const* header    = (CHashMapFileHeader const*)mapping;
+  uint64_t                  slot_size = header->len ? header->table_size / header->len : 0;
+  CHashMapHashFn            hash_fn   = (options && options->hash_fn) ? options->hash_fn : c_hashmap_hash_bytes;
+  size_t                    slots_offset, alignment;
+
+  bool is_valid = !(header->flags & CMAP_FILE_FLAG_SPLIT_VALUES);
+  if (is_valid && header->len) is_valid = (header->key_size <= slot_size) && (header->value_size <= slot_size - header->key_size);
+  if (is_valid) is_valid = c_internal_frozen_map_init(self, header->key_size, header->value_size, hash_fn, options ? options->eq_fn : NULL, header->len);
+  if (is_valid) is_valid = (header->capacity == self->buckets_count) && (header->table_size == c_internal_frozen_map_block_size(self, &slots_offset, &alignment));
+  if (!is_valid) {
+    c_error_set(C_ERROR_invalid_format);
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CFrozenMap, 1));
+    c_internal_map_file_unmap(mapping, mapping_size);
+    return NULL;
+  }
+
+  char* block         = mapping + CMAP_FILE_HEADER_SIZE;
+  self->displacements = (uint32_t const*)block;
+  self->slots         = block + slots_offset;
+  self->seed          = header->seed;
+  self->mapping       = mapping;
+  self->mapping_size  = mapping_size;
+
+  return self;
+}
+
+void c_frozen_map_destroy(CFrozenMap* self)
+{
+  if (self) {
+    CAllocator* allocator = self->allocator;
+    if (self->mapping) {
+      c_internal_map_file_unmap(self->mapping, self->mapping_size);
+    } else if (self->block) {
+      size_t slots_offset, alignment;
+      size_t block_size = c_internal_frozen_map_block_size(self, &slots_offset, &alignment);
+      c_allocator_free_sized(allocator, self->block, block_size, alignment);
+    }
+    *self = (CFrozenMap){0};
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CFrozenMap, 1));
+  }
+}
+
+CConcurrentHashMap* c_concurrent_hashmap_create(size_t key_size, size_t value_size, size_t shards_count, CHashMapOptions const* options, CAllocator* allocator)
+{
+  if (!shards_count) shards_count = CMAP_CONCURRENT_DEFAULT_SHARDS;
+  if (shards_count & (shards_count - 1)) {
+    c_error_set(C_ERROR_invalid_size);
+    return NULL;
+  }
+
+  if (!allocator) allocator = c_allocator_default();
+
+  CConcurrentHashMap* map = c_allocator_alloc_sized(allocator, c_allocator_alignas(CConcurrentHashMap, 1), true);
+  if (!map) return NULL;
+
+  map->shards = c_allocator_alloc_sized(allocator, shards_count * sizeof(CConcurrentHashMapShard), CMAP_CONCURRENT_ALIGNMENT, true);
+  if (!map->shards) {
+    c_allocator_free_sized(allocator, map, c_allocator_alignas(CConcurrentHashMap, 1));
+    return NULL;
+  }
+  map->shards_count = shards_count;
+  map->allocator    = allocator;
+  map->seed         = (options && options->seed) ? options->seed : c_internal_map_random_seed();
+
+  // with one shard, (hash >> 63) & 0 is still 0
+  unsigned shard_bits = 0;
+  while (((size_t)1 << shard_bits) < shards_count) shard_bits++;
+  map->shard_shift = 64 - (shard_bits ? shard_bits : 1);
+
+  // the shards start with the seed of the shard selection, so one hash serves both
+  CHashMapOptions shard_options = options ? *options : (CHashMapOptions){0};
+  shard_options.seed            = map->seed;
+  for (size_t iii = 0; iii < shards_count; ++iii) {
+    map->shards[iii].map = c_hashmap_create_ex(key_size, value_size, CMAP_DEFAULT_CAPACITY, &shard_options, allocator);
+    if (!map->shards[iii].map) {
+      c_concurrent_hashmap_destroy(map, NULL, NULL);
+      return NULL;
+    }
+    atomic_init(&map->shards[iii].lock, 0);
+  }
+
+  return map;
+}
+
+size_t c_concurrent_hashmap_len(CConcurrentHashMap* self)
+{
+  assert(self);
+
+  size_t len = 0;
+  for (size_t iii = 0; iii < self->shards_count; ++iii) {
+    c_internal_concurrent_map_read_lock(&self->shards[iii]);
+    len += self->shards[iii].map->len;
+    c_internal_concurrent_map_read_unlock(&self->shards[iii]);
+  }
+
+  return len;
+}
+
+bool c_concurrent_hashmap_insert(CConcurrentHashMap* self, void const* key, void const* value)
+{
+  assert(self);
+
+  if (!key || !value) {
+    c_error_set(C_ERROR_invalid_data);
+    return false;
+  }
+
+  uint64_t                 hash;
+  CConcurrentHashMapShard* shard = c_internal_concurrent_map_shard(self, key, &hash);
+
+  c_internal_concurrent_map_write_lock(shard);
+  bool status = c_internal_map_insert(shard->map, key, value, c_internal_concurrent_map_shard_hash(self, shard, key, hash));
+  c_internal_concurrent_map_write_unlock(shard);
+
+  return status;
+}
+
+bool c_concurrent_hashmap_get(CConcurrentHashMap* self, void const* key, void* out_value)
+{
+  assert(self);
+
+  if (!key || !out_value) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  uint64_t                 hash;
+  CConcurrentHashMapShard* shard = c_internal_concurrent_map_shard(self, key, &hash);
+
+  // c_internal_map_get doesn't change the map (not even the incremental resize)
+  c_internal_concurrent_map_read_lock(shard);
+  void* value = c_internal_map_get(shard->map, key, c_internal_concurrent_map_shard_hash(self, shard, key, hash));
+  if (value) memcpy(out_value, value, shard->map->value_size);
+  c_internal_concurrent_map_read_unlock(shard);
+
+  if (!value) {
+    c_error_set(C_ERROR_not_found);
+    return false;
+  }
+
+  return true;
+}
+
+bool c_concurrent_hashmap_remove(CConcurrentHashMap* self, void const* key, void* out_value)
+{
+  assert(self);
+
+  if (!key) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+
+  uint64_t                 hash;
+  CConcurrentHashMapShard* shard = c_internal_concurrent_map_shard(self, key, &hash);
+
+  c_internal_concurrent_map_write_lock(shard);
+  bool is_removed = c_internal_map_remove(shard->map, key, c_internal_concurrent_map_shard_hash(self, shard, key, hash));
+  if (is_removed && out_value) memcpy(out_value, shard->map->removed_slot + shard->map->value_offset, shard->map->value_size);
+  c_internal_concurrent_map_write_unlock(shard);
+
+  if (!is_removed) {
+    c_error_set(C_ERROR_not_found);
+    return false;
+  }
+
+  return true;
+}
+
+bool c_concurrent_hashmap_get_or_insert(CConcurrentHashMap* self, void const* key, void const* value, void* out_value, bool* out_inserted)
+{
+  assert(self);
+
+  if (!key || !value) {
+    c_error_set(C_ERROR_invalid_data);
+    return false;
+  }
+
+  uint64_t                 hash;
+  CConcurrentHashMapShard* shard      = c_internal_concurrent_map_shard(self, key, &hash);
+  size_t                   value_size = shard->map->value_size;
+
+  // [1] the common case, it exists (under the shared lock)
+  c_internal_concurrent_map_read_lock(shard);
+  void* existing = c_internal_map_get(shard->map, key, c_internal_concurrent_map_shard_hash(self, shard, key, hash));
+  if (existing && out_value) memcpy(out_value, existing, value_size);
+  c_internal_concurrent_map_read_unlock(shard);
+
+  if (existing) {
+    if (out_inserted) *out_inserted = false;
+    return true;
+  }
+
+  // [2] check again under the exclusive lock, another thread could insert it first
+  bool status = true;
+  c_internal_concurrent_map_write_lock(shard);
+  hash     = c_internal_concurrent_map_shard_hash(self, shard, key, hash);
+  existing = c_internal_map_get(shard->map, key, hash);
+  if (existing) {
+    if (out_value) memcpy(out_value, existing, value_size);
+  } else {
+    status = c_internal_map_insert(shard->map, key, value, hash);
+    if (status && out_value) memcpy(out_value, value, value_size);
+  }
+  c_internal_concurrent_map_write_unlock(shard);
+
+  if (out_inserted) *out_inserted = status && !existing;
+  return status;
+}
+
+void c_concurrent_hashmap_destroy(CConcurrentHashMap* self, CHashMapElementDestroyFn element_destroy_fn, void* user_data)
+{
+  if (self && self->shards) {
+    CAllocator* allocator = self->allocator;
+    for (size_t iii = 0; iii < self->shards_count; ++iii) {
+      c_hashmap_destroy(self->shards[iii].map, element_destroy_fn, user_data);
+    }
+    c_allocator_free_sized(allocator, self->shards, self->shards_count * sizeof(CConcurrentHashMapShard), CMAP_CONCURRENT_ALIGNMENT);
+    *self = (CConcurrentHashMap){0};
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CConcurrentHashMap, 1));
+  }
+}
+
+uint64_t c_hashmap_hash_bytes(void const* key, size_t key_size, uint64_t seed)
+{
+  return c_internal_hashmap_hash_bytes(key, key_size, seed);
+}
+
+uint64_t c_hashmap_hash_siphash(void const* key, size_t key_size, uint64_t seed)
+{
+  // the key of SipHash is 128 bits, the seed gives 64 of them
+  return c_internal_hashmap_siphash(key, key_size, seed, ~seed);
+}
+
+uint64_t c_hashmap_hash_str_ptr(void const* key, size_t key_size, uint64_t seed)
+{
+  (void)key_size;
+  char const* str = *(char const* const*)key;
+  return c_internal_hashmap_hash_bytes(str, strlen(str), seed);
+}
+
+bool c_hashmap_eq_str_ptr(void const* key1, void const* key2, size_t key_size)
+{
+  (void)key_size;
+  return strcmp(*(char const* const*)key1, *(char const* const*)key2) == 0;
+}
+
+// ------------------------- internal ------------------------- //
+
+uint64_t c_internal_map_hash(CHashMap const* self, void const* key)
+{
+  return c_internal_map_hash_with_seed(self, key, self->seed);
+}
+
+/// @brief the fixed key sizes are passed as constants, so the default hash is
+///        inlined with only the branch of that size
+uint64_t c_internal_map_hash_with_seed(CHashMap const* self, void const* key, uint64_t seed)
+{
+  switch (self->key_kind) {
+  case C_HASHMAP_KEY_KIND_4:
+    return c_internal_hashmap_hash_bytes(key, 4, seed);
+  case C_HASHMAP_KEY_KIND_8:
+    return c_internal_hashmap_hash_bytes(key, 8, seed);
+  case C_HASHMAP_KEY_KIND_16:
+    return c_internal_hashmap_hash_bytes(key, 16, seed);
+  default:
+    return self->hash_fn(key, self->key_size, seed);
+  }
+}
+
+/// @brief a seed for each map: a secret of the process (read once from the
+///        OS) mixed with a counter, like the hash maps of Rust
+uint64_t c_internal_map_random_seed(void)
+{
+  static once_flag            secret_once = ONCE_FLAG_INIT;
+  static atomic_uint_fast64_t counter;
+
+  call_once(&secret_once, c_internal_map_init_secret);
+  uint64_t count = atomic_fetch_add_explicit(&counter, 1, memory_order_relaxed);
+
+  // 0 is the "random seed" of the options
+  uint64_t seed = c_internal_hashmap_mix(c_internal_map_secret[0] + (count * CMAP_FROZEN_MULTIPLIER), c_internal_map_secret[1]);
+  return seed ? seed : CMAP_FROZEN_MULTIPLIER;
+}
+
+/// @brief fill c_internal_map_secret from the OS, or (if that fails) from the
+///        time and the address of the secret (which is random with ASLR)
+void c_internal_map_init_secret(void)
+{
+  bool is_random = false;
+#if defined(_WIN32)
+  unsigned int words[4];
+  is_random = true;
+  for (size_t iii = 0; iii < 4; ++iii) is_random = is_random && (rand_s(&words[iii]) == 0);
+  if (is_random) memcpy(c_internal_map_secret, words, sizeof(c_internal_map_secret));
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+  arc4random_buf(c_internal_map_secret, sizeof(c_internal_map_secret));
+  is_random = true;
+#else
+  int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    is_random = read(fd, c_internal_map_secret, sizeof(c_internal_map_secret)) == (ssize_t)sizeof(c_internal_map_secret);
+    close(fd);
+  }
+#endif
+
+  if (!is_random) {
+    struct timespec now = {0};
+    timespec_get(&now, TIME_UTC);
+    c_internal_map_secret[0] = c_internal_hashmap_mix((uint64_t)now.tv_sec ^ CMAP_FROZEN_MULTIPLIER, (uint64_t)now.tv_nsec ^ (uint64_t)(uintptr_t)c_internal_map_secret);
+    c_internal_map_secret[1] = c_internal_hashmap_mix(c_internal_map_secret[0], CMAP_FROZEN_MULTIPLIER) | 1;
+  }
+}
+
+/// @brief an insert probed too many groups: rehash the map (at the same
+///        capacity) with a new seed, once per capacity (a hash fn that ignores
+///        the seed would make it reseed again and again)
+/// @return false if the map kept its seed
+bool c_internal_map_reseed(CHashMap* self)
+{
+  if (!self->can_reseed || self->reseeded) return false;
+
+  if (self->old_table.ctrl) c_internal_map_migrate(self, self->old_table.capacity);
+
+  uint64_t old_seed = self->seed;
+  self->seed        = c_internal_map_random_seed();
+  if (!c_internal_map_resize(self, self->table.capacity)) {
+    self->seed = old_seed;
+    return false;
+  }
+  self->reseeded = true;
+
+  return true;
+}
+
+/// @brief SipHash-2-4 (the reference one, with the 128 bits key k0, k1)
+uint64_t c_internal_hashmap_siphash(void const* data, size_t data_len, uint64_t k0, uint64_t k1)
+{
+  uint8_t const* bytes = data;
+  uint64_t       v[4]  = {k0 ^ 0x736F6D6570736575ULL, k1 ^ 0x646F72616E646F6DULL, k0 ^ 0x6C7967656E657261ULL, k1 ^ 0x7465646279746573ULL};
+
+  size_t tail_len = data_len & 7;
+  for (uint8_t const* end = bytes + (data_len - tail_len); bytes != end; bytes += 8) {
+    uint64_t word = 0;
+    for (size_t iii = 0; iii < 8; ++iii) word |= (uint64_t)bytes[iii] << (iii * 8);
+    v[3] ^= word;
+    c_internal_hashmap_sipround(v);
+    c_internal_hashmap_sipround(v);
+    v[0] ^= word;
+  }
+
+  uint64_t last = (uint64_t)data_len << 56;
+  for (size_t iii = 0; iii < tail_len; ++iii) last |= (uint64_t)bytes[iii] << (iii * 8);
+  v[3] ^= last;
+  c_internal_hashmap_sipround(v);
+  c_internal_hashmap_sipround(v);
+  v[0] ^= last;
+
+  v[2] ^= 0xFF;
+  for (size_t iii = 0; iii < 4; ++iii) c_internal_hashmap_sipround(v);
+
+  return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+void c_internal_hashmap_sipround(uint64_t v[4])
+{
+  v[0] += v[1], v[1] = c_internal_hashmap_rotl(v[1], 13), v[1] ^= v[0], v[0] = c_internal_hashmap_rotl(v[0], 32);
+  v[2] += v[3], v[3] = c_internal_hashmap_rotl(v[3], 16), v[3] ^= v[2];
+  v[0] += v[3], v[3] = c_internal_hashmap_rotl(v[3], 21), v[3] ^= v[0];
+  v[2] += v[1], v[1] = c_internal_hashmap_rotl(v[1], 17), v[1] ^= v[2], v[2] = c_internal_hashmap_rotl(v[2], 32);
+}
+
+uint64_t c_internal_hashmap_rotl(uint64_t value, unsigned bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+/// @brief the biggest power of 2 that divides size (up to @ref CMAP_MAX_ALIGNMENT)
+size_t c_internal_map_alignment_of(size_t size)
+{
+  size_t alignment = size & (~size + 1);
+  return alignment < CMAP_MAX_ALIGNMENT ? alignment : CMAP_MAX_ALIGNMENT;
+}
+
+/// @brief c_hashmap_create_ex, that allows maps without values (value_size 0)
+CHashMap* c_internal_map_create(size_t key_size, size_t value_size, size_t capacity, CHashMapOptions const* options, CAllocator* allocator)
+{
+  if (!key_size) {
+    c_error_set(C_ERROR_invalid_size);
+    return NULL;
+  }
+  if (!capacity) {
+    c_error_set(C_ERROR_invalid_capacity);
+    return NULL;
+  }
+
+  if (!allocator) allocator = c_allocator_default();
+
+  CHashMap* map = c_allocator_alloc_sized(allocator, c_allocator_alignas(CHashMap, 1), true);
+  if (!map) return NULL;
+  c_internal_map_init(map, key_size, value_size, options, allocator);
+
+  CHashMapTable table;
+  if (!c_internal_map_allocate(map, c_internal_map_capacity_for(capacity), &table)) {
+    c_allocator_free_sized(allocator, map, c_allocator_alignas(CHashMap, 1));
+    return NULL;
+  }
+  c_internal_map_set_table(map, table);
+
+  return map;
+}
+
+/// @brief set the fields of a zeroed map, except the table
+void c_internal_map_init(CHashMap* map, size_t key_size, size_t value_size, CHashMapOptions const* options, CAllocator* allocator)
+{
+  // the size of a type is a multiple of its alignment, so this is enough for
+  // any type of key_size/value_size (a set has no values)
+  size_t key_alignment   = c_internal_map_alignment_of(key_size);
+  size_t value_alignment = value_size ? c_internal_map_alignment_of(value_size) : 1;
+
+  map->key_size           = key_size;
+  map->value_size         = value_size;
+  map->value_offset       = (key_size + value_alignment - 1) & ~(value_alignment - 1);
+  map->slot_alignment     = key_alignment > value_alignment ? key_alignment : value_alignment;
+  map->slot_size          = (map->value_offset + value_size + map->slot_alignment - 1) & ~(map->slot_alignment - 1);
+  map->split_values       = options ? options->split_values : false;
+  map->key_stride         = map->split_values ? key_size : map->slot_size;
+  map->value_stride       = map->split_values ? value_size : map->slot_size;
+  map->allocator          = allocator;
+  map->hash_fn            = (options && options->hash_fn) ? options->hash_fn : c_hashmap_hash_bytes;
+  map->eq_fn              = options ? options->eq_fn : NULL;
+  map->seed               = (options && options->seed) ? options->seed : c_internal_map_random_seed();
+  map->incremental_resize = options ? options->incremental_resize : false;
+  map->can_reseed         = true;
+
+  map->key_kind           = c_internal_map_key_kind(map->hash_fn, map->eq_fn, key_size);
+}
+
+/// @brief a copy of self with the same seed, so the table is copied as it is
+///        (unless an incremental resize is in progress)
+CHashMap* c_internal_map_clone(CHashMap const* self, CAllocator* allocator)
+{
+  CHashMap* map = c_allocator_alloc_sized(allocator, c_allocator_alignas(CHashMap, 1), false);
+  if (!map) return NULL;
+
+  *map               = *self;
+  map->table         = (CHashMapTable){0};
+  map->old_table     = (CHashMapTable){0};
+  map->migrate_index = 0;
+  map->allocator     = allocator;
+  map->mapping       = NULL;
+  map->mapping_size  = 0;
+
+  CHashMapTable table;
+  if (!c_internal_map_allocate(map, self->table.capacity, &table)) {
+    c_allocator_free_sized(allocator, map, c_allocator_alignas(CHashMap, 1));
+    return NULL;
+  }
+  c_internal_map_set_table(map, table);
+
+  if (!self->old_table.ctrl) {
+    memcpy(table.ctrl, self->table.ctrl, c_internal_map_layout(self, table.capacity).removed_slot_offset);
+    map->growth_left = self->growth_left;
+    return map;
+  }
+
+  // the keys of both tables fit in one with the capacity of the new one
+  CHashMapTable const* tables[] = {&self->old_table, &self->table};
+  for (size_t iii = 0; iii < 2; ++iii) {
+    for (size_t jjj = 0; jjj < tables[iii]->capacity; ++jjj) {
+      if (!c_internal_hashmap_is_full(tables[iii]->ctrl[jjj])) continue;
+
+      void* key = c_internal_map_get_key(self, tables[iii], jjj);
+      c_internal_map_place(map, key, c_internal_map_get_value(self, tables[iii], jjj), c_internal_map_hash(map, key));
+    }
+  }
+
+  return map;
+}
+
+/// @brief the keys of the default hash and equality, with one of the
+///        specialized sizes, are hashed and compared with a constant size
+CHashMapKeyKind c_internal_map_key_kind(CHashMapHashFn hash_fn, CHashMapEqFn eq_fn, size_t key_size)
+{
+  if ((hash_fn != c_hashmap_hash_bytes) || eq_fn) return C_HASHMAP_KEY_KIND_generic;
+
+  switch (key_size) {
+  case 4:
+    return C_HASHMAP_KEY_KIND_4;
+  case 8:
+    return C_HASHMAP_KEY_KIND_8;
+  case 16:
+    return C_HASHMAP_KEY_KIND_16;
+  default:
+    return C_HASHMAP_KEY_KIND_generic;
+  }
+}
+
+/// @brief insert or update (the key and the value are copied)
+bool c_internal_map_insert(CHashMap* self, void const* key, void const* value, uint64_t hash)
+{
+  /// TODO: we need to return old data
+  bool  was_present;
+  void* slot_value = c_internal_map_entry(self, key, hash, &was_present, NULL);
+  if (!slot_value) return false;
+
+  memcpy(slot_value, value, self->value_size);
+  return true;
+}
+
+/// @brief find key, or insert it (the new value is left uninitialized)
+/// @param out_key the key inside the map (could be NULL)
+/// @return the value of key, or NULL if the map failed to grow
+void* c_internal_map_entry(CHashMap* self, void const* key, uint64_t hash, bool* out_was_present, void** out_key)
+{
+  if (!c_internal_map_check_writable(self)) return NULL;
+  if (self->old_table.ctrl) c_internal_map_migrate(self, CMAP_MIGRATE_SLOTS);
+
+  CHashMapTable const* table;
+  size_t               index;
+
+  // [1] found one
+  *out_was_present = c_internal_map_find_any(self, key, hash, &table, &index);
+  if (*out_was_present) {
+    if (out_key) *out_key = c_internal_map_get_key(self, table, index);
+    return c_internal_map_get_value(self, table, index);
+  }
+
+  // [2] new one, reuse a deleted slot, or take an empty one (if the load factor allows it)
+  size_t groups;
+  index = c_internal_map_find_insert_slot(&self->table, hash, &groups);
+  if ((groups > CMAP_MAX_PROBE_GROUPS) && c_internal_map_reseed(self)) {
+    // too many collisions (crafted keys?), the hash of the caller is stale now
+    hash  = c_internal_map_hash(self, key);
+    index = c_internal_map_find_insert_slot(&self->table, hash, NULL);
+  }
+  if ((self->table.ctrl[index] == C_HASHMAP_CTRL_EMPTY) && (self->growth_left == 0)) {
+    if (!c_internal_map_grow(self)) return NULL;
+    index = c_internal_map_find_insert_slot(&self->table, hash, NULL);
+  }
+
+  if (self->table.ctrl[index] == C_HASHMAP_CTRL_EMPTY) self->growth_left--;
+  self->table.ctrl[index] = c_internal_hashmap_h2(hash);
+  void* slot_key = c_internal_map_get_key(self, &self->table, index);
+  memcpy(slot_key, key, self->key_size);
+  self->len++;
+
+  if (out_key) *out_key = slot_key;
+
+  return c_internal_map_get_value(self, &self->table, index);
+}
+
+/// @return the value of key, or NULL if it doesn't exist
+void* c_internal_map_get(CHashMap const* self, void const* key, uint64_t hash)
+{
+  CHashMapTable const* table;
+  size_t               index;
+  if (!c_internal_map_find_any(self, key, hash, &table, &index)) return NULL;
+  return c_internal_map_get_value(self, table, index);
+}
+
+/// @brief the removed slot is copied to removed_slot
+/// @return false if key doesn't exist
+bool c_internal_map_remove(CHashMap* self, void const* key, uint64_t hash)
+{
+  if (self->old_table.ctrl) c_internal_map_migrate(self, CMAP_MIGRATE_SLOTS);
+
+  CHashMapTable const* table;
+  size_t               index;
+  if (!c_internal_map_find_any(self, key, hash, &table, &index)) return false;
+
+  c_internal_map_erase(self, (CHashMapTable*)table, index);
+  return true;
+}
+
+/// @brief the capacity (power of 2) that holds elements_count without exceeding
+///        the maximum load factor (7/8)
+size_t c_internal_map_capacity_for(size_t elements_count)
+{
+  size_t capacity = CMAP_DEFAULT_CAPACITY;
+  while (capacity - (capacity / 8) < elements_count) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+/// @brief the block of a table is [control bytes][slots][removed slot], or
+///        [control bytes][keys][values][removed slot] with split_values
+CHashMapLayout c_internal_map_layout(CHashMap const* self, size_t capacity)
+{
+  CHashMapLayout layout;
+  size_t         alignment = self->slot_alignment > C_HASHMAP_GROUP_WIDTH ? self->slot_alignment : C_HASHMAP_GROUP_WIDTH;
+
+  layout.alignment   = alignment;
+  layout.keys_offset = (capacity + alignment - 1) & ~(alignment - 1);
+  if (self->split_values) {
+    layout.values_offset       = (layout.keys_offset + (capacity * self->key_stride) + alignment - 1) & ~(alignment - 1);
+    layout.removed_slot_offset = (layout.values_offset + (capacity * self->value_stride) + alignment - 1) & ~(alignment - 1);
+  } else {
+    layout.values_offset       = layout.keys_offset + self->value_offset;
+    layout.removed_slot_offset = layout.keys_offset + (capacity * self->slot_size);
+  }
+  layout.size = (layout.removed_slot_offset + self->slot_size + alignment - 1) & ~(alignment - 1);
+
+  return layout;
+}
+
+/// @brief allocate an empty table of capacity slots
+bool c_internal_map_allocate(CHashMap* self, size_t capacity, CHashMapTable* out_table)
+{
+  CHashMapLayout layout = c_internal_map_layout(self, capacity);
+
+  uint8_t* block = c_allocator_alloc_sized(self->allocator, layout.size, layout.alignment, false);
+  if (!block) return false;
+  memset(block, C_HASHMAP_CTRL_EMPTY, capacity);
+
+  out_table->ctrl     = block;
+  out_table->keys     = (char*)block + layout.keys_offset;
+  out_table->values   = (char*)block + layout.values_offset;
+  out_table->capacity = capacity;
+
+  return true;
+}
+
+void c_internal_map_deallocate(CHashMap* self, CHashMapTable* table)
+{
+  CHashMapLayout layout = c_internal_map_layout(self, table->capacity);
+
+  c_allocator_free_sized(self->allocator, table->ctrl, layout.size, layout.alignment);
+  *table = (CHashMapTable){0};
+}
+
+/// @brief make an empty table the one that takes the inserts
+void c_internal_map_set_table(CHashMap* self, CHashMapTable table)
+{
+  if (table.capacity != self->table.capacity) self->reseeded = false;
+  self->table        = table;
+  self->removed_slot = (char*)table.ctrl + c_internal_map_layout(self, table.capacity).removed_slot_offset;
+  self->growth_left  = table.capacity - (table.capacity / 8);
+}
+
+/// @brief make room for one more element, by rehashing into a new table, which
+///        is done at once, or incrementally (see @ref c_internal_map_migrate)
+bool c_internal_map_grow(CHashMap* self)
+{
+  if (self->old_table.ctrl) {
+    // the migration finishes before the table is full, but finish it anyway
+    c_internal_map_migrate(self, self->old_table.capacity);
+    if (self->growth_left) return true;
+  }
+
+  // a lot of deleted slots, rehash them away without growing
+  size_t new_capacity = (self->len <= (self->table.capacity * 7 / 16)) ? self->table.capacity : self->table.capacity * 2;
+  if (!self->incremental_resize) return c_internal_map_resize(self, new_capacity);
+
+  CHashMapTable new_table;
+  if (!c_internal_map_allocate(self, new_capacity, &new_table)) return false;
+  self->old_table     = self->table;
+  self->migrate_index = 0;
+  c_internal_map_set_table(self, new_table);
+
+  return true;
+}
+
+bool c_internal_map_resize(CHashMap* self, size_t new_capacity)
+{
+  CHashMapTable new_table;
+  if (!c_internal_map_allocate(self, new_capacity, &new_table)) return false;
+
+  CHashMapTable old_table = self->table;
+  c_internal_map_set_table(self, new_table);
+  for (size_t iii = 0; iii < old_table.capacity; ++iii) {
+    if (!c_internal_hashmap_is_full(old_table.ctrl[iii])) continue;
+
+    void* key = c_internal_map_get_key(self, &old_table, iii);
+    c_internal_map_place(self, key, c_internal_map_get_value(self, &old_table, iii), c_internal_map_hash(self, key));
+  }
+
+  c_internal_map_deallocate(self, &old_table);
+  return true;
+}
+
+/// @brief move up to slots_count slots of old_table into table, the old table
+///        is freed after its last slot.
+///        each insert migrates CMAP_MIGRATE_SLOTS (>= 3) slots, so the
+///        migration is done before table fills up: the new table has at least
+///        the capacity of the old one, with len <= 7/16 of it when it doesn't
+///        grow (so the inserts during the migration (capacity / 8) still fit)
+void c_internal_map_migrate(CHashMap* self, size_t slots_count)
+{
+  CHashMapTable* old_table = &self->old_table;
+  size_t         end       = self->migrate_index + slots_count;
+  if (end > old_table->capacity) end = old_table->capacity;
+
+  for (; self->migrate_index < end; ++self->migrate_index) {
+    if (!c_internal_hashmap_is_full(old_table->ctrl[self->migrate_index])) continue;
+
+    void* key = c_internal_map_get_key(self, old_table, self->migrate_index);
+    c_internal_map_place(self, key, c_internal_map_get_value(self, old_table, self->migrate_index), c_internal_map_hash(self, key));
+    // not EMPTY, the probing of the old table has to pass through it
+    old_table->ctrl[self->migrate_index] = C_HASHMAP_CTRL_DELETED;
+  }
+
+  if (self->migrate_index == old_table->capacity) c_internal_map_deallocate(self, old_table);
+}
+
+/// @brief copy the key and the value of a key that doesn't exist in table
+void c_internal_map_place(CHashMap* self, void const* key, void const* value, uint64_t hash)
+{
+  size_t index = c_internal_map_find_insert_slot(&self->table, hash, NULL);
+  if (self->table.ctrl[index] == C_HASHMAP_CTRL_EMPTY) self->growth_left--;
+  self->table.ctrl[index] = c_internal_hashmap_h2(hash);
+  if (self->split_values) {
+    memcpy(c_internal_map_get_key(self, &self->table, index), key, self->key_size);
+    memcpy(c_internal_map_get_value(self, &self->table, index), value, self->value_size);
+  } else {
+    memcpy(c_internal_map_get_key(self, &self->table, index), key, self->slot_size);
+  }
+}
+
+bool c_internal_map_eq(CHashMap const* self, void const* key1, void const* key2)
+{
+  switch (self->key_kind) {
+  case C_HASHMAP_KEY_KIND_4:
+    return memcmp(key1, key2, 4) == 0;
+  case C_HASHMAP_KEY_KIND_8:
+    return memcmp(key1, key2, 8) == 0;
+  case C_HASHMAP_KEY_KIND_16:
+    return memcmp(key1, key2, 16) == 0;
+  default:
+    return self->eq_fn ? self->eq_fn(key1, key2, self->key_size) : (memcmp(key1, key2, self->key_size) == 0);
+  }
+}
+
+/// @brief fill the (empty) table of self with threads: the groups of the table
+///        are split into threads_count partitions (by the high bits of the
+///        first group of a key), the keys are sorted by partition (a radix
+///        pass: count, then scatter), and each thread places the keys of its
+///        partition without locks; a key that would probe a group of another
+///        partition is inserted by the calling thread at the end
+bool c_internal_map_build(CHashMap* self, char const* keys, char const* values, size_t count, size_t threads_count)
+{
+  size_t              partitions_count = threads_count;
+  CHashMapBuildTask*  tasks            = c_allocator_alloc_sized(self->allocator, c_allocator_alignas(CHashMapBuildTask, threads_count), true);
+  size_t*             offsets          = c_allocator_alloc_sized(self->allocator, c_allocator_alignas(size_t, threads_count * partitions_count), true);
+  CHashMapBuildEntry* entries          = c_allocator_alloc_sized(self->allocator, c_allocator_alignas(CHashMapBuildEntry, count), false);
+  bool                is_built         = tasks && offsets && entries;
+
+  if (is_built) {
+    unsigned groups_shift = 0;
+    while (((size_t)C_HASHMAP_GROUP_WIDTH << groups_shift) < self->table.capacity) groups_shift++;
+
+    for (size_t iii = 0; iii < threads_count; ++iii) {
+      tasks[iii] = (CHashMapBuildTask){
+          .map              = self,
+          .keys             = keys,
+          .values           = values,
+          .first            = count * iii / threads_count,
+          .end              = count * (iii + 1) / threads_count,
+          .partition        = iii,
+          .partitions_count = partitions_count,
+          .groups_shift     = groups_shift,
+          .offsets          = offsets + (iii * partitions_count),
+          .entries          = entries,
+      };
+    }
+
+    // [1] count the keys of each chunk by partition, then turn the counts into
+    //     offsets: partition by partition, chunk by chunk (this keeps the
+    //     order of the keys inside a partition)
+    is_built = c_internal_map_build_run(c_internal_map_build_count, tasks, threads_count);
+    size_t offset = 0;
+    for (size_t partition = 0; partition < partitions_count; ++partition) {
+      tasks[partition].entries_first = offset;
+      for (size_t iii = 0; iii < threads_count; ++iii) {
+        size_t keys_count             = tasks[iii].offsets[partition];
+        tasks[iii].offsets[partition] = offset;
+        offset += keys_count;
+      }
+      tasks[partition].entries_end = offset;
+    }
+
+    // [2] scatter the keys, [3] place them
+    is_built = is_built && c_internal_map_build_run(c_internal_map_build_scatter, tasks, threads_count);
+    is_built = is_built && c_internal_map_build_run(c_internal_map_build_place, tasks, threads_count);
+  }
+
+  if (is_built) {
+    for (size_t iii = 0; iii < threads_count; ++iii) self->len += tasks[iii].placed_count;
+    self->growth_left -= self->len;
+
+    // [4] the deferred keys, in the order of their partition (a key that is
+    //     the same as a placed one comes after it)
+    uint64_t seed = self->seed;
+    for (size_t iii = 0; is_built && (iii < threads_count); ++iii) {
+      CHashMapBuildEntry const* deferred = entries + tasks[iii].entries_first;
+      for (size_t jjj = 0; is_built && (jjj < tasks[iii].deferred_count); ++jjj) {
+        char const* key  = keys + (deferred[jjj].index * self->key_size);
+        uint64_t    hash = (self->seed == seed) ? deferred[jjj].hash : c_internal_map_hash(self, key);
+        is_built         = c_internal_map_insert(self, key, values + (deferred[jjj].index * self->value_size), hash);
+      }
+    }
+  }
+
+  if (entries) c_allocator_free_sized(self->allocator, entries, c_allocator_alignas(CHashMapBuildEntry, count));
+  if (offsets) c_allocator_free_sized(self->allocator, offsets, c_allocator_alignas(size_t, threads_count * partitions_count));
+  if (tasks) c_allocator_free_sized(self->allocator, tasks, c_allocator_alignas(CHashMapBuildTask, threads_count));
+
+  return is_built;
+}
+
+/// @brief run task_fn on each task, tasks[0] on the calling thread (a task
+///        that gets no thread runs on the calling thread too)
+bool c_internal_map_build_run(thrd_start_t task_fn, CHashMapBuildTask* tasks, size_t tasks_count)
+{
+  thrd_t threads[CMAP_BUILD_MAX_THREADS];
+  bool   is_started[CMAP_BUILD_MAX_THREADS] = {0};
+  for (size_t iii = 1; iii < tasks_count; ++iii) {
+    is_started[iii] = thrd_create(&threads[iii], task_fn, &tasks[iii]) == thrd_success;
+  }
+
+  int result = task_fn(&tasks[0]);
+  for (size_t iii = 1; iii < tasks_count; ++iii) {
+    int task_result = 0;
+    if (is_started[iii]) {
+      thrd_join(threads[iii], &task_result);
+    } else {
+      task_result = task_fn(&tasks[iii]);
+    }
+    result |= task_result;
+  }
+
+  return result == 0;
+}
+
+/// @brief the partition of a group: its high bits
+size_t c_internal_map_build_partition(CHashMapBuildTask const* task, size_t group)
+{
+  return ((group / C_HASHMAP_GROUP_WIDTH) * task->partitions_count) >> task->groups_shift;
+}
+
+int c_internal_map_build_count(void* task)
+{
+  CHashMapBuildTask* self = task;
+  for (size_t iii = self->first; iii < self->end; ++iii) {
+    uint64_t hash = c_internal_map_hash(self->map, self->keys + (iii * self->map->key_size));
+    self->offsets[c_internal_map_build_partition(self, c_internal_map_first_group(&self->map->table, hash))]++;
+  }
+
+  return 0;
+}
+
+/// @brief the keys are hashed again, this is cheaper than keeping the hashes
+int c_internal_map_build_scatter(void* task)
+{
+  CHashMapBuildTask* self = task;
+  for (size_t iii = self->first; iii < self->end; ++iii) {
+    uint64_t hash      = c_internal_map_hash(self->map, self->keys + (iii * self->map->key_size));
+    size_t   partition = c_internal_map_build_partition(self, c_internal_map_first_group(&self->map->table, hash));
+    self->entries[self->offsets[partition]++] = (CHashMapBuildEntry){.hash = hash, .index = iii};
+  }
+
+  return 0;
+}
+
+/// @brief the table has no deleted slots, so the probing of a key stops at the
+///        first group with an empty slot, where it is inserted (if it wasn't
+///        found before)
+int c_internal_map_build_place(void* task)
+{
+  CHashMapBuildTask*   self  = task;
+  CHashMap*            map   = self->map;
+  CHashMapTable const* table = &map->table;
+  size_t               mask  = table->capacity - 1;
+
+  for (size_t iii = self->entries_first; iii < self->entries_end; ++iii) {
+    CHashMapBuildEntry entry = self->entries[iii];
+    char const*        key   = self->keys + (entry.index * map->key_size);
+    char const*        value = self->values + (entry.index * map->value_size);
+    size_t             group = c_internal_map_first_group(table, entry.hash);
+    uint8_t            h2    = c_internal_hashmap_h2(entry.hash);
+
+    for (size_t stride = C_HASHMAP_GROUP_WIDTH;; stride += C_HASHMAP_GROUP_WIDTH) {
+      // [1] an update
+      CHashMapGroupMask matched    = c_internal_hashmap_group_match(table->ctrl + group, h2);
+      bool              is_present = false;
+      while (matched && !is_present) {
+        size_t index = group + c_internal_hashmap_mask_next(&matched);
+        is_present   = c_internal_map_eq(map, c_internal_map_get_key(map, table, index), key);
+        if (is_present) memcpy(c_internal_map_get_value(map, table, index), value, map->value_size);
+      }
+      if (is_present) break;
+
+      // [2] a new key
+      CHashMapGroupMask empty = c_internal_hashmap_group_match_empty(table->ctrl + group);
+      if (empty) {
+        size_t index       = group + c_internal_hashmap_mask_next(&empty);
+        table->ctrl[index] = h2;
+        memcpy(c_internal_map_get_key(map, table, index), key, map->key_size);
+        memcpy(c_internal_map_get_value(map, table, index), value, map->value_size);
+        self->placed_count++;
+        break;
+      }
+
+      // [3] the next group belongs to another thread
+      group = (group + stride) & mask;
+      if (c_internal_map_build_partition(self, group) != self->partition) {
+        self->entries[self->entries_first + self->deferred_count++] = entry;
+        break;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/// @brief remove a full slot, it is copied to removed_slot first
+void c_internal_map_erase(CHashMap* self, CHashMapTable* table, size_t index)
+{
+  memcpy(self->removed_slot, c_internal_map_get_key(self, table, index), self->key_size);
+  memcpy(self->removed_slot + self->value_offset, c_internal_map_get_value(self, table, index), self->value_size);
+
+  // the probing stops at a group that has an empty slot, so if this group has
+  // one, no key was placed after it because this group was full
+  size_t            group = index & ~(size_t)(C_HASHMAP_GROUP_WIDTH - 1);
+  CHashMapGroupMask empty = c_internal_hashmap_group_match_empty(table->ctrl + group);
+  if (empty) {
+    table->ctrl[index] = C_HASHMAP_CTRL_EMPTY;
+    if (table == &self->table) self->growth_left++;
+  } else {
+    table->ctrl[index] = C_HASHMAP_CTRL_DELETED;
+  }
+  self->len--;
+}
+
+bool c_internal_map_find(CHashMap const* self, CHashMapTable const* table, void const* key, uint64_t hash, size_t* out_index)
+{
+  switch (self->key_kind) {
+  case C_HASHMAP_KEY_KIND_4:
+    return c_internal_map_find_sized(self, table, key, hash, 4, out_index);
+  case C_HASHMAP_KEY_KIND_8:
+    return c_internal_map_find_sized(self, table, key, hash, 8, out_index);
+  case C_HASHMAP_KEY_KIND_16:
+    return c_internal_map_find_sized(self, table, key, hash, 16, out_index);
+  default:
+    return c_internal_map_find_sized(self, table, key, hash, 0, out_index);
+  }
+}
+
+/// @brief the index of the first group of the probe sequence of hash
+size_t c_internal_map_first_group(CHashMapTable const* table, uint64_t hash)
+{
+  return c_internal_hashmap_h1(hash) & (table->capacity - 1) & ~(size_t)(C_HASHMAP_GROUP_WIDTH - 1);
+}
+
+/// @brief probe the groups (triangular probing visits all of them), only the
+///        slots of matched control bytes are touched
+/// @param fixed_key_size a constant key size (the keys are compared with an
+///                       inlined memcmp), or 0 to use self->eq_fn
+bool c_internal_map_find_sized(CHashMap const* self, CHashMapTable const* table, void const* key, uint64_t hash, size_t fixed_key_size, size_t* out_index)
+{
+  size_t  mask  = table->capacity - 1;
+  size_t  group = c_internal_map_first_group(table, hash);
+  uint8_t h2    = c_internal_hashmap_h2(hash);
+
+  for (size_t stride = C_HASHMAP_GROUP_WIDTH;; stride += C_HASHMAP_GROUP_WIDTH) {
+    CHashMapGroupMask matched = c_internal_hashmap_group_match(table->ctrl + group, h2);
+    while (matched) {
+      size_t      index    = group + c_internal_hashmap_mask_next(&matched);
+      void const* slot_key = c_internal_map_get_key(self, table, index);
+      bool        is_equal;
+      if (fixed_key_size) {
+        is_equal = memcmp(slot_key, key, fixed_key_size) == 0;
+      } else if (self->eq_fn) {
+        is_equal = self->eq_fn(slot_key, key, self->key_size);
+      } else {
+        is_equal = memcmp(slot_key, key, self->key_size) == 0;
+      }
+      if (is_equal) {
+        *out_index = index;
+        return true;
+      }
+    }
+    if (c_internal_hashmap_group_match_empty(table->ctrl + group)) return false;
+    if (stride > table->capacity) return false; // full table (this doesn't happen with the load factor)
+
+    group = (group + stride) & mask;
+  }
+}
+
+/// @brief find in table, then in old_table (while an incremental resize is in progress)
+bool c_internal_map_find_any(CHashMap const* self, void const* key, uint64_t hash, CHashMapTable const** out_table, size_t* out_index)
+{
+  if (c_internal_map_find(self, &self->table, key, hash, out_index)) {
+    *out_table = &self->table;
+    return true;
+  }
+  if (self->old_table.ctrl && c_internal_map_find(self, &self->old_table, key, hash, out_index)) {
+    *out_table = &self->old_table;
+    return true;
+  }
+  return false;
+}
+
+/// @brief find the first empty or deleted slot in the probe sequence of hash
+/// @param out_groups the probed groups (could be NULL)
+size_t c_internal_map_find_insert_slot(CHashMapTable const* table, uint64_t hash, size_t* out_groups)
+{
+  size_t mask  = table->capacity - 1;
+  size_t group = c_internal_map_first_group(table, hash);
+
+  for (size_t stride = C_HASHMAP_GROUP_WIDTH;; stride += C_HASHMAP_GROUP_WIDTH) {
+    CHashMapGroupMask available = c_internal_hashmap_group_match_empty_or_deleted(table->ctrl + group);
+    if (available) {
+      if (out_groups) *out_groups = stride / C_HASHMAP_GROUP_WIDTH;
+      return group + c_internal_hashmap_mask_next(&available);
+    }
+
+    group = (group + stride) & mask;
+  }
+}
+
+void* c_internal_map_get_key(CHashMap const* self, CHashMapTable const* table, size_t index)
+{
+  return table->keys + (self->key_stride * index);
+}
+
+void* c_internal_map_get_value(CHashMap const* self, CHashMapTable const* table, size_t index)
+{
+  return table->values + (self->value_stride * index);
+}
+
+/// @brief set C_ERROR_read_only if the map is a mapped snapshot
+bool c_internal_map_check_writable(CHashMap const* self)
+{
+  if (!self->mapping) return true;
+  c_error_set(C_ERROR_read_only);
+  return false;
+}
+
+uint64_t c_internal_map_file_checksum(CHashMapFileHeader const* header)
+{
+  return c_hashmap_hash_bytes(header, offsetof(CHashMapFileHeader, checksum), 0);
+}
+
+/// @brief write the header (its magic, version and checksum are set here) and
+///        the table
+bool c_internal_map_file_write(CFile* file, char const* magic, CHashMapFileHeader* header, void const* table)
+{
+  memcpy(header->magic, magic, sizeof(header->magic));
+  header->version  = CMAP_FILE_VERSION;
+  header->checksum = c_internal_map_file_checksum(header);
+
+  size_t written = 0;
+  if (!c_fs_file_write(file, (CStr){(char*)header, sizeof(*header)}, &written) || (written != sizeof(*header))) return false;
+  if (header->table_size) {
+    if (!c_fs_file_write(file, (CStr){(char*)table, header->table_size}, &written) || (written != header->table_size)) return false;
+  }
+
+  return c_fs_file_flush(file);
+}
+
+/// @brief map a snapshot, and validate the parts of its header that are
+///        common to all snapshots
+/// @return the mapping (the header is at its start), or NULL
+char* c_internal_map_file_open(CStr path, char const* magic, CHashMapOptions const* options, size_t* out_size)
+{
+  if (!path.data || !path.len) {
+    c_error_set(C_ERROR_fs_invalid_path);
+    return NULL;
+  }
+  if (path.data[path.len] != '\0') {
+    c_error_set(C_ERROR_none_terminated_raw_str);
+    return NULL;
+  }
+
+  char* mapping = c_internal_map_file_map(path.data, out_size);
+  if (!mapping) return NULL;
+
+  if (!c_internal_map_file_check((CHashMapFileHeader const*)mapping, *out_size, magic, options)) {
+    c_error_set(C_ERROR_invalid_format);
+    c_internal_map_file_unmap(mapping, *out_size);
+    return NULL;
+  }
+
+  return mapping;
+}
+
+/// @brief validate the header of a mapped snapshot (the table is not read,
+///        its pages are loaded on the first lookups)
+bool c_internal_map_file_check(CHashMapFileHeader const* header, size_t file_size, char const* magic, CHashMapOptions const* options)
+{
+  if (file_size < CMAP_FILE_HEADER_SIZE) return false;
+  if (memcmp(header->magic, magic, sizeof(header->magic)) != 0) return false;
+  if (header->version != CMAP_FILE_VERSION) return false;
+  if (header->checksum != c_internal_map_file_checksum(header)) return false;
+  if (header->flags & ~CMAP_FILE_FLAGS) return false;
+
+  // the functions can't be saved, the caller has to pass the same ones
+  if (!(header->flags & CMAP_FILE_FLAG_CUSTOM_HASH) != !(options && options->hash_fn)) return false;
+  if (!(header->flags & CMAP_FILE_FLAG_CUSTOM_EQ) != !(options && options->eq_fn)) return false;
+
+  if (header->table_size > file_size - CMAP_FILE_HEADER_SIZE) return false;
+  if (!header->key_size || !header->value_size) return false;
+
+  return true;
+}
+
+/// @brief map the whole file read only
+void* c_internal_map_file_map(char const* path, size_t* out_size)
+{
+#ifdef _WIN32
+  SetLastError(0);
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    c_error_set(GetLastError());
+    return NULL;
+  }
+
+  LARGE_INTEGER size    = {0};
+  HANDLE        mapping = NULL;
+  void*         mem     = NULL;
+  if (GetFileSizeEx(file, &size) && (size.QuadPart >= CMAP_FILE_HEADER_SIZE)) {
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping) mem = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mem) c_error_set(GetLastError());
+  } else {
+    c_error_set(C_ERROR_invalid_format);
+  }
+  if (mapping) CloseHandle(mapping);
+  CloseHandle(file);
+
+  *out_size = (size_t)size.QuadPart;
+  return mem;
+#else
+  errno  = 0;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    c_error_set(errno);
+    return NULL;
+  }
+
+  struct stat st;
+  void*       mem = NULL;
+  if (fstat(fd, &st) != 0) {
+    c_error_set(errno);
+  } else if (st.st_size < (off_t)CMAP_FILE_HEADER_SIZE) {
+    c_error_set(C_ERROR_invalid_format);
+  } else {
+    mem = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+      c_error_set(errno);
+      mem = NULL;
+    }
+  }
+  close(fd);
+
+  *out_size = (size_t)st.st_size;
+  return mem;
+#endif
+}
+
+void c_internal_map_file_unmap(void* mapping, size_t size)
+{
+#ifdef _WIN32
+  (void)size;
+  UnmapViewOfFile(mapping);
+#else
+  munmap(mapping, size);
+#endif
+}
+
+/// @brief set the sizes and the functions of a zeroed frozen map of len keys
+bool c_internal_frozen_map_init(CFrozenMap* self, size_t key_size, size_t value_size, CHashMapHashFn hash_fn, CHashMapEqFn eq_fn, size_t len)
+{
+  // the slots and the displacements are uint32_t
+  if (len > UINT32_MAX) {
+    c_error_set(C_ERROR_invalid_len);
+    return false;
+  }
+
+  size_t key_alignment   = c_internal_map_alignment_of(key_size);
+  size_t value_alignment = c_internal_map_alignment_of(value_size);
+
+  self->len            = len;
+  self->buckets_count  = (len + CMAP_FROZEN_BUCKET_SIZE - 1) / CMAP_FROZEN_BUCKET_SIZE;
+  self->key_size       = key_size;
+  self->value_size     = value_size;
+  self->value_offset   = (key_size + value_alignment - 1) & ~(value_alignment - 1);
+  self->slot_alignment = key_alignment > value_alignment ? key_alignment : value_alignment;
+  self->slot_size      = (self->value_offset + value_size + self->slot_alignment - 1) & ~(self->slot_alignment - 1);
+  self->hash_fn        = hash_fn;
+  self->eq_fn          = eq_fn;
+  self->key_kind       = c_internal_map_key_kind(hash_fn, eq_fn, key_size);
+
+  return true;
+}
+
+/// @brief the block is [displacements][slots]
+size_t c_internal_frozen_map_block_size(CFrozenMap const* self, size_t* out_slots_offset, size_t* out_alignment)
+{
+  size_t alignment = self->slot_alignment > sizeof(uint32_t) ? self->slot_alignment : sizeof(uint32_t);
+
+  *out_alignment    = alignment;
+  *out_slots_offset = ((self->buckets_count * 2 * sizeof(uint32_t)) + alignment - 1) & ~(alignment - 1);
+  return self->len ? (*out_slots_offset + (self->len * self->slot_size) + alignment - 1) & ~(alignment - 1) : 0;
+}
+
+/// @brief find the displacements (trying a few seeds), then copy the keys and
+///        the values to their slots
+bool c_internal_frozen_map_build(CFrozenMap* self, void const* const* keys, void const* const* values)
+{
+  if (!self->len) return true;
+
+  // the slot of each key, and the displacements of each bucket
+  size_t    scratch_size = (self->len + (self->buckets_count * 2)) * sizeof(uint32_t);
+  uint32_t* positions    = c_allocator_alloc_sized(self->allocator, scratch_size, sizeof(uint32_t), false);
+  if (!positions) return false;
+  uint32_t* displacements = positions + self->len;
+
+  bool is_placed = false;
+  bool is_retry  = true;
+  for (uint64_t attempt = 0; (attempt < CMAP_FROZEN_MAX_ATTEMPTS) && is_retry; ++attempt) {
+    self->seed = (attempt + 1) * CMAP_FROZEN_MULTIPLIER;
+    is_placed  = c_internal_frozen_map_place(self, keys, positions, displacements, &is_retry);
+    if (is_placed) break;
+  }
+  if (!is_placed && is_retry) c_error_set(C_ERROR_invalid_data);
+
+  size_t slots_offset, alignment;
+  size_t block_size = c_internal_frozen_map_block_size(self, &slots_offset, &alignment);
+  if (is_placed) {
+    self->block = c_allocator_alloc_sized(self->allocator, block_size, alignment, true);
+    is_placed   = self->block != NULL;
+  }
+
+  if (is_placed) {
+    memcpy(self->block, displacements, self->buckets_count * 2 * sizeof(uint32_t));
+
+    char* slots = self->block + slots_offset;
+    for (size_t iii = 0; iii < self->len; ++iii) {
+      char* slot = slots + (self->slot_size * positions[iii]);
+      memcpy(slot, keys[iii], self->key_size);
+      memcpy(slot + self->value_offset, values[iii], self->value_size);
+    }
+    self->displacements = (uint32_t const*)self->block;
+    self->slots         = slots;
+  }
+
+  c_allocator_free_sized(self->allocator, positions, scratch_size, sizeof(uint32_t));
+  return is_placed;
+}
+
+/// @brief with the current seed, find the displacements of the buckets, the
+///        biggest ones first (while most of the slots are free)
+/// @param out_retry set to true if another seed could work, false on errors
+///                  (like duplicated keys)
+/// @return true if every key got a slot
+bool c_internal_frozen_map_place(CFrozenMap const* self, void const* const* keys, uint32_t* positions, uint32_t* displacements, bool* out_retry)
+{
+  size_t const len           = self->len;
+  size_t const buckets_count = self->buckets_count;
+  size_t const words_count   = (len + 63) / 64;
+
+  // scratch: the hashes, the keys grouped by bucket, the first key of each
+  // bucket, the buckets sorted by size, and a bit for each taken slot (small
+  // enough to stay in the cache while the displacements are tried)
+  size_t scratch_size = ((len + words_count) * sizeof(uint64_t)) + (((len * 2) + (buckets_count * 2) + 1) * sizeof(uint32_t));
+  scratch_size        = (scratch_size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+  char* scratch       = c_allocator_alloc_sized(self->allocator, scratch_size, sizeof(uint64_t), true);
+  if (!scratch) {
+    *out_retry = false;
+    return false;
+  }
+  uint64_t* hashes = (uint64_t*)scratch;
+  uint64_t* taken  = hashes + len;
+  uint32_t* order  = (uint32_t*)(taken + words_count);
+  uint32_t* starts = order + len;
+  uint32_t* sorted = starts + buckets_count + 1;
+  uint32_t* cursor = positions; ///< the next key of each bucket, until the positions are written
+
+  bool   is_placed                                = false;
+  size_t size_offsets[CMAP_FROZEN_MAX_BUCKET + 1] = {0};
+
+  *out_retry = true;
+  memset(displacements, 0, buckets_count * 2 * sizeof(uint32_t));
+
+  // [1] group the keys by bucket (counting sort)
+  for (size_t iii = 0; iii < len; ++iii) {
+    hashes[iii] = c_internal_frozen_map_hash(self, keys[iii], self->seed);
+    starts[c_internal_frozen_map_bucket(self, hashes[iii]) + 1]++;
+  }
+  for (size_t iii = 0; iii < buckets_count; ++iii) {
+    if (starts[iii + 1] > CMAP_FROZEN_MAX_BUCKET) goto cleanup;
+    size_offsets[starts[iii + 1]]++;
+    starts[iii + 1] += starts[iii];
+    cursor[iii] = starts[iii];
+  }
+  for (uint32_t iii = 0; iii < len; ++iii) {
+    order[cursor[c_internal_frozen_map_bucket(self, hashes[iii])]++] = iii;
+  }
+
+  // [2] sort the buckets by size (counting sort, the biggest first)
+  for (size_t size = CMAP_FROZEN_MAX_BUCKET + 1, offset = 0; size-- > 0;) {
+    size_t count       = size_offsets[size];
+    size_offsets[size] = offset;
+    offset += count;
+  }
+  for (uint32_t iii = 0; iii < buckets_count; ++iii) {
+    sorted[size_offsets[starts[iii + 1] - starts[iii]]++] = iii;
+  }
+
+  // [3] the displacements of each bucket, the slot of a key is
+  //     (f1 + d1 * f2 + d2) % len = (base + d2) % len, so d2 is tried by
+  //     adding 1 to the slots of the previous try
+  size_t   free_word = 0; ///< the words before it have no free slot
+  uint64_t bases[CMAP_FROZEN_MAX_BUCKET];
+  uint64_t slots[CMAP_FROZEN_MAX_BUCKET];
+  for (size_t iii = 0; iii < buckets_count; ++iii) {
+    uint32_t bucket = sorted[iii];
+    uint32_t first  = starts[bucket];
+    uint32_t size   = starts[bucket + 1] - first;
+    if (!size) break;
+
+    // keys of the same hash can't be separated by any displacement
+    for (uint32_t jjj = 1; jjj < size; ++jjj) {
+      for (uint32_t kkk = 0; kkk < jjj; ++kkk) {
+        uint32_t key1 = order[first + jjj];
+        uint32_t key2 = order[first + kkk];
+        if (hashes[key1] != hashes[key2]) continue;
+        if (c_internal_frozen_map_eq(self, keys[key1], keys[key2])) {
+          c_error_set(C_ERROR_invalid_data);
+          *out_retry = false;
+        }
+        goto cleanup;
+      }
+    }
+
+    // the last buckets have one key, which takes the first free slot
+    if (size == 1) {
+      while (taken[free_word] == UINT64_MAX) free_word++;
+      size_t slot = free_word * 64;
+      while (taken[free_word] & ((uint64_t)1 << (slot % 64))) slot++;
+
+      uint32_t key                    = order[first];
+      displacements[(2 * bucket) + 1] = (uint32_t)((slot + len - c_internal_frozen_map_slot(self, hashes[key], 0, 0)) % len);
+      positions[key]                  = (uint32_t)slot;
+      taken[slot / 64] |= (uint64_t)1 << (slot % 64);
+      continue;
+    }
+
+    bool is_found = false;
+    for (uint32_t d1 = 0; (d1 < CMAP_FROZEN_MAX_D1) && !is_found; ++d1) {
+      for (uint32_t jjj = 0; jjj < size; ++jjj) {
+        bases[jjj] = c_internal_frozen_map_slot(self, hashes[order[first + jjj]], d1, 0);
+      }
+
+      for (uint32_t d2 = 0; (d2 < len) && !is_found; ++d2) {
+        uint32_t jjj = 0;
+        for (; jjj < size; ++jjj) {
+          uint64_t slot = bases[jjj] + d2;
+          if (slot >= len) slot -= len;
+          if (taken[slot / 64] & ((uint64_t)1 << (slot % 64))) break;
+
+          uint32_t kkk = 0;
+          while ((kkk < jjj) && (slots[kkk] != slot)) kkk++;
+          if (kkk < jjj) break;
+          slots[jjj] = slot;
+        }
+        if (jjj == size) {
+          is_found                        = true;
+          displacements[(2 * bucket)]     = d1;
+          displacements[(2 * bucket) + 1] = d2;
+        }
+      }
+    }
+    if (!is_found) goto cleanup;
+
+    for (uint32_t jjj = 0; jjj < size; ++jjj) {
+      positions[order[first + jjj]] = (uint32_t)slots[jjj];
+      taken[slots[jjj] / 64] |= (uint64_t)1 << (slots[jjj] % 64);
+    }
+  }
+  is_placed = true;
+
+cleanup:
+  c_allocator_free_sized(self->allocator, scratch, scratch_size, sizeof(uint64_t));
+  return is_placed;
+}
+
+/// @brief the hash of the map, mixed with the seed (so a new seed changes it,
+///        even if hash_fn ignores it)
+uint64_t c_internal_frozen_map_hash(CFrozenMap const* self, void const* key, uint64_t seed)
+{
+  uint64_t hash;
+  switch (self->key_kind) {
+  case C_HASHMAP_KEY_KIND_4:
+    hash = c_internal_hashmap_hash_bytes(key, 4, seed);
+    break;
+  case C_HASHMAP_KEY_KIND_8:
+    hash = c_internal_hashmap_hash_bytes(key, 8, seed);
+    break;
+  case C_HASHMAP_KEY_KIND_16:
+    hash = c_internal_hashmap_hash_bytes(key, 16, seed);
+    break;
+  default:
+    hash = self->hash_fn(key, self->key_size, seed);
+    break;
+  }
+
+  return c_internal_hashmap_mix(hash ^ seed, CMAP_FROZEN_MULTIPLIER);
+}
+
+/// @brief the high bits of the hash select the bucket
+size_t c_internal_frozen_map_bucket(CFrozenMap const* self, uint64_t hash)
+{
+  return (size_t)(((hash >> 32) * self->buckets_count) >> 32);
+}
+
+/// @brief the slot of a key of hash in a bucket with displacements (d1, d2)
+size_t c_internal_frozen_map_slot(CFrozenMap const* self, uint64_t hash, uint32_t d1, uint32_t d2)
+{
+  uint64_t f1 = (uint32_t)hash;
+  uint64_t f2 = (uint32_t)c_internal_hashmap_mix(hash, CMAP_FROZEN_MULTIPLIER);
+  return (size_t)((f1 + (d1 * f2) + d2) % self->len);
+}
+
+bool c_internal_frozen_map_eq(CFrozenMap const* self, void const* key1, void const* key2)
+{
+  switch (self->key_kind) {
+  case C_HASHMAP_KEY_KIND_4:
+    return memcmp(key1, key2, 4) == 0;
+  case C_HASHMAP_KEY_KIND_8:
+    return memcmp(key1, key2, 8) == 0;
+  case C_HASHMAP_KEY_KIND_16:
+    return memcmp(key1, key2, 16) == 0;
+  default:
+    return self->eq_fn ? self->eq_fn(key1, key2, self->key_size) : (memcmp(key1, key2, self->key_size) == 0);
+  }
+}
+
+/// @brief the hash of the string is computed once, and stored in the key
+uint64_t c_internal_str_map_key_hash(void const* key, size_t key_size, uint64_t seed)
+{
+  (void)key_size;
+  (void)seed;
+  return ((CStrHashMapKey const*)key)->hash;
+}
+
+bool c_internal_str_map_key_eq(void const* key1, void const* key2, size_t key_size)
+{
+  (void)key_size;
+  CStrHashMapKey const* str_key1 = key1;
+  CStrHashMapKey const* str_key2 = key2;
+  if ((str_key1->hash != str_key2->hash) || (str_key1->len != str_key2->len)) return false;
+  return memcmp(c_internal_str_map_key_data(str_key1), c_internal_str_map_key_data(str_key2), str_key1->len) == 0;
+}
+
+/// @brief make a key to look for str (a long key points to str.data)
+bool c_internal_str_map_key(CStrHashMap const* self, CStr str, CStrHashMapKey* out_key)
+{
+  if (!str.data && str.len) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+  if (str.len > UINT32_MAX) {
+    c_error_set(C_ERROR_invalid_len);
+    return false;
+  }
+
+  out_key->hash = c_internal_hashmap_hash_bytes(str.data, str.len, self->map->seed);
+  out_key->len  = (uint32_t)str.len;
+  memset(out_key->data, 0, sizeof(out_key->data));
+  if (str.len > CMAP_STR_INLINE_CAPACITY) {
+    memcpy(out_key->data, &str.data, sizeof(str.data));
+  } else if (str.len) {
+    memcpy(out_key->data, str.data, str.len);
+  }
+
+  return true;
+}
+
+char const* c_internal_str_map_key_data(CStrHashMapKey const* key)
+{
+  if (key->len <= CMAP_STR_INLINE_CAPACITY) return key->data;
+
+  char const* data;
+  memcpy(&data, key->data, sizeof(data));
+  return data;
+}
+
+/// @brief wrap map (it is destroyed on failure)
+CHashSet* c_internal_set_create(CHashMap* map, CAllocator* allocator)
+{
+  CHashSet* set = c_allocator_alloc_sized(allocator, c_allocator_alignas(CHashSet, 1), true);
+  if (!set) {
+    c_hashmap_destroy(map, NULL, NULL);
+    return NULL;
+  }
+  set->map = map;
+
+  return set;
+}
+
+/// @brief the keys of one set could be looked for in the other one
+bool c_internal_set_check_pair(CHashSet const* set1, CHashSet const* set2)
+{
+  if (!set1 || !set2) {
+    c_error_set(C_ERROR_null_ptr);
+    return false;
+  }
+  if ((set1->map->key_size != set2->map->key_size) || (set1->map->hash_fn != set2->map->hash_fn) || (set1->map->eq_fn != set2->map->eq_fn)) {
+    c_error_set(C_ERROR_invalid_data);
+    return false;
+  }
+
+  return true;
+}
+
+/// @brief an empty set with the allocator and the options of set (and a new seed)
+CHashSet* c_internal_set_create_like(CHashSet const* set, size_t capacity)
+{
+  CHashMapOptions options = {.hash_fn = set->map->hash_fn, .eq_fn = set->map->eq_fn, .incremental_resize = set->map->incremental_resize};
+  return c_hashset_create_ex(set->map->key_size, capacity ? capacity : CMAP_DEFAULT_CAPACITY, &options, set->map->allocator);
+}
+
+/// @brief the shards use the same hash fn (and seed), so the hash is computed
+///        once, and it is reused by the shard
+CConcurrentHashMapShard* c_internal_concurrent_map_shard(CConcurrentHashMap* self, void const* key, uint64_t* out_hash)
+{
+  *out_hash = c_internal_map_hash_with_seed(self->shards[0].map, key, self->seed);
+  return &self->shards[(size_t)(*out_hash >> self->shard_shift) & (self->shards_count - 1)];
+}
+
+/// @brief the hash of key in the map of shard (under its lock): the hash of
+///        the shard selection, unless the shard has reseeded itself
+uint64_t c_internal_concurrent_map_shard_hash(CConcurrentHashMap const* self, CConcurrentHashMapShard const* shard, void const* key, uint64_t hash)
+{
+  return (shard->map->seed == self->seed) ? hash : c_internal_map_hash(shard->map, key);
+}
+
+/// @brief readers only increment the counter, they back off while a writer
+///        holds (or waits for) the lock
+void c_internal_concurrent_map_read_lock(CConcurrentHashMapShard* shard)
+{
+  for (;;) {
+    uint32_t state = atomic_fetch_add_explicit(&shard->lock, 1, memory_order_acquire);
+    if (!(state & CMAP_CONCURRENT_WRITER)) return;
+
+    atomic_fetch_sub_explicit(&shard->lock, 1, memory_order_relaxed);
+    while (atomic_load_explicit(&shard->lock, memory_order_relaxed) & CMAP_CONCURRENT_WRITER) thrd_yield();
+  }
+}
+
+void c_internal_concurrent_map_read_unlock(CConcurrentHashMapShard* shard)
+{
+  atomic_fetch_sub_explicit(&shard->lock, 1, memory_order_release);
+}
+
+/// @brief take the writer bit (new readers back off), then wait for the
+///        current readers to leave
+void c_internal_concurrent_map_write_lock(CConcurrentHashMapShard* shard)
+{
+  while (atomic_fetch_or_explicit(&shard->lock, CMAP_CONCURRENT_WRITER, memory_order_acquire) & CMAP_CONCURRENT_WRITER) {
+    while (atomic_load_explicit(&shard->lock, memory_order_relaxed) & CMAP_CONCURRENT_WRITER) thrd_yield();
+  }
+  while (atomic_load_explicit(&shard->lock, memory_order_acquire) & ~CMAP_CONCURRENT_WRITER) thrd_yield();
+}
+
+void c_internal_concurrent_map_write_unlock(CConcurrentHashMapShard* shard)
+{
+  atomic_fetch_and_explicit(&shard->lock, ~CMAP_CONCURRENT_WRITER, memory_order_release);
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
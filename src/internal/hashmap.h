@@ -0,0 +1,295 @@
+#ifndef ANYLIBS_INTERNAL_HASHMAP_H
+#define ANYLIBS_INTERNAL_HASHMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "anylibs/allocator.h"
+#include "anylibs/hashmap.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define C_HASHMAP_GROUP_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define C_HASHMAP_GROUP_NEON 1
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(__SIZEOF_INT128__)
+#include <intrin.h>
+#pragma intrinsic(_umul128)
+#endif
+
+/// the control bytes: one for each slot, a full slot holds 7 bits of its hash
+/// (H2), the rest of the hash (H1) selects the first group to probe
+enum {
+  C_HASHMAP_CTRL_EMPTY   = 0x80,
+  C_HASHMAP_CTRL_DELETED = 0xFE,
+  C_HASHMAP_GROUP_WIDTH  = 16, ///< control bytes scanned at once
+};
+
+/// the keys that use the default hash and equality, and have one of these
+/// sizes, are hashed and compared with the key size as a constant
+typedef enum CHashMapKeyKind {
+  C_HASHMAP_KEY_KIND_generic,
+  C_HASHMAP_KEY_KIND_4,
+  C_HASHMAP_KEY_KIND_8,
+  C_HASHMAP_KEY_KIND_16,
+} CHashMapKeyKind;
+
+/// @brief a bit mask of the slots of a group that matched, iterate it with
+///        @ref c_internal_hashmap_mask_next
+#ifdef C_HASHMAP_GROUP_NEON
+typedef uint64_t CHashMapGroupMask; ///< 4 bits for each slot
+#define C_HASHMAP_GROUP_MASK_SHIFT 2
+#else
+typedef uint32_t CHashMapGroupMask; ///< 1 bit for each slot
+#define C_HASHMAP_GROUP_MASK_SHIFT 0
+#endif
+
+typedef struct CHashMapTable {
+  uint8_t* ctrl; ///< capacity control bytes, the keys and the values follow them in the same block
+  char*    keys; ///< interleaved: { [key, value], ... }, split: { key, ... }
+  char*    values; ///< interleaved: keys + value_offset, split: { value, ... }
+  size_t   capacity; ///< slots count (a power of 2, and a multiple of @ref C_HASHMAP_GROUP_WIDTH), 0 if there is no table
+} CHashMapTable;
+
+typedef struct CHashMap {
+  CHashMapTable table;
+  CHashMapTable old_table; ///< incremental resize: the table that is being migrated into table
+  size_t        migrate_index; ///< incremental resize: the slots of old_table before this are migrated
+  char*         removed_slot; ///< @ref c_hashmap_remove copies the removed slot here
+  size_t        len; ///< of both tables
+  size_t        growth_left; ///< EMPTY slots of table that could be used before the map has to grow (this keeps the load factor <= 7/8)
+  size_t        key_size;
+  size_t        value_size;
+  size_t        value_offset; ///< the offset of the value inside an interleaved slot (and removed_slot)
+  size_t        slot_size; ///< of an interleaved slot (and removed_slot)
+  size_t        slot_alignment;
+  size_t        key_stride; ///< between two keys of a table (slot_size if interleaved)
+  size_t        value_stride; ///< between two values of a table (slot_size if interleaved)
+  CAllocator*   allocator;
+  void*         mapping; ///< the file mapped by @ref c_hashmap_open_mmap (the map is read only), NULL otherwise
+  size_t        mapping_size;
+
+  CHashMapHashFn  hash_fn;
+  CHashMapEqFn    eq_fn; ///< NULL: memcmp
+  uint64_t        seed; ///< passed to hash_fn, random unless it is given by the options, it changes when the map reseeds
+  CHashMapKeyKind key_kind;
+  bool            incremental_resize;
+  bool            split_values;
+  bool            can_reseed; ///< false if the hashes don't depend on the seed (CStrHashMap stores them in its keys)
+  bool            reseeded; ///< at the current capacity, the map reseeds once at most
+} CHashMap;
+
+/// @brief multiply to 128 bits, and fold the halves
+static inline uint64_t c_internal_hashmap_mix(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+  __uint128_t result = (__uint128_t)a * b;
+  return (uint64_t)result ^ (uint64_t)(result >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  uint64_t high;
+  uint64_t low = _umul128(a, b, &high);
+  return low ^ high;
+#else
+  uint64_t a_high = a >> 32, a_low = (uint32_t)a;
+  uint64_t b_high = b >> 32, b_low = (uint32_t)b;
+  uint64_t middle1 = a_high * b_low, middle2 = a_low * b_high;
+  uint64_t low     = a_low * b_low;
+  uint64_t sum     = low + (middle1 << 32);
+  uint64_t carry   = sum < low;
+  low              = sum + (middle2 << 32);
+  carry += low < sum;
+  return low ^ ((a_high * b_high) + (middle1 >> 32) + (middle2 >> 32) + carry);
+#endif
+}
+
+/// @brief c_internal_hashmap_mix that keeps b (the factor with the seed), so
+///        if a is 0 (data equal to a secret) the seed isn't erased, otherwise
+///        such keys would collide whatever the seed is
+static inline uint64_t c_internal_hashmap_mix_keep(uint64_t a, uint64_t b)
+{
+  return c_internal_hashmap_mix(a, b) ^ b;
+}
+
+static inline uint64_t c_internal_hashmap_read8(uint8_t const* data)
+{
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static inline uint64_t c_internal_hashmap_read4(uint8_t const* data)
+{
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+/// @brief the default hash (wyhash like): the data is read 8 bytes at a time
+///        (3 lanes for long data), and mixed by 128 bits multiplications,
+///        when data_len is a constant, the compiler keeps only one branch
+static inline uint64_t c_internal_hashmap_hash_bytes(void const* data, size_t data_len, uint64_t seed)
+{
+  static uint64_t const secret[] = {0xA0761D6478BD642FULL, 0xE7037ED1A0B428DBULL, 0x8EBC6AF09C88C6E3ULL, 0x589965CC75374CC3ULL};
+
+  uint8_t const* bytes = data;
+  uint64_t       a, b;
+
+  seed ^= secret[0];
+  if (data_len <= 16) {
+    if (data_len >= 4) {
+      // two overlapping reads from each end cover 4 to 16 bytes
+      size_t step = (data_len >> 3) << 2;
+      a           = (c_internal_hashmap_read4(bytes) << 32) | c_internal_hashmap_read4(bytes + step);
+      b           = (c_internal_hashmap_read4(bytes + data_len - 4) << 32) | c_internal_hashmap_read4(bytes + data_len - 4 - step);
+    } else if (data_len > 0) {
+      a = ((uint64_t)bytes[0] << 16) | ((uint64_t)bytes[data_len >> 1] << 8) | bytes[data_len - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t remaining = data_len;
+    if (remaining > 48) {
+      uint64_t seed1 = seed, seed2 = seed;
+      do {
+        seed  = c_internal_hashmap_mix_keep(c_internal_hashmap_read8(bytes) ^ secret[1], c_internal_hashmap_read8(bytes + 8) ^ seed);
+        seed1 = c_internal_hashmap_mix_keep(c_internal_hashmap_read8(bytes + 16) ^ secret[2], c_internal_hashmap_read8(bytes + 24) ^ seed1);
+        seed2 = c_internal_hashmap_mix_keep(c_internal_hashmap_read8(bytes + 32) ^ secret[3], c_internal_hashmap_read8(bytes + 40) ^ seed2);
+        bytes += 48;
+        remaining -= 48;
+      } while (remaining > 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (remaining > 16) {
+      seed = c_internal_hashmap_mix_keep(c_internal_hashmap_read8(bytes) ^ secret[1], c_internal_hashmap_read8(bytes + 8) ^ seed);
+      bytes += 16;
+      remaining -= 16;
+    }
+    // the last 16 bytes (they could overlap the already mixed ones)
+    a = c_internal_hashmap_read8(bytes + remaining - 16);
+    b = c_internal_hashmap_read8(bytes + remaining - 8);
+  }
+
+  return c_internal_hashmap_mix(secret[1] ^ data_len, c_internal_hashmap_mix_keep(a ^ secret[1], b ^ seed));
+}
+
+/// @brief a hint to load the cache line of address (for reading)
+static inline void c_internal_hashmap_prefetch(void const* address)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address, 0, 3);
+#elif defined(C_HASHMAP_GROUP_SSE2)
+  _mm_prefetch((char const*)address, _MM_HINT_T0);
+#else
+  (void)address;
+#endif
+}
+
+/// @brief the first group to probe
+static inline size_t c_internal_hashmap_h1(uint64_t hash)
+{
+  return (size_t)(hash >> 7);
+}
+
+/// @brief the control byte of a full slot
+static inline uint8_t c_internal_hashmap_h2(uint64_t hash)
+{
+  return (uint8_t)(hash & 0x7F);
+}
+
+static inline bool c_internal_hashmap_is_full(uint8_t ctrl)
+{
+  return (ctrl & 0x80) == 0;
+}
+
+/// @brief get the index of the lowest matched slot, and remove it from mask
+static inline size_t c_internal_hashmap_mask_next(CHashMapGroupMask* mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+#ifdef C_HASHMAP_GROUP_NEON
+  _BitScanForward64(&index, *mask);
+#else
+  _BitScanForward(&index, *mask);
+#endif
+#else
+  size_t index = (sizeof(*mask) == 8) ? (size_t)__builtin_ctzll(*mask) : (size_t)__builtin_ctz((unsigned)*mask);
+#endif
+  *mask &= *mask - 1;
+  return (size_t)index >> C_HASHMAP_GROUP_MASK_SHIFT;
+}
+
+#if !defined(C_HASHMAP_GROUP_SSE2) && !defined(C_HASHMAP_GROUP_NEON)
+/// @brief scalar fallback, load 8 control bytes (first byte in the lowest bits)
+static inline uint64_t c_internal_hashmap_load8(uint8_t const* ctrl)
+{
+  uint64_t word = 0;
+  for (size_t iii = 0; iii < 8; ++iii) word |= (uint64_t)ctrl[iii] << (iii * 8);
+  return word;
+}
+
+/// @brief gather the high bit of each byte into 8 bits
+static inline CHashMapGroupMask c_internal_hashmap_pack8(uint64_t high_bits)
+{
+  return (CHashMapGroupMask)(((high_bits >> 7) * 0x0102040810204080ULL) >> 56);
+}
+#endif
+
+/// @brief match the slots of the group with control byte h2
+static inline CHashMapGroupMask c_internal_hashmap_group_match(uint8_t const* ctrl, uint8_t h2)
+{
+#if defined(C_HASHMAP_GROUP_SSE2)
+  __m128i group = _mm_load_si128((__m128i const*)ctrl);
+  return (CHashMapGroupMask)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+#elif defined(C_HASHMAP_GROUP_NEON)
+  uint8x16_t eq = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(h2));
+  return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0) & 0x8888888888888888ULL;
+#else
+  CHashMapGroupMask mask = 0;
+  for (size_t half = 0; half < 2; ++half) {
+    // the matched bytes are zero now, this detects them without false positives
+    uint64_t word = c_internal_hashmap_load8(ctrl + (half * 8)) ^ (0x0101010101010101ULL * h2);
+    uint64_t zero = ~(((word & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | word | 0x7F7F7F7F7F7F7F7FULL);
+    mask |= c_internal_hashmap_pack8(zero) << (half * 8);
+  }
+  return mask;
+#endif
+}
+
+static inline CHashMapGroupMask c_internal_hashmap_group_match_empty(uint8_t const* ctrl)
+{
+#if defined(C_HASHMAP_GROUP_SSE2) || defined(C_HASHMAP_GROUP_NEON)
+  return c_internal_hashmap_group_match(ctrl, C_HASHMAP_CTRL_EMPTY);
+#else
+  // EMPTY is the only one with the high bit set and the bit 1 cleared
+  CHashMapGroupMask mask = 0;
+  for (size_t half = 0; half < 2; ++half) {
+    uint64_t word = c_internal_hashmap_load8(ctrl + (half * 8));
+    mask |= c_internal_hashmap_pack8(word & ~(word << 6) & 0x8080808080808080ULL) << (half * 8);
+  }
+  return mask;
+#endif
+}
+
+static inline CHashMapGroupMask c_internal_hashmap_group_match_empty_or_deleted(uint8_t const* ctrl)
+{
+#if defined(C_HASHMAP_GROUP_SSE2)
+  return (CHashMapGroupMask)_mm_movemask_epi8(_mm_load_si128((__m128i const*)ctrl));
+#elif defined(C_HASHMAP_GROUP_NEON)
+  uint8x16_t high = vcltzq_s8(vreinterpretq_s8_u8(vld1q_u8(ctrl)));
+  return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(high), 4)), 0) & 0x8888888888888888ULL;
+#else
+  CHashMapGroupMask mask = 0;
+  for (size_t half = 0; half < 2; ++half) {
+    mask |= c_internal_hashmap_pack8(c_internal_hashmap_load8(ctrl + (half * 8)) & 0x8080808080808080ULL) << (half * 8);
+  }
+  return mask;
+#endif
+}
+
+#endif // ANYLIBS_INTERNAL_HASHMAP_H
@@ -8,6 +8,7 @@
 typedef struct CVecImpl {
   void*       data; ///< heap allocated data
   size_t      len; ///< current length in bytes
+  size_t      capacity; ///< allocated capacity in bytes (@ref CVecImpl::data is a sized allocation, check @ref c_allocator_alloc_sized)
   CAllocator* allocator; ///< memory allocator/deallocator
   size_t      raw_capacity; ///< this is only useful when used with @ref c_vec_create_from_raw
   size_t      element_size; ///< size of the element unit
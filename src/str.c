@@ -24,7 +24,7 @@
 #define TO_BYTES(str, units) ((units) * TO_IMPL(str)->element_size)
 #define TO_UNITS(str, bytes) ((bytes) / TO_IMPL(str)->element_size)
 #define GET_CAPACITY(str) (TO_IMPL(str)->raw_capacity > 0 ? TO_IMPL(str)->raw_capacity \
-                                                          : c_allocator_mem_size(TO_IMPL(str)->data))
+                                                          : TO_IMPL(str)->capacity)
 
 /// @brief ASCII whitespaces
 static unsigned char const c_ascii_whitespaces[] = {
@@ -106,12 +106,13 @@ CStrBuf* c_str_create_from_raw(CStr cstr, bool should_copy,
   if (!allocator) allocator = c_allocator_default();
 
   if (!should_copy) {
-    CVecImpl* impl = c_allocator_alloc(allocator, c_allocator_alignas(CVecImpl, 1), false);
+    CVecImpl* impl = c_allocator_alloc_sized(allocator, c_allocator_alignas(CVecImpl, 1), false);
     if (!impl) return NULL;
 
     impl->data         = cstr.data;
     impl->raw_capacity = cstr.len;
     impl->len          = cstr.len;
+    impl->capacity     = 0;
     impl->allocator    = allocator;
     impl->element_size = sizeof(char);
 
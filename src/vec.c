@@ -4,6 +4,8 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -22,9 +24,73 @@
 #define TO_UNITS(vec, bytes) ((bytes) / TO_IMPL(vec)->element_size)
 #define GET_CAPACITY(vec)                                      \
   (TO_IMPL(vec)->raw_capacity > 0 ? TO_IMPL(vec)->raw_capacity \
-                                  : c_allocator_mem_size(TO_IMPL(vec)->data))
+                                  : TO_IMPL(vec)->capacity)
 #define c_vec_should_shrink(vec) (TO_IMPL(vec)->len <= (GET_CAPACITY(vec) / 4))
 
+#define CVEC_SORT_INSERTION_THRESHOLD 24U ///< smaller ranges are insertion sorted
+#define CVEC_SORT_NINTHER_THRESHOLD 128U ///< bigger ranges take the median of 3 medians of 3 as the pivot
+#define CVEC_SORT_PARTIAL_INSERTION_LIMIT 8U ///< elements moved by an insertion sort of an already partitioned range before it gives up
+#define CVEC_SORT_BLOCK_SIZE 64U ///< elements classified at once by the branchless partition
+#define CVEC_SORT_MAX_DEPTH 64U ///< the pending ranges (the bigger side of each partition waits, so there are at most log2(len))
+#define CVEC_SORT_BUFFER_SIZE 256U ///< bigger elements get their temporaries from the allocator of the vector
+#define CVEC_RADIX_SORT_MAX_KEY_WIDTH 8U
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CVEC_SORT_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define CVEC_SORT_INLINE static __forceinline
+#else
+#define CVEC_SORT_INLINE static inline
+#endif
+
+typedef bool (*CVecSortLessFn)(void const* a, void const* b, CVecCompareFn cmp);
+
+/// @brief the parameters of a sort, the sort functions are inlined in each
+///        caller, so a constant size and less function are folded into them
+///        (the swaps of 4/8/16 bytes become register moves, and the typed
+///        comparisons become single instructions)
+typedef struct CVecSorter {
+  size_t         size; ///< element size
+  CVecSortLessFn less;
+  CVecCompareFn  cmp; ///< passed to less
+  bool           branchless; ///< partition blocks of elements without branches (for cheap inline comparisons)
+  char*          tmp; ///< one element
+  char*          pivot; ///< one element
+} CVecSorter;
+
+/// @brief a range that waits to be sorted
+typedef struct CVecSortRange {
+  char*  begin;
+  char*  end;
+  size_t bad_allowed; ///< unbalanced partitions left before heap sort is used
+  bool   leftmost; ///< false: the element before begin is <= all the elements of the range
+} CVecSortRange;
+
+CVEC_SORT_INLINE void     c_internal_vec_sort(CVecSorter s, char* data, size_t len);
+CVEC_SORT_INLINE bool     c_internal_vec_sort_typed(CVec* self, size_t size, CVecSortLessFn less);
+CVEC_SORT_INLINE bool     c_internal_vec_sort_sized(CVec* self, size_t size, CVecCompareFn cmp, char* buffer);
+CVEC_SORT_INLINE bool     c_internal_vec_sort_less(CVecSorter s, char const* a, char const* b);
+CVEC_SORT_INLINE void     c_internal_vec_sort_swap(CVecSorter s, char* a, char* b);
+CVEC_SORT_INLINE void     c_internal_vec_sort_sort3(CVecSorter s, char* a, char* b, char* c);
+CVEC_SORT_INLINE void     c_internal_vec_sort_insertion(CVecSorter s, char* begin, char* end, bool guarded);
+CVEC_SORT_INLINE bool     c_internal_vec_sort_partial_insertion(CVecSorter s, char* begin, char* end);
+CVEC_SORT_INLINE char*    c_internal_vec_sort_partition_right(CVecSorter s, char* begin, char* end, bool* out_already_partitioned);
+CVEC_SORT_INLINE char*    c_internal_vec_sort_partition_right_branchless(CVecSorter s, char* begin, char* end, bool* out_already_partitioned);
+CVEC_SORT_INLINE char*    c_internal_vec_sort_partition_left(CVecSorter s, char* begin, char* end);
+CVEC_SORT_INLINE void     c_internal_vec_sort_heap(CVecSorter s, char* begin, char* end);
+CVEC_SORT_INLINE void     c_internal_vec_sort_sift_down(CVecSorter s, char* begin, size_t root, size_t len);
+CVEC_SORT_INLINE void     c_internal_vec_sort_shuffle(CVecSorter s, char* begin, char* end, size_t len);
+CVEC_SORT_INLINE void     c_internal_vec_radix_sort(char* data, char* scratch, size_t len, size_t size, size_t key_offset, size_t key_width, CVecRadixSortFlags flags);
+CVEC_SORT_INLINE void     c_internal_vec_radix_sort_sized(char* data, char* scratch, size_t len, size_t size, size_t key_offset, size_t key_width, CVecRadixSortFlags flags);
+CVEC_SORT_INLINE uint64_t c_internal_vec_radix_key(char const* element, size_t key_offset, size_t key_width, uint64_t float_mask, uint64_t flip_mask);
+static bool               c_internal_vec_less_cmp(void const* a, void const* b, CVecCompareFn cmp);
+static bool               c_internal_vec_less_u32(void const* a, void const* b, CVecCompareFn cmp);
+static bool               c_internal_vec_less_u64(void const* a, void const* b, CVecCompareFn cmp);
+static bool               c_internal_vec_less_i32(void const* a, void const* b, CVecCompareFn cmp);
+static bool               c_internal_vec_less_i64(void const* a, void const* b, CVecCompareFn cmp);
+static bool               c_internal_vec_less_f32(void const* a, void const* b, CVecCompareFn cmp);
+static bool               c_internal_vec_less_f64(void const* a, void const* b, CVecCompareFn cmp);
+
 CVec* c_vec_create(size_t element_size, CAllocator* allocator)
 {
   return c_vec_create_with_capacity(element_size, 1U, false, allocator);
@@ -37,21 +103,22 @@ CVec* c_vec_create_with_capacity(size_t element_size, size_t capacity,
 
   if (!allocator) allocator = c_allocator_default();
 
-  CVecImpl* impl     = c_allocator_alloc(allocator, c_allocator_alignas(CVecImpl, 1), set_mem_to_zero);
-  void*     data_mem = c_allocator_alloc(allocator, capacity * element_size, element_size, set_mem_to_zero);
+  CVecImpl* impl     = c_allocator_alloc_sized(allocator, c_allocator_alignas(CVecImpl, 1), set_mem_to_zero);
+  void*     data_mem = c_allocator_alloc_sized(allocator, capacity * element_size, element_size, set_mem_to_zero);
   if (!impl || !data_mem) goto ERROR_ALLOC;
 
   impl->data         = data_mem;
   impl->element_size = element_size;
   impl->len          = 0;
+  impl->capacity     = capacity * element_size;
   impl->allocator    = allocator;
   impl->raw_capacity = 0;
 
   return FROM_IMPL(impl);
 
 ERROR_ALLOC:
-  c_allocator_free(allocator, impl);
-  c_allocator_free(allocator, data_mem);
+  c_allocator_free_sized(allocator, impl, c_allocator_alignas(CVecImpl, 1));
+  c_allocator_free_sized(allocator, data_mem, capacity * element_size, element_size);
   return NULL;
 }
 
@@ -64,12 +131,13 @@ CVec* c_vec_create_from_raw(void* data, size_t data_len, size_t element_size, bo
 
   CVecImpl* impl;
   if (!should_copy) {
-    impl = c_allocator_alloc(allocator, c_allocator_alignas(CVecImpl, 1), false);
+    impl = c_allocator_alloc_sized(allocator, c_allocator_alignas(CVecImpl, 1), false);
     if (!impl) goto ERROR_ALLOC;
 
     impl->data         = data;
     impl->element_size = element_size;
     impl->len          = data_len;
+    impl->capacity     = 0;
     impl->allocator    = allocator;
     impl->raw_capacity = data_len;
   } else {
@@ -156,10 +224,15 @@ bool c_vec_set_capacity(CVec* self, size_t new_capacity)
                        ? TO_BYTES(self, new_capacity)
                        : TO_IMPL(self)->len;
 
-  self->data = c_allocator_resize(TO_IMPL(self)->allocator, self->data, TO_BYTES(self, new_capacity));
+  // keep a valid allocation, even for empty vec
+  if (new_capacity == 0) new_capacity = 1;
 
-  if (self->data) {
-    TO_IMPL(self)->len = new_len;
+  void* new_data = c_allocator_resize_sized(TO_IMPL(self)->allocator, self->data, TO_IMPL(self)->capacity, TO_BYTES(self, new_capacity), TO_IMPL(self)->element_size);
+
+  if (new_data) {
+    self->data              = new_data;
+    TO_IMPL(self)->len      = new_len;
+    TO_IMPL(self)->capacity = TO_BYTES(self, new_capacity);
     return true;
   } else {
     return false;
@@ -277,7 +350,75 @@ bool c_vec_sort(CVec* self, CVecCompareFn cmp)
     return false;
   }
 
-  qsort(self->data, TO_UNITS(self, TO_IMPL(self)->len), TO_IMPL(self)->element_size, cmp);
+  // the swaps (and the copies) of common sizes are specialized
+  _Alignas(max_align_t) char buffer[2 * CVEC_SORT_BUFFER_SIZE];
+  switch (TO_IMPL(self)->element_size) {
+    case 4: return c_internal_vec_sort_sized(self, 4, cmp, buffer);
+    case 8: return c_internal_vec_sort_sized(self, 8, cmp, buffer);
+    case 16: return c_internal_vec_sort_sized(self, 16, cmp, buffer);
+    default: return c_internal_vec_sort_sized(self, TO_IMPL(self)->element_size, cmp, buffer);
+  }
+}
+
+bool c_vec_sort_u32(CVec* self)
+{
+  return c_internal_vec_sort_typed(self, sizeof(uint32_t), c_internal_vec_less_u32);
+}
+
+bool c_vec_sort_u64(CVec* self)
+{
+  return c_internal_vec_sort_typed(self, sizeof(uint64_t), c_internal_vec_less_u64);
+}
+
+bool c_vec_sort_i32(CVec* self)
+{
+  return c_internal_vec_sort_typed(self, sizeof(int32_t), c_internal_vec_less_i32);
+}
+
+bool c_vec_sort_i64(CVec* self)
+{
+  return c_internal_vec_sort_typed(self, sizeof(int64_t), c_internal_vec_less_i64);
+}
+
+bool c_vec_sort_f32(CVec* self)
+{
+  return c_internal_vec_sort_typed(self, sizeof(float), c_internal_vec_less_f32);
+}
+
+bool c_vec_sort_f64(CVec* self)
+{
+  return c_internal_vec_sort_typed(self, sizeof(double), c_internal_vec_less_f64);
+}
+
+bool c_vec_radix_sort(CVec* self, size_t key_offset, size_t key_width, CVecRadixSortFlags flags)
+{
+  assert(self && self->data);
+
+  size_t const size = TO_IMPL(self)->element_size;
+  if ((key_width != 1 && key_width != 2 && key_width != 4 && key_width != 8) || ((flags & C_VEC_RADIX_SORT_FLAG_float) && key_width != 4 && key_width != 8)) {
+    c_error_set(C_ERROR_invalid_size);
+    return false;
+  }
+  if ((key_offset > size) || (key_width > size - key_offset)) {
+    c_error_set(C_ERROR_invalid_range);
+    return false;
+  }
+
+  size_t const len = TO_UNITS(self, TO_IMPL(self)->len);
+  if (len < 2) return true;
+
+  char* scratch = c_allocator_alloc_sized(TO_IMPL(self)->allocator, TO_IMPL(self)->len, size, false);
+  if (!scratch) return false;
+
+  // the copies of common sizes are specialized
+  switch (size) {
+    case 4: c_internal_vec_radix_sort_sized(self->data, scratch, len, 4, key_offset, key_width, flags); break;
+    case 8: c_internal_vec_radix_sort_sized(self->data, scratch, len, 8, key_offset, key_width, flags); break;
+    case 16: c_internal_vec_radix_sort_sized(self->data, scratch, len, 16, key_offset, key_width, flags); break;
+    default: c_internal_vec_radix_sort_sized(self->data, scratch, len, size, key_offset, key_width, flags); break;
+  }
+
+  c_allocator_free_sized(TO_IMPL(self)->allocator, scratch, TO_IMPL(self)->len, size);
   return true;
 }
 
@@ -482,7 +623,7 @@ bool c_vec_replace(CVec* self, size_t index, size_t range_len, void* data,
   }
 
   size_t len_as_units = TO_UNITS(self, TO_IMPL(self)->len);
-  size_t cap_as_units = TO_UNITS(self, c_allocator_mem_size(self->data));
+  size_t cap_as_units = TO_UNITS(self, GET_CAPACITY(self));
 
   if ((index + range_len) >= len_as_units) range_len = len_as_units - index;
 
@@ -523,9 +664,9 @@ bool c_vec_rotate_right(CVec* self, size_t elements_count)
     return false;
   }
 
-  void* tmp_mem = c_allocator_alloc(TO_IMPL(self)->allocator,
-                                    TO_BYTES(self, elements_count),
-                                    TO_IMPL(self)->element_size, false);
+  void* tmp_mem = c_allocator_alloc_sized(TO_IMPL(self)->allocator,
+                                          TO_BYTES(self, elements_count),
+                                          TO_IMPL(self)->element_size, false);
   if (!tmp_mem) return false;
 
   memcpy(tmp_mem,
@@ -535,7 +676,7 @@ bool c_vec_rotate_right(CVec* self, size_t elements_count)
   memmove((uint8_t*)self->data + TO_BYTES(self, elements_count), self->data, TO_BYTES(self, elements_count));
   memcpy(self->data, tmp_mem, TO_BYTES(self, elements_count));
 
-  c_allocator_free(TO_IMPL(self)->allocator, tmp_mem);
+  c_allocator_free_sized(TO_IMPL(self)->allocator, tmp_mem, TO_BYTES(self, elements_count), TO_IMPL(self)->element_size);
 
   return true;
 }
@@ -550,9 +691,9 @@ bool c_vec_rotate_left(CVec* self, size_t elements_count)
     return false;
   }
 
-  void* tmp_mem = c_allocator_alloc(TO_IMPL(self)->allocator,
-                                    TO_BYTES(self, elements_count),
-                                    TO_IMPL(self)->element_size, false);
+  void* tmp_mem = c_allocator_alloc_sized(TO_IMPL(self)->allocator,
+                                          TO_BYTES(self, elements_count),
+                                          TO_IMPL(self)->element_size, false);
   if (!tmp_mem) return false;
 
   memcpy(tmp_mem, self->data, TO_BYTES(self, elements_count));
@@ -561,7 +702,7 @@ bool c_vec_rotate_left(CVec* self, size_t elements_count)
              TO_BYTES(self, elements_count),
          tmp_mem, TO_BYTES(self, elements_count));
 
-  c_allocator_free(TO_IMPL(self)->allocator, tmp_mem);
+  c_allocator_free_sized(TO_IMPL(self)->allocator, tmp_mem, TO_BYTES(self, elements_count), TO_IMPL(self)->element_size);
 
   return true;
 }
@@ -681,7 +822,7 @@ bool c_vec_reverse(CVec* self)
   uint8_t* start = self->data;
   uint8_t* end   = (uint8_t*)self->data + (TO_IMPL(self)->len - TO_IMPL(self)->element_size);
 
-  void* tmp_mem = c_allocator_alloc(TO_IMPL(self)->allocator, TO_IMPL(self)->element_size, TO_IMPL(self)->element_size, false);
+  void* tmp_mem = c_allocator_alloc_sized(TO_IMPL(self)->allocator, TO_IMPL(self)->element_size, TO_IMPL(self)->element_size, false);
   if (!tmp_mem) return false;
 
   while (end > start) {
@@ -693,7 +834,7 @@ bool c_vec_reverse(CVec* self)
     end -= TO_IMPL(self)->element_size;
   }
 
-  c_allocator_free(TO_IMPL(self)->allocator, tmp_mem);
+  c_allocator_free_sized(TO_IMPL(self)->allocator, tmp_mem, TO_IMPL(self)->element_size, TO_IMPL(self)->element_size);
 
   return true;
 }
@@ -716,12 +857,585 @@ void c_vec_destroy(CVec* self)
 {
   if (self && self->data) {
     CAllocator* allocator = TO_IMPL(self)->allocator;
-    if (TO_IMPL(self)->raw_capacity == 0) c_allocator_free(allocator, self->data);
+    if (TO_IMPL(self)->raw_capacity == 0) c_allocator_free_sized(allocator, self->data, TO_IMPL(self)->capacity, TO_IMPL(self)->element_size);
     *TO_IMPL(self) = (CVecImpl){0};
-    c_allocator_free(allocator, self);
+    c_allocator_free_sized(allocator, self, c_allocator_alignas(CVecImpl, 1));
+  }
+}
+
+// ------------------------- internal ------------------------- //
+
+/// @brief pattern-defeating quicksort (Orson Peters' pdqsort): quicksort with
+///        a median of 3 (or ninther) pivot, insertion sort for small ranges,
+///        equal elements are put aside in one pass, an already partitioned
+///        range is finished by insertion sort, and the elements of an
+///        unbalanced partition are shuffled (heap sort takes over after
+///        log2(len) of them, so the worst case is O(n log n))
+void c_internal_vec_sort(CVecSorter s, char* data, size_t len)
+{
+  size_t const  size = s.size;
+  CVecSortRange stack[CVEC_SORT_MAX_DEPTH];
+  size_t        stack_len   = 0;
+  char*         begin       = data;
+  char*         end         = data + (len * size);
+  size_t        bad_allowed = 0;
+  bool          leftmost    = true;
+  while (len >>= 1) ++bad_allowed;
+
+  for (;;) {
+    size_t range_len = (size_t)(end - begin) / size;
+    bool   is_done   = false;
+
+    if (range_len < CVEC_SORT_INSERTION_THRESHOLD) {
+      c_internal_vec_sort_insertion(s, begin, end, leftmost);
+      is_done = true;
+    } else {
+      // the pivot goes to begin
+      char* middle = begin + ((range_len / 2) * size);
+      if (range_len > CVEC_SORT_NINTHER_THRESHOLD) {
+        c_internal_vec_sort_sort3(s, begin, middle, end - size);
+        c_internal_vec_sort_sort3(s, begin + size, middle - size, end - (2 * size));
+        c_internal_vec_sort_sort3(s, begin + (2 * size), middle + size, end - (3 * size));
+        c_internal_vec_sort_sort3(s, middle - size, middle, middle + size);
+        c_internal_vec_sort_swap(s, begin, middle);
+      } else {
+        c_internal_vec_sort_sort3(s, middle, begin, end - size);
+      }
+
+      // the element before begin is <= the range, if the pivot is equal to it,
+      // the elements equal to the pivot are put on the left, they are sorted
+      if (!leftmost && !c_internal_vec_sort_less(s, begin - size, begin)) {
+        begin = c_internal_vec_sort_partition_left(s, begin, end) + size;
+        continue;
+      }
+
+      bool  already_partitioned;
+      char* pivot      = s.branchless ? c_internal_vec_sort_partition_right_branchless(s, begin, end, &already_partitioned)
+                                      : c_internal_vec_sort_partition_right(s, begin, end, &already_partitioned);
+      size_t left_len  = (size_t)(pivot - begin) / size;
+      size_t right_len = (size_t)(end - (pivot + size)) / size;
+
+      if ((left_len < range_len / 8) || (right_len < range_len / 8)) {
+        if (--bad_allowed == 0) {
+          c_internal_vec_sort_heap(s, begin, end);
+          is_done = true;
+        } else {
+          c_internal_vec_sort_shuffle(s, begin, pivot, left_len);
+          c_internal_vec_sort_shuffle(s, pivot + size, end, right_len);
+        }
+      } else if (already_partitioned) {
+        is_done = c_internal_vec_sort_partial_insertion(s, begin, pivot) && c_internal_vec_sort_partial_insertion(s, pivot + size, end);
+      }
+
+      if (!is_done) {
+        // the bigger side waits, the smaller one is sorted first
+        assert(stack_len < CVEC_SORT_MAX_DEPTH);
+        if (left_len > right_len) {
+          stack[stack_len++] = (CVecSortRange){begin, pivot, bad_allowed, leftmost};
+          begin              = pivot + size;
+          leftmost           = false;
+        } else {
+          stack[stack_len++] = (CVecSortRange){pivot + size, end, bad_allowed, false};
+          end                = pivot;
+        }
+        continue;
+      }
+    }
+
+    if (!stack_len) break;
+    CVecSortRange range = stack[--stack_len];
+    begin               = range.begin;
+    end                 = range.end;
+    bad_allowed         = range.bad_allowed;
+    leftmost            = range.leftmost;
+  }
+}
+
+/// @brief c_vec_sort_* of a vector of a primitive type
+bool c_internal_vec_sort_typed(CVec* self, size_t size, CVecSortLessFn less)
+{
+  assert(self && self->data);
+
+  if (TO_IMPL(self)->element_size != size) {
+    c_error_set(C_ERROR_invalid_element_size);
+    return false;
+  }
+
+  uint64_t tmp;
+  uint64_t pivot;
+  c_internal_vec_sort((CVecSorter){.size = size, .less = less, .branchless = true, .tmp = (char*)&tmp, .pivot = (char*)&pivot}, self->data, TO_UNITS(self, TO_IMPL(self)->len));
+  return true;
+}
+
+/// @brief c_vec_sort with elements of size bytes, buffer has room for 2
+///        elements of CVEC_SORT_BUFFER_SIZE bytes (bigger ones are allocated)
+bool c_internal_vec_sort_sized(CVec* self, size_t size, CVecCompareFn cmp, char* buffer)
+{
+  bool is_allocated = size > CVEC_SORT_BUFFER_SIZE;
+  if (is_allocated) {
+    buffer = c_allocator_alloc_sized(TO_IMPL(self)->allocator, 2 * size, size, false);
+    if (!buffer) return false;
+  }
+
+  c_internal_vec_sort((CVecSorter){.size = size, .less = c_internal_vec_less_cmp, .cmp = cmp, .tmp = buffer, .pivot = buffer + size}, self->data, TO_UNITS(self, TO_IMPL(self)->len));
+
+  if (is_allocated) c_allocator_free_sized(TO_IMPL(self)->allocator, buffer, 2 * size, size);
+  return true;
+}
+
+bool c_internal_vec_sort_less(CVecSorter s, char const* a, char const* b)
+{
+  return s.less(a, b, s.cmp);
+}
+
+void c_internal_vec_sort_swap(CVecSorter s, char* a, char* b)
+{
+  switch (s.size) {
+    case 4: {
+      uint32_t x, y;
+      memcpy(&x, a, 4);
+      memcpy(&y, b, 4);
+      memcpy(a, &y, 4);
+      memcpy(b, &x, 4);
+    } break;
+    case 8: {
+      uint64_t x, y;
+      memcpy(&x, a, 8);
+      memcpy(&y, b, 8);
+      memcpy(a, &y, 8);
+      memcpy(b, &x, 8);
+    } break;
+    case 16: {
+      uint64_t x[2], y[2];
+      memcpy(x, a, 16);
+      memcpy(y, b, 16);
+      memcpy(a, y, 16);
+      memcpy(b, x, 16);
+    } break;
+    default:
+      for (size_t offset = 0; offset < s.size; offset += sizeof(uint64_t)) {
+        uint64_t x, y;
+        size_t   len = (s.size - offset) < sizeof(uint64_t) ? (s.size - offset) : sizeof(uint64_t);
+        memcpy(&x, a + offset, len);
+        memcpy(&y, b + offset, len);
+        memcpy(a + offset, &y, len);
+        memcpy(b + offset, &x, len);
+      }
+      break;
   }
 }
 
+/// @brief sort a, b and c
+void c_internal_vec_sort_sort3(CVecSorter s, char* a, char* b, char* c)
+{
+  if (c_internal_vec_sort_less(s, b, a)) c_internal_vec_sort_swap(s, a, b);
+  if (c_internal_vec_sort_less(s, c, b)) c_internal_vec_sort_swap(s, b, c);
+  if (c_internal_vec_sort_less(s, b, a)) c_internal_vec_sort_swap(s, a, b);
+}
+
+/// @brief guarded false: the element before begin is <= all the elements of
+///        the range, so the inner loop doesn't check for begin
+void c_internal_vec_sort_insertion(CVecSorter s, char* begin, char* end, bool guarded)
+{
+  if (begin == end) return;
+
+  size_t const size = s.size;
+  for (char* current = begin + size; current != end; current += size) {
+    char* sift   = current;
+    char* sift_1 = current - size;
+    if (c_internal_vec_sort_less(s, sift, sift_1)) {
+      memcpy(s.tmp, sift, size);
+      do {
+        memcpy(sift, sift_1, size);
+        sift = sift_1;
+      } while ((!guarded || (sift != begin)) && c_internal_vec_sort_less(s, s.tmp, (sift_1 = sift - size)));
+      memcpy(sift, s.tmp, size);
+    }
+  }
+}
+
+/// @brief insertion sort that gives up (false) after moving
+///        CVEC_SORT_PARTIAL_INSERTION_LIMIT elements
+bool c_internal_vec_sort_partial_insertion(CVecSorter s, char* begin, char* end)
+{
+  if (begin == end) return true;
+
+  size_t const size  = s.size;
+  size_t       moved = 0;
+  for (char* current = begin + size; current != end; current += size) {
+    char* sift   = current;
+    char* sift_1 = current - size;
+    if (c_internal_vec_sort_less(s, sift, sift_1)) {
+      memcpy(s.tmp, sift, size);
+      do {
+        memcpy(sift, sift_1, size);
+        sift = sift_1;
+      } while ((sift != begin) && c_internal_vec_sort_less(s, s.tmp, (sift_1 = sift - size)));
+      memcpy(sift, s.tmp, size);
+      moved += (size_t)(current - sift) / size;
+      if (moved > CVEC_SORT_PARTIAL_INSERTION_LIMIT) return false;
+    }
+  }
+  return true;
+}
+
+/// @brief partition around the pivot at begin: the elements < pivot go to its
+///        left, the others to its right
+/// @return the position of the pivot, out_already_partitioned is true if no
+///         element was swapped
+char* c_internal_vec_sort_partition_right(CVecSorter s, char* begin, char* end, bool* out_already_partitioned)
+{
+  size_t const size  = s.size;
+  char*        first = begin;
+  char*        last  = end;
+  memcpy(s.pivot, begin, size);
+
+  // the first element >= pivot (the median of 3 guarantees that it exists),
+  // then the last one < pivot (it is guarded if nothing is before first)
+  do first += size;
+  while (c_internal_vec_sort_less(s, first, s.pivot));
+  if (first - size == begin) {
+    while ((first < last) && !c_internal_vec_sort_less(s, (last -= size), s.pivot)) {}
+  } else {
+    do last -= size;
+    while (!c_internal_vec_sort_less(s, last, s.pivot));
+  }
+
+  *out_already_partitioned = first >= last;
+  while (first < last) {
+    c_internal_vec_sort_swap(s, first, last);
+    do first += size;
+    while (c_internal_vec_sort_less(s, first, s.pivot));
+    do last -= size;
+    while (!c_internal_vec_sort_less(s, last, s.pivot));
+  }
+
+  char* pivot = first - size;
+  c_internal_vec_sort_swap(s, begin, pivot);
+  return pivot;
+}
+
+/// @brief same like c_internal_vec_sort_partition_right, the elements of the
+///        middle are classified in blocks (BlockQuicksort, Edelkamp and Weiss):
+///        the offsets of the misplaced ones are written without branches, then
+///        they are swapped in pairs
+char* c_internal_vec_sort_partition_right_branchless(CVecSorter s, char* begin, char* end, bool* out_already_partitioned)
+{
+  size_t const size  = s.size;
+  char*        first = begin;
+  char*        last  = end;
+  memcpy(s.pivot, begin, size);
+
+  do first += size;
+  while (c_internal_vec_sort_less(s, first, s.pivot));
+  if (first - size == begin) {
+    while ((first < last) && !c_internal_vec_sort_less(s, (last -= size), s.pivot)) {}
+  } else {
+    do last -= size;
+    while (!c_internal_vec_sort_less(s, last, s.pivot));
+  }
+
+  *out_already_partitioned = first >= last;
+  if (!*out_already_partitioned) {
+    c_internal_vec_sort_swap(s, first, last);
+    first += size;
+
+    unsigned char left_offsets[CVEC_SORT_BLOCK_SIZE];
+    unsigned char right_offsets[CVEC_SORT_BLOCK_SIZE];
+    char*         left_base   = first;
+    char*         right_base  = last;
+    size_t        left_count  = 0;
+    size_t        right_count = 0;
+    size_t        left_start  = 0;
+    size_t        right_start = 0;
+    while (first < last) {
+      // the elements of each side that are classified (a side that still has
+      // misplaced elements doesn't take more)
+      size_t unknown_count = (size_t)(last - first) / size;
+      size_t left_split    = (left_count == 0) ? ((right_count == 0) ? unknown_count / 2 : unknown_count) : 0;
+      size_t right_split   = (right_count == 0) ? (unknown_count - left_split) : 0;
+      if (left_split > CVEC_SORT_BLOCK_SIZE) left_split = CVEC_SORT_BLOCK_SIZE;
+      if (right_split > CVEC_SORT_BLOCK_SIZE) right_split = CVEC_SORT_BLOCK_SIZE;
+
+      for (size_t iii = 0; iii < left_split; ++iii, first += size) {
+        left_offsets[left_count] = (unsigned char)iii;
+        left_count += !c_internal_vec_sort_less(s, first, s.pivot);
+      }
+      for (size_t iii = 1; iii <= right_split; ++iii) {
+        last -= size;
+        right_offsets[right_count] = (unsigned char)iii;
+        right_count += c_internal_vec_sort_less(s, last, s.pivot);
+      }
+
+      // swap the pairs of misplaced elements (as a cycle of moves, or with
+      // real swaps if both sides have the same count, which keeps the
+      // descending input O(n))
+      size_t count = left_count < right_count ? left_count : right_count;
+      if (left_count == right_count) {
+        for (size_t iii = 0; iii < count; ++iii) {
+          c_internal_vec_sort_swap(s, left_base + (left_offsets[left_start + iii] * size), right_base - (right_offsets[right_start + iii] * size));
+        }
+      } else if (count > 0) {
+        char* left  = left_base + (left_offsets[left_start] * size);
+        char* right = right_base - (right_offsets[right_start] * size);
+        memcpy(s.tmp, left, size);
+        memcpy(left, right, size);
+        for (size_t iii = 1; iii < count; ++iii) {
+          left = left_base + (left_offsets[left_start + iii] * size);
+          memcpy(right, left, size);
+          right = right_base - (right_offsets[right_start + iii] * size);
+          memcpy(left, right, size);
+        }
+        memcpy(right, s.tmp, size);
+      }
+      left_count -= count;
+      right_count -= count;
+      left_start += count;
+      right_start += count;
+
+      if (left_count == 0) {
+        left_start = 0;
+        left_base  = first;
+      }
+      if (right_count == 0) {
+        right_start = 0;
+        right_base  = last;
+      }
+    }
+
+    // the misplaced elements that are left are swapped with the boundary
+    if (left_count) {
+      while (left_count--) {
+        last -= size;
+        c_internal_vec_sort_swap(s, left_base + (left_offsets[left_start + left_count] * size), last);
+      }
+      first = last;
+    }
+    if (right_count) {
+      while (right_count--) {
+        c_internal_vec_sort_swap(s, right_base - (right_offsets[right_start + right_count] * size), first);
+        first += size;
+      }
+      last = first;
+    }
+  }
+
+  char* pivot = first - size;
+  c_internal_vec_sort_swap(s, begin, pivot);
+  return pivot;
+}
+
+/// @brief partition around the pivot at begin: the elements <= pivot go to its
+///        left (used when they are all equal to it)
+/// @return the position of the pivot
+char* c_internal_vec_sort_partition_left(CVecSorter s, char* begin, char* end)
+{
+  size_t const size  = s.size;
+  char*        first = begin;
+  char*        last  = end;
+  memcpy(s.pivot, begin, size);
+
+  do last -= size;
+  while (c_internal_vec_sort_less(s, s.pivot, last));
+  if (last + size == end) {
+    while ((first < last) && !c_internal_vec_sort_less(s, s.pivot, (first += size))) {}
+  } else {
+    do first += size;
+    while (!c_internal_vec_sort_less(s, s.pivot, first));
+  }
+
+  while (first < last) {
+    c_internal_vec_sort_swap(s, first, last);
+    do last -= size;
+    while (c_internal_vec_sort_less(s, s.pivot, last));
+    do first += size;
+    while (!c_internal_vec_sort_less(s, s.pivot, first));
+  }
+
+  c_internal_vec_sort_swap(s, begin, last);
+  return last;
+}
+
+/// @brief heap sort, the fallback after too many unbalanced partitions
+void c_internal_vec_sort_heap(CVecSorter s, char* begin, char* end)
+{
+  size_t const len = (size_t)(end - begin) / s.size;
+  for (size_t iii = len / 2; iii-- > 0;) {
+    c_internal_vec_sort_sift_down(s, begin, iii, len);
+  }
+  for (size_t heap_len = len; heap_len-- > 1;) {
+    c_internal_vec_sort_swap(s, begin, begin + (heap_len * s.size));
+    c_internal_vec_sort_sift_down(s, begin, 0, heap_len);
+  }
+}
+
+/// @brief move the element at root down the max heap of len elements
+void c_internal_vec_sort_sift_down(CVecSorter s, char* begin, size_t root, size_t len)
+{
+  size_t const size = s.size;
+  for (size_t child; (child = (2 * root) + 1) < len; root = child) {
+    if ((child + 1 < len) && c_internal_vec_sort_less(s, begin + (child * size), begin + ((child + 1) * size))) ++child;
+    if (!c_internal_vec_sort_less(s, begin + (root * size), begin + (child * size))) break;
+    c_internal_vec_sort_swap(s, begin + (root * size), begin + (child * size));
+  }
+}
+
+/// @brief swap a few elements of an unbalanced side of a partition with ones
+///        from its quarters, to break the patterns that made it unbalanced
+void c_internal_vec_sort_shuffle(CVecSorter s, char* begin, char* end, size_t len)
+{
+  if (len < CVEC_SORT_INSERTION_THRESHOLD) return;
+
+  size_t const size    = s.size;
+  size_t const quarter = len / 4;
+  c_internal_vec_sort_swap(s, begin, begin + (quarter * size));
+  c_internal_vec_sort_swap(s, end - size, end - (quarter * size));
+  if (len > CVEC_SORT_NINTHER_THRESHOLD) {
+    c_internal_vec_sort_swap(s, begin + size, begin + ((quarter + 1) * size));
+    c_internal_vec_sort_swap(s, begin + (2 * size), begin + ((quarter + 2) * size));
+    c_internal_vec_sort_swap(s, end - (2 * size), end - ((quarter + 1) * size));
+    c_internal_vec_sort_swap(s, end - (3 * size), end - ((quarter + 2) * size));
+  }
+}
+
+/// @brief LSD radix sort: one histogram pass counts every byte of the keys,
+///        then a pass per byte (from the least significant one) scatters the
+///        elements between data and scratch, the bytes that are the same for
+///        all the keys have one full bucket, their passes are skipped
+void c_internal_vec_radix_sort(char* data, char* scratch, size_t len, size_t size, size_t key_offset, size_t key_width, CVecRadixSortFlags flags)
+{
+  size_t counts[CVEC_RADIX_SORT_MAX_KEY_WIDTH][256] = {{0}};
+  char*  buckets[256];
+
+  // the keys are turned into unsigned integers with the same order: the sign
+  // bit of the signed ones is flipped, all the bits of the negative floats
+  // are flipped, and all the bits of the descending ones
+  uint64_t const sign       = (uint64_t)1 << ((key_width * 8) - 1);
+  uint64_t const mask       = sign | (sign - 1);
+  uint64_t const float_mask = (flags & C_VEC_RADIX_SORT_FLAG_float) ? (mask ^ sign) : 0;
+  uint64_t const flip_mask  = ((flags & (C_VEC_RADIX_SORT_FLAG_signed | C_VEC_RADIX_SORT_FLAG_float)) ? sign : 0) ^ ((flags & C_VEC_RADIX_SORT_FLAG_descending) ? mask : 0);
+
+  char const* const end = data + (len * size);
+  for (char const* element = data; element != end; element += size) {
+    uint64_t key = c_internal_vec_radix_key(element, key_offset, key_width, float_mask, flip_mask);
+    for (size_t byte = 0; byte < key_width; ++byte, key >>= 8) ++counts[byte][key & 0xFF];
+  }
+
+  char* src = data;
+  char* dst = scratch;
+  for (size_t byte = 0; byte < key_width; ++byte) {
+    size_t const shift = byte * 8;
+    if (counts[byte][(c_internal_vec_radix_key(src, key_offset, key_width, float_mask, flip_mask) >> shift) & 0xFF] == len) continue;
+
+    char* bucket = dst;
+    for (size_t digit = 0; digit < 256; ++digit) {
+      buckets[digit] = bucket;
+      bucket += counts[byte][digit] * size;
+    }
+
+    char const* const src_end = src + (len * size);
+    for (char const* element = src; element != src_end; element += size) {
+      size_t digit = (c_internal_vec_radix_key(element, key_offset, key_width, float_mask, flip_mask) >> shift) & 0xFF;
+      memcpy(buckets[digit], element, size);
+      buckets[digit] += size;
+    }
+
+    char* tmp = src;
+    src       = dst;
+    dst       = tmp;
+  }
+
+  if (src != data) memcpy(data, src, len * size);
+}
+
+/// @brief c_internal_vec_radix_sort with the key width as a constant
+void c_internal_vec_radix_sort_sized(char* data, char* scratch, size_t len, size_t size, size_t key_offset, size_t key_width, CVecRadixSortFlags flags)
+{
+  switch (key_width) {
+    case 1: c_internal_vec_radix_sort(data, scratch, len, size, key_offset, 1, flags); break;
+    case 2: c_internal_vec_radix_sort(data, scratch, len, size, key_offset, 2, flags); break;
+    case 4: c_internal_vec_radix_sort(data, scratch, len, size, key_offset, 4, flags); break;
+    default: c_internal_vec_radix_sort(data, scratch, len, size, key_offset, 8, flags); break;
+  }
+}
+
+/// @brief the key of element as an unsigned integer that has the same order,
+///        float_mask is xored if the sign bit is set, then flip_mask
+uint64_t c_internal_vec_radix_key(char const* element, size_t key_offset, size_t key_width, uint64_t float_mask, uint64_t flip_mask)
+{
+  uint64_t key;
+  switch (key_width) {
+    case 1: {
+      uint8_t value;
+      memcpy(&value, element + key_offset, sizeof(value));
+      key = value;
+    } break;
+    case 2: {
+      uint16_t value;
+      memcpy(&value, element + key_offset, sizeof(value));
+      key = value;
+    } break;
+    case 4: {
+      uint32_t value;
+      memcpy(&value, element + key_offset, sizeof(value));
+      key = value;
+    } break;
+    default:
+      memcpy(&key, element + key_offset, sizeof(key));
+      break;
+  }
+
+  key ^= ((uint64_t)0 - (key >> ((key_width * 8) - 1))) & float_mask;
+  return key ^ flip_mask;
+}
+
+bool c_internal_vec_less_cmp(void const* a, void const* b, CVecCompareFn cmp)
+{
+  return cmp(a, b) < 0;
+}
+
+bool c_internal_vec_less_u32(void const* a, void const* b, CVecCompareFn cmp)
+{
+  (void)cmp;
+  return *(uint32_t const*)a < *(uint32_t const*)b;
+}
+
+bool c_internal_vec_less_u64(void const* a, void const* b, CVecCompareFn cmp)
+{
+  (void)cmp;
+  return *(uint64_t const*)a < *(uint64_t const*)b;
+}
+
+bool c_internal_vec_less_i32(void const* a, void const* b, CVecCompareFn cmp)
+{
+  (void)cmp;
+  return *(int32_t const*)a < *(int32_t const*)b;
+}
+
+bool c_internal_vec_less_i64(void const* a, void const* b, CVecCompareFn cmp)
+{
+  (void)cmp;
+  return *(int64_t const*)a < *(int64_t const*)b;
+}
+
+/// @brief the NaNs are bigger than the numbers (so they go last)
+bool c_internal_vec_less_f32(void const* a, void const* b, CVecCompareFn cmp)
+{
+  (void)cmp;
+  float const x = *(float const*)a;
+  float const y = *(float const*)b;
+  return (x < y) || ((y != y) && (x == x));
+}
+
+/// @brief the NaNs are bigger than the numbers (so they go last)
+bool c_internal_vec_less_f64(void const* a, void const* b, CVecCompareFn cmp)
+{
+  (void)cmp;
+  double const x = *(double const*)a;
+  double const y = *(double const*)b;
+  return (x < y) || ((y != y) && (x == x));
+}
+
 #ifdef MSC_VER
 #pragma warning(pop)
 #endif
@@ -1,9 +1,12 @@
 #include "anylibs/allocator.h"
 #include "anylibs/error.h"
+#include "anylibs/hashmap.h"
+#include "anylibs/vec.h"
 
 #include <utest.h>
 
 #include <stdalign.h>
+#include <threads.h>
 
 UTEST(CAllocator, default_general)
 {
@@ -45,6 +48,28 @@ UTEST(CAllocator, default_realloc)
   c_allocator_free(a, mem);
 }
 
+UTEST(CAllocator, default_realloc_big)
+{
+  CAllocator* a = c_allocator_default();
+
+  char* mem = c_allocator_alloc(a, 100, 1, false);
+  EXPECT_TRUE_MSG(mem, c_error_to_str(c_error_get()));
+  memset(mem, 'a', 100);
+
+  // small to big, then big to bigger, then back to small
+  size_t sizes[] = {2 << 20, 8 << 20, 3 << 20, 100};
+  for (size_t iii = 0; iii < sizeof(sizes) / sizeof(*sizes); ++iii) {
+    mem = c_allocator_resize(a, mem, sizes[iii]);
+    ASSERT_TRUE_MSG(mem, c_error_to_str(c_error_get()));
+    EXPECT_EQ(c_allocator_mem_size(mem), sizes[iii]);
+    EXPECT_EQ(mem[0], 'a');
+    EXPECT_EQ(mem[99], 'a');
+    mem[sizes[iii] - 1] = 'b';
+  }
+
+  c_allocator_free(a, mem);
+}
+
 UTEST(CAllocator, arena_general)
 {
   CAllocator* a = c_allocator_arena_create(1000);
@@ -136,3 +161,620 @@ UTEST(CAllocator, fixed_buffer_realloc)
   c_allocator_free(a, mem);
   c_allocator_fixed_buffer_destroy(a);
 }
+
+UTEST(CAllocator, arena_growable)
+{
+  CAllocator* a = c_allocator_arena_create_growable(64);
+  EXPECT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  // this is much more than the initial capacity
+  int* mems[100];
+  for (int iii = 0; iii < 100; ++iii) {
+    mems[iii] = c_allocator_alloc(a, c_allocator_alignas(int, 10), false);
+    ASSERT_TRUE_MSG(mems[iii], c_error_to_str(c_error_get()));
+    mems[iii][9] = iii;
+  }
+  for (int iii = 0; iii < 100; ++iii) {
+    EXPECT_EQ(mems[iii][9], iii);
+  }
+
+  void* big = c_allocator_alloc(a, 4096, 1, false);
+  EXPECT_TRUE_MSG(big, c_error_to_str(c_error_get()));
+
+  c_allocator_arena_destroy(a);
+}
+
+UTEST(CAllocator, arena_alignment)
+{
+  CAllocator* a = c_allocator_arena_create(1000);
+  EXPECT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  void* mem1 = c_allocator_alloc(a, 1, 1, false);
+  EXPECT_TRUE(mem1);
+  void* mem2 = c_allocator_alloc(a, 64, 64, false);
+  EXPECT_TRUE(mem2);
+  EXPECT_EQ((uintptr_t)mem2 % 64, 0U);
+  EXPECT_EQ(c_allocator_mem_alignment(mem2), 64U);
+
+  c_allocator_arena_destroy(a);
+}
+
+UTEST(CAllocator, arena_mark_rewind)
+{
+  CAllocator* a = c_allocator_arena_create_growable(128);
+  EXPECT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  void*               before = c_allocator_alloc(a, c_allocator_alignas(int, 4), false);
+  CAllocatorArenaMark mark   = c_allocator_arena_mark(a);
+  void*               first  = c_allocator_alloc(a, c_allocator_alignas(int, 4), false);
+  for (int iii = 0; iii < 10; ++iii) {
+    EXPECT_TRUE(c_allocator_alloc(a, c_allocator_alignas(int, 20), false));
+  }
+
+  c_allocator_arena_rewind_to_mark(a, mark);
+  void* again = c_allocator_alloc(a, c_allocator_alignas(int, 4), false);
+  EXPECT_EQ(first, again);
+
+  c_allocator_arena_reset(a);
+  void* after_reset = c_allocator_alloc(a, c_allocator_alignas(int, 4), false);
+  EXPECT_EQ(before, after_reset);
+
+  c_allocator_arena_destroy(a);
+}
+
+UTEST(CAllocator, fixed_buffer_reset)
+{
+  int         buf[100];
+  CAllocator* a = c_allocator_fixed_buffer_create(buf, sizeof(buf));
+  EXPECT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  void* mem = c_allocator_alloc(a, c_allocator_alignas(int, 50), false);
+  EXPECT_TRUE(mem);
+  EXPECT_FALSE(c_allocator_alloc(a, c_allocator_alignas(int, 50), false));
+
+  c_allocator_arena_reset(a);
+  EXPECT_EQ(c_allocator_alloc(a, c_allocator_alignas(int, 50), false), mem);
+
+  c_allocator_fixed_buffer_destroy(a);
+}
+
+UTEST(CAllocator, arena_virtual)
+{
+  int         flags[] = {C_ALLOCATOR_ARENA_FLAG_none, C_ALLOCATOR_ARENA_FLAG_huge_pages | C_ALLOCATOR_ARENA_FLAG_release_on_reset};
+  size_t const reserve = (size_t)64 << 20;
+  for (size_t iii = 0; iii < sizeof(flags) / sizeof(*flags); ++iii) {
+    CAllocator* a = c_allocator_arena_create_virtual(reserve, flags[iii]);
+    ASSERT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+    // this commits many pages
+    char* mems[64];
+    for (size_t jjj = 0; jjj < 64; ++jjj) {
+      mems[jjj] = c_allocator_alloc(a, 131072, 64, false);
+      ASSERT_TRUE_MSG(mems[jjj], c_error_to_str(c_error_get()));
+      EXPECT_EQ((uintptr_t)mems[jjj] % 64, 0U);
+      memset(mems[jjj], (int)jjj, 131072);
+    }
+    EXPECT_EQ(mems[10][131071], 10);
+
+    // the last allocation grows in place
+    char* grown = c_allocator_resize(a, mems[63], 5000000);
+    EXPECT_EQ(grown, mems[63]);
+    EXPECT_EQ(grown[131071], 63);
+
+    // more than the reserved space
+    EXPECT_FALSE(c_allocator_alloc(a, reserve, 1, false));
+
+    c_allocator_arena_reset(a);
+    char* after_reset = c_allocator_alloc(a, 131072, 64, true);
+    EXPECT_EQ(after_reset, mems[0]);
+    EXPECT_EQ(after_reset[500], 0);
+
+    c_allocator_arena_destroy(a);
+  }
+
+  // a single huge page, all of it is committed by the first allocation (with
+  // explicit huge pages if the system has them, normal pages otherwise)
+  CAllocator* a = c_allocator_arena_create_virtual((size_t)2 << 20, C_ALLOCATOR_ARENA_FLAG_huge_pages);
+  ASSERT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+  char* mem = c_allocator_alloc_sized(a, (size_t)2 << 20, 64, false);
+  ASSERT_TRUE_MSG(mem, c_error_to_str(c_error_get()));
+  memset(mem, 1, (size_t)2 << 20);
+  EXPECT_EQ(mem[((size_t)2 << 20) - 1], 1);
+  EXPECT_FALSE(c_allocator_alloc_sized(a, 64, 64, false));
+  c_allocator_arena_destroy(a);
+
+  EXPECT_FALSE(c_allocator_arena_create_virtual(0, C_ALLOCATOR_ARENA_FLAG_none));
+}
+
+UTEST(CAllocator, pool_general)
+{
+  CAllocator* a = c_allocator_pool_create(c_allocator_alignas(int, 4), 8);
+  EXPECT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  // more than one chunk
+  int* mems[20];
+  for (int iii = 0; iii < 20; ++iii) {
+    mems[iii] = c_allocator_alloc(a, c_allocator_alignas(int, 4), true);
+    ASSERT_TRUE_MSG(mems[iii], c_error_to_str(c_error_get()));
+    EXPECT_EQ(c_allocator_mem_size(mems[iii]), sizeof(int) * 4);
+    EXPECT_EQ(mems[iii][3], 0);
+    mems[iii][3] = iii;
+  }
+  for (int iii = 0; iii < 20; ++iii) {
+    EXPECT_EQ(mems[iii][3], iii);
+  }
+
+  // freed slots are reused
+  c_allocator_free(a, mems[5]);
+  int* reused = c_allocator_alloc(a, c_allocator_alignas(int, 4), false);
+  EXPECT_EQ(reused, mems[5]);
+
+  // bigger than a slot
+  int* big = c_allocator_alloc(a, c_allocator_alignas(int, 100), true);
+  EXPECT_TRUE_MSG(big, c_error_to_str(c_error_get()));
+  big = c_allocator_resize(a, big, sizeof(int) * 2);
+  EXPECT_TRUE_MSG(big, c_error_to_str(c_error_get()));
+  c_allocator_free(a, big);
+
+  for (int iii = 0; iii < 20; ++iii) {
+    c_allocator_free(a, mems[iii]);
+  }
+  c_allocator_pool_destroy(a);
+}
+
+UTEST(CAllocator, pool_with_containers)
+{
+  CAllocator* a = c_allocator_pool_create(64, alignof(max_align_t), 32);
+  EXPECT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  CVec* vec = c_vec_create(sizeof(int), a);
+  ASSERT_TRUE(vec);
+  for (int iii = 0; iii < 100; ++iii) {
+    EXPECT_TRUE(c_vec_push(vec, &iii));
+  }
+  EXPECT_EQ(c_vec_len(vec), 100U);
+  EXPECT_EQ(((int*)vec->data)[99], 99);
+  c_vec_destroy(vec);
+
+  CHashMap* map = c_hashmap_create(sizeof(int), sizeof(int), a);
+  ASSERT_TRUE(map);
+  EXPECT_TRUE(c_hashmap_insert(map, &(int){1}, &(int){10}));
+  int* value = NULL;
+  EXPECT_TRUE(c_hashmap_get(map, &(int){1}, (void**)&value));
+  EXPECT_TRUE(value && *value == 10);
+  c_hashmap_destroy(map, NULL, NULL);
+
+  c_allocator_pool_destroy(a);
+}
+
+UTEST(CAllocator, pool_sized)
+{
+  CAllocator* headered = c_allocator_pool_create(16, 8, 32);
+  CAllocator* sized    = c_allocator_pool_create_sized(16, 8, 32);
+  EXPECT_TRUE_MSG(headered && sized, c_error_to_str(c_error_get()));
+
+  // the slots are linked in address order, the distance between 2
+  // allocations is the slot size
+  char* mems[32];
+  for (size_t iii = 0; iii < 32; ++iii) {
+    mems[iii] = c_allocator_alloc_sized(sized, 16, 8, false);
+    ASSERT_TRUE(mems[iii]);
+    memset(mems[iii], (int)iii, 16);
+  }
+  char* headered1 = c_allocator_alloc_sized(headered, 16, 8, false);
+  char* headered2 = c_allocator_alloc_sized(headered, 16, 8, false);
+  ASSERT_TRUE(headered1 && headered2);
+  for (size_t iii = 1; iii < 32; ++iii) EXPECT_EQ(mems[iii] - mems[iii - 1], 16);
+  EXPECT_TRUE(headered2 - headered1 > 16);
+  for (size_t iii = 0; iii < 32; ++iii) EXPECT_EQ(mems[iii][15], (char)iii);
+
+  // freed slots are reused
+  c_allocator_free_sized(sized, mems[7], 16, 8);
+  EXPECT_EQ(c_allocator_alloc_sized(sized, 16, 8, false), mems[7]);
+
+  // c_allocator_alloc objects don't fit in a slot, they fallback
+  char* mem = c_allocator_alloc(sized, 16, 8, true);
+  EXPECT_TRUE(mem);
+  EXPECT_EQ(c_allocator_mem_size(mem), 16U);
+  EXPECT_TRUE((mem = c_allocator_resize(sized, mem, 64)));
+  c_allocator_free(sized, mem);
+
+  // containers use the sized allocations
+  CVec* vec = c_vec_create_with_capacity(sizeof(int), 4, false, sized);
+  ASSERT_TRUE(vec);
+  for (int iii = 0; iii < 100; ++iii) EXPECT_TRUE(c_vec_push(vec, &iii));
+  EXPECT_EQ(((int*)vec->data)[99], 99);
+  c_vec_destroy(vec);
+
+  c_allocator_free_sized(headered, headered1, 16, 8);
+  c_allocator_free_sized(headered, headered2, 16, 8);
+  for (size_t iii = 0; iii < 32; ++iii) c_allocator_free_sized(sized, mems[iii], 16, 8);
+  c_allocator_pool_destroy(headered);
+  c_allocator_pool_destroy(sized);
+}
+
+UTEST(CAllocator, slab_general)
+{
+  CAllocator* a = c_allocator_slab_create();
+  EXPECT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  // every size class, and the fallback
+  size_t sizes[] = {1, 8, 17, 100, 129, 200, 1000, 5000, 32000, 100000};
+  char*  mems[sizeof(sizes) / sizeof(*sizes)];
+  for (size_t iii = 0; iii < sizeof(sizes) / sizeof(*sizes); ++iii) {
+    mems[iii] = c_allocator_alloc(a, sizes[iii], 1, true);
+    ASSERT_TRUE_MSG(mems[iii], c_error_to_str(c_error_get()));
+    EXPECT_EQ(c_allocator_mem_size(mems[iii]), sizes[iii]);
+    EXPECT_EQ(mems[iii][sizes[iii] - 1], 0);
+    memset(mems[iii], (int)iii, sizes[iii]);
+  }
+
+  // grow through classes, then to the fallback
+  mems[0] = c_allocator_resize(a, mems[0], 300);
+  ASSERT_TRUE_MSG(mems[0], c_error_to_str(c_error_get()));
+  mems[0] = c_allocator_resize(a, mems[0], 70000);
+  ASSERT_TRUE_MSG(mems[0], c_error_to_str(c_error_get()));
+  EXPECT_EQ(mems[0][0], 0);
+
+  for (size_t iii = 1; iii < sizeof(sizes) / sizeof(*sizes); ++iii) {
+    EXPECT_EQ(mems[iii][sizes[iii] - 1], (char)iii);
+  }
+
+  void* aligned = c_allocator_alloc(a, 64, 64, false);
+  EXPECT_TRUE(aligned);
+  EXPECT_EQ((uintptr_t)aligned % 64, 0U);
+  c_allocator_free(a, aligned);
+
+  for (size_t iii = 0; iii < sizeof(sizes) / sizeof(*sizes); ++iii) {
+    c_allocator_free(a, mems[iii]);
+  }
+  c_allocator_slab_destroy(a);
+}
+
+enum { SLAB_TEST_OBJECTS = 1000 };
+
+typedef struct SlabTestData {
+  CAllocator* allocator;
+  int*        objects[SLAB_TEST_OBJECTS];
+} SlabTestData;
+
+static int slab_test_alloc(void* arg)
+{
+  SlabTestData* data = arg;
+  for (int iii = 0; iii < SLAB_TEST_OBJECTS; ++iii) {
+    data->objects[iii] = c_allocator_alloc(data->allocator, c_allocator_alignas(int, (iii % 20) + 1), false);
+    if (!data->objects[iii]) return 1;
+    data->objects[iii][0] = iii;
+  }
+  return 0;
+}
+
+static int slab_test_free(void* arg)
+{
+  SlabTestData* data = arg;
+  for (int iii = 0; iii < SLAB_TEST_OBJECTS; ++iii) {
+    if (data->objects[iii][0] != iii) return 1;
+    c_allocator_free(data->allocator, data->objects[iii]);
+  }
+  return 0;
+}
+
+UTEST(CAllocator, slab_threads)
+{
+  enum { THREADS_COUNT = 4 };
+
+  CAllocator* a = c_allocator_slab_create();
+  EXPECT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  static SlabTestData data[THREADS_COUNT];
+  thrd_t              threads[THREADS_COUNT];
+  int                 result;
+
+  for (int round = 0; round < 3; ++round) {
+    for (int iii = 0; iii < THREADS_COUNT; ++iii) {
+      data[iii].allocator = a;
+      ASSERT_EQ(thrd_create(&threads[iii], slab_test_alloc, &data[iii]), thrd_success);
+    }
+    for (int iii = 0; iii < THREADS_COUNT; ++iii) {
+      thrd_join(threads[iii], &result);
+      EXPECT_EQ(result, 0);
+    }
+
+    // free the objects from other threads than the ones allocated them
+    for (int iii = 0; iii < THREADS_COUNT; ++iii) {
+      ASSERT_EQ(thrd_create(&threads[iii], slab_test_free, &data[(iii + 1) % THREADS_COUNT]), thrd_success);
+    }
+    for (int iii = 0; iii < THREADS_COUNT; ++iii) {
+      thrd_join(threads[iii], &result);
+      EXPECT_EQ(result, 0);
+    }
+  }
+
+  c_allocator_slab_destroy(a);
+}
+
+UTEST(CAllocator, concurrent_arena_general)
+{
+  CAllocator* a = c_allocator_concurrent_arena_create(1 << 20);
+  ASSERT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  char* mem1 = c_allocator_alloc(a, 100, 1, false);
+  char* mem2 = c_allocator_alloc(a, 100, 1, false);
+  ASSERT_TRUE(mem1 && mem2);
+
+  // only the last allocation grows in place or rolls back
+  EXPECT_EQ(c_allocator_resize(a, mem2, 200), mem2);
+  EXPECT_NE(c_allocator_resize(a, mem1, 200), mem1);
+  char* mem3 = c_allocator_alloc(a, 100, 1, false);
+  c_allocator_free(a, mem3);
+  EXPECT_EQ(c_allocator_alloc(a, 100, 1, false), mem3);
+
+  // bigger than the sub-chunks
+  char* big = c_allocator_alloc(a, 131072, 64, false);
+  EXPECT_TRUE(big);
+  EXPECT_EQ((uintptr_t)big % 64, 0U);
+  EXPECT_FALSE(c_allocator_alloc(a, 1 << 20, 1, false));
+
+  c_allocator_concurrent_arena_reset(a);
+  EXPECT_TRUE(c_allocator_alloc(a, 900000, 1, false));
+
+  c_allocator_concurrent_arena_destroy(a);
+}
+
+UTEST(CAllocator, concurrent_arena_small)
+{
+  // arenas of a sub-chunk or less give all their memory
+  size_t const capacities[] = {1024, 32768, 65536};
+  for (size_t iii = 0; iii < sizeof(capacities) / sizeof(*capacities); ++iii) {
+    CAllocator* a = c_allocator_concurrent_arena_create(capacities[iii]);
+    ASSERT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+    EXPECT_TRUE(c_allocator_alloc(a, 16, 1, false));
+    c_allocator_concurrent_arena_reset(a);
+
+    size_t count = 0;
+    while (c_allocator_alloc_sized(a, 16, 16, false)) ++count;
+    EXPECT_EQ(capacities[iii] / 16, count);
+
+    c_allocator_concurrent_arena_destroy(a);
+  }
+}
+
+UTEST(CAllocator, concurrent_arena_fill)
+{
+  // the capacity isn't a multiple of the sub-chunks, the failed requests
+  // don't take any memory, so it is filled up to its last allocation
+  size_t const capacity = (size_t)131072 + 100;
+  CAllocator*  a        = c_allocator_concurrent_arena_create(capacity);
+  ASSERT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  for (size_t round = 0; round < 2; ++round) {
+    EXPECT_FALSE(c_allocator_alloc_sized(a, capacity + 64, 64, false));
+    EXPECT_FALSE(c_allocator_alloc_sized(a, 131072 + 128, 64, false));
+
+    size_t count = 0;
+    while (c_allocator_alloc_sized(a, 64, 64, false)) {
+      ++count;
+      if (count % 100 == 0) EXPECT_FALSE(c_allocator_alloc_sized(a, capacity, 1, false));
+    }
+    EXPECT_EQ(capacity / 64, count);
+    EXPECT_TRUE(c_allocator_alloc_sized(a, 32, 32, false));
+    EXPECT_FALSE(c_allocator_alloc_sized(a, 32, 32, false));
+
+    c_allocator_concurrent_arena_reset(a);
+  }
+
+  c_allocator_concurrent_arena_destroy(a);
+}
+
+enum { CONCURRENT_ARENA_TEST_OBJECTS = 2000 };
+
+typedef struct ConcurrentArenaTestData {
+  CAllocator*   allocator;
+  unsigned char id;
+  size_t        sizes[CONCURRENT_ARENA_TEST_OBJECTS];
+  char*         objects[CONCURRENT_ARENA_TEST_OBJECTS];
+} ConcurrentArenaTestData;
+
+static int concurrent_arena_test_alloc(void* arg)
+{
+  ConcurrentArenaTestData* data = arg;
+  for (size_t iii = 0; iii < CONCURRENT_ARENA_TEST_OBJECTS; ++iii) {
+    // some of them are bigger than the thread sub-chunks
+    data->sizes[iii]   = (iii % 97 == 0) ? 20000 : (iii * 7) % 300 + 1;
+    data->objects[iii] = c_allocator_alloc(data->allocator, data->sizes[iii], 1, false);
+    if (!data->objects[iii]) return 1;
+    memset(data->objects[iii], data->id, data->sizes[iii]);
+    if (iii % 10 == 0) {
+      char* grown = c_allocator_resize(data->allocator, data->objects[iii], data->sizes[iii] * 2);
+      if (!grown) return 1;
+      memset(grown, data->id, data->sizes[iii] * 2);
+      data->objects[iii] = grown;
+      data->sizes[iii] *= 2;
+    }
+  }
+  return 0;
+}
+
+UTEST(CAllocator, concurrent_arena_threads)
+{
+  enum { THREADS_COUNT = 16 };
+
+  CAllocator* a = c_allocator_concurrent_arena_create((size_t)256 << 20);
+  ASSERT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  static ConcurrentArenaTestData data[THREADS_COUNT];
+  thrd_t                         threads[THREADS_COUNT];
+  int                            result;
+
+  for (int round = 0; round < 2; ++round) {
+    for (int iii = 0; iii < THREADS_COUNT; ++iii) {
+      data[iii].allocator = a;
+      data[iii].id        = (unsigned char)(iii + 1);
+      ASSERT_EQ(thrd_create(&threads[iii], concurrent_arena_test_alloc, &data[iii]), thrd_success);
+    }
+    for (int iii = 0; iii < THREADS_COUNT; ++iii) {
+      thrd_join(threads[iii], &result);
+      EXPECT_EQ(result, 0);
+    }
+
+    // overlapping allocations would overwrite each other
+    for (int iii = 0; iii < THREADS_COUNT; ++iii) {
+      for (size_t jjj = 0; jjj < CONCURRENT_ARENA_TEST_OBJECTS; ++jjj) {
+        for (size_t kkk = 0; kkk < data[iii].sizes[jjj]; ++kkk) {
+          if ((unsigned char)data[iii].objects[jjj][kkk] != data[iii].id) {
+            ASSERT_TRUE_MSG(false, "overlapping allocations");
+          }
+        }
+      }
+    }
+
+    c_allocator_concurrent_arena_reset(a);
+  }
+
+  c_allocator_concurrent_arena_destroy(a);
+}
+
+UTEST(CAllocator, sized)
+{
+  // no header, the objects are packed
+  CAllocator* arena = c_allocator_arena_create(1024);
+  ASSERT_TRUE_MSG(arena, c_error_to_str(c_error_get()));
+  char* mem1 = c_allocator_alloc_sized(arena, 16, 8, false);
+  char* mem2 = c_allocator_alloc_sized(arena, 16, 8, false);
+  EXPECT_TRUE(mem1 && mem2);
+  EXPECT_EQ(mem2 - mem1, 16);
+
+  mem2 = c_allocator_resize_sized(arena, mem2, 16, 64, 8);
+  EXPECT_EQ(mem2 - mem1, 16);
+  c_allocator_free_sized(arena, mem2, 64, 8);
+  EXPECT_EQ(c_allocator_alloc_sized(arena, 4, 4, false), mem2);
+  c_allocator_arena_destroy(arena);
+
+  CAllocator* allocators[] = {c_allocator_default(), c_allocator_pool_create(24, 8, 16), c_allocator_slab_create()};
+  for (size_t iii = 0; iii < sizeof(allocators) / sizeof(*allocators); ++iii) {
+    CAllocator* a = allocators[iii];
+    ASSERT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+    int* mem = c_allocator_alloc_sized(a, c_allocator_alignas(int, 6), true);
+    ASSERT_TRUE(mem);
+    EXPECT_EQ(mem[5], 0);
+    mem[5] = 5;
+    mem    = c_allocator_resize_sized(a, mem, sizeof(int) * 6, sizeof(int) * 1000, alignof(int));
+    ASSERT_TRUE(mem);
+    EXPECT_EQ(mem[5], 5);
+    mem[999] = 999;
+    c_allocator_free_sized(a, mem, c_allocator_alignas(int, 1000));
+  }
+  c_allocator_pool_destroy(allocators[1]);
+  c_allocator_slab_destroy(allocators[2]);
+}
+
+UTEST(CAllocator, stats)
+{
+  CAllocator* a = c_allocator_arena_create_growable(64);
+  EXPECT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  CAllocatorStats stats;
+#ifdef ANYLIBS_ENABLE_ALLOCATOR_STATS
+  void* mem1 = c_allocator_alloc(a, 100, 1, false);
+  void* mem2 = c_allocator_alloc(a, 10, 1, false);
+  EXPECT_TRUE(mem1 && mem2);
+  // mem1 is not the last allocation, it has to be copied
+  mem1 = c_allocator_resize(a, mem1, 200);
+  EXPECT_TRUE(mem1);
+  c_allocator_free(a, mem2);
+
+  EXPECT_TRUE(c_allocator_stats(a, &stats));
+  EXPECT_EQ(stats.live_bytes, 200U);
+  EXPECT_EQ(stats.peak_bytes, 210U);
+  EXPECT_EQ(stats.alloc_count, 2U);
+  EXPECT_EQ(stats.resize_count, 1U);
+  EXPECT_EQ(stats.free_count, 1U);
+  EXPECT_TRUE(stats.resize_copied_bytes >= 100U);
+  EXPECT_EQ(stats.size_classes[6], 1U); // 100 in [64, 128)
+  EXPECT_EQ(stats.size_classes[3], 1U); // 10 in [8, 16)
+#else
+  EXPECT_FALSE(c_allocator_stats(a, &stats));
+#endif
+
+  c_allocator_arena_destroy(a);
+}
+
+UTEST(CAllocator, stats_arena_reset)
+{
+  CAllocator* a = c_allocator_arena_create_growable(256);
+  CAllocator* c = c_allocator_concurrent_arena_create(1 << 16);
+  EXPECT_TRUE_MSG(a && c, c_error_to_str(c_error_get()));
+
+  CAllocatorStats stats;
+#ifdef ANYLIBS_ENABLE_ALLOCATOR_STATS
+  // a rewind drops the allocations done after the mark
+  for (size_t iii = 0; iii < 4; ++iii) EXPECT_TRUE(c_allocator_alloc(a, 100, 1, false));
+  CAllocatorArenaMark mark = c_allocator_arena_mark(a);
+  for (size_t iii = 0; iii < 6; ++iii) EXPECT_TRUE(c_allocator_alloc(a, 100, 1, false));
+  c_allocator_arena_rewind_to_mark(a, mark);
+
+  EXPECT_TRUE(c_allocator_stats(a, &stats));
+  EXPECT_EQ(stats.live_bytes, 400U);
+  EXPECT_EQ(stats.peak_bytes, 1000U);
+  EXPECT_EQ(stats.alloc_count, 10U);
+  EXPECT_EQ(stats.free_count, 6U);
+
+  // a reset drops all of them
+  c_allocator_arena_reset(a);
+  EXPECT_TRUE(c_allocator_stats(a, &stats));
+  EXPECT_EQ(stats.live_bytes, 0U);
+  EXPECT_EQ(stats.alloc_count, 10U);
+  EXPECT_EQ(stats.free_count, 10U);
+
+  EXPECT_TRUE(c_allocator_alloc(a, 50, 1, false));
+  EXPECT_TRUE(c_allocator_stats(a, &stats));
+  EXPECT_EQ(stats.live_bytes, 50U);
+  EXPECT_EQ(stats.peak_bytes, 1000U);
+
+  for (size_t iii = 0; iii < 10; ++iii) EXPECT_TRUE(c_allocator_alloc_sized(c, 64, 64, false));
+  c_allocator_concurrent_arena_reset(c);
+  EXPECT_TRUE(c_allocator_stats(c, &stats));
+  EXPECT_EQ(stats.live_bytes, 0U);
+  EXPECT_EQ(stats.alloc_count, 10U);
+  EXPECT_EQ(stats.free_count, 10U);
+#else
+  EXPECT_FALSE(c_allocator_stats(a, &stats));
+#endif
+
+  c_allocator_concurrent_arena_destroy(c);
+  c_allocator_arena_destroy(a);
+}
+
+UTEST(CAllocator, stats_fixed_buffer)
+{
+  _Alignas(max_align_t) char buffer[1024];
+  CAllocator*                a = c_allocator_fixed_buffer_create(buffer, sizeof(buffer));
+  EXPECT_TRUE_MSG(a, c_error_to_str(c_error_get()));
+
+  CAllocatorStats stats;
+#ifdef ANYLIBS_ENABLE_ALLOCATOR_STATS
+  // a new allocator starts from zero
+  EXPECT_TRUE(c_allocator_stats(a, &stats));
+  EXPECT_EQ(stats.live_bytes, 0U);
+  EXPECT_EQ(stats.peak_bytes, 0U);
+  EXPECT_EQ(stats.alloc_count, 0U);
+  EXPECT_EQ(stats.free_count, 0U);
+
+  void* mem1 = c_allocator_alloc(a, 100, 1, false);
+  void* mem2 = c_allocator_alloc_sized(a, 16, 16, false);
+  EXPECT_TRUE(mem1 && mem2);
+  c_allocator_free_sized(a, mem2, 16, 16);
+
+  EXPECT_TRUE(c_allocator_stats(a, &stats));
+  EXPECT_EQ(stats.live_bytes, 100U);
+  EXPECT_EQ(stats.peak_bytes, 116U);
+  EXPECT_EQ(stats.alloc_count, 2U);
+  EXPECT_EQ(stats.free_count, 1U);
+#else
+  EXPECT_FALSE(c_allocator_stats(a, &stats));
+#endif
+
+  c_allocator_fixed_buffer_destroy(a);
+}
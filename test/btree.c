@@ -0,0 +1,300 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "anylibs/btree.h"
+
+#include <utest.h>
+
+static int  cmp_u64(void const* a, void const* b);
+static int  cmp_str(void const* a, void const* b);
+static bool is_sorted(CBTreeMap* map, CVecCompareFn cmp);
+static void count_element(void* key, void* value, void* user_data);
+
+UTEST(CBTreeMap, general)
+{
+  size_t const count = 20000;
+
+  CBTreeMap* map = c_btree_map_create(sizeof(uint64_t), sizeof(uint64_t), cmp_u64, NULL);
+  ASSERT_TRUE(map);
+  EXPECT_TRUE(c_btree_map_is_empty(map));
+  EXPECT_FALSE(c_btree_map_first(map, NULL, NULL));
+
+  // the keys in a shuffled order (7919 is coprime with count)
+  for (uint64_t iii = 0; iii < count; ++iii) {
+    uint64_t key = (iii * 7919) % count;
+    ASSERT_TRUE(c_btree_map_insert(map, &key, &(uint64_t){key * 2}));
+  }
+  EXPECT_EQ(c_btree_map_len(map), count);
+  EXPECT_TRUE(is_sorted(map, cmp_u64));
+
+  for (uint64_t key = 0; key < count; ++key) {
+    uint64_t* value = NULL;
+    EXPECT_TRUE(c_btree_map_get(map, &key, (void**)&value));
+    ASSERT_TRUE(value);
+    EXPECT_EQ(*value, key * 2);
+  }
+  uint64_t* value = NULL;
+  EXPECT_TRUE(c_btree_map_get(map, &(uint64_t){count}, (void**)&value));
+  EXPECT_TRUE(value == NULL);
+  EXPECT_FALSE(c_btree_map_has_key(map, &(uint64_t){count}));
+
+  // update
+  EXPECT_TRUE(c_btree_map_insert(map, &(uint64_t){5}, &(uint64_t){500}));
+  EXPECT_EQ(c_btree_map_len(map), count);
+  EXPECT_TRUE(c_btree_map_get(map, &(uint64_t){5}, (void**)&value));
+  EXPECT_EQ(*value, 500U);
+
+  uint64_t* key = NULL;
+  EXPECT_TRUE(c_btree_map_first(map, (void**)&key, (void**)&value));
+  EXPECT_EQ(*key, 0U);
+  EXPECT_TRUE(c_btree_map_last(map, (void**)&key, (void**)&value));
+  EXPECT_EQ(*key, count - 1);
+  EXPECT_EQ(*value, (count - 1) * 2);
+
+  // remove the odd keys, then the others in a shuffled order
+  for (uint64_t iii = 1; iii < count; iii += 2) {
+    EXPECT_TRUE(c_btree_map_remove(map, &iii, (void**)&key, (void**)&value));
+    EXPECT_EQ(*key, iii);
+    EXPECT_EQ(*value, (iii == 5) ? 500 : iii * 2);
+  }
+  EXPECT_FALSE(c_btree_map_remove(map, &(uint64_t){1}, NULL, NULL));
+  EXPECT_EQ(c_btree_map_len(map), count / 2);
+  EXPECT_TRUE(is_sorted(map, cmp_u64));
+  for (uint64_t iii = 0; iii < count; ++iii) {
+    EXPECT_EQ(c_btree_map_has_key(map, &iii), iii % 2 == 0);
+  }
+
+  for (uint64_t iii = 0; iii < count; ++iii) {
+    uint64_t removed = (iii * 7919) % count;
+    EXPECT_EQ(c_btree_map_remove(map, &removed, NULL, NULL), removed % 2 == 0);
+    if (iii % 1000 == 0) EXPECT_TRUE(is_sorted(map, cmp_u64));
+  }
+  EXPECT_TRUE(c_btree_map_is_empty(map));
+  CBTreeMapIter iter = c_btree_map_iter(map);
+  EXPECT_FALSE(c_btree_map_iter_next(&iter, NULL, NULL));
+
+  // the map is still usable
+  for (uint64_t iii = 0; iii < 1000; ++iii) {
+    EXPECT_TRUE(c_btree_map_insert(map, &iii, &iii));
+  }
+  size_t destroyed = 0;
+  c_btree_map_clear(map, count_element, &destroyed);
+  EXPECT_EQ(destroyed, 1000U);
+  EXPECT_TRUE(c_btree_map_is_empty(map));
+  EXPECT_TRUE(c_btree_map_insert(map, &(uint64_t){1}, &(uint64_t){2}));
+  EXPECT_EQ(c_btree_map_len(map), 1U);
+
+  destroyed = 0;
+  c_btree_map_destroy(map, count_element, &destroyed);
+  EXPECT_EQ(destroyed, 1U);
+
+  EXPECT_TRUE(c_btree_map_create(sizeof(uint64_t), sizeof(uint64_t), NULL, NULL) == NULL);
+  EXPECT_TRUE(c_btree_map_create(0, sizeof(uint64_t), cmp_u64, NULL) == NULL);
+}
+
+UTEST(CBTreeMap, bounds)
+{
+  CBTreeMap* map = c_btree_map_create(sizeof(uint64_t), sizeof(uint64_t), cmp_u64, NULL);
+  ASSERT_TRUE(map);
+
+  // 0, 10, 20, ..., 9990 (appended)
+  for (uint64_t key = 0; key < 10000; key += 10) {
+    ASSERT_TRUE(c_btree_map_insert(map, &key, &(uint64_t){key + 1}));
+  }
+
+  uint64_t*     key;
+  uint64_t*     value;
+  CBTreeMapIter iter = c_btree_map_lower_bound(map, &(uint64_t){50});
+  EXPECT_TRUE(c_btree_map_iter_next(&iter, (void**)&key, (void**)&value));
+  EXPECT_EQ(*key, 50U);
+  EXPECT_EQ(*value, 51U);
+  iter = c_btree_map_lower_bound(map, &(uint64_t){51});
+  EXPECT_TRUE(c_btree_map_iter_next(&iter, (void**)&key, NULL));
+  EXPECT_EQ(*key, 60U);
+  iter = c_btree_map_upper_bound(map, &(uint64_t){50});
+  EXPECT_TRUE(c_btree_map_iter_next(&iter, (void**)&key, NULL));
+  EXPECT_EQ(*key, 60U);
+  iter = c_btree_map_upper_bound(map, &(uint64_t){9990});
+  EXPECT_FALSE(c_btree_map_iter_next(&iter, (void**)&key, NULL));
+  iter = c_btree_map_lower_bound(map, &(uint64_t){20000});
+  EXPECT_FALSE(c_btree_map_iter_next(&iter, (void**)&key, NULL));
+
+  // [from, to) over many leaves
+  size_t   len      = 0;
+  uint64_t expected = 1230;
+  iter              = c_btree_map_range(map, &(uint64_t){1225}, &(uint64_t){8000});
+  while (c_btree_map_iter_next(&iter, (void**)&key, (void**)&value)) {
+    EXPECT_EQ(*key, expected);
+    EXPECT_EQ(*value, expected + 1);
+    expected += 10;
+    ++len;
+  }
+  EXPECT_EQ(len, 677U);
+
+  // the same range leaf by leaf
+  size_t    count;
+  uint64_t* chunk_keys;
+  uint64_t* chunk_values;
+  len      = 0;
+  expected = 1230;
+  iter     = c_btree_map_range(map, &(uint64_t){1225}, &(uint64_t){8000});
+  while (c_btree_map_iter_next_chunk(&iter, (void**)&chunk_keys, (void**)&chunk_values, &count)) {
+    EXPECT_TRUE(count > 0);
+    for (size_t iii = 0; iii < count; ++iii, expected += 10) {
+      EXPECT_EQ(chunk_keys[iii], expected);
+      EXPECT_EQ(chunk_values[iii], expected + 1);
+    }
+    len += count;
+  }
+  EXPECT_EQ(len, 677U);
+
+  // open ranges and empty ones
+  len  = 0;
+  iter = c_btree_map_range(map, NULL, &(uint64_t){100});
+  while (c_btree_map_iter_next(&iter, NULL, NULL)) ++len;
+  EXPECT_EQ(len, 10U);
+  len  = 0;
+  iter = c_btree_map_range(map, &(uint64_t){9900}, NULL);
+  while (c_btree_map_iter_next(&iter, NULL, NULL)) ++len;
+  EXPECT_EQ(len, 10U);
+  iter = c_btree_map_range(map, &(uint64_t){501}, &(uint64_t){509});
+  EXPECT_FALSE(c_btree_map_iter_next(&iter, NULL, NULL));
+  iter = c_btree_map_range(map, &(uint64_t){600}, &(uint64_t){500});
+  EXPECT_FALSE(c_btree_map_iter_next(&iter, NULL, NULL));
+
+  c_btree_map_destroy(map, NULL, NULL);
+}
+
+UTEST(CBTreeMap, create_from_sorted)
+{
+  // sizes around the node capacities, up to a few levels
+  size_t const sizes[] = {0, 1, 2, 15, 16, 30, 31, 32, 33, 46, 47, 62, 63, 200, 961, 962, 977, 29791, 29792, 100000};
+  for (size_t sss = 0; sss < sizeof(sizes) / sizeof(*sizes); ++sss) {
+    size_t const count  = sizes[sss];
+    CVec*        keys   = c_vec_create(sizeof(uint64_t), NULL);
+    CVec*        values = c_vec_create(sizeof(uint64_t), NULL);
+    ASSERT_TRUE(keys && values);
+    for (uint64_t iii = 0; iii < count; ++iii) {
+      ASSERT_TRUE(c_vec_push(keys, &(uint64_t){iii * 2}));
+      ASSERT_TRUE(c_vec_push(values, &(uint64_t){iii}));
+    }
+
+    CBTreeMap* map = c_btree_map_create_from_sorted(keys, values, cmp_u64, NULL);
+    ASSERT_TRUE(map);
+    EXPECT_EQ(c_btree_map_len(map), count);
+    EXPECT_TRUE(is_sorted(map, cmp_u64));
+    for (uint64_t iii = 0; iii < count; ++iii) {
+      uint64_t* value = NULL;
+      EXPECT_TRUE(c_btree_map_get(map, &(uint64_t){iii * 2}, (void**)&value));
+      ASSERT_TRUE(value);
+      EXPECT_EQ(*value, iii);
+    }
+
+    // the loaded tree takes inserts (between the keys) and removes
+    for (uint64_t iii = 0; iii < count; ++iii) {
+      EXPECT_TRUE(c_btree_map_insert(map, &(uint64_t){(iii * 2) + 1}, &iii));
+    }
+    EXPECT_EQ(c_btree_map_len(map), count * 2);
+    EXPECT_TRUE(is_sorted(map, cmp_u64));
+    for (uint64_t iii = 0; iii < count * 2; ++iii) {
+      EXPECT_TRUE(c_btree_map_remove(map, &iii, NULL, NULL));
+    }
+    EXPECT_TRUE(c_btree_map_is_empty(map));
+
+    c_btree_map_destroy(map, NULL, NULL);
+    c_vec_destroy(keys);
+    c_vec_destroy(values);
+  }
+
+  // a key that repeats takes its last value
+  CVec* keys   = c_vec_create_from_raw((uint64_t[]){1, 2, 2, 2, 3}, 5, sizeof(uint64_t), true, NULL);
+  CVec* values = c_vec_create_from_raw((uint64_t[]){10, 20, 21, 22, 30}, 5, sizeof(uint64_t), true, NULL);
+  ASSERT_TRUE(keys && values);
+  CBTreeMap* map = c_btree_map_create_from_sorted(keys, values, cmp_u64, NULL);
+  ASSERT_TRUE(map);
+  EXPECT_EQ(c_btree_map_len(map), 3U);
+  uint64_t* value = NULL;
+  EXPECT_TRUE(c_btree_map_get(map, &(uint64_t){2}, (void**)&value));
+  EXPECT_EQ(*value, 22U);
+  c_btree_map_destroy(map, NULL, NULL);
+
+  // the keys must be sorted, and as many as the values
+  EXPECT_TRUE(c_vec_push(keys, &(uint64_t){0}));
+  EXPECT_TRUE(c_btree_map_create_from_sorted(keys, values, cmp_u64, NULL) == NULL);
+  EXPECT_TRUE(c_vec_push(values, &(uint64_t){0}));
+  EXPECT_TRUE(c_btree_map_create_from_sorted(keys, values, cmp_u64, NULL) == NULL);
+
+  c_vec_destroy(keys);
+  c_vec_destroy(values);
+}
+
+UTEST(CBTreeMap, big_keys)
+{
+  // a set of strings (4 keys per node)
+  CBTreeMap* set = c_btree_map_create(sizeof(char[100]), 0, cmp_str, NULL);
+  ASSERT_TRUE(set);
+
+  char key[100] = {0};
+  for (size_t iii = 0; iii < 2000; ++iii) {
+    snprintf(key, sizeof(key), "key %05zu", (iii * 337) % 2000);
+    ASSERT_TRUE(c_btree_map_insert(set, key, NULL));
+  }
+  EXPECT_EQ(c_btree_map_len(set), 2000U);
+  EXPECT_TRUE(is_sorted(set, cmp_str));
+
+  size_t        len  = 0;
+  char*         item = NULL;
+  CBTreeMapIter iter = c_btree_map_range(set, "key 00100", "key 00200");
+  while (c_btree_map_iter_next(&iter, (void**)&item, NULL)) {
+    snprintf(key, sizeof(key), "key %05zu", 100 + len++);
+    EXPECT_STREQ(item, key);
+  }
+  EXPECT_EQ(len, 100U);
+
+  for (size_t iii = 0; iii < 2000; iii += 3) {
+    snprintf(key, sizeof(key), "key %05zu", iii);
+    EXPECT_TRUE(c_btree_map_remove(set, key, (void**)&item, NULL));
+    EXPECT_STREQ(item, key);
+  }
+  EXPECT_EQ(c_btree_map_len(set), 1333U);
+  EXPECT_TRUE(is_sorted(set, cmp_str));
+
+  c_btree_map_destroy(set, NULL, NULL);
+}
+
+/******************************************************************************/
+
+int cmp_u64(void const* a, void const* b)
+{
+  uint64_t const x = *(uint64_t const*)a;
+  uint64_t const y = *(uint64_t const*)b;
+  return (x > y) - (x < y);
+}
+
+int cmp_str(void const* a, void const* b)
+{
+  return strcmp(a, b);
+}
+
+/// @brief the keys are in a strictly increasing order and there are len of them
+bool is_sorted(CBTreeMap* map, CVecCompareFn cmp)
+{
+  size_t        len  = 0;
+  void*         prev = NULL;
+  void*         key;
+  CBTreeMapIter iter = c_btree_map_iter(map);
+  while (c_btree_map_iter_next(&iter, &key, NULL)) {
+    if (prev && (cmp(prev, key) >= 0)) return false;
+    prev = key;
+    ++len;
+  }
+  return len == c_btree_map_len(map);
+}
+
+void count_element(void* key, void* value, void* user_data)
+{
+  (void)key;
+  (void)value;
+  ++*(size_t*)user_data;
+}
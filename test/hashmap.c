@@ -1,5 +1,9 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
 
+#include "anylibs/fs.h"
 #include "anylibs/hashmap.h"
 
 #include <utest.h>
@@ -78,3 +82,850 @@ void c_hashmap_handler(void* key, void* value, void* extra_data)
   (void)key;
   *(int*)extra_data += *(int*)value;
 }
+
+UTEST(CHashMap, grow)
+{
+  // the map uses sized allocations, so it works with headerless memory too
+  CAllocator* arena = c_allocator_arena_create_growable(1024);
+  ASSERT_TRUE(arena);
+  CHashMap* map = c_hashmap_create(sizeof(int), sizeof(int), arena);
+  ASSERT_TRUE(map);
+
+  for (int iii = 0; iii < 1000; ++iii) {
+    EXPECT_TRUE(c_hashmap_insert(map, &iii, &(int){iii * 2}));
+  }
+  EXPECT_EQ(c_hashmap_len(map), 1000U);
+  EXPECT_TRUE(c_hashmap_capacity(map) >= 1000U);
+
+  for (int iii = 0; iii < 1000; ++iii) {
+    int* value = NULL;
+    EXPECT_TRUE(c_hashmap_get(map, &iii, (void**)&value));
+    EXPECT_TRUE(value && *value == iii * 2);
+  }
+
+  c_hashmap_destroy(map, NULL, NULL);
+  c_allocator_arena_destroy(arena);
+}
+
+UTEST(CHashMap, remove_reinsert)
+{
+  CHashMap* map = c_hashmap_create(sizeof(int), sizeof(int), NULL);
+  ASSERT_TRUE(map);
+
+  for (int round = 0; round < 3; ++round) {
+    for (int iii = 0; iii < 10000; ++iii) {
+      EXPECT_TRUE(c_hashmap_insert(map, &iii, &(int){iii + round}));
+    }
+    EXPECT_EQ(c_hashmap_len(map), 10000U);
+
+    // leave deleted slots behind
+    for (int iii = 0; iii < 10000; iii += 2) {
+      int* value = NULL;
+      EXPECT_TRUE(c_hashmap_remove(map, &iii, (void**)&value));
+      EXPECT_TRUE(value && *value == iii + round);
+    }
+    EXPECT_EQ(c_hashmap_len(map), 5000U);
+
+    for (int iii = 0; iii < 10000; ++iii) {
+      EXPECT_EQ(c_hashmap_has_key(map, &iii), iii % 2 == 1);
+    }
+
+    size_t count = 0;
+    int*   key   = NULL;
+    int*   value = NULL;
+
+    CHashMapIter iter = c_hashmap_iter(map);
+    while (c_hashmap_iter_next(&iter, (void**)&key, (void**)&value)) {
+      EXPECT_TRUE(*key % 2 == 1 && *value == *key + round);
+      count++;
+    }
+    EXPECT_EQ(count, 5000U);
+  }
+
+  int   missing = -1;
+  void* value   = NULL;
+  EXPECT_FALSE(c_hashmap_remove(map, &missing, &value));
+
+  c_hashmap_destroy(map, NULL, NULL);
+}
+
+UTEST(CHashMap, str_ptr_keys)
+{
+  // the keys are pointers, they are hashed and compared by the strings content
+  CHashMapOptions options = {.hash_fn = c_hashmap_hash_str_ptr, .eq_fn = c_hashmap_eq_str_ptr};
+  CHashMap*       map     = c_hashmap_create_ex(sizeof(char*), sizeof(int), 16, &options, NULL);
+  ASSERT_TRUE(map);
+
+  char        key1[] = "first key";
+  char        key2[] = "a longer key that needs more than one block of 48 bytes";
+  char const* key    = key1;
+  EXPECT_TRUE(c_hashmap_insert(map, &key, &(int){1}));
+  key = key2;
+  EXPECT_TRUE(c_hashmap_insert(map, &key, &(int){2}));
+
+  int* value = NULL;
+  key        = "first key";
+  EXPECT_TRUE(c_hashmap_get(map, &key, (void**)&value));
+  EXPECT_TRUE(value && *value == 1);
+  key = "a longer key that needs more than one block of 48 bytes";
+  EXPECT_TRUE(c_hashmap_get(map, &key, (void**)&value));
+  EXPECT_TRUE(value && *value == 2);
+  key = "first";
+  EXPECT_TRUE(c_hashmap_get(map, &key, (void**)&value));
+  EXPECT_TRUE(!value);
+
+  c_hashmap_destroy(map, NULL, NULL);
+}
+
+static uint64_t c_hashmap_test_hash_mod(void const* key, size_t key_size, uint64_t seed)
+{
+  (void)key_size;
+  (void)seed;
+  return c_hashmap_hash_bytes(&(int){*(int const*)key % 10}, sizeof(int), 0);
+}
+
+static bool c_hashmap_test_eq_mod(void const* key1, void const* key2, size_t key_size)
+{
+  (void)key_size;
+  return *(int const*)key1 % 10 == *(int const*)key2 % 10;
+}
+
+UTEST(CHashMap, custom_hash_eq)
+{
+  // 4 bytes keys with custom callbacks don't take the specialized path
+  CHashMapOptions options = {.hash_fn = c_hashmap_test_hash_mod, .eq_fn = c_hashmap_test_eq_mod};
+  CHashMap*       map     = c_hashmap_create_ex(sizeof(int), sizeof(int), 16, &options, NULL);
+  ASSERT_TRUE(map);
+
+  for (int iii = 0; iii < 100; ++iii) {
+    EXPECT_TRUE(c_hashmap_insert(map, &iii, &iii));
+  }
+  EXPECT_EQ(c_hashmap_len(map), 10U);
+
+  int* value = NULL;
+  EXPECT_TRUE(c_hashmap_get(map, &(int){13}, (void**)&value));
+  EXPECT_TRUE(value && *value == 93);
+
+  c_hashmap_destroy(map, NULL, NULL);
+}
+
+UTEST(CHashMap, fixed_size_keys)
+{
+  typedef struct Key16 {
+    uint64_t a;
+    uint64_t b;
+  } Key16;
+
+  CHashMap* map8  = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  CHashMap* map16 = c_hashmap_create_ex(sizeof(Key16), sizeof(uint64_t), 16, &(CHashMapOptions){0}, NULL);
+  ASSERT_TRUE(map8 && map16);
+
+  for (uint64_t iii = 0; iii < 5000; ++iii) {
+    EXPECT_TRUE(c_hashmap_insert(map8, &iii, &iii));
+    EXPECT_TRUE(c_hashmap_insert(map16, &(Key16){iii, ~iii}, &iii));
+  }
+  for (uint64_t iii = 0; iii < 5000; ++iii) {
+    uint64_t* value = NULL;
+    EXPECT_TRUE(c_hashmap_get(map8, &iii, (void**)&value));
+    EXPECT_TRUE(value && *value == iii);
+    EXPECT_TRUE(c_hashmap_get(map16, &(Key16){iii, ~iii}, (void**)&value));
+    EXPECT_TRUE(value && *value == iii);
+    EXPECT_FALSE(c_hashmap_has_key(map16, &(Key16){iii, iii}));
+  }
+
+  c_hashmap_destroy(map8, NULL, NULL);
+  c_hashmap_destroy(map16, NULL, NULL);
+}
+
+UTEST(CHashMap, incremental_resize)
+{
+  CHashMapOptions options = {.incremental_resize = true};
+  CHashMap*       map     = c_hashmap_create_ex(sizeof(int), sizeof(int), 16, &options, NULL);
+  ASSERT_TRUE(map);
+
+  // the keys live in the old and the new table while they are migrated
+  for (int iii = 0; iii < 20000; ++iii) {
+    EXPECT_TRUE(c_hashmap_insert(map, &iii, &(int){iii * 3}));
+    if (iii % 3 == 0) {
+      int* value = NULL;
+      EXPECT_TRUE(c_hashmap_remove(map, &(int){iii / 2}, (void**)&value));
+      EXPECT_TRUE(value && *value == (iii / 2) * 3);
+      EXPECT_TRUE(c_hashmap_insert(map, &(int){iii / 2}, &(int){(iii / 2) * 3}));
+    }
+    if (iii % 1000 == 999) {
+      size_t count = 0;
+      int*   key   = NULL;
+      int*   value = NULL;
+
+      CHashMapIter iter = c_hashmap_iter(map);
+      while (c_hashmap_iter_next(&iter, (void**)&key, (void**)&value)) {
+        EXPECT_EQ(*value, *key * 3);
+        count++;
+      }
+      EXPECT_EQ(count, (size_t)iii + 1);
+    }
+  }
+  EXPECT_EQ(c_hashmap_len(map), 20000U);
+
+  for (int iii = 0; iii < 20000; ++iii) {
+    int* value = NULL;
+    EXPECT_TRUE(c_hashmap_get(map, &iii, (void**)&value));
+    EXPECT_TRUE(value && *value == iii * 3);
+  }
+
+  c_hashmap_destroy(map, NULL, NULL);
+}
+
+UTEST(CHashMap, split_values)
+{
+  typedef struct Value {
+    uint64_t id;
+    char     payload[120];
+  } Value;
+
+  for (int incremental = 0; incremental < 2; ++incremental) {
+    CHashMapOptions options = {.split_values = true, .incremental_resize = incremental};
+    CHashMap*       map     = c_hashmap_create_ex(3, sizeof(Value), 16, &options, NULL);
+    ASSERT_TRUE(map);
+
+    // 3 bytes keys, so the keys array is not aligned like the values
+    for (uint32_t iii = 0; iii < 5000; ++iii) {
+      Value value = {.id = iii};
+      memset(value.payload, (int)(iii & 0x7F), sizeof(value.payload));
+      EXPECT_TRUE(c_hashmap_insert(map, &iii, &value));
+    }
+    EXPECT_EQ(c_hashmap_len(map), 5000U);
+
+    for (uint32_t iii = 0; iii < 5000; iii += 2) {
+      Value* value = NULL;
+      EXPECT_TRUE(c_hashmap_remove(map, &iii, (void**)&value));
+      EXPECT_TRUE(value && value->id == iii && value->payload[119] == (char)(iii & 0x7F));
+    }
+
+    size_t   count = 0;
+    uint8_t* key   = NULL;
+    Value*   value = NULL;
+
+    CHashMapIter iter = c_hashmap_iter(map);
+    while (c_hashmap_iter_next(&iter, (void**)&key, (void**)&value)) {
+      uint32_t id = key[0] | ((uint32_t)key[1] << 8) | ((uint32_t)key[2] << 16);
+      EXPECT_EQ(value->id, (uint64_t)id);
+      EXPECT_EQ(value->payload[0], (char)(id & 0x7F));
+      count++;
+    }
+    EXPECT_EQ(count, 2500U);
+
+    for (uint32_t iii = 0; iii < 5000; ++iii) {
+      EXPECT_EQ(c_hashmap_has_key(map, &iii), (bool)(iii % 2));
+    }
+
+    c_hashmap_destroy(map, NULL, NULL);
+  }
+}
+
+UTEST(CHashMap, save_open_mmap)
+{
+  CStr path = CSTR(ANYLIBS_C_TEST_PLAYGROUND "/hashmap_snapshot");
+
+  for (int split = 0; split < 2; ++split) {
+    CHashMapOptions options = {.incremental_resize = true, .split_values = split};
+    CHashMap*       map     = c_hashmap_create_ex(sizeof(uint64_t), sizeof(uint32_t), 16, &options, NULL);
+    ASSERT_TRUE(map);
+    for (uint64_t iii = 0; iii < 3000; ++iii) {
+      EXPECT_TRUE(c_hashmap_insert(map, &iii, &(uint32_t){(uint32_t)iii * 7}));
+    }
+
+    // the pending migration is finished by the save
+    CFile* f = c_fs_file_open(path, CSTR("wb"));
+    ASSERT_TRUE(f);
+    EXPECT_TRUE(c_hashmap_save(map, f));
+    EXPECT_TRUE(c_fs_file_close(f));
+    c_hashmap_destroy(map, NULL, NULL);
+
+    CHashMap* loaded = c_hashmap_open_mmap(path, NULL, NULL);
+    ASSERT_TRUE(loaded);
+    EXPECT_EQ(c_hashmap_len(loaded), 3000U);
+
+    for (uint64_t iii = 0; iii < 4000; ++iii) {
+      uint32_t* value = NULL;
+      EXPECT_TRUE(c_hashmap_get(loaded, &iii, (void**)&value));
+      if (iii < 3000) {
+        EXPECT_TRUE(value && *value == (uint32_t)iii * 7);
+      } else {
+        EXPECT_TRUE(value == NULL);
+      }
+    }
+
+    size_t    count = 0;
+    uint64_t* key   = NULL;
+    uint32_t* value = NULL;
+
+    CHashMapIter iter = c_hashmap_iter(loaded);
+    while (c_hashmap_iter_next(&iter, (void**)&key, (void**)&value)) {
+      EXPECT_EQ(*value, (uint32_t)*key * 7);
+      count++;
+    }
+    EXPECT_EQ(count, 3000U);
+
+    // read only
+    uint64_t new_key = 5000;
+    EXPECT_FALSE(c_hashmap_insert(loaded, &new_key, &(uint32_t){1}));
+    EXPECT_FALSE(c_hashmap_remove(loaded, &(uint64_t){1}, (void**)&value));
+    EXPECT_TRUE(c_hashmap_has_key(loaded, &(uint64_t){1}));
+
+    // the hash function of the saved map is the default one
+    CHashMapOptions custom = {.hash_fn = c_hashmap_hash_str_ptr};
+    EXPECT_FALSE(c_hashmap_open_mmap(path, &custom, NULL));
+
+    c_hashmap_destroy(loaded, NULL, NULL);
+  }
+
+  // a corrupted header
+  CFile* f = c_fs_file_open(path, CSTR("r+b"));
+  ASSERT_TRUE(f);
+  EXPECT_TRUE(c_fs_file_write(f, CSTR("CHASHMAQ"), NULL));
+  EXPECT_TRUE(c_fs_file_close(f));
+  EXPECT_FALSE(c_hashmap_open_mmap(path, NULL, NULL));
+
+  EXPECT_TRUE(c_fs_delete(path));
+  EXPECT_FALSE(c_hashmap_open_mmap(path, NULL, NULL));
+}
+
+UTEST(CHashMap, batch)
+{
+  CHashMap* map = c_hashmap_create(sizeof(int), sizeof(int), NULL);
+  ASSERT_TRUE(map);
+
+  int keys[1000];
+  int values[1000];
+  for (int iii = 0; iii < 1000; ++iii) {
+    keys[iii]   = iii * 2;
+    values[iii] = iii;
+  }
+  EXPECT_TRUE(c_hashmap_insert_batch(map, keys, values, 1000));
+  EXPECT_EQ(c_hashmap_len(map), 1000U);
+  EXPECT_TRUE(c_hashmap_insert_batch(map, keys, values, 10)); // updates only
+  EXPECT_EQ(c_hashmap_len(map), 1000U);
+
+  // odd keys don't exist
+  int   lookups[1001];
+  void* found[1001];
+  for (int iii = 0; iii < 1001; ++iii) lookups[iii] = iii;
+  EXPECT_TRUE(c_hashmap_get_batch(map, lookups, 1001, found));
+  for (int iii = 0; iii < 1001; ++iii) {
+    if (iii % 2) {
+      EXPECT_TRUE(!found[iii]);
+    } else {
+      EXPECT_TRUE(found[iii] && *(int*)found[iii] == iii / 2);
+    }
+  }
+
+  c_hashmap_destroy(map, NULL, NULL);
+}
+
+UTEST(CHashMap, build_from)
+{
+  // 100000 keys, the last 10000 repeat the first ones with new values
+  enum { KEYS_COUNT = 100000, REPEATED = 10000 };
+  uint64_t* keys   = malloc(KEYS_COUNT * sizeof(uint64_t));
+  uint64_t* values = malloc(KEYS_COUNT * sizeof(uint64_t));
+  ASSERT_TRUE(keys && values);
+  for (uint64_t iii = 0; iii < KEYS_COUNT; ++iii) {
+    keys[iii]   = (iii < KEYS_COUNT - REPEATED) ? iii * 7 : (iii - (KEYS_COUNT - REPEATED)) * 7;
+    values[iii] = iii;
+  }
+
+  size_t const threads[] = {1, 4, 64};
+  for (size_t iii = 0; iii < sizeof(threads) / sizeof(*threads); ++iii) {
+    for (int split = 0; split < 2; ++split) {
+      CHashMap* map = c_hashmap_build_from(keys, values, KEYS_COUNT, sizeof(uint64_t), sizeof(uint64_t), threads[iii], &(CHashMapOptions){.split_values = split}, NULL);
+      ASSERT_TRUE(map);
+      EXPECT_EQ(c_hashmap_len(map), (size_t)(KEYS_COUNT - REPEATED));
+
+      for (uint64_t jjj = 0; jjj < KEYS_COUNT - REPEATED; ++jjj) {
+        uint64_t  key   = jjj * 7;
+        uint64_t* value = NULL;
+        EXPECT_TRUE(c_hashmap_get(map, &key, (void**)&value));
+        EXPECT_TRUE(value && *value == ((jjj < REPEATED) ? jjj + (KEYS_COUNT - REPEATED) : jjj));
+      }
+
+      // it is a normal map
+      EXPECT_TRUE(c_hashmap_insert(map, &(uint64_t){1}, &(uint64_t){1}));
+      EXPECT_EQ(c_hashmap_len(map), (size_t)(KEYS_COUNT - REPEATED + 1));
+      c_hashmap_destroy(map, NULL, NULL);
+    }
+  }
+
+  CHashMap* map = c_hashmap_build_from(NULL, NULL, 0, sizeof(uint64_t), sizeof(uint64_t), 4, NULL, NULL);
+  ASSERT_TRUE(map);
+  EXPECT_EQ(c_hashmap_len(map), 0U);
+  c_hashmap_destroy(map, NULL, NULL);
+  EXPECT_TRUE(c_hashmap_build_from(NULL, values, 10, sizeof(uint64_t), sizeof(uint64_t), 4, NULL, NULL) == NULL);
+
+  free(keys);
+  free(values);
+}
+
+UTEST(CFrozenMap, general)
+{
+  CHashMap* map = c_hashmap_create(sizeof(uint64_t), sizeof(uint32_t), NULL);
+  ASSERT_TRUE(map);
+  for (uint64_t iii = 0; iii < 10000; ++iii) {
+    uint64_t key = iii * 3;
+    EXPECT_TRUE(c_hashmap_insert(map, &key, &(uint32_t){(uint32_t)iii}));
+  }
+
+  CFrozenMap* frozen = c_hashmap_freeze(map, NULL);
+  ASSERT_TRUE(frozen);
+  c_hashmap_destroy(map, NULL, NULL);
+  EXPECT_EQ(c_frozen_map_len(frozen), 10000U);
+
+  CStr path = CSTR(ANYLIBS_C_TEST_PLAYGROUND "/frozen_map");
+  CFile* f  = c_fs_file_open(path, CSTR("wb"));
+  ASSERT_TRUE(f);
+  EXPECT_TRUE(c_frozen_map_save(frozen, f));
+  EXPECT_TRUE(c_fs_file_close(f));
+
+  CFrozenMap* loaded = c_frozen_map_open_mmap(path, NULL, NULL);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(c_frozen_map_len(loaded), 10000U);
+  EXPECT_FALSE(c_hashmap_open_mmap(path, NULL, NULL));
+
+  CFrozenMap* maps[] = {frozen, loaded};
+  for (size_t iii = 0; iii < 2; ++iii) {
+    for (uint64_t jjj = 0; jjj < 30000; ++jjj) {
+      uint32_t* value = NULL;
+      EXPECT_TRUE(c_frozen_map_get(maps[iii], &jjj, (void**)&value));
+      if (jjj % 3 == 0) {
+        EXPECT_TRUE(value && *value == jjj / 3);
+      } else {
+        EXPECT_TRUE(value == NULL);
+      }
+    }
+  }
+
+  c_frozen_map_destroy(loaded);
+  c_frozen_map_destroy(frozen);
+  EXPECT_TRUE(c_fs_delete(path));
+}
+
+UTEST(CFrozenMap, arrays)
+{
+  // small ones, every bucket count
+  for (uint32_t count = 0; count < 20; ++count) {
+    uint32_t keys[20];
+    uint16_t values[20];
+    for (uint32_t iii = 0; iii < count; ++iii) {
+      keys[iii]   = iii * 7919;
+      values[iii] = (uint16_t)iii;
+    }
+
+    CFrozenMap* frozen = c_frozen_map_create(keys, values, count, sizeof(uint32_t), sizeof(uint16_t), NULL, NULL);
+    ASSERT_TRUE(frozen);
+    EXPECT_EQ(c_frozen_map_len(frozen), (size_t)count);
+    for (uint32_t iii = 0; iii < count; ++iii) {
+      uint16_t* value = NULL;
+      EXPECT_TRUE(c_frozen_map_get(frozen, &keys[iii], (void**)&value));
+      EXPECT_TRUE(value && *value == iii);
+    }
+    uint16_t* value = NULL;
+    EXPECT_TRUE(c_frozen_map_get(frozen, &(uint32_t){1}, (void**)&value));
+    EXPECT_TRUE(value == NULL);
+    c_frozen_map_destroy(frozen);
+  }
+
+  // duplicated keys
+  uint32_t keys[]   = {1, 2, 3, 2};
+  uint32_t values[] = {1, 2, 3, 4};
+  EXPECT_FALSE(c_frozen_map_create(keys, values, 4, sizeof(uint32_t), sizeof(uint32_t), NULL, NULL));
+}
+
+UTEST(CConcurrentHashMap, general)
+{
+  EXPECT_FALSE(c_concurrent_hashmap_create(sizeof(int), sizeof(int), 3, NULL, NULL));
+
+  CConcurrentHashMap* map = c_concurrent_hashmap_create(sizeof(int), sizeof(int), 4, NULL, NULL);
+  ASSERT_TRUE(map);
+
+  for (int iii = 0; iii < 1000; ++iii) {
+    EXPECT_TRUE(c_concurrent_hashmap_insert(map, &iii, &(int){iii * 2}));
+  }
+  EXPECT_EQ(c_concurrent_hashmap_len(map), 1000U);
+
+  int value = 0;
+  EXPECT_TRUE(c_concurrent_hashmap_get(map, &(int){10}, &value));
+  EXPECT_EQ(value, 20);
+  EXPECT_FALSE(c_concurrent_hashmap_get(map, &(int){1000}, &value));
+
+  EXPECT_TRUE(c_concurrent_hashmap_remove(map, &(int){10}, &value));
+  EXPECT_EQ(value, 20);
+  EXPECT_FALSE(c_concurrent_hashmap_remove(map, &(int){10}, NULL));
+
+  bool inserted = false;
+  EXPECT_TRUE(c_concurrent_hashmap_get_or_insert(map, &(int){11}, &(int){-1}, &value, &inserted));
+  EXPECT_FALSE(inserted);
+  EXPECT_EQ(value, 22);
+  EXPECT_TRUE(c_concurrent_hashmap_get_or_insert(map, &(int){10}, &(int){-1}, &value, &inserted));
+  EXPECT_TRUE(inserted);
+  EXPECT_EQ(value, -1);
+  EXPECT_EQ(c_concurrent_hashmap_len(map), 1000U);
+
+  c_concurrent_hashmap_destroy(map, NULL, NULL);
+}
+
+enum { C_CONCURRENT_HASHMAP_TEST_THREADS = 8, C_CONCURRENT_HASHMAP_TEST_KEYS = 5000 };
+
+typedef struct CConcurrentHashMapTestArg {
+  CConcurrentHashMap* map;
+  int                 id;
+  int                 inserted_count;
+  bool                failed;
+} CConcurrentHashMapTestArg;
+
+static int c_concurrent_hashmap_test_worker(void* data)
+{
+  CConcurrentHashMapTestArg* arg = data;
+
+  // all threads race on the same keys, only one of them inserts each key
+  for (int iii = 0; iii < C_CONCURRENT_HASHMAP_TEST_KEYS; ++iii) {
+    int  value;
+    bool inserted;
+    if (!c_concurrent_hashmap_get_or_insert(arg->map, &iii, &arg->id, &value, &inserted)) arg->failed = true;
+    if (inserted) arg->inserted_count++;
+    if (inserted != (value == arg->id)) arg->failed = true;
+
+    int key = iii + (C_CONCURRENT_HASHMAP_TEST_KEYS * (arg->id + 1));
+    if (!c_concurrent_hashmap_insert(arg->map, &key, &key)) arg->failed = true;
+    if (!c_concurrent_hashmap_get(arg->map, &key, &value) || value != key) arg->failed = true;
+  }
+
+  return 0;
+}
+
+UTEST(CConcurrentHashMap, threads)
+{
+  CConcurrentHashMap* map = c_concurrent_hashmap_create(sizeof(int), sizeof(int), 0, NULL, NULL);
+  ASSERT_TRUE(map);
+
+  thrd_t                    threads[C_CONCURRENT_HASHMAP_TEST_THREADS];
+  CConcurrentHashMapTestArg args[C_CONCURRENT_HASHMAP_TEST_THREADS] = {0};
+  for (int iii = 0; iii < C_CONCURRENT_HASHMAP_TEST_THREADS; ++iii) {
+    args[iii] = (CConcurrentHashMapTestArg){.map = map, .id = iii};
+    EXPECT_EQ(thrd_create(&threads[iii], c_concurrent_hashmap_test_worker, &args[iii]), thrd_success);
+  }
+
+  int inserted_count = 0;
+  for (int iii = 0; iii < C_CONCURRENT_HASHMAP_TEST_THREADS; ++iii) {
+    thrd_join(threads[iii], NULL);
+    EXPECT_FALSE(args[iii].failed);
+    inserted_count += args[iii].inserted_count;
+  }
+  EXPECT_EQ(inserted_count, C_CONCURRENT_HASHMAP_TEST_KEYS);
+  EXPECT_EQ(c_concurrent_hashmap_len(map), (size_t)C_CONCURRENT_HASHMAP_TEST_KEYS * (C_CONCURRENT_HASHMAP_TEST_THREADS + 1));
+
+  c_concurrent_hashmap_destroy(map, NULL, NULL);
+}
+
+static void c_hashmap_test_count(void* value, bool was_present, void* user_data)
+{
+  *(int*)value += 1;
+  *(int*)user_data += !was_present;
+}
+
+UTEST(CHashMap, entry)
+{
+  CHashMap* map = c_hashmap_create(sizeof(char[20]), sizeof(int), NULL);
+  ASSERT_TRUE(map);
+
+  char const* words[] = {"one", "two", "two", "three", "three", "three"};
+
+  // counting with one probe per word
+  for (size_t iii = 0; iii < sizeof(words) / sizeof(*words); ++iii) {
+    char key[20] = {0};
+    strcpy(key, words[iii]);
+
+    int* count       = NULL;
+    bool was_present = true;
+    EXPECT_TRUE(c_hashmap_entry(map, key, (void**)&count, &was_present));
+    EXPECT_TRUE(count);
+    if (!count) break;
+    EXPECT_EQ(was_present, *count != 0);
+    *count += 1;
+  }
+  EXPECT_EQ(c_hashmap_len(map), 3U);
+
+  int* count = NULL;
+  EXPECT_TRUE(c_hashmap_get(map, (char[20]){"three"}, (void**)&count));
+  EXPECT_TRUE(count && *count == 3);
+
+  int new_keys = 0;
+  EXPECT_TRUE(c_hashmap_upsert_with(map, (char[20]){"three"}, c_hashmap_test_count, &new_keys));
+  EXPECT_TRUE(c_hashmap_upsert_with(map, (char[20]){"four"}, c_hashmap_test_count, &new_keys));
+  EXPECT_EQ(new_keys, 1);
+  EXPECT_TRUE(c_hashmap_get(map, (char[20]){"three"}, (void**)&count));
+  EXPECT_TRUE(count && *count == 4);
+  EXPECT_TRUE(c_hashmap_get(map, (char[20]){"four"}, (void**)&count));
+  EXPECT_TRUE(count && *count == 1);
+
+  c_hashmap_destroy(map, NULL, NULL);
+}
+
+UTEST(CHashMap, prehashed)
+{
+  // the same hash serves two maps with the same key type (and seed)
+  CHashMapOptions options = {.seed = 42};
+  CHashMap*       map1    = c_hashmap_create_ex(sizeof(uint64_t), sizeof(int), 16, &options, NULL);
+  CHashMap*       map2    = c_hashmap_create_ex(sizeof(uint64_t), sizeof(int), 16, &options, NULL);
+  ASSERT_TRUE(map1 && map2);
+
+  for (uint64_t key = 0; key < 1000; ++key) {
+    uint64_t hash = c_hashmap_hash(map1, &key);
+    EXPECT_EQ(hash, c_hashmap_hash(map2, &key));
+    EXPECT_TRUE(c_hashmap_insert_prehashed(map1, &key, &(int){1}, hash));
+    EXPECT_TRUE(c_hashmap_insert_prehashed(map2, &key, &(int){2}, hash));
+  }
+
+  for (uint64_t key = 0; key < 1000; ++key) {
+    uint64_t hash  = c_hashmap_hash(map1, &key);
+    int*     value = NULL;
+    EXPECT_TRUE(c_hashmap_get_prehashed(map1, &key, hash, (void**)&value));
+    EXPECT_TRUE(value && *value == 1);
+    EXPECT_TRUE(c_hashmap_get(map2, &key, (void**)&value)); // the same as the normal functions
+    EXPECT_TRUE(value && *value == 2);
+    EXPECT_TRUE(c_hashmap_remove_prehashed(map2, &key, hash, (void**)&value));
+    EXPECT_TRUE(value && *value == 2);
+  }
+  EXPECT_EQ(c_hashmap_len(map1), 1000U);
+  EXPECT_EQ(c_hashmap_len(map2), 0U);
+
+  c_hashmap_destroy(map1, NULL, NULL);
+  c_hashmap_destroy(map2, NULL, NULL);
+}
+
+/// all the keys collide with the seed 42 (like keys crafted for a known seed)
+static uint64_t c_hashmap_test_hash_weak_seed(void const* key, size_t key_size, uint64_t seed)
+{
+  return seed == 42 ? 0 : c_hashmap_hash_bytes(key, key_size, seed);
+}
+
+UTEST(CHashMap, seed)
+{
+  // [1] a random seed for each map, or a fixed one
+  CHashMap* map1 = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  CHashMap* map2 = c_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), NULL);
+  ASSERT_TRUE(map1 && map2);
+  uint64_t key = 1;
+  EXPECT_NE(c_hashmap_seed(map1), c_hashmap_seed(map2));
+  EXPECT_NE(c_hashmap_hash(map1, &key), c_hashmap_hash(map2, &key));
+  c_hashmap_destroy(map1, NULL, NULL);
+  c_hashmap_destroy(map2, NULL, NULL);
+
+  CHashMapOptions options = {.hash_fn = c_hashmap_hash_siphash, .seed = 7};
+  CHashMap*       map     = c_hashmap_create_ex(sizeof(uint64_t), sizeof(uint64_t), 16, &options, NULL);
+  ASSERT_TRUE(map);
+  EXPECT_EQ(c_hashmap_seed(map), 7U);
+  EXPECT_EQ(c_hashmap_hash(map, &key), c_hashmap_hash_siphash(&key, sizeof(key), 7));
+  EXPECT_NE(c_hashmap_hash_siphash(&key, sizeof(key), 7), c_hashmap_hash_siphash(&key, sizeof(key), 8));
+  for (uint64_t iii = 0; iii < 1000; ++iii) EXPECT_TRUE(c_hashmap_insert(map, &iii, &iii));
+  for (uint64_t iii = 0; iii < 1000; ++iii) {
+    uint64_t* value = NULL;
+    EXPECT_TRUE(c_hashmap_get(map, &iii, (void**)&value));
+    EXPECT_TRUE(value && *value == iii);
+  }
+  c_hashmap_destroy(map, NULL, NULL);
+
+  // [2] colliding keys make the map reseed, with all kinds of inserts
+  for (int incremental = 0; incremental < 2; ++incremental) {
+    options = (CHashMapOptions){.hash_fn = c_hashmap_test_hash_weak_seed, .seed = 42, .incremental_resize = incremental};
+    map     = c_hashmap_create_ex(sizeof(uint64_t), sizeof(uint64_t), 16, &options, NULL);
+    ASSERT_TRUE(map);
+
+    uint64_t keys[1000];
+    for (uint64_t iii = 0; iii < 1000; ++iii) keys[iii] = iii + 3000;
+    for (uint64_t iii = 0; iii < 1000; ++iii) EXPECT_TRUE(c_hashmap_insert(map, &iii, &iii));
+    EXPECT_NE(c_hashmap_seed(map), 42U);
+    for (uint64_t iii = 1000; iii < 2000; ++iii) EXPECT_TRUE(c_hashmap_insert_prehashed(map, &iii, &iii, c_hashmap_hash(map, &iii)));
+    EXPECT_TRUE(c_hashmap_insert_batch(map, keys, keys, 1000));
+
+    EXPECT_EQ(c_hashmap_len(map), 3000U);
+    for (uint64_t iii = 0; iii < 2000; ++iii) {
+      uint64_t* value = NULL;
+      EXPECT_TRUE(c_hashmap_get(map, &iii, (void**)&value));
+      EXPECT_TRUE(value && *value == iii);
+    }
+    void* values[1000];
+    EXPECT_TRUE(c_hashmap_get_batch(map, keys, 1000, values));
+    for (size_t iii = 0; iii < 1000; ++iii) EXPECT_TRUE(values[iii] && *(uint64_t*)values[iii] == keys[iii]);
+    c_hashmap_destroy(map, NULL, NULL);
+  }
+
+  // [3] a shard that reseeds itself
+  options                = (CHashMapOptions){.hash_fn = c_hashmap_test_hash_weak_seed, .seed = 42};
+  CConcurrentHashMap* cm = c_concurrent_hashmap_create(sizeof(uint64_t), sizeof(uint64_t), 4, &options, NULL);
+  ASSERT_TRUE(cm);
+  for (uint64_t iii = 0; iii < 1000; ++iii) EXPECT_TRUE(c_concurrent_hashmap_insert(cm, &iii, &iii));
+  for (uint64_t iii = 0; iii < 1000; ++iii) {
+    uint64_t value = 0;
+    EXPECT_TRUE(c_concurrent_hashmap_get(cm, &iii, &value));
+    EXPECT_EQ(value, iii);
+    EXPECT_TRUE(c_concurrent_hashmap_get_or_insert(cm, &iii, &(uint64_t){0}, &value, NULL));
+    EXPECT_EQ(value, iii);
+  }
+  EXPECT_EQ(c_concurrent_hashmap_len(cm), 1000U);
+  for (uint64_t iii = 0; iii < 1000; ++iii) EXPECT_TRUE(c_concurrent_hashmap_remove(cm, &iii, NULL));
+  EXPECT_EQ(c_concurrent_hashmap_len(cm), 0U);
+  c_concurrent_hashmap_destroy(cm, NULL, NULL);
+}
+
+UTEST(CStrHashMap, general)
+{
+  CStrHashMap* map = c_str_hashmap_create(sizeof(int), NULL);
+  ASSERT_TRUE(map);
+
+  // short keys are inline, long ones are copied to the arena
+  char long_key[] = "x-forwarded-for-a-very-long-header-name";
+  EXPECT_TRUE(c_str_hashmap_insert(map, CSTR("host"), &(int){1}));
+  EXPECT_TRUE(c_str_hashmap_insert(map, CSTR(""), &(int){2}));
+  EXPECT_TRUE(c_str_hashmap_insert(map, (CStr){long_key, sizeof(long_key) - 1}, &(int){3}));
+  EXPECT_TRUE(c_str_hashmap_insert(map, CSTR("host"), &(int){4}));
+  EXPECT_EQ(c_str_hashmap_len(map), 3U);
+  long_key[0] = 'y'; // the map has its own copy
+
+  int* value = NULL;
+  EXPECT_TRUE(c_str_hashmap_get(map, CSTR("host"), (void**)&value));
+  EXPECT_TRUE(value && *value == 4);
+  EXPECT_TRUE(c_str_hashmap_get(map, CSTR(""), (void**)&value));
+  EXPECT_TRUE(value && *value == 2);
+  EXPECT_TRUE(c_str_hashmap_get(map, CSTR("x-forwarded-for-a-very-long-header-name"), (void**)&value));
+  EXPECT_TRUE(value && *value == 3);
+  EXPECT_TRUE(c_str_hashmap_get(map, (CStr){long_key, sizeof(long_key) - 1}, (void**)&value));
+  EXPECT_TRUE(!value);
+  EXPECT_TRUE(c_str_hashmap_get(map, CSTR("hos"), (void**)&value));
+  EXPECT_TRUE(!value);
+
+  size_t          count = 0;
+  CStr            key;
+  CStrHashMapIter iter = c_str_hashmap_iter(map);
+  while (c_str_hashmap_iter_next(&iter, &key, (void**)&value)) {
+    if (*value == 3) {
+      EXPECT_EQ(key.len, sizeof(long_key) - 1);
+      EXPECT_TRUE(memcmp(key.data, "x-forwarded-for-a-very-long-header-name", key.len) == 0);
+    }
+    count++;
+  }
+  EXPECT_EQ(count, 3U);
+
+  EXPECT_TRUE(c_str_hashmap_remove(map, CSTR("x-forwarded-for-a-very-long-header-name"), (void**)&value));
+  EXPECT_TRUE(value && *value == 3);
+  EXPECT_FALSE(c_str_hashmap_remove(map, CSTR("x-forwarded-for-a-very-long-header-name"), (void**)&value));
+
+  c_str_hashmap_destroy(map);
+}
+
+UTEST(CStrHashMap, many)
+{
+  CStrHashMap* map = c_str_hashmap_create(sizeof(size_t), NULL);
+  ASSERT_TRUE(map);
+
+  char buffer[64];
+  for (size_t iii = 0; iii < 5000; ++iii) {
+    int len = snprintf(buffer, sizeof(buffer), iii % 2 ? "tenant-%zu" : "tenant-with-a-long-prefix-%zu", iii);
+    EXPECT_TRUE(c_str_hashmap_insert(map, (CStr){buffer, (size_t)len}, &iii));
+  }
+  EXPECT_EQ(c_str_hashmap_len(map), 5000U);
+
+  for (size_t iii = 0; iii < 5000; ++iii) {
+    int     len   = snprintf(buffer, sizeof(buffer), iii % 2 ? "tenant-%zu" : "tenant-with-a-long-prefix-%zu", iii);
+    size_t* value = NULL;
+    EXPECT_TRUE(c_str_hashmap_get(map, (CStr){buffer, (size_t)len}, (void**)&value));
+    EXPECT_TRUE(value && *value == iii);
+  }
+
+  c_str_hashmap_clear(map);
+  EXPECT_EQ(c_str_hashmap_len(map), 0U);
+  c_str_hashmap_destroy(map);
+}
+
+UTEST(CHashSet, general)
+{
+  CHashSet* set = c_hashset_create(sizeof(uint32_t), NULL);
+  ASSERT_TRUE(set);
+
+  bool was_present = true;
+  for (uint32_t iii = 0; iii < 1000; ++iii) {
+    EXPECT_TRUE(c_hashset_insert(set, &iii, &was_present));
+    EXPECT_FALSE(was_present);
+  }
+  EXPECT_TRUE(c_hashset_insert(set, &(uint32_t){7}, &was_present));
+  EXPECT_TRUE(was_present);
+  EXPECT_EQ(c_hashset_len(set), 1000U);
+
+  for (uint32_t iii = 0; iii < 2000; ++iii) EXPECT_EQ(c_hashset_contains(set, &iii), iii < 1000);
+  for (uint32_t iii = 0; iii < 1000; iii += 2) EXPECT_TRUE(c_hashset_remove(set, &iii));
+  EXPECT_FALSE(c_hashset_remove(set, &(uint32_t){0}));
+  EXPECT_EQ(c_hashset_len(set), 500U);
+
+  size_t       count = 0;
+  uint32_t*    key   = NULL;
+  CHashSetIter iter  = c_hashset_iter(set);
+  while (c_hashset_iter_next(&iter, (void**)&key)) {
+    EXPECT_TRUE(*key % 2 == 1);
+    count++;
+  }
+  EXPECT_EQ(count, 500U);
+
+  c_hashset_clear(set);
+  EXPECT_EQ(c_hashset_len(set), 0U);
+  EXPECT_FALSE(c_hashset_contains(set, &(uint32_t){1}));
+  c_hashset_destroy(set);
+}
+
+UTEST(CHashSet, operations)
+{
+  // small: multiples of 3 below 300, big: even numbers below 3000 (with an
+  // incremental resize in progress, so the copy rehashes both tables)
+  CHashSet* small = c_hashset_create(sizeof(uint64_t), NULL);
+  CHashSet* big   = c_hashset_create_ex(sizeof(uint64_t), 16, &(CHashMapOptions){.incremental_resize = true}, NULL);
+  ASSERT_TRUE(small && big);
+  for (uint64_t iii = 0; iii < 300; iii += 3) EXPECT_TRUE(c_hashset_insert(small, &iii, NULL));
+  for (uint64_t iii = 0; iii < 3000; iii += 2) EXPECT_TRUE(c_hashset_insert(big, &iii, NULL));
+
+  CHashSet* sets[] = {
+      c_hashset_union(small, big),
+      c_hashset_union(big, small),
+      c_hashset_intersect(small, big),
+      c_hashset_intersect(big, small),
+      c_hashset_difference(small, big),
+      c_hashset_difference(big, small),
+  };
+  for (size_t iii = 0; iii < sizeof(sets) / sizeof(*sets); ++iii) ASSERT_TRUE(sets[iii]);
+
+  for (uint64_t key = 0; key < 3100; ++key) {
+    bool in_small = (key < 300) && (key % 3 == 0);
+    bool in_big   = (key < 3000) && (key % 2 == 0);
+    EXPECT_EQ(c_hashset_contains(sets[0], &key), in_small || in_big);
+    EXPECT_EQ(c_hashset_contains(sets[1], &key), in_small || in_big);
+    EXPECT_EQ(c_hashset_contains(sets[2], &key), in_small && in_big);
+    EXPECT_EQ(c_hashset_contains(sets[3], &key), in_small && in_big);
+    EXPECT_EQ(c_hashset_contains(sets[4], &key), in_small && !in_big);
+    EXPECT_EQ(c_hashset_contains(sets[5], &key), in_big && !in_small);
+  }
+  EXPECT_EQ(c_hashset_len(sets[0]), 1550U);
+  EXPECT_EQ(c_hashset_len(sets[2]), 50U);
+  EXPECT_EQ(c_hashset_len(sets[4]), 50U);
+  EXPECT_EQ(c_hashset_len(sets[5]), 1450U);
+
+  // the results are sets like the others
+  EXPECT_TRUE(c_hashset_insert(sets[0], &(uint64_t){5000}, NULL));
+  EXPECT_TRUE(c_hashset_contains(sets[0], &(uint64_t){5000}));
+  for (size_t iii = 0; iii < sizeof(sets) / sizeof(*sets); ++iii) c_hashset_destroy(sets[iii]);
+
+  // the keys must be comparable
+  CHashSet* other = c_hashset_create(sizeof(uint32_t), NULL);
+  ASSERT_TRUE(other);
+  EXPECT_TRUE(c_hashset_union(small, other) == NULL);
+  c_hashset_destroy(other);
+
+  c_hashset_destroy(small);
+  c_hashset_destroy(big);
+}
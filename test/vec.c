@@ -1,11 +1,19 @@
 #include "anylibs/vec.h"
 
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <utest.h>
 
 static int cmp(void const* a, void const* b);
 static int cmp_inv(void const* a, void const* b);
+static int cmp_key(void const* a, void const* b);
+static int cmp_u64(void const* a, void const* b);
+
+static uint32_t sort_key(size_t distribution, size_t index, size_t len, unsigned long long* seed);
 
 typedef struct CVecTest {
   CVec* vec;
@@ -351,6 +359,237 @@ UTEST(CVec, replace_with_larger_data)
   c_vec_destroy(vec);
 }
 
+UTEST(CVec, sort_distributions)
+{
+  size_t const sizes[]   = {4, 8, 12, 16, 24, 300};
+  size_t const lens[]    = {0, 1, 2, 23, 24, 25, 129, 1000, 10000};
+  size_t const max_len   = 10000;
+  char*        expected  = malloc(max_len * 300);
+  ASSERT_TRUE(expected);
+
+  for (size_t sss = 0; sss < sizeof(sizes) / sizeof(*sizes); ++sss) {
+    size_t const size = sizes[sss];
+    for (size_t lll = 0; lll < sizeof(lens) / sizeof(*lens); ++lll) {
+      size_t const len = lens[lll];
+      for (size_t distribution = 0; distribution < 6; ++distribution) {
+        CVec* vec = c_vec_create_with_capacity(size, len + 1, false, NULL);
+        ASSERT_TRUE(vec);
+
+        // the key is the first 4 bytes, the other bytes follow it, so the
+        // sorted elements are equal to the ones of qsort
+        unsigned long long seed = 42 + distribution;
+        for (size_t iii = 0; iii < len; ++iii) {
+          uint32_t key = sort_key(distribution, iii, len, &seed);
+          memset(expected + (iii * size), (int)(key & 0xFF), size);
+          memcpy(expected + (iii * size), &key, sizeof(key));
+          EXPECT_TRUE(c_vec_push(vec, expected + (iii * size)));
+        }
+        qsort(expected, len, size, cmp_key);
+
+        EXPECT_TRUE(c_vec_sort(vec, cmp_key));
+        EXPECT_EQ(len, c_vec_len(vec));
+        EXPECT_EQ(0, memcmp(expected, vec->data, len * size));
+
+        c_vec_destroy(vec);
+      }
+    }
+  }
+
+  free(expected);
+}
+
+UTEST(CVec, sort_typed)
+{
+  size_t const len      = 5000;
+  uint64_t*    expected = malloc(len * sizeof(*expected));
+  ASSERT_TRUE(expected);
+
+  for (size_t distribution = 0; distribution < 6; ++distribution) {
+    CVec* vec_u32 = c_vec_create_with_capacity(sizeof(uint32_t), len, false, NULL);
+    CVec* vec_u64 = c_vec_create_with_capacity(sizeof(uint64_t), len, false, NULL);
+    CVec* vec_i32 = c_vec_create_with_capacity(sizeof(int32_t), len, false, NULL);
+    CVec* vec_i64 = c_vec_create_with_capacity(sizeof(int64_t), len, false, NULL);
+    CVec* vec_f32 = c_vec_create_with_capacity(sizeof(float), len, false, NULL);
+    CVec* vec_f64 = c_vec_create_with_capacity(sizeof(double), len, false, NULL);
+    ASSERT_TRUE(vec_u32 && vec_u64 && vec_i32 && vec_i64 && vec_f32 && vec_f64);
+
+    unsigned long long seed = 7 + distribution;
+    for (size_t iii = 0; iii < len; ++iii) {
+      uint32_t key = sort_key(distribution, iii, len, &seed);
+      expected[iii] = ((uint64_t)key << 32) | key;
+      EXPECT_TRUE(c_vec_push(vec_u32, &key));
+      EXPECT_TRUE(c_vec_push(vec_u64, &expected[iii]));
+      EXPECT_TRUE(c_vec_push(vec_i32, &(int32_t){(int32_t)key - INT32_MAX / 2}));
+      EXPECT_TRUE(c_vec_push(vec_i64, &(int64_t){(int64_t)expected[iii] - INT64_MAX / 2}));
+      EXPECT_TRUE(c_vec_push(vec_f32, &(float){(float)key - 1000.0F}));
+      EXPECT_TRUE(c_vec_push(vec_f64, &(double){(double)key - 1000.0}));
+    }
+    qsort(expected, len, sizeof(*expected), cmp_u64);
+
+    EXPECT_TRUE(c_vec_sort_u32(vec_u32));
+    EXPECT_TRUE(c_vec_sort_u64(vec_u64));
+    EXPECT_TRUE(c_vec_sort_i32(vec_i32));
+    EXPECT_TRUE(c_vec_sort_i64(vec_i64));
+    EXPECT_TRUE(c_vec_sort_f32(vec_f32));
+    EXPECT_TRUE(c_vec_sort_f64(vec_f64));
+    for (size_t iii = 0; iii < len; ++iii) {
+      uint32_t key = (uint32_t)expected[iii];
+      EXPECT_EQ(key, ((uint32_t*)vec_u32->data)[iii]);
+      EXPECT_EQ(expected[iii], ((uint64_t*)vec_u64->data)[iii]);
+      EXPECT_EQ((int32_t)key - INT32_MAX / 2, ((int32_t*)vec_i32->data)[iii]);
+      EXPECT_EQ((int64_t)expected[iii] - INT64_MAX / 2, ((int64_t*)vec_i64->data)[iii]);
+      EXPECT_EQ((float)key - 1000.0F, ((float*)vec_f32->data)[iii]);
+      EXPECT_EQ((double)key - 1000.0, ((double*)vec_f64->data)[iii]);
+    }
+
+    c_vec_destroy(vec_u32);
+    c_vec_destroy(vec_u64);
+    c_vec_destroy(vec_i32);
+    c_vec_destroy(vec_i64);
+    c_vec_destroy(vec_f32);
+    c_vec_destroy(vec_f64);
+  }
+
+  free(expected);
+}
+
+UTEST(CVec, sort_typed_special)
+{
+  // NaNs go last
+  CVec* vec = c_vec_create_from_raw((double[]){3.0, NAN, -1.0, NAN, 2.0, -INFINITY, 0.5}, 7, sizeof(double), true, NULL);
+  ASSERT_TRUE(vec);
+  EXPECT_TRUE(c_vec_sort_f64(vec));
+  double const* data = vec->data;
+  EXPECT_EQ(-INFINITY, data[0]);
+  EXPECT_EQ(-1.0, data[1]);
+  EXPECT_EQ(0.5, data[2]);
+  EXPECT_EQ(2.0, data[3]);
+  EXPECT_EQ(3.0, data[4]);
+  EXPECT_TRUE(isnan(data[5]) && isnan(data[6]));
+  c_vec_destroy(vec);
+
+  // the extreme values of the signed types
+  vec = c_vec_create_from_raw((int64_t[]){0, INT64_MAX, -1, INT64_MIN, 1}, 5, sizeof(int64_t), true, NULL);
+  ASSERT_TRUE(vec);
+  EXPECT_TRUE(c_vec_sort_i64(vec));
+  EXPECT_EQ(0, memcmp(vec->data, ((int64_t[]){INT64_MIN, -1, 0, 1, INT64_MAX}), 5 * sizeof(int64_t)));
+  c_vec_destroy(vec);
+
+  // the element size must match
+  vec = c_vec_create(sizeof(uint32_t), NULL);
+  ASSERT_TRUE(vec);
+  EXPECT_FALSE(c_vec_sort_u64(vec));
+  EXPECT_FALSE(c_vec_sort_f64(vec));
+  EXPECT_TRUE(c_vec_sort_u32(vec));
+  EXPECT_TRUE(c_vec_sort_f32(vec));
+  c_vec_destroy(vec);
+}
+
+UTEST(CVec, radix_sort)
+{
+  size_t const lens[] = {0, 1, 2, 255, 256, 1000, 10000};
+  uint64_t*    expected = malloc(10000 * sizeof(*expected));
+  ASSERT_TRUE(expected);
+
+  for (size_t lll = 0; lll < sizeof(lens) / sizeof(*lens); ++lll) {
+    size_t const len = lens[lll];
+    for (size_t distribution = 0; distribution < 6; ++distribution) {
+      CVec* vec_u64 = c_vec_create_with_capacity(sizeof(uint64_t), len + 1, false, NULL);
+      CVec* vec_u32 = c_vec_create_with_capacity(sizeof(uint32_t), len + 1, false, NULL);
+      ASSERT_TRUE(vec_u64 && vec_u32);
+
+      unsigned long long seed = 3 + distribution;
+      for (size_t iii = 0; iii < len; ++iii) {
+        uint32_t key  = sort_key(distribution, iii, len, &seed);
+        expected[iii] = ((uint64_t)key << 32) | (key >> 3);
+        EXPECT_TRUE(c_vec_push(vec_u64, &expected[iii]));
+        EXPECT_TRUE(c_vec_push(vec_u32, &key));
+      }
+      qsort(expected, len, sizeof(*expected), cmp_u64);
+
+      EXPECT_TRUE(c_vec_radix_sort(vec_u64, 0, sizeof(uint64_t), C_VEC_RADIX_SORT_FLAG_unsigned));
+      EXPECT_TRUE(c_vec_radix_sort(vec_u32, 0, sizeof(uint32_t), C_VEC_RADIX_SORT_FLAG_unsigned));
+      EXPECT_EQ(0, memcmp(expected, vec_u64->data, len * sizeof(*expected)));
+      for (size_t iii = 0; iii < len; ++iii) EXPECT_EQ((uint32_t)(expected[iii] >> 32), ((uint32_t*)vec_u32->data)[iii]);
+
+      c_vec_destroy(vec_u64);
+      c_vec_destroy(vec_u32);
+    }
+  }
+
+  free(expected);
+}
+
+UTEST(CVec, radix_sort_records)
+{
+  // the key (a signed int32_t) is in the middle of 12 bytes records, the
+  // order of the equal keys (the index) is kept
+  typedef struct Record {
+    uint32_t index;
+    int32_t  key;
+    uint32_t padding;
+  } Record;
+
+  size_t const len = 5000;
+  CVec*        vec = c_vec_create_with_capacity(sizeof(Record), len, false, NULL);
+  ASSERT_TRUE(vec);
+  unsigned long long seed = 11;
+  for (size_t iii = 0; iii < len; ++iii) {
+    int32_t key = (int32_t)sort_key(3, iii, len, &seed) - 2;
+    EXPECT_TRUE(c_vec_push(vec, &(Record){(uint32_t)iii, key * 1000000, 0}));
+  }
+
+  EXPECT_TRUE(c_vec_radix_sort(vec, offsetof(Record, key), sizeof(int32_t), C_VEC_RADIX_SORT_FLAG_signed));
+  Record const* records = vec->data;
+  for (size_t iii = 1; iii < len; ++iii) {
+    EXPECT_TRUE((records[iii - 1].key < records[iii].key) || ((records[iii - 1].key == records[iii].key) && (records[iii - 1].index < records[iii].index)));
+  }
+
+  EXPECT_TRUE(c_vec_radix_sort(vec, offsetof(Record, key), sizeof(int32_t), C_VEC_RADIX_SORT_FLAG_signed | C_VEC_RADIX_SORT_FLAG_descending));
+  for (size_t iii = 1; iii < len; ++iii) {
+    EXPECT_TRUE((records[iii - 1].key > records[iii].key) || ((records[iii - 1].key == records[iii].key) && (records[iii - 1].index < records[iii].index)));
+  }
+
+  // the key must be in the record
+  EXPECT_FALSE(c_vec_radix_sort(vec, 10, sizeof(int32_t), C_VEC_RADIX_SORT_FLAG_signed));
+  EXPECT_FALSE(c_vec_radix_sort(vec, 0, 3, C_VEC_RADIX_SORT_FLAG_unsigned));
+  EXPECT_FALSE(c_vec_radix_sort(vec, 0, 2, C_VEC_RADIX_SORT_FLAG_float));
+  EXPECT_TRUE(c_vec_radix_sort(vec, 8, sizeof(uint32_t), C_VEC_RADIX_SORT_FLAG_unsigned));
+
+  c_vec_destroy(vec);
+}
+
+UTEST(CVec, radix_sort_keys)
+{
+  CVec* vec = c_vec_create_from_raw((double[]){3.0, -0.0, -1.5, INFINITY, 0.0, -INFINITY, 1e-300, -1e300}, 8, sizeof(double), true, NULL);
+  ASSERT_TRUE(vec);
+  EXPECT_TRUE(c_vec_radix_sort(vec, 0, sizeof(double), C_VEC_RADIX_SORT_FLAG_float));
+  double const expected_f64[] = {-INFINITY, -1e300, -1.5, -0.0, 0.0, 1e-300, 3.0, INFINITY};
+  EXPECT_EQ(0, memcmp(expected_f64, vec->data, sizeof(expected_f64)));
+  c_vec_destroy(vec);
+
+  vec = c_vec_create_from_raw((float[]){2.5F, -2.5F, 0.0F, -100.0F, 100.0F}, 5, sizeof(float), true, NULL);
+  ASSERT_TRUE(vec);
+  EXPECT_TRUE(c_vec_radix_sort(vec, 0, sizeof(float), C_VEC_RADIX_SORT_FLAG_float | C_VEC_RADIX_SORT_FLAG_descending));
+  float const expected_f32[] = {100.0F, 2.5F, 0.0F, -2.5F, -100.0F};
+  EXPECT_EQ(0, memcmp(expected_f32, vec->data, sizeof(expected_f32)));
+  c_vec_destroy(vec);
+
+  vec = c_vec_create_from_raw((int64_t[]){0, INT64_MAX, -1, INT64_MIN, 1, -256, 256}, 7, sizeof(int64_t), true, NULL);
+  ASSERT_TRUE(vec);
+  EXPECT_TRUE(c_vec_radix_sort(vec, 0, sizeof(int64_t), C_VEC_RADIX_SORT_FLAG_signed));
+  int64_t const expected_i64[] = {INT64_MIN, -256, -1, 0, 1, 256, INT64_MAX};
+  EXPECT_EQ(0, memcmp(expected_i64, vec->data, sizeof(expected_i64)));
+  c_vec_destroy(vec);
+
+  // the key is the second byte of 2 bytes elements
+  vec = c_vec_create_from_raw((uint8_t[]){1, 9, 2, 3, 3, 200, 4, 3}, 4, 2, true, NULL);
+  ASSERT_TRUE(vec);
+  EXPECT_TRUE(c_vec_radix_sort(vec, 1, 1, C_VEC_RADIX_SORT_FLAG_unsigned));
+  EXPECT_EQ(0, memcmp(((uint8_t[]){2, 3, 4, 3, 1, 9, 3, 200}), vec->data, 8));
+  c_vec_destroy(vec);
+}
+
 /******************************************************************************/
 
 int cmp(void const* a, void const* b)
@@ -362,3 +601,34 @@ int cmp_inv(void const* a, void const* b)
 {
   return *(int*)b - *(int*)a;
 }
+
+int cmp_key(void const* a, void const* b)
+{
+  uint32_t x, y;
+  memcpy(&x, a, sizeof(x));
+  memcpy(&y, b, sizeof(y));
+  return (x > y) - (x < y);
+}
+
+int cmp_u64(void const* a, void const* b)
+{
+  uint64_t const x = *(uint64_t const*)a;
+  uint64_t const y = *(uint64_t const*)b;
+  return (x > y) - (x < y);
+}
+
+/// @brief 0: random, 1: sorted, 2: reversed, 3: few unique, 4: organ pipe,
+///        5: sorted with a few random ones
+uint32_t sort_key(size_t distribution, size_t index, size_t len, unsigned long long* seed)
+{
+  *seed = (*seed * 6364136223846793005ULL) + 1442695040888963407ULL;
+  uint32_t const random = (uint32_t)(*seed >> 33);
+  switch (distribution) {
+    case 1: return (uint32_t)index;
+    case 2: return (uint32_t)(len - index);
+    case 3: return random % 4;
+    case 4: return (uint32_t)(index < len / 2 ? index : len - index);
+    case 5: return (random % 16 == 0) ? random : (uint32_t)index;
+    default: return random;
+  }
+}